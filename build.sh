@@ -6,10 +6,14 @@ mkdir -p ./output/bin
 # ensure shader output directories exists
 mkdir -p ./output/shader
 
-# Build and compile shaders
+# Build (shaders are embedded into qq by default) and compile loose shaders,
+# which are read only by builds configured with -DQQ_EMBED_SHADERS=OFF
 make && \
     glslc ./src/shaders/shader.vert -o ./output/shader/vert.spv && \
-    glslc ./src/shaders/shader.frag -o ./output/shader/frag.spv
+    glslc -DUSE_VERTEX_COLOR ./src/shaders/shader.vert -o ./output/shader/vert_color.spv && \
+    glslc ./src/shaders/shader.frag -o ./output/shader/frag.spv && \
+    glslc ./src/shaders/depth.vert -o ./output/shader/depth_vert.spv && \
+    glslc ./src/shaders/downsample.comp -o ./output/shader/downsample_comp.spv
 
 # Ensure models directory exists and copy textures
 mkdir -p ./output/model && \
@@ -21,4 +25,8 @@ mkdir -p ./output/texture && \
     rm -rf ./output/texture/* && \
     cp ./src/textures/* ./output/texture
 
+# Compress textures into KTX2 (loader falls back to PNG when missing)
+./output/bin/qq-texconv ./src/textures/lizard.png ./output/texture/lizard.ktx2 --format bc7 --quality 1
 
+# Virtual texture pages (used with --virtual-texture)
+./output/bin/qq-texconv ./src/textures/lizard.png ./output/texture/lizard.qvt --virtual
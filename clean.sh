@@ -9,5 +9,6 @@ rm CMakeCache.txt \
     Makefile \
     *.cbp
 
+rm -rf shader texture embedded_files.c
 rm -rf output/*
 
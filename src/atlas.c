@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <atlas.h>
+
+// Cells are aligned to padding, so levels down to the gutter width stay separated
+static u32 getAlignment(const AtlasPacker* packer) {
+    return packer->padding != 0 ? packer->padding : 1;
+}
+
+static u32 alignUp(u32 value, u32 alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+static u32 getCellSize(u32 size, u32 padding) {
+    u32 alignment = padding != 0 ? padding : 1;
+    return alignUp(size + 2 * padding, alignment);
+}
+
+b32 atlasPackerCreate(AtlasPacker* packer, u32 layerSize, u32 padding, u32 maxLayers) {
+    if ((padding & (padding - 1)) != 0 || layerSize == 0 || maxLayers == 0) {
+        return QQ_FALSE;
+    }
+
+    *packer = (AtlasPacker){
+        .layerSize = layerSize,
+        .padding = padding,
+        .maxLayers = maxLayers
+    };
+    packer->nodeCapacity = layerSize / getAlignment(packer) + 1;
+    packer->nodes = malloc(sizeof(AtlasSkylineNode) * packer->nodeCapacity * maxLayers);
+    packer->nodeCounts = calloc(maxLayers, sizeof(u32));
+
+    // Every layer starts with flat skyline at the top
+    for (u32 layer = 0; layer < maxLayers; layer++) {
+        packer->nodes[layer * packer->nodeCapacity] = (AtlasSkylineNode){0, 0, layerSize};
+        packer->nodeCounts[layer] = 1;
+    }
+    return QQ_TRUE;
+}
+
+void atlasPackerDestroy(AtlasPacker* packer) {
+    free(packer->nodes);
+    free(packer->nodeCounts);
+    packer->nodes = NULL;
+    packer->nodeCounts = NULL;
+}
+
+// Lowest top of the cell placed at node `index`, U32_MAX when it does not fit there
+static u32 fitCell(const AtlasPacker* packer, const AtlasSkylineNode* nodes, u32 nodeCount, u32 index, u32 width, u32 height) {
+    if (nodes[index].x + width > packer->layerSize) {
+        return U32_MAX;
+    }
+
+    // Cell rests on the highest segment below it
+    u32 y = 0;
+    u32 remaining = width;
+    for (u32 i = index; i < nodeCount && remaining > 0; i++) {
+        if (nodes[i].y > y) {
+            y = nodes[i].y;
+        }
+        remaining = nodes[i].width >= remaining ? 0 : remaining - nodes[i].width;
+    }
+
+    if (y + height > packer->layerSize) {
+        return U32_MAX;
+    }
+    return y;
+}
+
+// Raises skyline under the new cell and merges segments of the same height
+static void addCell(AtlasPacker* packer, u32 layer, u32 index, u32 x, u32 y, u32 width) {
+    AtlasSkylineNode* nodes = &packer->nodes[layer * packer->nodeCapacity];
+    u32 nodeCount = packer->nodeCounts[layer];
+
+    memmove(&nodes[index + 1], &nodes[index], sizeof(AtlasSkylineNode) * (nodeCount - index));
+    nodes[index] = (AtlasSkylineNode){x, y, width};
+    nodeCount += 1;
+
+    // Following segments are cut by the cell or removed when fully covered
+    u32 cellEnd = x + width;
+    u32 i = index + 1;
+    while (i < nodeCount && nodes[i].x < cellEnd) {
+        u32 nodeEnd = nodes[i].x + nodes[i].width;
+        if (nodeEnd <= cellEnd) {
+            memmove(&nodes[i], &nodes[i + 1], sizeof(AtlasSkylineNode) * (nodeCount - i - 1));
+            nodeCount -= 1;
+            continue;
+        }
+        nodes[i].width = nodeEnd - cellEnd;
+        nodes[i].x = cellEnd;
+        break;
+    }
+
+    for (i = 0; i + 1 < nodeCount;) {
+        if (nodes[i].y == nodes[i + 1].y) {
+            nodes[i].width += nodes[i + 1].width;
+            memmove(&nodes[i + 1], &nodes[i + 2], sizeof(AtlasSkylineNode) * (nodeCount - i - 2));
+            nodeCount -= 1;
+        } else {
+            i++;
+        }
+    }
+
+    packer->nodeCounts[layer] = nodeCount;
+}
+
+b32 atlasPackerInsert(AtlasPacker* packer, u32 width, u32 height, AtlasRect* rect) {
+    *rect = (AtlasRect){.width = width, .height = height, .isPacked = QQ_FALSE};
+
+    u32 cellWidth = getCellSize(width, packer->padding);
+    u32 cellHeight = getCellSize(height, packer->padding);
+    if (width == 0 || height == 0 || cellWidth > packer->layerSize || cellHeight > packer->layerSize) {
+        return QQ_FALSE;
+    }
+
+    // Bottom-left rule per layer (lowest top, then leftmost), earlier layers are filled first
+    for (u32 layer = 0; layer < packer->maxLayers; layer++) {
+        const AtlasSkylineNode* nodes = &packer->nodes[layer * packer->nodeCapacity];
+        u32 nodeCount = packer->nodeCounts[layer];
+
+        u32 bestIndex = U32_MAX;
+        u32 bestTop = U32_MAX;
+        for (u32 i = 0; i < nodeCount; i++) {
+            u32 y = fitCell(packer, nodes, nodeCount, i, cellWidth, cellHeight);
+            if (y != U32_MAX && y + cellHeight < bestTop) {
+                bestTop = y + cellHeight;
+                bestIndex = i;
+            }
+        }
+        if (bestIndex == U32_MAX) {
+            continue;
+        }
+
+        u32 x = nodes[bestIndex].x;
+        addCell(packer, layer, bestIndex, x, bestTop, cellWidth);
+
+        rect->x = x + packer->padding;
+        rect->y = bestTop - cellHeight + packer->padding;
+        rect->layer = layer;
+        rect->isPacked = QQ_TRUE;
+
+        if (layer + 1 > packer->layerCount) {
+            packer->layerCount = layer + 1;
+        }
+        packer->usedArea += (u64)cellWidth * cellHeight;
+        return QQ_TRUE;
+    }
+
+    return QQ_FALSE;
+}
+
+u32 atlasPackerInsertAll(AtlasPacker* packer, const u32* widths, const u32* heights, u32 count, AtlasRect* rects) {
+    // Insertion sort of indices, atlases hold hundreds of images at most
+    u32* order = malloc(sizeof(u32) * count);
+    for (u32 i = 0; i < count; i++) {
+        u32 j = i;
+        while (
+            j > 0
+            && (
+                heights[order[j - 1]] < heights[i]
+                || (heights[order[j - 1]] == heights[i] && widths[order[j - 1]] < widths[i])
+            )
+        ) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+
+    u32 packedCount = 0;
+    for (u32 i = 0; i < count; i++) {
+        u32 index = order[i];
+        packedCount += atlasPackerInsert(packer, widths[index], heights[index], &rects[index]) == QQ_TRUE;
+    }
+
+    free(order);
+    return packedCount;
+}
+
+u32 atlasGetLevelCount(u32 layerSize, u32 padding) {
+    // Level `n` keeps `padding >> n` gutter texels, last one keeps a single texel
+    u32 levelCount = 1;
+    while (padding > 1 && (layerSize >> levelCount) > 0) {
+        padding >>= 1;
+        levelCount += 1;
+    }
+    return levelCount;
+}
+
+void atlasCopyImage(u8* layerPixels, u32 layerSize, u32 padding, const AtlasRect* rect, const u8* pixels) {
+    u32 cellX = rect->x - padding;
+    u32 cellY = rect->y - padding;
+    u32 cellWidth = getCellSize(rect->width, padding);
+    u32 cellHeight = getCellSize(rect->height, padding);
+
+    // Gutter texels repeat the closest edge texel (clamp to edge)
+    for (u32 y = 0; y < cellHeight; y++) {
+        i32 sourceY = (i32)y - (i32)padding;
+        sourceY = sourceY < 0 ? 0 : (sourceY >= (i32)rect->height ? (i32)rect->height - 1 : sourceY);
+        const u8* sourceRow = &pixels[(u64)sourceY * rect->width * 4];
+        u8* row = &layerPixels[((u64)(cellY + y) * layerSize + cellX) * 4];
+
+        for (u32 x = 0; x < padding; x++) {
+            memcpy(&row[x * 4], &sourceRow[0], 4);
+        }
+        memcpy(&row[padding * 4], sourceRow, (u64)rect->width * 4);
+        for (u32 x = padding + rect->width; x < cellWidth; x++) {
+            memcpy(&row[x * 4], &sourceRow[(rect->width - 1) * 4], 4);
+        }
+    }
+}
+
+void atlasGetUvTransform(const AtlasRect* rect, u32 layerSize, f32* transform) {
+    transform[0] = (f32)rect->width / (f32)layerSize;
+    transform[1] = (f32)rect->height / (f32)layerSize;
+    transform[2] = (f32)rect->x / (f32)layerSize;
+    transform[3] = (f32)rect->y / (f32)layerSize;
+}
@@ -0,0 +1,1257 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <bcn.h>
+
+// BC7 mode layout, all counts are in bits
+typedef struct {
+    u8 subsetCount;
+    u8 partitionBits;
+    u8 rotationBits;
+    u8 indexSelectionBits;
+    u8 colorBits;
+    u8 alphaBits;
+    u8 endpointPBits;
+    u8 sharedPBits;
+    u8 indexBits;
+    u8 secondaryIndexBits;
+} Bc7ModeInfo;
+
+static const Bc7ModeInfo bc7Modes[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}
+};
+
+// Two subset partitions, bit per texel selects the subset
+static const u16 bc7Partitions2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+};
+
+// Three subset partitions, subset per texel
+static const u8 bc7Partitions3[64][16] = {
+    {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1},
+    {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+    {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2},
+    {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+    {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2},
+    {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+    {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2},
+    {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+    {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0},
+    {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+    {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1},
+    {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+    {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2},
+    {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+    {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2},
+    {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+    {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1},
+    {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+    {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0},
+    {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+    {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2},
+    {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+    {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1},
+    {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+    {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1},
+    {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+    {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2},
+    {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+    {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2},
+    {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+    {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2},
+    {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0}
+};
+
+// Anchor texels (stored with one index bit less) of the second subset
+static const u8 bc7Anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+    15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+     6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+// Anchor texels of the second and third subset in three subset partitions
+static const u8 bc7Anchors3Second[64] = {
+     3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+     3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+     8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+     3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3
+};
+
+static const u8 bc7Anchors3Third[64] = {
+    15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+    15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+    15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+    15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8
+};
+
+// Interpolation weights (out of 64) by index bit count
+static const u8 bc7Weights2[4] = {0, 21, 43, 64};
+static const u8 bc7Weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const u8 bc7Weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Reads little-endian bit stream, least significant bit first
+typedef struct {
+    const u8* data;
+    u32 position;
+} BitReader;
+
+static u32 readBits(BitReader* reader, u32 count) {
+    u32 value = 0;
+    for (u32 i = 0; i < count; i++) {
+        u32 bit = reader->position + i;
+        value |= (u32)((reader->data[bit >> 3] >> (bit & 7)) & 1) << i;
+    }
+    reader->position += count;
+    return value;
+}
+
+static u16 readU16(const u8* data) {
+    return (u16)(data[0] | (data[1] << 8));
+}
+
+static u32 readU32(const u8* data) {
+    return (u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16) | ((u32)data[3] << 24);
+}
+
+// Expands RGB565 into RGB8
+static void unpackColor565(u16 color, u8* rgb) {
+    u32 r = (color >> 11) & 31;
+    u32 g = (color >> 5) & 63;
+    u32 b = color & 31;
+    rgb[0] = (u8)((r << 3) | (r >> 2));
+    rgb[1] = (u8)((g << 2) | (g >> 4));
+    rgb[2] = (u8)((b << 3) | (b >> 2));
+}
+
+// Color part of BC1/BC3, BC3 always uses 4 color mode
+static void decodeColorBlock(const u8* block, u8* rgba, b32 allowPunchThrough) {
+    u16 color0 = readU16(block);
+    u16 color1 = readU16(block + 2);
+    u32 indices = readU32(block + 4);
+
+    u8 palette[4][4];
+    unpackColor565(color0, palette[0]);
+    unpackColor565(color1, palette[1]);
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+
+    if (color0 > color1 || allowPunchThrough == QQ_FALSE) {
+        for (u32 c = 0; c < 3; c++) {
+            palette[2][c] = (u8)((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = (u8)((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 255;
+    } else {
+        // Three colors and transparent black
+        for (u32 c = 0; c < 3; c++) {
+            palette[2][c] = (u8)((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+        palette[2][3] = 255;
+        palette[3][3] = 0;
+    }
+
+    for (u32 i = 0; i < 16; i++) {
+        memcpy(&rgba[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+// Single channel block (BC3 alpha, BC4/BC5 channels), writes every `stride` bytes
+static void decodeChannelBlock(const u8* block, u8* output, u32 stride) {
+    u32 value0 = block[0];
+    u32 value1 = block[1];
+
+    u8 palette[8];
+    palette[0] = (u8)value0;
+    palette[1] = (u8)value1;
+    if (value0 > value1) {
+        for (u32 i = 1; i < 7; i++) {
+            palette[i + 1] = (u8)(((7 - i) * value0 + i * value1) / 7);
+        }
+    } else {
+        for (u32 i = 1; i < 5; i++) {
+            palette[i + 1] = (u8)(((5 - i) * value0 + i * value1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    // 16 indices of 3 bits packed into 48 bits
+    u64 indices = 0;
+    for (u32 i = 0; i < 6; i++) {
+        indices |= (u64)block[2 + i] << (i * 8);
+    }
+
+    for (u32 i = 0; i < 16; i++) {
+        output[i * stride] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+// Expands quantized endpoint component to 8 bits
+static u8 expandBits(u32 value, u32 bits) {
+    if (bits >= 8) {
+        return (u8)value;
+    }
+    return (u8)((value << (8 - bits)) | (value >> (2 * bits - 8)));
+}
+
+static u8 interpolate(u32 endpoint0, u32 endpoint1, u32 index, u32 bits) {
+    u32 weight;
+    if (bits == 2) {
+        weight = bc7Weights2[index];
+    } else if (bits == 3) {
+        weight = bc7Weights3[index];
+    } else {
+        weight = bc7Weights4[index];
+    }
+    return (u8)(((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6);
+}
+
+static u32 getSubset(u32 subsetCount, u32 partition, u32 texel) {
+    if (subsetCount == 2) {
+        return (bc7Partitions2[partition] >> texel) & 1;
+    }
+    if (subsetCount == 3) {
+        return bc7Partitions3[partition][texel];
+    }
+    return 0;
+}
+
+static b32 isAnchor(u32 subsetCount, u32 partition, u32 texel) {
+    if (texel == 0) {
+        return QQ_TRUE;
+    }
+    if (subsetCount == 2) {
+        return texel == bc7Anchors2[partition];
+    }
+    if (subsetCount == 3) {
+        return texel == bc7Anchors3Second[partition] || texel == bc7Anchors3Third[partition];
+    }
+    return QQ_FALSE;
+}
+
+static void decodeBc7Block(const u8* block, u8* rgba) {
+    // Mode is encoded as position of the lowest set bit
+    u32 mode = 0;
+    while (mode < 8 && (block[0] & (1 << mode)) == 0) {
+        mode++;
+    }
+
+    // Reserved mode decodes to transparent black
+    if (mode == 8) {
+        memset(rgba, 0, 16 * 4);
+        return;
+    }
+
+    const Bc7ModeInfo* info = &bc7Modes[mode];
+    BitReader reader = {
+        .data = block,
+        .position = mode + 1
+    };
+
+    u32 partition = readBits(&reader, info->partitionBits);
+    u32 rotation = readBits(&reader, info->rotationBits);
+    u32 indexSelection = readBits(&reader, info->indexSelectionBits);
+
+    // Endpoints are stored channel by channel: R of all endpoints, then G, ...
+    u32 endpoints[3][2][4];
+    u32 endpointCount = info->subsetCount * 2;
+    for (u32 channel = 0; channel < 3; channel++) {
+        for (u32 i = 0; i < endpointCount; i++) {
+            endpoints[i >> 1][i & 1][channel] = readBits(&reader, info->colorBits);
+        }
+    }
+    if (info->alphaBits != 0) {
+        for (u32 i = 0; i < endpointCount; i++) {
+            endpoints[i >> 1][i & 1][3] = readBits(&reader, info->alphaBits);
+        }
+    }
+
+    u32 colorPrecision = info->colorBits;
+    u32 alphaPrecision = info->alphaBits;
+
+    // P-bits extend all channels by one least significant bit
+    if (info->endpointPBits != 0 || info->sharedPBits != 0) {
+        u32 pBits[3][2];
+        for (u32 subset = 0; subset < info->subsetCount; subset++) {
+            if (info->endpointPBits != 0) {
+                pBits[subset][0] = readBits(&reader, 1);
+                pBits[subset][1] = readBits(&reader, 1);
+            } else {
+                pBits[subset][0] = readBits(&reader, 1);
+                pBits[subset][1] = pBits[subset][0];
+            }
+        }
+
+        u32 channelCount = info->alphaBits != 0 ? 4 : 3;
+        for (u32 i = 0; i < endpointCount; i++) {
+            for (u32 channel = 0; channel < channelCount; channel++) {
+                endpoints[i >> 1][i & 1][channel] =
+                    (endpoints[i >> 1][i & 1][channel] << 1) | pBits[i >> 1][i & 1];
+            }
+        }
+
+        colorPrecision += 1;
+        if (info->alphaBits != 0) {
+            alphaPrecision += 1;
+        }
+    }
+
+    for (u32 i = 0; i < endpointCount; i++) {
+        for (u32 channel = 0; channel < 3; channel++) {
+            endpoints[i >> 1][i & 1][channel] = expandBits(endpoints[i >> 1][i & 1][channel], colorPrecision);
+        }
+        endpoints[i >> 1][i & 1][3] = info->alphaBits != 0
+            ? expandBits(endpoints[i >> 1][i & 1][3], alphaPrecision)
+            : 255;
+    }
+
+    // Anchor texels store index without most significant bit (always zero)
+    u32 primaryIndices[16];
+    for (u32 texel = 0; texel < 16; texel++) {
+        u32 bits = info->indexBits;
+        if (isAnchor(info->subsetCount, partition, texel) == QQ_TRUE) {
+            bits -= 1;
+        }
+        primaryIndices[texel] = readBits(&reader, bits);
+    }
+
+    u32 secondaryIndices[16];
+    if (info->secondaryIndexBits != 0) {
+        for (u32 texel = 0; texel < 16; texel++) {
+            secondaryIndices[texel] = readBits(&reader, info->secondaryIndexBits - (texel == 0 ? 1 : 0));
+        }
+    }
+
+    for (u32 texel = 0; texel < 16; texel++) {
+        u32 subset = getSubset(info->subsetCount, partition, texel);
+        u32* endpoint0 = endpoints[subset][0];
+        u32* endpoint1 = endpoints[subset][1];
+        u8* output = &rgba[texel * 4];
+
+        // Modes 4 and 5 have separate color and alpha indices
+        u32 colorIndex = primaryIndices[texel];
+        u32 colorIndexBits = info->indexBits;
+        u32 alphaIndex = primaryIndices[texel];
+        u32 alphaIndexBits = info->indexBits;
+        if (info->secondaryIndexBits != 0) {
+            if (indexSelection != 0) {
+                colorIndex = secondaryIndices[texel];
+                colorIndexBits = info->secondaryIndexBits;
+            } else {
+                alphaIndex = secondaryIndices[texel];
+                alphaIndexBits = info->secondaryIndexBits;
+            }
+        }
+
+        for (u32 channel = 0; channel < 3; channel++) {
+            output[channel] = interpolate(endpoint0[channel], endpoint1[channel], colorIndex, colorIndexBits);
+        }
+        output[3] = interpolate(endpoint0[3], endpoint1[3], alphaIndex, alphaIndexBits);
+
+        // Rotation swaps alpha with one of the color channels
+        if (rotation != 0) {
+            u8 alpha = output[3];
+            output[3] = output[rotation - 1];
+            output[rotation - 1] = alpha;
+        }
+    }
+}
+
+u32 bcnGetBlockSize(BcnFormat format) {
+    return format == BCN_FORMAT_BC1 ? 8 : 16;
+}
+
+u64 bcnGetLevelSize(BcnFormat format, u32 width, u32 height) {
+    u64 blocksX = (width + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+    u64 blocksY = (height + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+    return blocksX * blocksY * bcnGetBlockSize(format);
+}
+
+void bcnDecodeBlock(BcnFormat format, const u8* block, u8* rgba) {
+    switch (format) {
+        case BCN_FORMAT_BC1:
+            decodeColorBlock(block, rgba, QQ_TRUE);
+            break;
+        case BCN_FORMAT_BC3:
+            decodeColorBlock(block + 8, rgba, QQ_FALSE);
+            decodeChannelBlock(block, rgba + 3, 4);
+            break;
+        case BCN_FORMAT_BC5:
+            // Two channels (usually normal map XY), blue is reconstructed in shader
+            decodeChannelBlock(block, rgba, 4);
+            decodeChannelBlock(block + 8, rgba + 1, 4);
+            for (u32 i = 0; i < 16; i++) {
+                rgba[i * 4 + 2] = 0;
+                rgba[i * 4 + 3] = 255;
+            }
+            break;
+        case BCN_FORMAT_BC7:
+            decodeBc7Block(block, rgba);
+            break;
+    }
+}
+
+void bcnDecodeImage(BcnFormat format, const u8* blocks, u32 width, u32 height, u8* rgba) {
+    u32 blockSize = bcnGetBlockSize(format);
+    u32 blocksX = (width + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+    u32 blocksY = (height + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+
+    for (u32 blockY = 0; blockY < blocksY; blockY++) {
+        for (u32 blockX = 0; blockX < blocksX; blockX++) {
+            u8 texels[16 * 4];
+            bcnDecodeBlock(format, blocks, texels);
+            blocks += blockSize;
+
+            // Edge blocks of non multiple of 4 levels are cropped
+            for (u32 y = 0; y < BCN_BLOCK_DIMENSION; y++) {
+                u32 imageY = blockY * BCN_BLOCK_DIMENSION + y;
+                if (imageY >= height) {
+                    break;
+                }
+                for (u32 x = 0; x < BCN_BLOCK_DIMENSION; x++) {
+                    u32 imageX = blockX * BCN_BLOCK_DIMENSION + x;
+                    if (imageX >= width) {
+                        break;
+                    }
+                    memcpy(
+                        &rgba[((u64)imageY * width + imageX) * 4],
+                        &texels[(y * BCN_BLOCK_DIMENSION + x) * 4],
+                        4
+                    );
+                }
+            }
+        }
+    }
+}
+
+// ENCODER
+
+// Block texels in structure of arrays layout, padded for 4-wide SIMD
+typedef struct {
+    f32 r[16];
+    f32 g[16];
+    f32 b[16];
+    f32 a[16];
+    u32 count;
+} PixelSet;
+
+// Quantized endpoints of one BC7 subset
+typedef struct {
+    u32 endpoints[2][4];
+    u32 pBits[2];
+    u8 indices[16];
+    f32 error;
+} Bc7SubsetFit;
+
+// Writes little-endian bit stream, least significant bit first
+typedef struct {
+    u8* data;
+    u32 position;
+} BitWriter;
+
+static void writeBits(BitWriter* writer, u32 value, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        u32 bit = writer->position + i;
+        writer->data[bit >> 3] |= (u8)(((value >> i) & 1) << (bit & 7));
+    }
+    writer->position += count;
+}
+
+static void addPixel(PixelSet* set, const f32* pixel) {
+    set->r[set->count] = pixel[0];
+    set->g[set->count] = pixel[1];
+    set->b[set->count] = pixel[2];
+    set->a[set->count] = pixel[3];
+    set->count += 1;
+}
+
+// Picks closest palette entry for every pixel, returns sum of squared errors
+static f32 selectIndices(const PixelSet* set, const f32 (*palette)[4], u32 paletteSize, u8* indices) {
+    f32 totalError = 0.0f;
+
+#if defined(__SSE2__)
+    // Four pixels at once, palette entries are broadcast
+    for (u32 i = 0; i < set->count; i += 4) {
+        __m128 r = _mm_loadu_ps(&set->r[i]);
+        __m128 g = _mm_loadu_ps(&set->g[i]);
+        __m128 b = _mm_loadu_ps(&set->b[i]);
+        __m128 a = _mm_loadu_ps(&set->a[i]);
+
+        __m128 bestError = _mm_set1_ps(3.4e38f);
+        __m128i bestIndex = _mm_setzero_si128();
+
+        for (u32 entry = 0; entry < paletteSize; entry++) {
+            __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[entry][0]));
+            __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[entry][1]));
+            __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[entry][2]));
+            __m128 da = _mm_sub_ps(a, _mm_set1_ps(palette[entry][3]));
+            __m128 error = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)),
+                _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da))
+            );
+
+            __m128i isBetter = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestError = _mm_min_ps(error, bestError);
+            bestIndex = _mm_or_si128(
+                _mm_and_si128(isBetter, _mm_set1_epi32((i32)entry)),
+                _mm_andnot_si128(isBetter, bestIndex)
+            );
+        }
+
+        f32 errors[4];
+        u32 lanes[4];
+        _mm_storeu_ps(errors, bestError);
+        _mm_storeu_si128((__m128i*)lanes, bestIndex);
+
+        // Padding lanes are ignored
+        for (u32 lane = 0; lane < 4 && i + lane < set->count; lane++) {
+            indices[i + lane] = (u8)lanes[lane];
+            totalError += errors[lane];
+        }
+    }
+#else
+    for (u32 i = 0; i < set->count; i++) {
+        f32 bestError = 3.4e38f;
+        u32 bestIndex = 0;
+
+        for (u32 entry = 0; entry < paletteSize; entry++) {
+            f32 dr = set->r[i] - palette[entry][0];
+            f32 dg = set->g[i] - palette[entry][1];
+            f32 db = set->b[i] - palette[entry][2];
+            f32 da = set->a[i] - palette[entry][3];
+            f32 error = dr * dr + dg * dg + db * db + da * da;
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = entry;
+            }
+        }
+
+        indices[i] = (u8)bestIndex;
+        totalError += bestError;
+    }
+#endif
+
+    return totalError;
+}
+
+// Mean and principal axis (power iteration on covariance) of the pixel set
+static void computePrincipalAxis(const PixelSet* set, f32* mean, f32* axis) {
+    const f32* channels[4] = {set->r, set->g, set->b, set->a};
+
+    for (u32 c = 0; c < 4; c++) {
+        mean[c] = 0.0f;
+        for (u32 i = 0; i < set->count; i++) {
+            mean[c] += channels[c][i];
+        }
+        mean[c] /= (f32)set->count;
+    }
+
+    f32 covariance[4][4] = {0};
+    for (u32 i = 0; i < set->count; i++) {
+        f32 d[4];
+        for (u32 c = 0; c < 4; c++) {
+            d[c] = channels[c][i] - mean[c];
+        }
+        for (u32 row = 0; row < 4; row++) {
+            for (u32 column = 0; column < 4; column++) {
+                covariance[row][column] += d[row] * d[column];
+            }
+        }
+    }
+
+    // Start from the luminance-ish diagonal, converges in a few steps for 16 pixels
+    f32 vector[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (u32 iteration = 0; iteration < 6; iteration++) {
+        f32 next[4] = {0};
+        f32 length = 0.0f;
+        for (u32 row = 0; row < 4; row++) {
+            for (u32 column = 0; column < 4; column++) {
+                next[row] += covariance[row][column] * vector[column];
+            }
+            length += next[row] * next[row];
+        }
+
+        // Uniform block, any axis works
+        if (length < 1e-12f) {
+            break;
+        }
+
+        length = 1.0f / sqrtf(length);
+        for (u32 c = 0; c < 4; c++) {
+            vector[c] = next[c] * length;
+        }
+    }
+
+    memcpy(axis, vector, sizeof(f32) * 4);
+}
+
+// Squared error left after projecting pixels onto their principal axis
+static f32 estimateLineError(const PixelSet* set) {
+    if (set->count == 0) {
+        return 0.0f;
+    }
+
+    f32 mean[4], axis[4];
+    computePrincipalAxis(set, mean, axis);
+
+    const f32* channels[4] = {set->r, set->g, set->b, set->a};
+    f32 error = 0.0f;
+    for (u32 i = 0; i < set->count; i++) {
+        f32 d[4];
+        f32 t = 0.0f;
+        for (u32 c = 0; c < 4; c++) {
+            d[c] = channels[c][i] - mean[c];
+            t += d[c] * axis[c];
+        }
+        for (u32 c = 0; c < 4; c++) {
+            f32 residual = d[c] - t * axis[c];
+            error += residual * residual;
+        }
+    }
+    return error;
+}
+
+// Endpoints spanning the pixel set along its principal axis
+static void computeLineEndpoints(const PixelSet* set, f32* endpoint0, f32* endpoint1) {
+    f32 mean[4], axis[4];
+    computePrincipalAxis(set, mean, axis);
+
+    const f32* channels[4] = {set->r, set->g, set->b, set->a};
+    f32 minT = 3.4e38f;
+    f32 maxT = -3.4e38f;
+    for (u32 i = 0; i < set->count; i++) {
+        f32 t = 0.0f;
+        for (u32 c = 0; c < 4; c++) {
+            t += (channels[c][i] - mean[c]) * axis[c];
+        }
+        minT = fminf(minT, t);
+        maxT = fmaxf(maxT, t);
+    }
+
+    for (u32 c = 0; c < 4; c++) {
+        endpoint0[c] = fminf(fmaxf(mean[c] + minT * axis[c], 0.0f), 255.0f);
+        endpoint1[c] = fminf(fmaxf(mean[c] + maxT * axis[c], 0.0f), 255.0f);
+    }
+}
+
+// Least squares endpoints for given interpolation weights (0..1) per pixel,
+// returns QQ_FALSE if all pixels use the same weight
+static b32 solveEndpoints(const PixelSet* set, const f32* weights, f32* endpoint0, f32* endpoint1) {
+    const f32* channels[4] = {set->r, set->g, set->b, set->a};
+
+    f32 aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    f32 ax[4] = {0}, bx[4] = {0};
+    for (u32 i = 0; i < set->count; i++) {
+        f32 b = weights[i];
+        f32 a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (u32 c = 0; c < 4; c++) {
+            ax[c] += a * channels[c][i];
+            bx[c] += b * channels[c][i];
+        }
+    }
+
+    f32 determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) {
+        return QQ_FALSE;
+    }
+
+    f32 inverse = 1.0f / determinant;
+    for (u32 c = 0; c < 4; c++) {
+        endpoint0[c] = fminf(fmaxf((bb * ax[c] - ab * bx[c]) * inverse, 0.0f), 255.0f);
+        endpoint1[c] = fminf(fmaxf((aa * bx[c] - ab * ax[c]) * inverse, 0.0f), 255.0f);
+    }
+    return QQ_TRUE;
+}
+
+static const u8* getBc7Weights(u32 indexBits) {
+    if (indexBits == 2) {
+        return bc7Weights2;
+    }
+    if (indexBits == 3) {
+        return bc7Weights3;
+    }
+    return bc7Weights4;
+}
+
+// Closest quantized value (of `bits` bits) which expands back near `value`,
+// with p-bit appended as least significant bit when `pBit` is not U32_MAX
+static u32 quantizeEndpoint(f32 value, u32 bits, u32 pBit) {
+    u32 maxValue = (1u << bits) - 1;
+    i32 quantized;
+    if (pBit == U32_MAX) {
+        quantized = (i32)(value * (f32)maxValue / 255.0f + 0.5f);
+    } else {
+        f32 extendedMax = (f32)((1u << (bits + 1)) - 1);
+        quantized = (i32)((value * extendedMax / 255.0f - (f32)pBit) * 0.5f + 0.5f);
+    }
+    if (quantized < 0) {
+        quantized = 0;
+    }
+    if (quantized > (i32)maxValue) {
+        quantized = (i32)maxValue;
+    }
+    return (u32)quantized;
+}
+
+// Quantizes float endpoints for the mode (trying all p-bit combinations) and selects indices
+static void evaluateBc7Endpoints(
+    const PixelSet* set,
+    const Bc7ModeInfo* info,
+    const f32* endpoint0,
+    const f32* endpoint1,
+    Bc7SubsetFit* bestFit
+) {
+    const f32* endpoints[2] = {endpoint0, endpoint1};
+    u32 combinationCount = info->endpointPBits != 0 ? 4 : (info->sharedPBits != 0 ? 2 : 1);
+    b32 hasPBits = info->endpointPBits != 0 || info->sharedPBits != 0;
+    u32 paletteSize = 1u << info->indexBits;
+
+    for (u32 combination = 0; combination < combinationCount; combination++) {
+        Bc7SubsetFit fit;
+        u8 expanded[2][4];
+
+        if (info->endpointPBits != 0) {
+            fit.pBits[0] = combination & 1;
+            fit.pBits[1] = combination >> 1;
+        } else {
+            fit.pBits[0] = combination;
+            fit.pBits[1] = combination;
+        }
+
+        for (u32 e = 0; e < 2; e++) {
+            u32 pBit = hasPBits ? fit.pBits[e] : U32_MAX;
+            for (u32 c = 0; c < 3; c++) {
+                fit.endpoints[e][c] = quantizeEndpoint(endpoints[e][c], info->colorBits, pBit);
+                expanded[e][c] = hasPBits
+                    ? expandBits((fit.endpoints[e][c] << 1) | pBit, info->colorBits + 1)
+                    : expandBits(fit.endpoints[e][c], info->colorBits);
+            }
+
+            if (info->alphaBits != 0) {
+                fit.endpoints[e][3] = quantizeEndpoint(endpoints[e][3], info->alphaBits, pBit);
+                expanded[e][3] = hasPBits
+                    ? expandBits((fit.endpoints[e][3] << 1) | pBit, info->alphaBits + 1)
+                    : expandBits(fit.endpoints[e][3], info->alphaBits);
+            } else {
+                fit.endpoints[e][3] = 0;
+                expanded[e][3] = 255;
+            }
+        }
+
+        f32 palette[16][4];
+        for (u32 index = 0; index < paletteSize; index++) {
+            for (u32 c = 0; c < 4; c++) {
+                palette[index][c] = interpolate(expanded[0][c], expanded[1][c], index, info->indexBits);
+            }
+        }
+
+        fit.error = selectIndices(set, (const f32 (*)[4])palette, paletteSize, fit.indices);
+        if (fit.error < bestFit->error) {
+            *bestFit = fit;
+        }
+    }
+}
+
+static void fitBc7Subset(const PixelSet* set, const Bc7ModeInfo* info, u32 refineIterations, Bc7SubsetFit* fit) {
+    fit->error = 3.4e38f;
+
+    f32 endpoint0[4], endpoint1[4];
+    computeLineEndpoints(set, endpoint0, endpoint1);
+    evaluateBc7Endpoints(set, info, endpoint0, endpoint1, fit);
+
+    // Refit endpoints to the chosen indices
+    const u8* weightTable = getBc7Weights(info->indexBits);
+    for (u32 iteration = 0; iteration < refineIterations; iteration++) {
+        f32 weights[16];
+        for (u32 i = 0; i < set->count; i++) {
+            weights[i] = (f32)weightTable[fit->indices[i]] / 64.0f;
+        }
+
+        if (solveEndpoints(set, weights, endpoint0, endpoint1) == QQ_FALSE) {
+            break;
+        }
+
+        f32 previousError = fit->error;
+        evaluateBc7Endpoints(set, info, endpoint0, endpoint1, fit);
+        if (fit->error >= previousError) {
+            break;
+        }
+    }
+}
+
+// Encodes block with one of the single index set modes (0, 1, 2, 3, 6, 7), returns squared error
+static f32 encodeBc7Mode(
+    const f32 (*pixels)[4],
+    u32 mode,
+    u32 partition,
+    u32 refineIterations,
+    u8* block
+) {
+    const Bc7ModeInfo* info = &bc7Modes[mode];
+
+    // Split texels by subset, remembering where each one went
+    PixelSet sets[3];
+    u8 texelSlots[16];
+    for (u32 subset = 0; subset < info->subsetCount; subset++) {
+        memset(&sets[subset], 0, sizeof(PixelSet));
+    }
+    for (u32 texel = 0; texel < 16; texel++) {
+        u32 subset = getSubset(info->subsetCount, partition, texel);
+        texelSlots[texel] = (u8)sets[subset].count;
+        addPixel(&sets[subset], pixels[texel]);
+    }
+
+    Bc7SubsetFit fits[3];
+    f32 totalError = 0.0f;
+    for (u32 subset = 0; subset < info->subsetCount; subset++) {
+        fitBc7Subset(&sets[subset], info, refineIterations, &fits[subset]);
+        totalError += fits[subset].error;
+    }
+
+    // Anchor index must have its most significant bit clear, otherwise swap endpoints
+    u32 indexMax = (1u << info->indexBits) - 1;
+    for (u32 subset = 0; subset < info->subsetCount; subset++) {
+        u32 anchor = 0;
+        if (subset == 1) {
+            anchor = info->subsetCount == 2 ? bc7Anchors2[partition] : bc7Anchors3Second[partition];
+        } else if (subset == 2) {
+            anchor = bc7Anchors3Third[partition];
+        }
+
+        Bc7SubsetFit* fit = &fits[subset];
+        if (fit->indices[texelSlots[anchor]] <= (indexMax >> 1)) {
+            continue;
+        }
+
+        for (u32 c = 0; c < 4; c++) {
+            u32 tmp = fit->endpoints[0][c];
+            fit->endpoints[0][c] = fit->endpoints[1][c];
+            fit->endpoints[1][c] = tmp;
+        }
+        u32 tmpPBit = fit->pBits[0];
+        fit->pBits[0] = fit->pBits[1];
+        fit->pBits[1] = tmpPBit;
+
+        for (u32 i = 0; i < sets[subset].count; i++) {
+            fit->indices[i] = (u8)(indexMax - fit->indices[i]);
+        }
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer = {
+        .data = block,
+        .position = 0
+    };
+
+    writeBits(&writer, 1u << mode, mode + 1);
+    writeBits(&writer, partition, info->partitionBits);
+
+    for (u32 c = 0; c < 3; c++) {
+        for (u32 subset = 0; subset < info->subsetCount; subset++) {
+            writeBits(&writer, fits[subset].endpoints[0][c], info->colorBits);
+            writeBits(&writer, fits[subset].endpoints[1][c], info->colorBits);
+        }
+    }
+    if (info->alphaBits != 0) {
+        for (u32 subset = 0; subset < info->subsetCount; subset++) {
+            writeBits(&writer, fits[subset].endpoints[0][3], info->alphaBits);
+            writeBits(&writer, fits[subset].endpoints[1][3], info->alphaBits);
+        }
+    }
+
+    for (u32 subset = 0; subset < info->subsetCount; subset++) {
+        if (info->endpointPBits != 0) {
+            writeBits(&writer, fits[subset].pBits[0], 1);
+            writeBits(&writer, fits[subset].pBits[1], 1);
+        } else if (info->sharedPBits != 0) {
+            writeBits(&writer, fits[subset].pBits[0], 1);
+        }
+    }
+
+    for (u32 texel = 0; texel < 16; texel++) {
+        u32 subset = getSubset(info->subsetCount, partition, texel);
+        u32 bits = info->indexBits;
+        if (isAnchor(info->subsetCount, partition, texel) == QQ_TRUE) {
+            bits -= 1;
+        }
+        writeBits(&writer, fits[subset].indices[texelSlots[texel]], bits);
+    }
+
+    return totalError;
+}
+
+// Orders partitions of the given subset count by estimated error, fills `best` with `count` of them
+// Only the first `partitionLimit` partitions are searched, modes with fewer partition bits cannot address the rest
+static void findBestPartitions(const f32 (*pixels)[4], u32 subsetCount, u32 partitionLimit, u32* best, u32 count) {
+    f32 bestErrors[64];
+    for (u32 i = 0; i < count; i++) {
+        bestErrors[i] = 3.4e38f;
+        best[i] = 0;
+    }
+
+    for (u32 partition = 0; partition < partitionLimit; partition++) {
+        PixelSet sets[3];
+        for (u32 subset = 0; subset < subsetCount; subset++) {
+            memset(&sets[subset], 0, sizeof(PixelSet));
+        }
+        for (u32 texel = 0; texel < 16; texel++) {
+            addPixel(&sets[getSubset(subsetCount, partition, texel)], pixels[texel]);
+        }
+
+        f32 error = 0.0f;
+        for (u32 subset = 0; subset < subsetCount; subset++) {
+            error += estimateLineError(&sets[subset]);
+        }
+
+        // Insertion into the short sorted list
+        for (u32 i = 0; i < count; i++) {
+            if (error < bestErrors[i]) {
+                for (u32 j = count - 1; j > i; j--) {
+                    bestErrors[j] = bestErrors[j - 1];
+                    best[j] = best[j - 1];
+                }
+                bestErrors[i] = error;
+                best[i] = partition;
+                break;
+            }
+        }
+    }
+}
+
+static void encodeBc7Block(const f32 (*pixels)[4], BcnQuality quality, u8* block) {
+    b32 hasAlpha = QQ_FALSE;
+    for (u32 texel = 0; texel < 16; texel++) {
+        if (pixels[texel][3] < 255.0f) {
+            hasAlpha = QQ_TRUE;
+            break;
+        }
+    }
+
+    // Mode 6 (single subset, 4-bit indices, with alpha) is the baseline for all qualities
+    u32 refineIterations = quality == BCN_QUALITY_FAST ? 1 : (quality == BCN_QUALITY_NORMAL ? 2 : 4);
+    f32 bestError = encodeBc7Mode(pixels, 6, 0, refineIterations, block);
+    if (quality == BCN_QUALITY_FAST || bestError == 0.0f) {
+        return;
+    }
+
+    u8 candidate[16];
+    u32 partitions[8];
+
+    // Two subset modes: 1 and 3 for opaque blocks, 7 when alpha is present
+    u32 partitionCount = quality == BCN_QUALITY_NORMAL ? 2 : 8;
+    findBestPartitions(pixels, 2, 1u << bc7Modes[1].partitionBits, partitions, partitionCount);
+    for (u32 i = 0; i < partitionCount; i++) {
+        u32 modes[2] = {1, 3};
+        u32 modeCount = 2;
+        if (hasAlpha == QQ_TRUE) {
+            modes[0] = 7;
+            modeCount = 1;
+        }
+
+        for (u32 m = 0; m < modeCount; m++) {
+            f32 error = encodeBc7Mode(pixels, modes[m], partitions[i], refineIterations, candidate);
+            if (error < bestError) {
+                bestError = error;
+                memcpy(block, candidate, 16);
+            }
+        }
+    }
+
+    // Three subset modes (opaque only) for the slowest setting
+    // Mode 0 addresses the first 16 partitions only, so each mode gets its own search
+    if (quality == BCN_QUALITY_SLOW && hasAlpha == QQ_FALSE) {
+        partitionCount = 4;
+        u32 modes[2] = {0, 2};
+        for (u32 m = 0; m < 2; m++) {
+            findBestPartitions(pixels, 3, 1u << bc7Modes[modes[m]].partitionBits, partitions, partitionCount);
+            for (u32 i = 0; i < partitionCount; i++) {
+                f32 error = encodeBc7Mode(pixels, modes[m], partitions[i], refineIterations, candidate);
+                if (error < bestError) {
+                    bestError = error;
+                    memcpy(block, candidate, 16);
+                }
+            }
+        }
+    }
+}
+
+static u16 packColor565(const f32* color) {
+    u32 r = quantizeEndpoint(color[0], 5, U32_MAX);
+    u32 g = quantizeEndpoint(color[1], 6, U32_MAX);
+    u32 b = quantizeEndpoint(color[2], 5, U32_MAX);
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+// Evaluates 565 endpoints in 4 color mode, same palette as decoder
+static f32 evaluateBc1Endpoints(const PixelSet* set, u16 color0, u16 color1, u8* indices) {
+    u8 colors[2][4];
+    unpackColor565(color0, colors[0]);
+    unpackColor565(color1, colors[1]);
+
+    f32 palette[4][4];
+    for (u32 c = 0; c < 3; c++) {
+        palette[0][c] = colors[0][c];
+        palette[1][c] = colors[1][c];
+        palette[2][c] = (f32)((2 * colors[0][c] + colors[1][c]) / 3);
+        palette[3][c] = (f32)((colors[0][c] + 2 * colors[1][c]) / 3);
+    }
+    for (u32 i = 0; i < 4; i++) {
+        palette[i][3] = 255.0f;
+    }
+
+    return selectIndices(set, (const f32 (*)[4])palette, 4, indices);
+}
+
+// BC1 color block (also color part of BC3), alpha is ignored
+static void encodeColorBlock(const f32 (*pixels)[4], u32 refineIterations, u8* block) {
+    PixelSet set;
+    memset(&set, 0, sizeof(set));
+    for (u32 texel = 0; texel < 16; texel++) {
+        f32 opaque[4] = {pixels[texel][0], pixels[texel][1], pixels[texel][2], 255.0f};
+        addPixel(&set, opaque);
+    }
+
+    f32 endpoint0[4], endpoint1[4];
+    computeLineEndpoints(&set, endpoint0, endpoint1);
+
+    u8 indices[16];
+    u16 color0 = packColor565(endpoint1);
+    u16 color1 = packColor565(endpoint0);
+    f32 error = evaluateBc1Endpoints(&set, color0, color1, indices);
+
+    static const f32 bc1Weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    for (u32 iteration = 0; iteration < refineIterations; iteration++) {
+        f32 weights[16];
+        for (u32 i = 0; i < 16; i++) {
+            weights[i] = bc1Weights[indices[i]];
+        }
+        if (solveEndpoints(&set, weights, endpoint0, endpoint1) == QQ_FALSE) {
+            break;
+        }
+
+        u8 candidateIndices[16];
+        u16 candidate0 = packColor565(endpoint0);
+        u16 candidate1 = packColor565(endpoint1);
+        f32 candidateError = evaluateBc1Endpoints(&set, candidate0, candidate1, candidateIndices);
+        if (candidateError >= error) {
+            break;
+        }
+
+        error = candidateError;
+        color0 = candidate0;
+        color1 = candidate1;
+        memcpy(indices, candidateIndices, sizeof(indices));
+    }
+
+    // Four color mode requires color0 > color1, swapping endpoints swaps index pairs
+    if (color0 < color1) {
+        u16 tmp = color0;
+        color0 = color1;
+        color1 = tmp;
+        for (u32 i = 0; i < 16; i++) {
+            indices[i] ^= 1;
+        }
+    } else if (color0 == color1) {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    u32 packedIndices = 0;
+    for (u32 i = 0; i < 16; i++) {
+        packedIndices |= (u32)indices[i] << (i * 2);
+    }
+
+    block[0] = (u8)(color0 & 0xFF);
+    block[1] = (u8)(color0 >> 8);
+    block[2] = (u8)(color1 & 0xFF);
+    block[3] = (u8)(color1 >> 8);
+    for (u32 i = 0; i < 4; i++) {
+        block[4 + i] = (u8)(packedIndices >> (i * 8));
+    }
+}
+
+// Single channel block in 8 value mode (BC3 alpha, BC5 channels)
+static void encodeChannelBlock(const f32 (*pixels)[4], u32 channel, u8* block) {
+    f32 minValue = 255.0f;
+    f32 maxValue = 0.0f;
+    for (u32 texel = 0; texel < 16; texel++) {
+        minValue = fminf(minValue, pixels[texel][channel]);
+        maxValue = fmaxf(maxValue, pixels[texel][channel]);
+    }
+
+    u32 value0 = (u32)(maxValue + 0.5f);
+    u32 value1 = (u32)(minValue + 0.5f);
+
+    // value0 > value1 selects 8 value mode, equal values decode index 0 as value0 anyway
+    f32 palette[8];
+    palette[0] = (f32)value0;
+    palette[1] = (f32)value1;
+    for (u32 i = 1; i < 7; i++) {
+        palette[i + 1] = (f32)(((7 - i) * value0 + i * value1) / 7);
+    }
+
+    u64 indices = 0;
+    for (u32 texel = 0; texel < 16; texel++) {
+        u32 bestIndex = 0;
+        f32 bestError = 3.4e38f;
+        for (u32 i = 0; i < 8; i++) {
+            f32 error = fabsf(pixels[texel][channel] - palette[i]);
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = i;
+            }
+        }
+        if (value0 == value1) {
+            bestIndex = 0;
+        }
+        indices |= (u64)bestIndex << (texel * 3);
+    }
+
+    block[0] = (u8)value0;
+    block[1] = (u8)value1;
+    for (u32 i = 0; i < 6; i++) {
+        block[2 + i] = (u8)(indices >> (i * 8));
+    }
+}
+
+void bcnEncodeBlock(BcnFormat format, BcnQuality quality, const u8* rgba, u8* block) {
+    f32 pixels[16][4];
+    for (u32 i = 0; i < 16 * 4; i++) {
+        pixels[i >> 2][i & 3] = (f32)rgba[i];
+    }
+
+    u32 refineIterations = quality == BCN_QUALITY_FAST ? 1 : 2;
+    switch (format) {
+        case BCN_FORMAT_BC1:
+            encodeColorBlock((const f32 (*)[4])pixels, refineIterations, block);
+            break;
+        case BCN_FORMAT_BC3:
+            encodeChannelBlock((const f32 (*)[4])pixels, 3, block);
+            encodeColorBlock((const f32 (*)[4])pixels, refineIterations, block + 8);
+            break;
+        case BCN_FORMAT_BC5:
+            encodeChannelBlock((const f32 (*)[4])pixels, 0, block);
+            encodeChannelBlock((const f32 (*)[4])pixels, 1, block + 8);
+            break;
+        case BCN_FORMAT_BC7:
+            encodeBc7Block((const f32 (*)[4])pixels, quality, block);
+            break;
+    }
+}
+
+// Rows of blocks encoded by one job
+#define BCN_ENCODE_ROWS_PER_JOB 4
+
+typedef struct {
+    BcnFormat format;
+    BcnQuality quality;
+    const u8* rgba;
+    u32 width;
+    u32 height;
+    u8* blocks;
+
+    u32 firstRow;
+    u32 rowCount;
+} BcnEncodeJob;
+
+static void encodeBlockRows(void* userData) {
+    BcnEncodeJob* job = (BcnEncodeJob*)userData;
+    u32 blockSize = bcnGetBlockSize(job->format);
+    u32 blocksX = (job->width + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+
+    for (u32 blockY = job->firstRow; blockY < job->firstRow + job->rowCount; blockY++) {
+        for (u32 blockX = 0; blockX < blocksX; blockX++) {
+            // Edge blocks repeat last row/column of the image
+            u8 texels[16 * 4];
+            for (u32 y = 0; y < BCN_BLOCK_DIMENSION; y++) {
+                u32 imageY = blockY * BCN_BLOCK_DIMENSION + y;
+                if (imageY >= job->height) {
+                    imageY = job->height - 1;
+                }
+                for (u32 x = 0; x < BCN_BLOCK_DIMENSION; x++) {
+                    u32 imageX = blockX * BCN_BLOCK_DIMENSION + x;
+                    if (imageX >= job->width) {
+                        imageX = job->width - 1;
+                    }
+                    memcpy(
+                        &texels[(y * BCN_BLOCK_DIMENSION + x) * 4],
+                        &job->rgba[((u64)imageY * job->width + imageX) * 4],
+                        4
+                    );
+                }
+            }
+
+            u8* block = job->blocks + ((u64)blockY * blocksX + blockX) * blockSize;
+            bcnEncodeBlock(job->format, job->quality, texels, block);
+        }
+    }
+}
+
+void bcnEncodeImage(
+    BcnFormat format,
+    BcnQuality quality,
+    const u8* rgba,
+    u32 width,
+    u32 height,
+    u8* blocks,
+    JobPool* pool
+) {
+    u32 blocksY = (height + BCN_BLOCK_DIMENSION - 1) / BCN_BLOCK_DIMENSION;
+    u32 jobCount = (blocksY + BCN_ENCODE_ROWS_PER_JOB - 1) / BCN_ENCODE_ROWS_PER_JOB;
+
+    BcnEncodeJob* jobs = malloc(sizeof(BcnEncodeJob) * jobCount);
+    JobCounter counter = { .pending = 0 };
+
+    for (u32 i = 0; i < jobCount; i++) {
+        u32 firstRow = i * BCN_ENCODE_ROWS_PER_JOB;
+        BcnEncodeJob job = {
+            .format = format,
+            .quality = quality,
+            .rgba = rgba,
+            .width = width,
+            .height = height,
+            .blocks = blocks,
+            .firstRow = firstRow,
+            .rowCount = blocksY - firstRow < BCN_ENCODE_ROWS_PER_JOB
+                ? blocksY - firstRow
+                : BCN_ENCODE_ROWS_PER_JOB
+        };
+        jobs[i] = job;
+
+        if (pool != NULL) {
+            jobPoolSubmit(pool, &encodeBlockRows, &jobs[i], &counter);
+        } else {
+            encodeBlockRows(&jobs[i]);
+        }
+    }
+
+    if (pool != NULL) {
+        jobPoolWait(pool, &counter);
+    }
+
+    free(jobs);
+}
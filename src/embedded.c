@@ -0,0 +1,27 @@
+#define _GNU_SOURCE
+#include <string.h>
+
+#include <embedded.h>
+
+const EmbeddedFile* embeddedFind(const char* path) {
+    if (strncmp(path, "./", 2) == 0) {
+        path += 2;
+    }
+
+    for (u32 i = 0; i < embeddedFileCount; i++) {
+        if (strcmp(embeddedFiles[i].path, path) == 0) {
+            return &embeddedFiles[i];
+        }
+    }
+    return NULL;
+}
+
+FILE* embeddedOpen(const char* path, const char* mode) {
+    const EmbeddedFile* file = embeddedFind(path);
+    if (file == NULL) {
+        return fopen(path, mode);
+    }
+
+    // Stream only reads, so the constant words are never written
+    return fmemopen((void*)file->words, file->size, "r");
+}
@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <jobs.h>
+#include <log.h>
+#include <trace.h>
+
+// Initial size of job ring buffer
+#define JOB_QUEUE_INITIAL_CAPACITY 64
+
+// Pops the oldest job, must be called with mutex held
+static b32 popJob(JobPool* pool, Job* job) {
+    if (pool->queueCount == 0) {
+        return QQ_FALSE;
+    }
+
+    *job = pool->queue[pool->queueHead];
+    pool->queueHead = (pool->queueHead + 1) % pool->queueCapacity;
+    pool->queueCount -= 1;
+
+    return QQ_TRUE;
+}
+
+// Runs job and signals waiters once the counter drops to zero
+static void runJob(JobPool* pool, Job* job) {
+    job->function(job->userData);
+
+    if (job->counter != NULL) {
+        if (atomic_fetch_sub(&job->counter->pending, 1) == 1) {
+            pthread_mutex_lock(&pool->mutex);
+            pthread_cond_broadcast(&pool->doneCondition);
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+}
+
+static void* workerMain(void* userData) {
+    JobPool* pool = (JobPool*)userData;
+    traceSetThreadName("job worker");
+
+    for (;;) {
+        Job job;
+
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->queueCount == 0 && pool->isShuttingDown == QQ_FALSE) {
+            pthread_cond_wait(&pool->wakeCondition, &pool->mutex);
+        }
+
+        // Queue is drained before shutting down
+        if (popJob(pool, &job) == QQ_FALSE) {
+            pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        pthread_mutex_unlock(&pool->mutex);
+
+        runJob(pool, &job);
+    }
+
+    return NULL;
+}
+
+u32 jobPoolDefaultThreadCount() {
+    long coreCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+    // Leave one core for the render thread
+    if (coreCount <= 2) {
+        return 1;
+    }
+    return (u32)(coreCount - 1);
+}
+
+void jobPoolCreate(JobPool* pool, u32 threadCount) {
+    if (threadCount == 0) {
+        threadCount = jobPoolDefaultThreadCount();
+    }
+
+    pool->threadCount = threadCount;
+    pool->threads = malloc(sizeof(pthread_t) * threadCount);
+
+    pool->queueCapacity = JOB_QUEUE_INITIAL_CAPACITY;
+    pool->queue = malloc(sizeof(Job) * pool->queueCapacity);
+    pool->queueHead = 0;
+    pool->queueCount = 0;
+
+    pool->isShuttingDown = QQ_FALSE;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wakeCondition, NULL);
+    pthread_cond_init(&pool->doneCondition, NULL);
+
+    for (u32 i = 0; i < threadCount; i++) {
+        if (pthread_create(&pool->threads[i], NULL, &workerMain, pool) != 0) {
+            logError("Failed to create worker thread");
+        }
+    }
+}
+
+void jobPoolDestroy(JobPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->isShuttingDown = QQ_TRUE;
+    pthread_cond_broadcast(&pool->wakeCondition);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (u32 i = 0; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->doneCondition);
+    pthread_cond_destroy(&pool->wakeCondition);
+    pthread_mutex_destroy(&pool->mutex);
+
+    free(pool->queue);
+    free(pool->threads);
+}
+
+void jobPoolSubmit(JobPool* pool, JobFunction function, void* userData, JobCounter* counter) {
+    if (counter != NULL) {
+        atomic_fetch_add(&counter->pending, 1);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    // Grow ring buffer, unrolling wrapped part to the start of the new storage
+    if (pool->queueCount == pool->queueCapacity) {
+        u32 newCapacity = pool->queueCapacity * 2;
+        Job* newQueue = malloc(sizeof(Job) * newCapacity);
+        for (u32 i = 0; i < pool->queueCount; i++) {
+            newQueue[i] = pool->queue[(pool->queueHead + i) % pool->queueCapacity];
+        }
+        free(pool->queue);
+
+        pool->queue = newQueue;
+        pool->queueCapacity = newCapacity;
+        pool->queueHead = 0;
+    }
+
+    u32 tail = (pool->queueHead + pool->queueCount) % pool->queueCapacity;
+    pool->queue[tail].function = function;
+    pool->queue[tail].userData = userData;
+    pool->queue[tail].counter = counter;
+    pool->queueCount += 1;
+
+    pthread_cond_signal(&pool->wakeCondition);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void jobPoolWait(JobPool* pool, JobCounter* counter) {
+    while (atomic_load(&counter->pending) != 0) {
+        Job job;
+
+        pthread_mutex_lock(&pool->mutex);
+
+        // Help with queued work instead of sleeping
+        if (popJob(pool, &job) == QQ_TRUE) {
+            pthread_mutex_unlock(&pool->mutex);
+            runJob(pool, &job);
+            continue;
+        }
+
+        if (atomic_load(&counter->pending) != 0) {
+            pthread_cond_wait(&pool->doneCondition, &pool->mutex);
+        }
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+b32 jobCounterIsDone(JobCounter* counter) {
+    return atomic_load(&counter->pending) == 0;
+}
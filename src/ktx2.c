@@ -0,0 +1,342 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <ktx2.h>
+#include <log.h>
+
+// File identifier: «KTX 20»\r\n\x1A\n
+static const u8 ktx2Identifier[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+// Identifier, header, index
+#define KTX2_HEADER_SIZE 80
+
+// Each level index entry: byteOffset, byteLength, uncompressedByteLength
+#define KTX2_LEVEL_INDEX_ENTRY_SIZE 24
+
+// Container is little endian, reading byte by byte keeps it portable
+static u32 readU32(const u8* data) {
+    return (u32)data[0]
+        | ((u32)data[1] << 8)
+        | ((u32)data[2] << 16)
+        | ((u32)data[3] << 24);
+}
+
+static u64 readU64(const u8* data) {
+    return (u64)readU32(data) | ((u64)readU32(data + 4) << 32);
+}
+
+b32 ktx2Parse(u8* data, u64 dataSize, Ktx2Texture* texture) {
+    if (dataSize < KTX2_HEADER_SIZE || memcmp(data, ktx2Identifier, sizeof(ktx2Identifier)) != 0) {
+        logError("Not a KTX2 file");
+        return QQ_FALSE;
+    }
+
+    u32 format = readU32(data + 12);
+    u32 width = readU32(data + 20);
+    u32 height = readU32(data + 24);
+    u32 depth = readU32(data + 28);
+    u32 layerCount = readU32(data + 32);
+    u32 faceCount = readU32(data + 36);
+    u32 levelCount = readU32(data + 40);
+    u32 supercompressionScheme = readU32(data + 44);
+
+    if (width == 0 || height == 0 || depth != 0 || layerCount > 1 || faceCount != 1) {
+        logError("Only 2D KTX2 textures without layers/faces are supported");
+        return QQ_FALSE;
+    }
+    if (supercompressionScheme != 0) {
+        logError("KTX2 supercompression is not supported");
+        return QQ_FALSE;
+    }
+
+    // Zero means loader should generate mips, there is still one level stored
+    if (levelCount == 0) {
+        levelCount = 1;
+    }
+
+    // Full chain ends at 1x1, more levels would shift extents out of range
+    u32 maxLevelCount = 1;
+    for (u32 size = width > height ? width : height; size > 1; size >>= 1) {
+        maxLevelCount += 1;
+    }
+    if (levelCount > maxLevelCount) {
+        logError("KTX2 has %u levels, %ux%u has at most %u", levelCount, width, height, maxLevelCount);
+        return QQ_FALSE;
+    }
+
+    if (dataSize < KTX2_HEADER_SIZE + (u64)levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE) {
+        logError("KTX2 level index is truncated");
+        return QQ_FALSE;
+    }
+
+    Ktx2Level* levels = malloc(sizeof(Ktx2Level) * levelCount);
+    for (u32 i = 0; i < levelCount; i++) {
+        const u8* entry = data + KTX2_HEADER_SIZE + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+
+        levels[i].offset = readU64(entry);
+        levels[i].size = readU64(entry + 8);
+        levels[i].width = width >> i ? width >> i : 1;
+        levels[i].height = height >> i ? height >> i : 1;
+
+        if (levels[i].offset > dataSize || levels[i].size > dataSize - levels[i].offset) {
+            logError("KTX2 level %u is out of file bounds", i);
+            free(levels);
+            return QQ_FALSE;
+        }
+    }
+
+    texture->data = data;
+    texture->dataSize = dataSize;
+    texture->format = format;
+    texture->width = width;
+    texture->height = height;
+    texture->levelCount = levelCount;
+    texture->levels = levels;
+
+    return QQ_TRUE;
+}
+
+b32 ktx2Load(const char* path, Ktx2Texture* texture) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return QQ_FALSE;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize <= 0) {
+        fclose(file);
+        return QQ_FALSE;
+    }
+
+    u8* data = malloc(fileSize);
+    size_t readSize = fread(data, 1, fileSize, file);
+    fclose(file);
+
+    if (readSize != (size_t)fileSize || ktx2Parse(data, (u64)fileSize, texture) == QQ_FALSE) {
+        logError("Failed to read KTX2 texture %s", path);
+        free(data);
+        return QQ_FALSE;
+    }
+
+    return QQ_TRUE;
+}
+
+void ktx2Free(Ktx2Texture* texture) {
+    free(texture->levels);
+    free(texture->data);
+}
+
+const u8* ktx2GetLevelData(const Ktx2Texture* texture, u32 level) {
+    return texture->data + texture->levels[level].offset;
+}
+
+// Data format descriptor (Khronos Data Format) color models
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC5 132
+#define KHR_DF_MODEL_BC7 134
+
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_TRANSFER_SRGB 2
+
+// Sample channel qualifier, marks alpha of sRGB formats as linear
+#define KHR_DF_SAMPLE_LINEAR 0x10
+
+#define KHR_DF_CHANNEL_ALPHA 15
+
+typedef struct {
+    u32 bitOffset;
+    u32 bitLength;
+    u32 channel;
+    u32 upper;
+} Ktx2Sample;
+
+static void writeU32(u8* data, u32 value) {
+    data[0] = (u8)value;
+    data[1] = (u8)(value >> 8);
+    data[2] = (u8)(value >> 16);
+    data[3] = (u8)(value >> 24);
+}
+
+static void writeU64(u8* data, u64 value) {
+    writeU32(data, (u32)value);
+    writeU32(data + 4, (u32)(value >> 32));
+}
+
+// Fills descriptor of the format, returns its size (0 for unknown formats)
+static u32 buildDataFormatDescriptor(u32 format, u8* descriptor, u32* blockSize) {
+    u32 model;
+    u32 blockDimension = 3;
+    b32 isSrgb = QQ_FALSE;
+    Ktx2Sample samples[4];
+    u32 sampleCount = 1;
+
+    switch (format) {
+        case KTX2_FORMAT_R8G8B8A8_SRGB:
+            isSrgb = QQ_TRUE;
+            // fall through
+        case KTX2_FORMAT_R8G8B8A8_UNORM:
+            model = KHR_DF_MODEL_RGBSDA;
+            blockDimension = 0;
+            *blockSize = 4;
+            sampleCount = 4;
+            for (u32 i = 0; i < 4; i++) {
+                samples[i] = (Ktx2Sample){ i * 8, 8, i, 255 };
+            }
+            samples[3].channel = KHR_DF_CHANNEL_ALPHA | (isSrgb == QQ_TRUE ? KHR_DF_SAMPLE_LINEAR : 0);
+            break;
+        case KTX2_FORMAT_BC1_RGB_SRGB:
+        case KTX2_FORMAT_BC1_RGBA_SRGB:
+            isSrgb = QQ_TRUE;
+            // fall through
+        case KTX2_FORMAT_BC1_RGB_UNORM:
+        case KTX2_FORMAT_BC1_RGBA_UNORM:
+            model = KHR_DF_MODEL_BC1A;
+            *blockSize = 8;
+            samples[0] = (Ktx2Sample){ 0, 64, 0, U32_MAX };
+
+            // Punch-through alpha is described as a separate channel
+            if (format == KTX2_FORMAT_BC1_RGBA_UNORM || format == KTX2_FORMAT_BC1_RGBA_SRGB) {
+                samples[0].channel = 1;
+            }
+            break;
+        case KTX2_FORMAT_BC3_SRGB:
+            isSrgb = QQ_TRUE;
+            // fall through
+        case KTX2_FORMAT_BC3_UNORM:
+            model = KHR_DF_MODEL_BC3;
+            *blockSize = 16;
+            sampleCount = 2;
+            samples[0] = (Ktx2Sample){ 0, 64, KHR_DF_CHANNEL_ALPHA | (isSrgb == QQ_TRUE ? KHR_DF_SAMPLE_LINEAR : 0), U32_MAX };
+            samples[1] = (Ktx2Sample){ 64, 64, 0, U32_MAX };
+            break;
+        case KTX2_FORMAT_BC5_UNORM:
+            model = KHR_DF_MODEL_BC5;
+            *blockSize = 16;
+            sampleCount = 2;
+            samples[0] = (Ktx2Sample){ 0, 64, 0, U32_MAX };
+            samples[1] = (Ktx2Sample){ 64, 64, 1, U32_MAX };
+            break;
+        case KTX2_FORMAT_BC7_SRGB:
+            isSrgb = QQ_TRUE;
+            // fall through
+        case KTX2_FORMAT_BC7_UNORM:
+            model = KHR_DF_MODEL_BC7;
+            *blockSize = 16;
+            samples[0] = (Ktx2Sample){ 0, 128, 0, U32_MAX };
+            break;
+        default:
+            return 0;
+    }
+
+    u32 blockByteSize = 24 + 16 * sampleCount;
+    u32 totalSize = 4 + blockByteSize;
+    memset(descriptor, 0, totalSize);
+
+    writeU32(descriptor, totalSize);
+
+    // Vendor and descriptor type (Khronos basic descriptor) are zero
+    writeU32(descriptor + 8, 2 | (blockByteSize << 16));
+    descriptor[12] = (u8)model;
+    descriptor[13] = KHR_DF_PRIMARIES_BT709;
+    descriptor[14] = isSrgb == QQ_TRUE ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+
+    // Block dimensions are stored minus one
+    descriptor[16] = (u8)blockDimension;
+    descriptor[17] = (u8)blockDimension;
+    descriptor[20] = (u8)*blockSize;
+
+    for (u32 i = 0; i < sampleCount; i++) {
+        u8* sample = descriptor + 28 + i * 16;
+        writeU32(
+            sample,
+            samples[i].bitOffset | ((samples[i].bitLength - 1) << 16) | (samples[i].channel << 24)
+        );
+        writeU32(sample + 12, samples[i].upper);
+    }
+
+    return totalSize;
+}
+
+b32 ktx2Write(
+    const char* path,
+    u32 format,
+    u32 width,
+    u32 height,
+    u32 levelCount,
+    const u8* const* levelData,
+    const u64* levelSizes
+) {
+    u8 descriptor[4 + 24 + 16 * 4];
+    u32 blockSize = 0;
+    u32 descriptorSize = buildDataFormatDescriptor(format, descriptor, &blockSize);
+    if (descriptorSize == 0) {
+        logError("Cannot write KTX2 with format %u", format);
+        return QQ_FALSE;
+    }
+
+    // Level data must be aligned to lcm(block size, 4), block sizes are 4, 8 or 16
+    u64 alignment = blockSize;
+    u64 descriptorOffset = KTX2_HEADER_SIZE + (u64)levelCount * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    u64 dataOffset = descriptorOffset + descriptorSize;
+
+    // Levels are stored from the smallest one
+    u64* levelOffsets = malloc(sizeof(u64) * levelCount);
+    for (u32 i = levelCount; i > 0; i--) {
+        u32 level = i - 1;
+        dataOffset = (dataOffset + alignment - 1) / alignment * alignment;
+        levelOffsets[level] = dataOffset;
+        dataOffset += levelSizes[level];
+    }
+
+    u64 fileSize = dataOffset;
+    u8* data = calloc(fileSize, 1);
+
+    memcpy(data, ktx2Identifier, sizeof(ktx2Identifier));
+    writeU32(data + 12, format);
+    writeU32(data + 16, 1); // typeSize
+    writeU32(data + 20, width);
+    writeU32(data + 24, height);
+    writeU32(data + 28, 0); // depth
+    writeU32(data + 32, 0); // layer count
+    writeU32(data + 36, 1); // face count
+    writeU32(data + 40, levelCount);
+    writeU32(data + 44, 0); // supercompression
+
+    writeU32(data + 48, (u32)descriptorOffset);
+    writeU32(data + 52, descriptorSize);
+
+    // Key/value data and supercompression global data are left empty
+    for (u32 level = 0; level < levelCount; level++) {
+        u8* entry = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        writeU64(entry, levelOffsets[level]);
+        writeU64(entry + 8, levelSizes[level]);
+        writeU64(entry + 16, levelSizes[level]);
+        memcpy(data + levelOffsets[level], levelData[level], levelSizes[level]);
+    }
+
+    memcpy(data + descriptorOffset, descriptor, descriptorSize);
+
+    b32 isWritten = QQ_FALSE;
+    FILE* file = fopen(path, "wb");
+    if (file != NULL) {
+        isWritten = fwrite(data, 1, fileSize, file) == fileSize;
+        fclose(file);
+    }
+    if (isWritten == QQ_FALSE) {
+        logError("Failed to write KTX2 texture %s", path);
+    }
+
+    free(levelOffsets);
+    free(data);
+
+    return isWritten;
+}
@@ -0,0 +1,193 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <log.h>
+
+// Flusher sleep when the ring is empty
+#define LOG_FLUSH_INTERVAL_US 1000
+
+_Atomic i32 logLevel = LOG_LEVEL_INFO;
+
+static LogSlot slots[LOG_RING_CAPACITY];
+static _Atomic u64 enqueuePosition = 0;
+
+// Written by flusher only, read by logFlush
+static _Atomic u64 writtenPosition = 0;
+
+static _Atomic b32 isRunning = QQ_FALSE;
+static pthread_t flusherThread;
+static FILE* output = NULL;
+
+static const char* getLevelPrefix(LogLevel level) {
+    switch (level) {
+        case LOG_LEVEL_ERROR:
+            return "[ERROR] ";
+        case LOG_LEVEL_WARNING:
+            return "[WARNING] ";
+        default:
+            return "";
+    }
+}
+
+static FILE* getOutput() {
+    return output != NULL ? output : stdout;
+}
+
+// Writes every message which is complete, returns amount of written messages
+static u64 drainRing() {
+    u64 position = atomic_load_explicit(&writtenPosition, memory_order_relaxed);
+    u64 count = 0;
+    for (;;) {
+        LogSlot* slot = &slots[position & (LOG_RING_CAPACITY - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1) {
+            break;
+        }
+
+        fprintf(getOutput(), "%s%s\n", getLevelPrefix(slot->level), slot->text);
+
+        // Slot is free again for the position one lap later
+        atomic_store_explicit(&slot->sequence, position + LOG_RING_CAPACITY, memory_order_release);
+        position += 1;
+        count += 1;
+        atomic_store_explicit(&writtenPosition, position, memory_order_release);
+    }
+    return count;
+}
+
+static void* flusherMain(void* userData) {
+    (void)userData;
+
+    for (;;) {
+        if (drainRing() != 0) {
+            fflush(getOutput());
+            continue;
+        }
+
+        // Exits only with empty ring, producers which claimed a slot are waited for
+        if (
+            atomic_load(&isRunning) == QQ_FALSE
+            && atomic_load(&enqueuePosition) == atomic_load(&writtenPosition)
+        ) {
+            break;
+        }
+        usleep(LOG_FLUSH_INTERVAL_US);
+    }
+
+    return NULL;
+}
+
+void logSetLevel(LogLevel level) {
+    atomic_store(&logLevel, (i32)level);
+}
+
+b32 logParseLevel(const char* name, LogLevel* level) {
+    const char* names[] = {"debug", "info", "warning", "error", "none"};
+    for (u32 i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *level = (LogLevel)i;
+            return QQ_TRUE;
+        }
+    }
+    return QQ_FALSE;
+}
+
+b32 logStart(const char* path) {
+    if (path != NULL) {
+        output = fopen(path, "w");
+        if (output == NULL) {
+            fprintf(stdout, "[ERROR] Failed to open log file %s\n", path);
+            return QQ_FALSE;
+        }
+    }
+
+    // Slot `i` is free for position `i`
+    u64 position = atomic_load(&enqueuePosition);
+    for (u64 i = 0; i < LOG_RING_CAPACITY; i++) {
+        atomic_store(&slots[(position + i) & (LOG_RING_CAPACITY - 1)].sequence, position + i);
+    }
+    atomic_store(&writtenPosition, position);
+
+    atomic_store(&isRunning, QQ_TRUE);
+    if (pthread_create(&flusherThread, NULL, &flusherMain, NULL) != 0) {
+        atomic_store(&isRunning, QQ_FALSE);
+        fprintf(getOutput(), "[ERROR] Failed to start log flusher, logging synchronously\n");
+        return QQ_FALSE;
+    }
+    return QQ_TRUE;
+}
+
+void logStop() {
+    if (atomic_exchange(&isRunning, QQ_FALSE) == QQ_FALSE) {
+        return;
+    }
+    pthread_join(flusherThread, NULL);
+
+    // Producer which saw the flusher running right before it stopped
+    drainRing();
+
+    fflush(getOutput());
+    if (output != NULL) {
+        fclose(output);
+        output = NULL;
+    }
+}
+
+void logFlush() {
+    if (atomic_load(&isRunning) == QQ_FALSE) {
+        fflush(getOutput());
+        return;
+    }
+
+    u64 position = atomic_load(&enqueuePosition);
+    while (atomic_load_explicit(&writtenPosition, memory_order_acquire) < position) {
+        usleep(LOG_FLUSH_INTERVAL_US / 10);
+    }
+}
+
+void logWrite(LogLevel level, const char* format, ...) {
+    va_list arguments;
+    va_start(arguments, format);
+
+    if (atomic_load_explicit(&isRunning, memory_order_acquire) == QQ_FALSE) {
+        char text[LOG_MESSAGE_LENGTH];
+        vsnprintf(text, sizeof(text), format, arguments);
+        va_end(arguments);
+        fprintf(getOutput(), "%s%s\n", getLevelPrefix(level), text);
+        return;
+    }
+
+    // Claim next position once its slot was written out by the flusher
+    u64 position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+    LogSlot* slot;
+    for (;;) {
+        slot = &slots[position & (LOG_RING_CAPACITY - 1)];
+        u64 sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        i64 difference = (i64)sequence - (i64)position;
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(
+                &enqueuePosition,
+                &position,
+                position + 1,
+                memory_order_relaxed,
+                memory_order_relaxed
+            )) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Ring is full
+            sched_yield();
+            position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+        } else {
+            position = atomic_load_explicit(&enqueuePosition, memory_order_relaxed);
+        }
+    }
+
+    vsnprintf(slot->text, LOG_MESSAGE_LENGTH, format, arguments);
+    va_end(arguments);
+    slot->level = level;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+}
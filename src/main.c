@@ -18,12 +18,36 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <unistd.h>
 
 #include <qq.h>
+#include <jobs.h>
+#include <occlusion.h>
+#include <qq_time.h>
+#include <render_queue.h>
+#include <ktx2.h>
+#include <bcn.h>
+#include <mipmap.h>
+#include <staging_ring.h>
+#include <trace.h>
+#include <log.h>
+#include <embedded.h>
+#include <spirv_reflect.h>
 
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
-#define MAX_FRAMES_IN_FLIGHT 2
+
+// Upper bound of `--frames-in-flight`, per frame buffer slices are always sized for it
+// (shaders index them with the same stride)
+#define MAX_FRAMES_IN_FLIGHT 4
+
+// Presented frames tracked at once for latency measurement
+#define PRESENT_WAIT_MAX_PENDING 16
+
+// Frame pacing report interval of `--frame-stats`
+#define FRAME_STATS_INTERVAL_MS 1000.0
 
 #ifdef QQ_DEBUG
 const b32 debugModeEnabled = QQ_TRUE;
@@ -47,6 +71,139 @@ const b32 debugModeEnabled = QQ_FALSE;
 #define MESH_MODEL_PATH "model/lizard_triangle.obj"
 #define MESH_TEXTURE_PATH "texture/lizard.png"
 
+// Pre-compressed (BCn) version of the mesh texture, used instead of PNG when present
+#define MESH_TEXTURE_KTX2_PATH "texture/lizard.ktx2"
+
+// Resolution of software depth buffer used for occlusion culling
+#define OCCLUSION_BUFFER_WIDTH 320
+#define OCCLUSION_BUFFER_HEIGHT 192
+
+// Render queue ids, order of passes defines order of execution
+#define RENDER_PASS_DEPTH_PREPASS 0
+#define RENDER_PASS_OPAQUE 1
+
+// Pipeline kinds, render queue pipeline id is a variant of kind and shader features
+#define RENDER_PIPELINE_DEPTH_PREPASS 0
+#define RENDER_PIPELINE_MAIN 1
+#define RENDER_PIPELINE_MAIN_DEPTH_EQUAL 2
+
+#define RENDER_MESH_MODEL 0
+#define RENDER_MESH_MODEL_QUANTIZED 1
+
+// Shader features baked into pipeline variants, draws pay only for the ones they use
+#define SHADER_FEATURE_TEXTURE 0x1
+#define SHADER_FEATURE_VERTEX_COLOR 0x2
+#define SHADER_FEATURE_ALPHA_TEST 0x4
+// Positions as 16 bit UNORM within mesh bounds, changes vertex input only
+#define SHADER_FEATURE_QUANTIZED_POSITIONS 0x8
+#define SHADER_FEATURE_ALL 0xF
+
+// Specialization constant ids (constant_id in shaders)
+#define SHADER_CONSTANT_USE_TEXTURE 0
+// Fragment shader only, vertex shader reads colors only when built as vert_color.spv
+#define SHADER_CONSTANT_USE_VERTEX_COLOR 1
+#define SHADER_CONSTANT_USE_ALPHA_TEST 2
+#define SHADER_CONSTANT_ALPHA_CUTOFF 3
+#define SHADER_ALPHA_CUTOFF 0.5f
+
+// Every pass kind with every feature combination fits, so the pipeline count stays bounded
+#define MAX_PIPELINE_VARIANTS 64
+
+// Variants are compiled by pipeline workers, draws use fallback variant meanwhile
+#define PIPELINE_VARIANT_COMPILING 0
+#define PIPELINE_VARIANT_READY 1
+#define PIPELINE_VARIANT_FAILED 2
+#define PIPELINE_COMPILE_THREADS 2
+
+// Features fallback variants keep, vertex format must match the bound position stream
+#define SHADER_FEATURE_FALLBACK (SHADER_FEATURE_TEXTURE | SHADER_FEATURE_QUANTIZED_POSITIONS)
+// Features generic fallback keeps, it draws any material untextured
+#define SHADER_FEATURE_GENERIC_FALLBACK SHADER_FEATURE_QUANTIZED_POSITIONS
+
+// Global (bindless) descriptor set bindings, must match shaders
+#define GLOBAL_BINDING_FRAMES 0
+#define GLOBAL_BINDING_MATERIALS 1
+#define GLOBAL_BINDING_SAMPLER 2
+#define GLOBAL_BINDING_TEXTURES 3
+#define GLOBAL_BINDING_TEXTURE_RESIDENCY 4
+#define GLOBAL_BINDING_VIRTUAL_PAGE_TABLES 5
+#define GLOBAL_BINDING_VIRTUAL_TEXTURES 6
+#define GLOBAL_BINDING_VIRTUAL_FEEDBACK 7
+
+// Upper bounds of the global set, texture count is also clamped by device limits
+#define GLOBAL_TEXTURE_CAPACITY 4096
+#define GLOBAL_MATERIAL_CAPACITY 1024
+
+// Levels up to this size are uploaded at startup, larger ones are streamed afterwards
+#define TEXTURE_STREAM_RESIDENT_DIMENSION 64
+#define MAX_TEXTURE_STREAMS 16
+
+// Texture loading service, workers decode directly into slices of one staging ring
+#define TEXTURE_STAGING_RING_SIZE (64 * 1024 * 1024)
+#define TEXTURE_STAGING_RING_MAX_SLICES 1024
+#define TEXTURE_UPLOAD_BATCH_COUNT 4
+
+// Virtual texturing, pages of all virtual textures share one page cache image
+#define MAX_VIRTUAL_TEXTURES 8
+#define VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE 16
+
+// Feedback entries (pages of all virtual textures) in every frame slice
+#define VIRTUAL_FEEDBACK_CAPACITY (1 << 17)
+
+// Streamer limits, pages over the limits are requested again by next frames
+#define VIRTUAL_PAGE_MAX_REQUESTS 4096
+#define VIRTUAL_PAGE_MAX_PENDING_LOADS 32
+#define VIRTUAL_PAGE_UPLOADS_PER_FRAME 16
+
+// Texture atlas of small images, images over the size limit are left to the loading service
+#define ATLAS_LAYER_SIZE 2048
+#define ATLAS_MAX_LAYERS 8
+#define ATLAS_PADDING 8
+#define ATLAS_MAX_IMAGE_DIMENSION 512
+#define ATLAS_MAX_IMAGES 512
+// Mip levels of a layer copied at most, full chain of ATLAS_LAYER_SIZE has log2(size) + 1 levels
+#define ATLAS_MAX_LEVELS 12
+
+// Compute mip generation, one workgroup reduces 64x64 texels of level 0
+#define MIP_GENERATION_BLOCK_SIZE 64
+#define MIP_GENERATION_MAX_DIMENSION 4096
+#define MIP_GENERATION_MAX_TARGETS 32
+
+// Size of the image generated by `--bench-mip-generation`
+#define MIP_GENERATION_BENCHMARK_DIMENSION 4096
+#define MIP_GENERATION_BENCHMARK_ITERATIONS 20
+
+// Amount of draws sorted by `--bench-render-queue`
+#define RENDER_QUEUE_BENCHMARK_DRAW_COUNT 100000
+
+// Synthetic scene of `--bench-occlusion`: walls on a grid with boxes scattered behind them
+#define OCCLUSION_BENCHMARK_OCCLUDER_COUNT 64
+#define OCCLUSION_BENCHMARK_OBJECT_COUNT 4096
+#define OCCLUSION_BENCHMARK_FRAMES 120
+
+// Deterministic benchmark (`--bench`), simulated time advances by fixed step every frame
+#define BENCHMARK_TIMESTEP_SECONDS (1.0 / 60.0)
+#define BENCHMARK_WARMUP_FRAMES 60
+#define BENCHMARK_DEFAULT_FRAME_COUNT 1000
+
+// GPU profiler, timestamp pairs per frame slot and weight of new sample in scope average
+#define GPU_PROFILER_MAX_SCOPES 32
+#define GPU_PROFILER_MAX_FRAME_SCOPES 16
+#define GPU_PROFILER_AVERAGE_WEIGHT 0.05
+#define GPU_PROFILE_SCOPE_FRAME 0
+#define GPU_PROFILE_SCOPE_FRAME_NAME "frame"
+#define GPU_PROFILE_DEFAULT_OUTPUT_PATH "gpu_profile.json"
+
+// CPU trace written by F6 when no `--trace` path is given
+#define TRACE_DEFAULT_OUTPUT_PATH "trace.json"
+
+// Startup stages reported with the first frame and shaders read before the device exists
+#define STARTUP_MAX_STAGES 16
+#define STARTUP_SHADER_COUNT 5
+
+// Shader modules whose reflection is kept for layouts and pipelines
+#define MAX_SHADER_REFLECTIONS 8
+
 
 // GLOBALS
 // TODO: Put into structure
@@ -54,6 +211,150 @@ const b32 debugModeEnabled = QQ_FALSE;
 // Program start time
 f64 frameDeltaTime = 0.0f;
 
+// Time used for animation of the current frame
+f64 currentFrameTime = 0.0;
+
+// Worker threads for CPU side jobs
+JobPool jobPool;
+
+// CPU occlusion culling
+OcclusionCuller occlusionCuller;
+u32 meshOcclusionObject = 0;
+u32 meshOccluder = 0;
+
+// Startup timing, measured until the first frame is submitted
+f64 applicationStartTime = 0.0;
+b32 isFirstFramePresented = QQ_FALSE;
+StartupStage startupStages[STARTUP_MAX_STAGES];
+u32 startupStageCount = 0;
+f64 startupStageEndMs = 0.0;
+
+// Asset reads started in main, joined by initVulkan once the device exists
+b32 serialStartupEnabled = QQ_FALSE;
+StartupTask modelLoadTask;
+StartupTask meshTextureTask;
+StartupTask shaderReadTask;
+MeshTextureSource meshTextureSource;
+const char* startupShaderPaths[STARTUP_SHADER_COUNT] = {
+    "shader/vert.spv",
+    "shader/vert_color.spv",
+    "shader/frag.spv",
+    "shader/depth_vert.spv",
+    "shader/downsample_comp.spv"
+};
+VulkanShaderCode startupShaderCodes[STARTUP_SHADER_COUNT];
+
+// Progressive texture streaming, levels are decoded on own thread to not delay frame jobs
+b32 textureStreamingEnabled = QQ_TRUE;
+JobPool streamingJobPool;
+TextureStream textureStreams[MAX_TEXTURE_STREAMS];
+u32 textureStreamCount = 0;
+
+// Staging buffer shared by streams, holds one level at a time
+VkBuffer streamStagingBuffer = VK_NULL_HANDLE;
+VkDeviceMemory streamStagingBufferMemory = VK_NULL_HANDLE;
+u8* streamStagingMapped = NULL;
+VkDeviceSize streamStagingSize = 0;
+b32 isStreamStagingBusy = QQ_FALSE;
+
+// Host visible memory used for texture uploads
+VkDeviceSize textureStagingBytes = 0;
+VkDeviceSize textureStagingPeakBytes = 0;
+
+// Texture loading service (see `requestTextureLoad`)
+b32 isTextureLoaderCreated = QQ_FALSE;
+StagingRing textureStagingRing;
+VkBuffer textureStagingRingBuffer;
+VkDeviceMemory textureStagingRingMemory;
+u8* textureStagingRingMapped = NULL;
+TextureLoadRequest** textureLoadRequests = NULL;
+u32 textureLoadRequestCount = 0;
+u32 textureLoadRequestCapacity = 0;
+TextureUploadBatch textureUploadBatches[TEXTURE_UPLOAD_BATCH_COUNT];
+u32 textureUploadBatchSubmitCount = 0;
+
+// Directory loaded at startup with `--load-textures`
+const char* textureDirectoryPath = NULL;
+
+// Virtual textures (see `createVirtualTexture`), file is set by `--virtual-texture`
+const char* virtualTexturePath = NULL;
+VirtualTexture virtualTextures[MAX_VIRTUAL_TEXTURES];
+u32 virtualTextureCount = 0;
+u64 virtualFrameNumber = 0;
+
+// Page table of every virtual texture, bound in global set
+VkImage virtualPageTableImages[MAX_VIRTUAL_TEXTURES];
+VkDeviceMemory virtualPageTableImageMemories[MAX_VIRTUAL_TEXTURES];
+VkImageView virtualPageTableImageViews[MAX_VIRTUAL_TEXTURES];
+
+// Physical page cache, created with the first virtual texture
+b32 isVirtualPageCacheCreated = QQ_FALSE;
+VirtualPageCache virtualPageCache;
+VkImage virtualPageCacheImage;
+VkDeviceMemory virtualPageCacheImageMemory;
+VkImageView virtualPageCacheImageView;
+u32 virtualPageCacheTexture = 0;
+
+// Entries of all virtual textures, written once per texture
+VkBuffer virtualTextureBuffer;
+VkDeviceMemory virtualTextureBufferMemory;
+VirtualTextureData* virtualTexturesMapped;
+
+// Pages requested by fragment shader, one slice per frame in flight
+VkBuffer virtualFeedbackBuffer;
+VkDeviceMemory virtualFeedbackBufferMemory;
+u32* virtualFeedbackMapped;
+u32 virtualFeedbackUsed = 0;
+
+// Page uploads followed by page table copies, one slice per frame in flight
+VkBuffer virtualStagingBuffer;
+VkDeviceMemory virtualStagingBufferMemory;
+u8* virtualStagingMapped;
+VkDeviceSize virtualStagingFrameSize = 0;
+
+// Streamer state, uploads are recorded into the command buffer of the frame
+typedef struct {
+    u32 texture;
+    u32 page;
+    u32 level;
+} VirtualPageRequest;
+VirtualPageRequest* virtualPageRequests = NULL;
+VirtualPageLoad virtualPageLoads[VIRTUAL_PAGE_MAX_PENDING_LOADS];
+u32 virtualPageUploadSlots[VIRTUAL_PAGE_UPLOADS_PER_FRAME];
+u32 virtualPageUploadCount = 0;
+u32 virtualPageTableUploadMask = 0;
+u64 virtualPagesUploaded = 0;
+
+// Texture atlas loaded with `--atlas` (see `createTextureAtlas`), one array image for all images
+const char* atlasDirectoryPath = NULL;
+AtlasImage* atlasImages = NULL;
+u32 atlasImageCount = 0;
+u32 atlasLayerCount = 0;
+VkImage atlasImage;
+VkDeviceMemory atlasImageMemory;
+VkImageView atlasLayerViews[ATLAS_MAX_LAYERS];
+
+// Material drawn on the mesh, F4 cycles through atlas materials
+u32 meshMaterialChoice = 0;
+
+// Single pass compute mip generation (see `recordMipGeneration`)
+b32 isMipGenerationSupported = QQ_FALSE;
+VkDescriptorSetLayout mipGenerationSetLayout;
+VkPipelineLayout mipGenerationPipelineLayout;
+VkPipeline mipGenerationPipeline;
+VkDescriptorPool mipGenerationDescriptorPool;
+VkBuffer mipGenerationCounterBuffer;
+VkDeviceMemory mipGenerationCounterBufferMemory;
+VkDeviceSize mipGenerationCounterStride = 0;
+b32 mipGenerationCounterSlots[MIP_GENERATION_MAX_TARGETS];
+b32 mipGenerationBenchmarkEnabled = QQ_FALSE;
+
+// Draws of the current frame, sorted by state before recording
+RenderQueue renderQueue;
+RenderQueueStats renderQueueFrameStats = {0};
+RenderQueueStats renderQueueTotalStats = {0};
+u64 renderQueueFrameCount = 0;
+
 // GLFW window
 GLFWwindow *window;
 
@@ -83,15 +384,48 @@ VkImageView* swapchainImageViews;
 // Rendering surface
 VkSurfaceKHR surface;
 
-// Descriptor set layout
+// Descriptor set layout, bindings are reflected from shaders
 VkDescriptorSetLayout descriptorSetLayout;
+VkDescriptorSetLayoutBinding globalBindings[SPIRV_REFLECT_MAX_BINDINGS];
+u32 globalBindingCount = 0;
+
+// Shader stages which declare draw push constants
+VkShaderStageFlags drawPushConstantStages = 0;
+
+// Reflected shader modules
+ShaderReflection shaderReflections[MAX_SHADER_REFLECTIONS];
+u32 shaderReflectionCount = 0;
 
 // Rendering pass and pipeline layout
 VkRenderPass renderPass;
 VkPipelineLayout pipelineLayout;
 
-// Rendering pipeline
-VkPipeline graphicsPipeline;
+// Shader modules of graphics pipelines, variants are created from them on first use
+VkShaderModule vertShaderModule;
+VkShaderModule vertColorShaderModule;
+VkShaderModule fragShaderModule;
+VkShaderModule depthVertShaderModule;
+
+// Vertex inputs of the modules, kept apart from reflection cache which pipeline workers must not touch
+SpirvReflection vertShaderReflection;
+SpirvReflection vertColorShaderReflection;
+SpirvReflection depthVertShaderReflection;
+
+// Rendering pipelines, one per pass kind and shader feature set
+PipelineVariant pipelineVariants[MAX_PIPELINE_VARIANTS];
+u32 pipelineVariantCount = 0;
+
+// Pipeline workers share the cache, it is internally synchronized
+// Cache is loaded from and saved into `--pipeline-cache` file when given
+VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+const char* pipelineCachePath = NULL;
+b32 asyncPipelinesEnabled = QQ_TRUE;
+JobPool pipelineJobPool;
+JobCounter pipelineCompileCounter;
+PipelineCompileStats pipelineCompileStats = {0};
+
+// Opt-in depth pre-pass, toggled at runtime with F2
+b32 depthPrepassEnabled = QQ_FALSE;
 
 // Framebuffers
 VkFramebuffer* swapchainFramebuffers;
@@ -99,21 +433,60 @@ VkFramebuffer* swapchainFramebuffers;
 // Command pool
 VkCommandPool commandPool;
 
-// Vertex buffer and memory for it
-VkBuffer vertexBuffer;
-VkDeviceMemory vertexBufferMemory;
+// Vertex streams: tightly packed positions and the rest of the attributes
+VkBuffer vertexPositionBuffer;
+VkDeviceMemory vertexPositionBufferMemory;
+VkBuffer vertexAttributeBuffer;
+VkDeviceMemory vertexAttributeBufferMemory;
+
+// Positions as 16 bit fractions of mesh bounds, bound instead of full precision ones
+b32 quantizedPositionsEnabled = QQ_FALSE;
+VkBuffer vertexQuantizedPositionBuffer = VK_NULL_HANDLE;
+VkDeviceMemory vertexQuantizedPositionBufferMemory = VK_NULL_HANDLE;
+
+// Mesh has other than white vertex colors, so they are worth reading
+b32 meshHasVertexColors = QQ_FALSE;
 
 // Index buffer and memory for it
 VkBuffer indexBuffer;
 VkDeviceMemory indexBufferMemory;
 
-// Descriptor pool
+// Descriptor pool and the only (global) descriptor set, created once
+// Textures are referenced by index, so set survives swapchain recreation
 VkDescriptorPool descriptorPool;
-VkDescriptorSet* descriptorSets;
+VkDescriptorSet globalDescriptorSet;
+
+// Amount of registered textures and size of the texture array
+u32 globalTextureCount = 0;
+u32 globalTextureCapacity = 0;
+
+// Uniform buffer, one UniformBufferObject slice per frame in flight
+VkBuffer uniformBuffer;
+VkDeviceMemory uniformBufferMemory;
+
+// Uniform buffer stays mapped for its whole lifetime
+UniformBufferObject* uniformBufferMapped;
+
+// Materials storage buffer, persistently mapped and indexed from push constants
+VkBuffer materialBuffer;
+VkDeviceMemory materialBufferMemory;
+MaterialData* materialsMapped;
+u32 materialCount = 0;
+
+// Shader features every material needs (SHADER_FEATURE_...), selects its pipeline variant
+u32 materialFeatures[GLOBAL_MATERIAL_CAPACITY];
+
+// Features allowed to be enabled, cleared bits fall back to the simpler variant
+u32 shaderFeatureMask = SHADER_FEATURE_ALL;
 
-// Uniform buffers
-VkBuffer* uniformBuffers;
-VkDeviceMemory* uniformBuffersMemory;
+// Material of the loaded mesh
+u32 meshMaterial = 0;
+
+// Per texture min LOD, one value per frame in flight ([texture][frame])
+// Written for the frame being recorded, so frames in flight keep their clamp
+VkBuffer textureResidencyBuffer;
+VkDeviceMemory textureResidencyBufferMemory;
+f32* textureResidencyMapped;
 
 // Command buffers
 VkCommandBuffer* commandBuffers;
@@ -128,6 +501,7 @@ VkImageView colorImageView;
 
 // Loaded image handle and memory
 u32 mipLevels = 0; // Amount of mip levels
+VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
 VkImage textureImage;
 VkDeviceMemory textureImageMemory;
 VkSampler textureSampler;
@@ -143,12 +517,85 @@ VkImageView depthImageView;
 // Current frame index
 u32 currentFrame = 0;
 
+// Headless mode (`--headless`), no window or surface, frames go into offscreen images
+// standing in for swapchain images, one per frame slot
+b32 headlessEnabled = QQ_FALSE;
+u32 headlessWidth = WINDOW_WIDTH;
+u32 headlessHeight = WINDOW_HEIGHT;
+u64 headlessFrameCount = 300;
+const char* headlessCapturePath = NULL;
+VkDeviceMemory* headlessImageMemories = NULL;
+
+// Frames submitted so far, main loop ends on request or after headless frame count
+u64 submittedFrameCount = 0;
+b32 isExitRequested = QQ_FALSE;
+
+// Benchmark run, frames after warmup are measured and reported as JSON (`--bench-output`)
+b32 benchmarkEnabled = QQ_FALSE;
+u32 benchmarkFrameCount = BENCHMARK_DEFAULT_FRAME_COUNT;
+const char* benchmarkOutputPath = NULL;
+f64 benchmarkStartTimeMs = 0.0;
+f64* benchmarkCpuTimesMs = NULL;
+f64* benchmarkGpuTimesMs = NULL;
+u32 benchmarkCpuSampleCount = 0;
+u32 benchmarkGpuSampleCount = 0;
+
+// GPU profiler, scopes of every frame slot are read once the slot is waited for
+VkQueryPool gpuProfilerQueryPool = VK_NULL_HANDLE;
+f64 timestampPeriodNs = 0.0;
+u64 timestampMask = U64_MAX;
+GpuProfileScope gpuProfileScopes[GPU_PROFILER_MAX_SCOPES];
+u32 gpuProfileScopeCount = 0;
+u32 gpuProfileDepth = 0;
+u32 gpuProfileFrameScopes[MAX_FRAMES_IN_FLIGHT][GPU_PROFILER_MAX_FRAME_SCOPES];
+u32 gpuProfileFrameScopeCounts[MAX_FRAMES_IN_FLIGHT];
+u64 gpuProfileFrames[MAX_FRAMES_IN_FLIGHT];
+const char* gpuProfileOutputPath = NULL;
+
+// CPU trace, recorded from start with `--trace` or between two F6 presses
+const char* traceOutputPath = NULL;
+
+// Log goes into stdout unless `--log-file` is given, level is set by `--log-level`
+const char* logFilePath = NULL;
+
+// Frame pacing, configured from command line (`--frames-in-flight`, `--present-mode`, `--fps-limit`)
+u32 framesInFlight = 2;
+b32 isPresentModeRequested = QQ_FALSE;
+VkPresentModeKHR requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+VkPresentModeKHR swapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+f64 frameLimitFps = 0.0;
+f64 nextFrameStartMs = 0.0;
+
+// Input to present latency, present wait is optional (frame completion is used without it)
+b32 isPresentWaitSupported = QQ_FALSE;
+PFN_vkWaitForPresentKHR waitForPresentKHR = NULL;
+u64 presentId = 0;
+PendingPresent pendingPresents[PRESENT_WAIT_MAX_PENDING];
+u32 pendingPresentHead = 0;
+u32 pendingPresentCount = 0;
+
+// Input time of the frame submitted in every frame slot (0 when none)
+f64 frameInputTimesMs[MAX_FRAMES_IN_FLIGHT];
+
+// Frame statistics, printed every interval with `--frame-stats` and on F3
+b32 frameStatsEnabled = QQ_FALSE;
+FrameStats frameStats;
+FrameStats lastFrameStats;
+
 // Flag to handle resize explicitly
 u32 framebufferResized = QQ_FALSE;
 
-// Semaphores and fence
-VkFence* inFlightFences;
-VkFence* imagesInFlight;
+// Every graphics queue submission signals the next value of one timeline semaphore,
+// so completion of anything submitted is a single counter comparison
+VkSemaphore graphicsTimeline = VK_NULL_HANDLE;
+u64 graphicsTimelineValue = 0;
+HostWaitStats hostWaitStats[HOST_WAIT_SITE_COUNT];
+
+// Timeline value of the last frame submitted in every frame slot and with every swapchain image
+u64 frameTimelineValues[MAX_FRAMES_IN_FLIGHT];
+u64* imageTimelineValues;
+
+// Binary semaphores, swapchain acquire and present cannot use timelines
 VkSemaphore* imageAvailableSemaphores;
 VkSemaphore* renderFinishedSemaphores;
 
@@ -171,9 +618,18 @@ u32* meshIndices = NULL;
 VkBuffer meshVertexBuffer;
 VkDeviceMemory meshVertexBufferMemory;
 
+// Object space bounds of the loaded mesh
+vec3 meshBoundsMin = {0.0f, 0.0f, 0.0f};
+vec3 meshBoundsMax = {0.0f, 0.0f, 0.0f};
+
 // ------ END GLOBALS
 
 
+// Seconds since start, used instead of GLFW timer which needs a display
+f64 getApplicationTime() {
+    return (getTimeMs() - applicationStartTime) / 1000.0;
+}
+
 // Determines max amount of samples per pixel
 VkSampleCountFlagBits getMaxUsableSampleCount() {
     VkPhysicalDeviceProperties physicalDeviceProperties;
@@ -196,48 +652,222 @@ VkSampleCountFlagBits getMaxUsableSampleCount() {
 
 // ------ VERTEX HELPERS
 // All functions below are related to Vertex struct (ideally, methods in the class)
-VkVertexInputBindingDescription getVertexBindingDescription() {
-    VkVertexInputBindingDescription bindingDescription = {
-        // Positional index
+// Vertex data is split into 2 streams on GPU:
+//  - binding 0: positions only (used by depth pre-pass as well)
+//  - binding 1: remaining attributes
+// Pipelines bind only the streams their vertex shader reads (see getVertexInputDescription)
+#define VERTEX_STREAM_COUNT 3
+
+// Location directive in shaders of every attribute the mesh provides
+const VertexStream vertexStreams[VERTEX_STREAM_COUNT] = {
+    {
+        .location = 0,
         .binding = 0,
+        .offset = 0,
+        .stride = sizeof(vec3),
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .componentType = SPIRV_COMPONENT_FLOAT
+    },
+    {
+        .location = 1,
+        .binding = 1,
+        .offset = offsetof(VertexAttributes, color),
+        .stride = sizeof(VertexAttributes),
+        .format = VK_FORMAT_R32G32B32_SFLOAT,
+        .componentType = SPIRV_COMPONENT_FLOAT
+    },
+    {
+        .location = 2,
+        .binding = 1,
+        .offset = offsetof(VertexAttributes, uv),
+        .stride = sizeof(VertexAttributes),
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .componentType = SPIRV_COMPONENT_FLOAT
+    }
+};
+
+// Replaces position stream of meshes with quantized positions, shader reads it as floats in [0, 1]
+const VertexStream quantizedPositionStream = {
+    .location = 0,
+    .binding = 0,
+    .offset = 0,
+    .stride = sizeof(u16) * 4,
+    .format = VK_FORMAT_R16G16B16A16_UNORM,
+    .componentType = SPIRV_COMPONENT_FLOAT
+};
+
+// Attributes the vertex shader reads and their bindings, inputs it never reads are not fetched
+b32 getVertexInputDescription(const SpirvReflection* reflection, u32 features, VertexInputDescription* description) {
+    *description = (VertexInputDescription){.bindingCount = 0, .attributeCount = 0};
+
+    for (u32 i = 0; i < reflection->inputCount; i++) {
+        const SpirvInput* input = &reflection->inputs[i];
+        if (input->isUsed == QQ_FALSE) {
+            logDebug(" - Vertex input at location %u is never read, stream is skipped", input->location);
+            continue;
+        }
+
+        const VertexStream* stream = NULL;
+        for (u32 j = 0; j < VERTEX_STREAM_COUNT; j++) {
+            if (vertexStreams[j].location == input->location) {
+                stream = &vertexStreams[j];
+            }
+        }
+        if ((features & SHADER_FEATURE_QUANTIZED_POSITIONS) != 0 && input->location == quantizedPositionStream.location) {
+            stream = &quantizedPositionStream;
+        }
+        if (stream == NULL) {
+            logError("Vertex shader reads location %u, which mesh does not provide", input->location);
+            return QQ_FALSE;
+        }
+
+        // Shader may read fewer or more components, missing ones are filled in by the device
+        if (input->componentType != stream->componentType) {
+            logError("Vertex shader reads location %u in other format than mesh provides", input->location);
+            return QQ_FALSE;
+        }
+
+        description->attributes[description->attributeCount] = (VkVertexInputAttributeDescription){
+            .binding = stream->binding,
+            .location = stream->location,
+            .format = stream->format,
+            .offset = stream->offset
+        };
+        description->attributeCount += 1;
+
+        // Binding is added with its first attribute
+        b32 isBound = QQ_FALSE;
+        for (u32 j = 0; j < description->bindingCount; j++) {
+            if (description->bindings[j].binding == stream->binding) {
+                isBound = QQ_TRUE;
+            }
+        }
+        if (isBound == QQ_FALSE) {
+            description->bindings[description->bindingCount] = (VkVertexInputBindingDescription){
+                .binding = stream->binding,
+                // Distance between each entry
+                .stride = stream->stride,
+                // Move to the next data entry after each vertex
+                .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+            };
+            description->bindingCount += 1;
+        }
+    }
+
+    return QQ_TRUE;
+}
+// ------ END VERTEX HELPERS
 
-        // Distance between each entry
-        .stride = sizeof(Vertex),
+void createGraphicsTimeline() {
+    logDebug("Creating graphics timeline");
 
-        // Move to the next data entry after each vertex
-        .inputRate = VK_VERTEX_INPUT_RATE_VERTEX
+    VkSemaphoreTypeCreateInfo typeInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0
+    };
+    VkSemaphoreCreateInfo semaphoreInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &typeInfo
     };
+    if (vkCreateSemaphore(logicalDevice, &semaphoreInfo, NULL, &graphicsTimeline) != VK_SUCCESS) {
+        logError("Failed to create graphics timeline semaphore");
+    }
+}
 
-    return bindingDescription;
+b32 isTimelineValueReached(u64 value) {
+    u64 completedValue = 0;
+    vkGetSemaphoreCounterValue(logicalDevice, graphicsTimeline, &completedValue);
+    return completedValue >= value;
 }
 
-VkVertexInputAttributeDescription* getVertexAttributeDescription() {
-    // TODO: Not sure if allocating memory here is a good idea
-    VkVertexInputAttributeDescription* attributeDescription = malloc(
-        3 * sizeof(VkVertexInputAttributeDescription)
-    );
+// Blocks until GPU finished everything submitted up to `value`, time spent blocked is recorded per site
+void waitTimelineValue(u64 value, HostWaitSite site) {
+    HostWaitStats* stats = &hostWaitStats[site];
+    stats->waitCount += 1;
+    if (isTimelineValueReached(value) == QQ_TRUE) {
+        return;
+    }
+
+    f64 startTime = getTimeMs();
+    VkSemaphoreWaitInfo waitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &graphicsTimeline,
+        .pValues = &value
+    };
+    if (vkWaitSemaphores(logicalDevice, &waitInfo, U64_MAX) != VK_SUCCESS) {
+        logError("Failed to wait for graphics timeline");
+    }
+
+    f64 stallTimeMs = getTimeMs() - startTime;
+    stats->stallCount += 1;
+    stats->stallTimeMs += stallTimeMs;
+    stats->maxStallTimeMs = max(stats->maxStallTimeMs, stallTimeMs);
+}
+
+// Submits command buffer to graphics queue, returns timeline value signaled on completion
+// Binary semaphores are only used for swapchain (VK_NULL_HANDLE when not needed)
+u64 submitGraphicsCommands(
+    VkCommandBuffer commandBuffer,
+    VkSemaphore waitSemaphore,
+    VkPipelineStageFlags waitStage,
+    VkSemaphore signalSemaphore
+) {
+    u64 value = graphicsTimelineValue + 1;
 
-    // Provide position data location
-    attributeDescription[0].binding = 0;
-    attributeDescription[0].location = 0; // Location directive in shader
-    attributeDescription[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescription[0].offset = offsetof(Vertex, position);
+    // Values of binary semaphores are ignored
+    VkSemaphore signalSemaphores[2] = {graphicsTimeline, signalSemaphore};
+    u64 signalValues[2] = {value, 0};
+    u32 signalCount = signalSemaphore != VK_NULL_HANDLE ? 2 : 1;
 
-    // Provide color data location
-    attributeDescription[1].binding = 0;
-    attributeDescription[1].location = 1; // Location directive in shader
-    attributeDescription[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescription[1].offset = offsetof(Vertex, color);
+    VkTimelineSemaphoreSubmitInfo timelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .signalSemaphoreValueCount = signalCount,
+        .pSignalSemaphoreValues = signalValues
+    };
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timelineInfo,
+        .waitSemaphoreCount = waitSemaphore != VK_NULL_HANDLE ? 1 : 0,
+        .pWaitSemaphores = &waitSemaphore,
+        .pWaitDstStageMask = &waitStage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = signalCount,
+        .pSignalSemaphores = signalSemaphores
+    };
+    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        logError("Failed to submit to graphics queue");
+        return graphicsTimelineValue;
+    }
+
+    graphicsTimelineValue = value;
+    return value;
+}
 
-    // Provide UV coordinates
-    attributeDescription[2].binding = 0;
-    attributeDescription[2].location = 2;
-    attributeDescription[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescription[2].offset = offsetof(Vertex, uv);
+void printHostWaitStats() {
+    const char* siteNames[HOST_WAIT_SITE_COUNT] = {
+        [HOST_WAIT_FRAME_SLOT] = "frame slot",
+        [HOST_WAIT_SWAPCHAIN_IMAGE] = "swapchain image",
+        [HOST_WAIT_SINGLE_TIME_COMMANDS] = "single time commands"
+    };
 
-    return attributeDescription;
+    u64 completedValue = 0;
+    vkGetSemaphoreCounterValue(logicalDevice, graphicsTimeline, &completedValue);
+    logInfo("[SYNC] Timeline at %lu of %lu submitted", completedValue, graphicsTimelineValue);
+    for (u32 i = 0; i < HOST_WAIT_SITE_COUNT; i++) {
+        const HostWaitStats* stats = &hostWaitStats[i];
+        logInfo(
+            "[SYNC]   %s: %lu waits, %lu stalled, %.2f ms total, %.2f ms max",
+            siteNames[i],
+            stats->waitCount,
+            stats->stallCount,
+            stats->stallTimeMs,
+            stats->maxStallTimeMs
+        );
+    }
 }
-// ------ END VERTEX HELPERS
 
 // Helper to create command buffer and start recoring
 VkCommandBuffer beginSingleTimeCommands() {
@@ -261,18 +891,12 @@ VkCommandBuffer beginSingleTimeCommands() {
     return commandBuffer;
 }
 
-// Helper to stop recording of single time buffer
+// Helper to stop recording of single time buffer, waits for this submission only
 void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     vkEndCommandBuffer(commandBuffer);
 
-    VkSubmitInfo submitInfo = {
-        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .commandBufferCount = 1,
-        .pCommandBuffers = &commandBuffer
-    };
-
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
+    u64 value = submitGraphicsCommands(commandBuffer, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+    waitTimelineValue(value, HOST_WAIT_SINGLE_TIME_COMMANDS);
 
     vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
 }
@@ -299,7 +923,7 @@ VkFormat findSupportedFormat(
             return candidates[i];
         }
 
-        printf("[ERROR] Failed to find supported foramt!\n");
+        logError("Failed to find supported foramt!");
     }
 }
 
@@ -350,10 +974,22 @@ u32 findMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties) {
         }
     }
 
-    printf("[ERROR] Failed to find suitable memory type\n");
+    logError("Failed to find suitable memory type");
     return 0;
 }
 
+// Checks if any memory type has all `properties`
+b32 isMemoryTypeAvailable(VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    for (u32 i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return QQ_TRUE;
+        }
+    }
+    return QQ_FALSE;
+}
+
 // Helper to create and allocate buffer(-s?)
 void createBuffer(
     VkDeviceSize size,
@@ -362,7 +998,7 @@ void createBuffer(
     VkBuffer* buffer,
     VkDeviceMemory* bufferMemory
 ) {
-    printf("[LOG] Attempting to create buffer of size %d\n", size);
+    logDebug("Attempting to create buffer of size %lu", size);
 
     // Create buffer
     VkBufferCreateInfo bufferInfo = {
@@ -373,7 +1009,7 @@ void createBuffer(
     };
 
     if (vkCreateBuffer(logicalDevice, &bufferInfo, NULL, buffer) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create buffer\n");
+        logError("Failed to create buffer");
     }
 
     // Get memory requirements for this type of buffer
@@ -392,7 +1028,7 @@ void createBuffer(
         .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties)
     };
     if (vkAllocateMemory(logicalDevice, &allocInfo, NULL, bufferMemory) != VK_SUCCESS) {
-        printf("[ERROR] Failed to allocate buffer memory\n");
+        logError("Failed to allocate buffer memory");
     }
 
     // Bind buffer memory
@@ -446,7 +1082,7 @@ void createImage(
     };
 
     if (vkCreateImage(logicalDevice, &imageInfo, NULL, image) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create image\n");
+        logError("Failed to create image");
     }
 
     // Get requirements and allocate memory for the image
@@ -462,7 +1098,7 @@ void createImage(
         )
     };
     if (vkAllocateMemory(logicalDevice, &allocInfo, NULL, imageMemory) != VK_SUCCESS) {
-        printf("[ERROR] Failed to allocate memory for the image");
+        logError("Failed to allocate memory for the image");
     }
 
     vkBindImageMemory(logicalDevice, *image, *imageMemory, 0);
@@ -485,14 +1121,28 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(VkSurfaceFormatKHR* formats, u32 coun
 }
 
 // Determines presentation mode
+const char* getPresentModeName(VkPresentModeKHR mode) {
+    switch (mode) {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+        default: return "unknown";
+    }
+}
+
+// Uses mode set by `--present-mode` (MAILBOX when not set) if surface supports it
 VkPresentModeKHR chooseSwapPresentMode(VkPresentModeKHR* modes, u32 count) {
     for (u32 i = 0; i < count; i++) {
-        if (modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) {
-            // Preferred display mode
-            return VK_PRESENT_MODE_MAILBOX_KHR;
+        if (modes[i] == requestedPresentMode) {
+            return requestedPresentMode;
         }
     }
 
+    if (isPresentModeRequested == QQ_TRUE) {
+        logWarning("Present mode %s is not supported, using fifo", getPresentModeName(requestedPresentMode));
+    }
+
     // This mode should be always available
     return VK_PRESENT_MODE_FIFO_KHR;
 }
@@ -573,7 +1223,7 @@ SwapchainSupportDetails querySwapChainSupport(VkPhysicalDevice device) {
 }
 
 QueueFamilyIndices findVulkanQueueFamilies(VkPhysicalDevice device) {
-    printf("Checking for required queue families\n");
+    logDebug("Checking for required queue families");
 
     QueueFamilyIndices indices = {
         .isGraphicsSet = QQ_FALSE,
@@ -599,6 +1249,11 @@ QueueFamilyIndices findVulkanQueueFamilies(VkPhysicalDevice device) {
             continue;
         }
 
+        // There is no surface to present to in headless mode
+        if (headlessEnabled == QQ_TRUE) {
+            continue;
+        }
+
         VkBool32 presentSupport = QQ_FALSE;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         if (indices.isPresentSet == QQ_FALSE && presentSupport != QQ_FALSE) {
@@ -618,11 +1273,49 @@ QueueFamilyIndices findVulkanQueueFamilies(VkPhysicalDevice device) {
 
     free(queueFamilies);
 
+    // Headless frames are never presented, graphics queue stands in for present queue
+    if (headlessEnabled == QQ_TRUE && indices.isGraphicsSet == QQ_TRUE) {
+        indices.present = indices.graphics;
+        indices.isPresentSet = QQ_TRUE;
+    }
+
     return indices;
 }
 
+// Offscreen color images used as swapchain images in headless mode
+void createHeadlessTargets() {
+    logDebug("Creating headless targets (%ux%u)", headlessWidth, headlessHeight);
+
+    swapchainImageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    swapchainExtent = (VkExtent2D){headlessWidth, headlessHeight};
+
+    // Frame slot renders into its own image, so image index is the frame slot
+    swapchainImageCount = framesInFlight;
+    swapchainImages = (VkImage*)malloc(swapchainImageCount * sizeof(VkImage));
+    headlessImageMemories = (VkDeviceMemory*)malloc(swapchainImageCount * sizeof(VkDeviceMemory));
+    for (u32 i = 0; i < swapchainImageCount; i++) {
+        createImage(
+            headlessWidth,
+            headlessHeight,
+            1,
+            VK_SAMPLE_COUNT_1_BIT,
+            swapchainImageFormat,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &swapchainImages[i],
+            &headlessImageMemories[i]
+        );
+    }
+}
+
 void createSwapchain() {
-    printf("Creating swapchain\n");
+    if (headlessEnabled == QQ_TRUE) {
+        createHeadlessTargets();
+        return;
+    }
+
+    logDebug("Creating swapchain");
 
     SwapchainSupportDetails swapChainSupport = querySwapChainSupport(
         physicalDevice
@@ -700,6 +1393,7 @@ void createSwapchain() {
     // Specify present mode
     // Don't case about pixels obscured by another window
     createInfo.presentMode = presentMode;
+    swapchainPresentMode = presentMode;
     createInfo.clipped = VK_TRUE;
 
     // Specify previous swap chain (in case of recreation)
@@ -710,7 +1404,7 @@ void createSwapchain() {
     if (
         vkCreateSwapchainKHR(logicalDevice, &createInfo, NULL, &swapchain) != VK_SUCCESS
     ) {
-        printf("[ERR] Failed to create vulkan swapchain");
+        logError("Failed to create vulkan swapchain");
     }
 
     // Get swap chain images
@@ -749,12 +1443,33 @@ void createSwapchain() {
 }
 
 
+b32 isDeviceExtensionAvailable(VkPhysicalDevice device, const char* name) {
+    u32 extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, NULL);
+
+    VkExtensionProperties* availableExtensions = (VkExtensionProperties*)malloc(
+        extensionCount * sizeof(VkExtensionProperties)
+    );
+    vkEnumerateDeviceExtensionProperties(device, NULL, &extensionCount, availableExtensions);
+
+    b32 isFound = QQ_FALSE;
+    for (u32 i = 0; i < extensionCount; i++) {
+        if (strcmp(name, availableExtensions[i].extensionName) == 0) {
+            isFound = QQ_TRUE;
+            break;
+        }
+    }
+
+    free(availableExtensions);
+    return isFound;
+}
+
 void createLogicalDevice() {
-    printf("Creating vulkan logical device\n");
+    logDebug("Creating vulkan logical device");
     QueueFamilyIndices indices = findVulkanQueueFamilies(physicalDevice);
 
-    // Create list of queue create infos
-    u32 queueCount = 2;
+    // Create list of queue create infos (one per distinct family)
+    u32 queueCount = indices.graphics == indices.present ? 1 : 2;
     u32 queues[2] = { indices.graphics, indices.present };
     VkDeviceQueueCreateInfo* queueCreateInfos = (VkDeviceQueueCreateInfo*)malloc(
         queueCount * sizeof(VkDeviceQueueCreateInfo)
@@ -773,33 +1488,89 @@ void createLogicalDevice() {
         queueCreateInfos[i] = queueCreateInfo;
     }
 
+    // Compute mip generation indexes level views, it is disabled without the feature
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     // Declare required device features (already checked for availability)
-    // Empty for now
     VkPhysicalDeviceFeatures deviceFeatures = {
-        .samplerAnisotropy = VK_TRUE
+        .samplerAnisotropy = VK_TRUE,
+        .shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+        .shaderStorageImageArrayDynamicIndexing = supportedFeatures.shaderStorageImageArrayDynamicIndexing,
+        .fragmentStoresAndAtomics = VK_TRUE
+    };
+    isMipGenerationSupported = supportedFeatures.shaderStorageImageArrayDynamicIndexing == VK_TRUE;
+
+    // Present id and present wait tell when frames reach the display, used only when both exist
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR
+    };
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+        .pNext = &presentWaitFeatures
+    };
+    isPresentWaitSupported = headlessEnabled == QQ_FALSE
+        && isDeviceExtensionAvailable(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+        && isDeviceExtensionAvailable(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    if (isPresentWaitSupported == QQ_TRUE) {
+        VkPhysicalDeviceFeatures2 features = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &presentIdFeatures
+        };
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+        isPresentWaitSupported = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+    }
+
+    u32 enabledExtensionCount = 0;
+    const char* enabledExtensions[3];
+    for (u32 i = 0; i < requiredVulkanDeviceExtensionCount; i++) {
+        enabledExtensions[enabledExtensionCount++] = reqVulkanDeviceExtensions[i];
+    }
+    if (isPresentWaitSupported == QQ_TRUE) {
+        enabledExtensions[enabledExtensionCount++] = VK_KHR_PRESENT_ID_EXTENSION_NAME;
+        enabledExtensions[enabledExtensionCount++] = VK_KHR_PRESENT_WAIT_EXTENSION_NAME;
+    }
+
+    // Descriptor indexing for the global texture array
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .descriptorIndexing = VK_TRUE,
+        .runtimeDescriptorArray = VK_TRUE,
+        .descriptorBindingPartiallyBound = VK_TRUE,
+        .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+        .timelineSemaphore = VK_TRUE,
+        .pNext = isPresentWaitSupported == QQ_TRUE ? &presentIdFeatures : NULL
     };
 
     // Create logical device
     VkDeviceCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = &vulkan12Features,
         .pQueueCreateInfos = queueCreateInfos,
         .queueCreateInfoCount = queueCount,
         .pEnabledFeatures = &deviceFeatures,
         // TODO: Research about virtual device layers/extensions (is it deprecated?)
-        .enabledExtensionCount = requiredVulkanDeviceExtensionCount,
-        .ppEnabledExtensionNames = reqVulkanDeviceExtensions
+        .enabledExtensionCount = enabledExtensionCount,
+        .ppEnabledExtensionNames = enabledExtensions
     };
 
     if (
         vkCreateDevice(physicalDevice, &createInfo, NULL, &logicalDevice) != VK_SUCCESS
     ) {
-        printf("[ERR] Failed to create vulkan virtual device");
+        logError("Failed to create vulkan virtual device");
     }
 
     // Get handle for graphics queue
     vkGetDeviceQueue(logicalDevice, indices.graphics, 0, &graphicsQueue);
     vkGetDeviceQueue(logicalDevice, indices.present, 0, &presentQueue);
 
+    // Extension entry points are not exported by the loader
+    if (isPresentWaitSupported == QQ_TRUE) {
+        waitForPresentKHR = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(logicalDevice, "vkWaitForPresentKHR");
+        isPresentWaitSupported = waitForPresentKHR != NULL;
+    }
+    logDebug(" - Latency measured %s", isPresentWaitSupported == QQ_TRUE ? "to present (present wait)" : "to GPU finish (no present wait)");
+
     // Free queue infos
     free(queueCreateInfos);
 }
@@ -824,13 +1595,13 @@ b32 checkDeviceExtensionSupport(VkPhysicalDevice device) {
         }
 
         if (isFound == QQ_FALSE) {
-            printf("Extension %s wasn't found\n", reqVulkanDeviceExtensions[i]);
+            logError("Extension %s wasn't found", reqVulkanDeviceExtensions[i]);
             allExtensionsFound = QQ_FALSE;
         }
     }
 
     if (allExtensionsFound == QQ_TRUE) {
-        printf(" - All required extensions are present\n");
+        logDebug(" - All required extensions are present");
     }
 
     free(availableExtensions);
@@ -859,6 +1630,38 @@ u32 rateVulkanPhysicalDevice(VkPhysicalDevice device) {
         return 0;
     }
 
+    // Textures are indexed from push constants
+    if (!deviceFeatures.shaderSampledImageArrayDynamicIndexing) {
+        return 0;
+    }
+
+    // Virtual texture feedback is written from fragment shader
+    if (!deviceFeatures.fragmentStoresAndAtomics) {
+        return 0;
+    }
+
+    // Global descriptor set relies on Vulkan 1.2 descriptor indexing
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return 0;
+    }
+    VkPhysicalDeviceVulkan12Features vulkan12Features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES
+    };
+    VkPhysicalDeviceFeatures2 deviceFeatures2 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &vulkan12Features
+    };
+    vkGetPhysicalDeviceFeatures2(device, &deviceFeatures2);
+    if (
+        !vulkan12Features.descriptorIndexing
+        || !vulkan12Features.runtimeDescriptorArray
+        || !vulkan12Features.descriptorBindingPartiallyBound
+        || !vulkan12Features.descriptorBindingSampledImageUpdateAfterBind
+        || !vulkan12Features.timelineSemaphore
+    ) {
+        return 0;
+    }
+
     // Check queue families
     QueueFamilyIndices indices = findVulkanQueueFamilies(device);
     if (indices.isGraphicsSet != QQ_TRUE) {
@@ -876,19 +1679,22 @@ u32 rateVulkanPhysicalDevice(VkPhysicalDevice device) {
         return 0;
     }
 
-    SwapchainSupportDetails swapChainSupport = querySwapChainSupport(device);
-    b32 swapChainWorkingCorrectly = (
-        swapChainSupport.formatCount != 0
-        && swapChainSupport.presentModeCount != 0
-    );
-    if (swapChainSupport.formatCount != 0) {
-        free(swapChainSupport.formats);
-    }
-    if (swapChainSupport.presentModeCount != 0) {
-        free(swapChainSupport.presentModes);
-    }
-    if (swapChainWorkingCorrectly == QQ_FALSE) {
-        return 0;
+    // Offscreen rendering does not need presentation support
+    if (headlessEnabled == QQ_FALSE) {
+        SwapchainSupportDetails swapChainSupport = querySwapChainSupport(device);
+        b32 swapChainWorkingCorrectly = (
+            swapChainSupport.formatCount != 0
+            && swapChainSupport.presentModeCount != 0
+        );
+        if (swapChainSupport.formatCount != 0) {
+            free(swapChainSupport.formats);
+        }
+        if (swapChainSupport.presentModeCount != 0) {
+            free(swapChainSupport.presentModes);
+        }
+        if (swapChainWorkingCorrectly == QQ_FALSE) {
+            return 0;
+        }
     }
 
     // Prefer discrete GPUs
@@ -899,19 +1705,19 @@ u32 rateVulkanPhysicalDevice(VkPhysicalDevice device) {
     // Bigger supported size of textures is better
     score += deviceProperties.limits.maxImageDimension2D;
 
-    printf("Device %s | score: %d\n", deviceProperties.deviceName, score);
+    logDebug("Device %s | score: %d", deviceProperties.deviceName, score);
 
     return score;
 }
 
 void pickPhysicalDevice() {
-    printf("Picking vulkan physical device\n");
+    logDebug("Picking vulkan physical device");
 
     u32 deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, NULL);
 
     if (deviceCount == 0) {
-        printf(" [ERR] Failed to find GPUs with Vulkan support\n");
+        logError("Failed to find GPUs with Vulkan support");
     }
 
     VkPhysicalDevice* devices = (VkPhysicalDevice *)malloc(
@@ -935,7 +1741,7 @@ void pickPhysicalDevice() {
    }
 
     if (physicalDevice == VK_NULL_HANDLE) {
-        printf(" [ERR] All devices are failed to meet requirements\n");
+        logError("All devices are failed to meet requirements");
     }
 
     // Free previously allocated memory
@@ -943,7 +1749,7 @@ void pickPhysicalDevice() {
 }
 
 b32 checkVulkanValidationLayerSupport() {
-    printf("Checking if required Vulkan layers are present\n");
+    logDebug("Checking if required Vulkan layers are present");
 
     u32 availableLayerCount;
     vkEnumerateInstanceLayerProperties(&availableLayerCount, NULL);
@@ -965,25 +1771,25 @@ b32 checkVulkanValidationLayerSupport() {
         }
 
         if (layerIsFound == QQ_FALSE) {
-            printf("Layer %s was required, but wasn't found\n", requiredVulkanLayers[i]);
+            logError("Layer %s was required, but wasn't found", requiredVulkanLayers[i]);
             allLayersIsFound = QQ_FALSE;
         }
     }
 
     if (allLayersIsFound == QQ_TRUE) {
-        printf(" - All required layers are present\n");
+        logDebug(" - All required layers are present");
     }
 
     return (allLayersIsFound == QQ_TRUE);
 }
 
 void displaySupportedVulkanExtensions() {
-    printf("Loading available Vulkan extensions\n");
+    logDebug("Loading available Vulkan extensions");
 
     u32 extensionCount = 0;
     vkEnumerateInstanceExtensionProperties(NULL, &extensionCount, NULL);
 
-    printf("%d Vulkan extensions are supported:\n", extensionCount);
+    logDebug("%d Vulkan extensions are supported:", extensionCount);
 
     // Allocate memory for list of available extensions
     VkExtensionProperties *availableExtensions = (VkExtensionProperties *) malloc(
@@ -993,8 +1799,8 @@ void displaySupportedVulkanExtensions() {
 
     // List available extensions
     for (u32 i = 0; i < extensionCount; i++) {
-        printf(
-            " - %s (spec: %d)\n",
+        logDebug(
+            " - %s (spec: %d)",
             availableExtensions[i].extensionName,
             availableExtensions[i].specVersion
         );
@@ -1005,7 +1811,7 @@ void displaySupportedVulkanExtensions() {
 }
 
 void createInstance() {
-    printf("Creating Vulkan instance\n");
+    logDebug("Creating Vulkan instance");
 
     // Display supported extensions
     // TODO: Move into into debug module
@@ -1023,7 +1829,7 @@ void createInstance() {
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "No Engine",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0
+        .apiVersion = VK_API_VERSION_1_2
     };
 
     // Structure describing requirements from Vulkan instance
@@ -1033,11 +1839,13 @@ void createInstance() {
     };
 
     // Describe extensions required
-    // For now, just fetch all extensions, required by GLFW
-    u32 glfwExtensionCount = 0;
-    const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    // For now, just fetch all extensions, required by GLFW (none without window)
+    if (headlessEnabled == QQ_FALSE) {
+        u32 glfwExtensionCount = 0;
+        const char **glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        createInfo.enabledExtensionCount = glfwExtensionCount;
+        createInfo.ppEnabledExtensionNames = glfwExtensions;
+    }
     
     // TODO: These lines are causing segfault
     //       But it is correct declaration (Probably GLFW messes it up)
@@ -1055,14 +1863,14 @@ void createInstance() {
     // Create Vulkan instance
     VkResult instanceCreationSuccess = vkCreateInstance(&createInfo, NULL, &instance);
     if (instanceCreationSuccess != VK_SUCCESS) {
-        printf("Failed to initialize Vulkan instance\n");
+        logError("Failed to initialize Vulkan instance");
     }
 }
 
 void createSurface() {
-    printf("Creating KHR surface for window\n");
+    logDebug("Creating KHR surface for window");
     if (glfwCreateWindowSurface(instance, window, NULL, &surface)) {
-        printf("[ERR] Failed to create window surface\n");
+        logError("Failed to create window surface");
     }
 }
 
@@ -1089,14 +1897,14 @@ VkImageView createImageView(
 
     VkImageView imageView;
     if (vkCreateImageView(logicalDevice, &viewInfo, NULL, &imageView) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create image view\n");
+        logError("Failed to create image view");
     }
 
     return imageView;
 }
 
 void createImageViews() {
-    printf("Creating swap chain image views");
+    logDebug("Creating swap chain image views");
 
     swapchainImageViews = (VkImageView*)malloc(
         swapchainImageCount * sizeof(VkImageView)
@@ -1114,24 +1922,37 @@ void createImageViews() {
 }
 
 void unloadShaderCode(VulkanShaderCode code) {
-    // Free shader memory
-    free(code.data);
+    // Free shader memory, embedded code lives in the executable
+    if (code.isEmbedded == QQ_FALSE) {
+        free(code.data);
+    }
 }
 
 VulkanShaderCode loadShaderCodeByPath(const char* path) {
-    printf("Loading shader code from file: %s\n", path);
+    // SPIR-V compiled into the binary is used in place, words are already aligned
+    const EmbeddedFile* embeddedFile = embeddedFind(path);
+    if (embeddedFile != NULL) {
+        return (VulkanShaderCode){
+            .data = (u8*)embeddedFile->words,
+            .size = (i64)embeddedFile->size,
+            .isEmbedded = QQ_TRUE
+        };
+    }
+
+    logDebug("Loading shader code from file: %s", path);
 
     FILE* file = fopen(path, "rb");
 
     // Open file
     file = fopen(path, "rb");
     if (file == NULL) {
-        printf("Error opening: %s\n", path);
+        logError("Error opening: %s", path);
     }
     
     VulkanShaderCode code = {
         .size = 0,
-        .data = NULL
+        .data = NULL,
+        .isEmbedded = QQ_FALSE
     };
 
     // Get file size
@@ -1148,8 +1969,240 @@ VulkanShaderCode loadShaderCodeByPath(const char* path) {
     return code;
 }
 
+void runStartupTask(void* userData) {
+    StartupTask* task = (StartupTask*)userData;
+
+    f64 startTime = getTimeMs();
+    u64 traceStart = traceBegin();
+    task->function(NULL);
+    traceEnd(task->name, traceStart);
+    task->runTimeMs = getTimeMs() - startTime;
+}
+
+void startStartupTask(StartupTask* task) {
+    task->isSubmitted = QQ_TRUE;
+    jobPoolSubmit(&jobPool, &runStartupTask, task, &task->counter);
+}
+
+// Joins task on first use, task which was not submitted runs right here
+void finishStartupTask(StartupTask* task) {
+    if (task->isFinished == QQ_TRUE) {
+        return;
+    }
+
+    f64 startTime = getTimeMs();
+    if (task->isSubmitted == QQ_TRUE) {
+        jobPoolWait(&jobPool, &task->counter);
+    } else {
+        runStartupTask(task);
+    }
+    task->waitTimeMs = getTimeMs() - startTime;
+    task->isFinished = QQ_TRUE;
+}
+
+// Closes stage started at the end of the previous one, `traceStart` also records it in the trace
+void endStartupStage(const char* name, u64 traceStart) {
+    f64 endTime = getTimeMs();
+    traceEnd(name, traceStart);
+
+    if (startupStageCount < STARTUP_MAX_STAGES) {
+        startupStages[startupStageCount] = (StartupStage){
+            .name = name,
+            .durationMs = endTime - startupStageEndMs
+        };
+        startupStageCount += 1;
+    }
+    startupStageEndMs = endTime;
+}
+
+void readStartupShadersJob(void* userData) {
+    for (u32 i = 0; i < STARTUP_SHADER_COUNT; i++) {
+        startupShaderCodes[i] = loadShaderCodeByPath(startupShaderPaths[i]);
+    }
+}
+
+// Hands over shader read during startup, other paths are read right away
+VulkanShaderCode takeStartupShaderCode(const char* path) {
+    finishStartupTask(&shaderReadTask);
+
+    for (u32 i = 0; i < STARTUP_SHADER_COUNT; i++) {
+        if (strcmp(startupShaderPaths[i], path) == 0 && startupShaderCodes[i].data != NULL) {
+            VulkanShaderCode code = startupShaderCodes[i];
+            startupShaderCodes[i] = (VulkanShaderCode){.size = 0, .data = NULL};
+            return code;
+        }
+    }
+    return loadShaderCodeByPath(path);
+}
+
+// Shaders read during startup which no pipeline took
+void releaseStartupShaderCodes() {
+    for (u32 i = 0; i < STARTUP_SHADER_COUNT; i++) {
+        if (startupShaderCodes[i].data != NULL) {
+            unloadShaderCode(startupShaderCodes[i]);
+            startupShaderCodes[i] = (VulkanShaderCode){.size = 0, .data = NULL};
+        }
+    }
+}
+
+// Reflects shader once, startup code is left in place for the pipeline which takes it
+b32 getShaderReflection(const char* path, SpirvReflection* reflection) {
+    for (u32 i = 0; i < shaderReflectionCount; i++) {
+        if (strcmp(shaderReflections[i].path, path) == 0) {
+            *reflection = shaderReflections[i].reflection;
+            return QQ_TRUE;
+        }
+    }
+
+    finishStartupTask(&shaderReadTask);
+    VulkanShaderCode code = {.size = 0, .data = NULL, .isEmbedded = QQ_FALSE};
+    b32 isLoaded = QQ_FALSE;
+    for (u32 i = 0; i < STARTUP_SHADER_COUNT; i++) {
+        if (strcmp(startupShaderPaths[i], path) == 0 && startupShaderCodes[i].data != NULL) {
+            code = startupShaderCodes[i];
+        }
+    }
+    if (code.data == NULL) {
+        code = loadShaderCodeByPath(path);
+        isLoaded = QQ_TRUE;
+    }
+
+    b32 isReflected = spirvReflect((const u32*)code.data, (u64)code.size, reflection);
+    if (isLoaded == QQ_TRUE) {
+        unloadShaderCode(code);
+    }
+    if (isReflected == QQ_FALSE) {
+        logError("Failed to reflect shader %s", path);
+        return QQ_FALSE;
+    }
+
+    if (shaderReflectionCount < MAX_SHADER_REFLECTIONS) {
+        shaderReflections[shaderReflectionCount] = (ShaderReflection){
+            .path = path,
+            .reflection = *reflection
+        };
+        shaderReflectionCount += 1;
+    }
+    return QQ_TRUE;
+}
+
+VkShaderStageFlags getShaderStageFlags(SpirvStage stage) {
+    switch (stage) {
+        case SPIRV_STAGE_VERTEX:
+            return VK_SHADER_STAGE_VERTEX_BIT;
+        case SPIRV_STAGE_FRAGMENT:
+            return VK_SHADER_STAGE_FRAGMENT_BIT;
+        default:
+            return VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+}
+
+VkDescriptorType getShaderDescriptorType(SpirvDescriptorType type) {
+    switch (type) {
+        case SPIRV_DESCRIPTOR_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case SPIRV_DESCRIPTOR_COMBINED_IMAGE_SAMPLER:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case SPIRV_DESCRIPTOR_SAMPLED_IMAGE:
+            return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        case SPIRV_DESCRIPTOR_STORAGE_IMAGE:
+            return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        case SPIRV_DESCRIPTOR_UNIFORM_TEXEL_BUFFER:
+            return VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        case SPIRV_DESCRIPTOR_STORAGE_TEXEL_BUFFER:
+            return VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+        case SPIRV_DESCRIPTOR_UNIFORM_BUFFER:
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        default:
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+}
+
+// Bindings of `set` declared by any of the stages, unsized arrays keep 0 descriptors for caller to size
+u32 mergeShaderBindings(const SpirvReflection* reflections, u32 reflectionCount, u32 set, VkDescriptorSetLayoutBinding* bindings) {
+    u32 bindingCount = 0;
+    for (u32 i = 0; i < reflectionCount; i++) {
+        for (u32 j = 0; j < reflections[i].bindingCount; j++) {
+            const SpirvBinding* shaderBinding = &reflections[i].bindings[j];
+            if (shaderBinding->set != set) {
+                continue;
+            }
+
+            VkDescriptorSetLayoutBinding* binding = NULL;
+            for (u32 k = 0; k < bindingCount; k++) {
+                if (bindings[k].binding == shaderBinding->binding) {
+                    binding = &bindings[k];
+                }
+            }
+
+            VkDescriptorType type = getShaderDescriptorType(shaderBinding->type);
+            if (binding == NULL) {
+                if (bindingCount == SPIRV_REFLECT_MAX_BINDINGS) {
+                    logError("Shaders declare more than %u bindings in set %u", SPIRV_REFLECT_MAX_BINDINGS, set);
+                    continue;
+                }
+                bindings[bindingCount] = (VkDescriptorSetLayoutBinding){
+                    .binding = shaderBinding->binding,
+                    .descriptorType = type,
+                    .descriptorCount = shaderBinding->count,
+                    .stageFlags = 0,
+                    .pImmutableSamplers = NULL
+                };
+                binding = &bindings[bindingCount];
+                bindingCount += 1;
+            } else if (binding->descriptorType != type || binding->descriptorCount != shaderBinding->count) {
+                logError("Binding %u of set %u is declared differently by shader stages", shaderBinding->binding, set);
+            }
+            binding->stageFlags |= getShaderStageFlags(reflections[i].stage);
+        }
+    }
+    return bindingCount;
+}
+
+// One range covering push constants of every stage which declares them
+VkPushConstantRange getShaderPushConstantRange(const SpirvReflection* reflections, u32 reflectionCount) {
+    VkPushConstantRange range = {
+        .stageFlags = 0,
+        .offset = 0,
+        .size = 0
+    };
+    for (u32 i = 0; i < reflectionCount; i++) {
+        if (reflections[i].pushConstantSize == 0) {
+            continue;
+        }
+        range.stageFlags |= getShaderStageFlags(reflections[i].stage);
+        range.size = max(range.size, reflections[i].pushConstantSize);
+    }
+    return range;
+}
+
+// Pool sizes for `setCount` sets of layout with given bindings, one per descriptor type
+u32 getDescriptorPoolSizes(
+    const VkDescriptorSetLayoutBinding* bindings,
+    u32 bindingCount,
+    u32 setCount,
+    VkDescriptorPoolSize* poolSizes
+) {
+    u32 poolSizeCount = 0;
+    for (u32 i = 0; i < bindingCount; i++) {
+        VkDescriptorPoolSize* poolSize = NULL;
+        for (u32 j = 0; j < poolSizeCount; j++) {
+            if (poolSizes[j].type == bindings[i].descriptorType) {
+                poolSize = &poolSizes[j];
+            }
+        }
+        if (poolSize == NULL) {
+            poolSize = &poolSizes[poolSizeCount];
+            *poolSize = (VkDescriptorPoolSize){.type = bindings[i].descriptorType, .descriptorCount = 0};
+            poolSizeCount += 1;
+        }
+        poolSize->descriptorCount += bindings[i].descriptorCount * setCount;
+    }
+    return poolSizeCount;
+}
+
 VkShaderModule createVulkanShaderModule(VulkanShaderCode code) {
-    printf("Creating shader module\n");
+    logDebug("Creating shader module");
     VkShaderModuleCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
         .codeSize = code.size,
@@ -1158,7 +2211,7 @@ VkShaderModule createVulkanShaderModule(VulkanShaderCode code) {
 
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(logicalDevice, &createInfo, NULL, &shaderModule) != VK_SUCCESS) {
-        printf("Failed to create shader module");
+        logError("Failed to create shader module");
     }
 
     return shaderModule;
@@ -1175,46 +2228,73 @@ VkShaderModule createVulkanShaderModule(VulkanShaderCode code) {
  * will be bound to the descriptors
  */
 void createDescriptorSetLayout() {
-    printf("Creating descriptor set layout\n");
+    logDebug("Creating descriptor set layout");
 
-    VkDescriptorSetLayoutBinding uboLayoutBinding = {
-        // Binding, used in the shader
-        .binding = 0,
-
-        // Type of the descriptor
-        .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+    // Texture array size is limited by update-after-bind limits of the device
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES
+    };
+    VkPhysicalDeviceProperties2 properties = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+        .pNext = &indexingProperties
+    };
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+    // Page tables of virtual textures are counted against the same limits
+    globalTextureCapacity = min(
+        GLOBAL_TEXTURE_CAPACITY,
+        min(
+            indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages
+        ) - MAX_VIRTUAL_TEXTURES
+    );
+    logDebug(" - Global texture array capacity: %u", globalTextureCapacity);
+
+    // Bindings are declared by the shaders (see GLOBAL_BINDING_* for their meaning),
+    // stage flags tell which stages actually access them
+    SpirvReflection reflections[3];
+    getShaderReflection("shader/vert.spv", &reflections[0]);
+    getShaderReflection("shader/frag.spv", &reflections[1]);
+    getShaderReflection("shader/depth_vert.spv", &reflections[2]);
+    globalBindingCount = mergeShaderBindings(reflections, 3, 0, globalBindings);
+    u32 bindingCount = globalBindingCount;
+
+    VkDescriptorBindingFlags bindingFlags[SPIRV_REFLECT_MAX_BINDINGS];
+    for (u32 i = 0; i < bindingCount; i++) {
+        VkDescriptorSetLayoutBinding* binding = &globalBindings[i];
+
+        // Only the texture array is unsized, it is as large as the device allows
+        if (binding->descriptorCount == 0) {
+            binding->descriptorCount = globalTextureCapacity;
+        }
 
-        // It is possible to pass an array, so we need to specify count manually
-        // Passing multiple might be useful for skeletal animation
-        .descriptorCount = 1,
+        // Texture arrays are filled as textures load (slots may stay empty),
+        // new textures can be written while set is used by frames in flight
+        bindingFlags[i] = 0;
+        if (binding->descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE && binding->descriptorCount > 1) {
+            bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+        }
 
-        // Which stages will access this descriptor
-        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        logDebug(
+            " - Binding %u: %u descriptors of type %u",
+            binding->binding,
+            binding->descriptorCount,
+            (u32)binding->descriptorType
+        );
+    }
 
-        // Only relevant for image descriptors
-        .pImmutableSamplers = NULL
-    };
-
-    VkDescriptorSetLayoutBinding samplerLayoutBinding = {
-        .binding = 1,
-        .descriptorCount = 1,
-        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-        .pImmutableSamplers = NULL,
-        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT
-    };
-
-    // List all layout bindings
-    u32 bindingCount = 2;
-    VkDescriptorSetLayoutBinding bindings[2] = {
-        uboLayoutBinding,
-        samplerLayoutBinding
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = bindingCount,
+        .pBindingFlags = bindingFlags
     };
 
     // All descriptor binding are combined into DescriptorSetLayout
     VkDescriptorSetLayoutCreateInfo layoutInfo = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = &bindingFlagsInfo,
+        .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
         .bindingCount = bindingCount,
-        .pBindings = bindings
+        .pBindings = globalBindings
     };
     if (vkCreateDescriptorSetLayout(
         logicalDevice,
@@ -1222,62 +2302,169 @@ void createDescriptorSetLayout() {
         NULL,
         &descriptorSetLayout
     ) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create descriptor set layout\n");
+        logError("Failed to create descriptor set layout");
     }
 }
 
 void createGraphicsPipeline() {
-    printf("Creating graphics pipeline\n");
+    logDebug("Creating graphics pipeline");
+
+    // Reflected before the code is taken, so startup code is not loaded again
+    SpirvReflection reflections[4];
+    getShaderReflection("shader/vert.spv", &reflections[0]);
+    getShaderReflection("shader/frag.spv", &reflections[1]);
+    getShaderReflection("shader/depth_vert.spv", &reflections[2]);
+    getShaderReflection("shader/vert_color.spv", &reflections[3]);
+
+    VulkanShaderCode vertShaderCode = takeStartupShaderCode("shader/vert.spv");
+    VulkanShaderCode vertColorShaderCode = takeStartupShaderCode("shader/vert_color.spv");
+    VulkanShaderCode fragShaderCode = takeStartupShaderCode("shader/frag.spv");
+    VulkanShaderCode depthVertShaderCode = takeStartupShaderCode("shader/depth_vert.spv");
+
+    // Create modules, kept for variants created on first use
+    logDebug("Creating shader module");
+    vertShaderModule = createVulkanShaderModule(vertShaderCode);
+    vertColorShaderModule = createVulkanShaderModule(vertColorShaderCode);
+    fragShaderModule = createVulkanShaderModule(fragShaderCode);
+    depthVertShaderModule = createVulkanShaderModule(depthVertShaderCode);
+
+    // Free loaded shader memory
+    unloadShaderCode(vertShaderCode);
+    unloadShaderCode(vertColorShaderCode);
+    unloadShaderCode(fragShaderCode);
+    unloadShaderCode(depthVertShaderCode);
+
+    // Per draw data is pushed directly into command buffer, block is declared by the shaders
+    VkPushConstantRange pushConstantRange = getShaderPushConstantRange(reflections, 4);
+    if (pushConstantRange.size != sizeof(DrawPushConstants)) {
+        logError(
+            "Shaders declare %u bytes of push constants, DrawPushConstants has %u",
+            pushConstantRange.size,
+            (u32)sizeof(DrawPushConstants)
+        );
+    }
+    drawPushConstantStages = pushConstantRange.stageFlags;
+    vertShaderReflection = reflections[0];
+    depthVertShaderReflection = reflections[2];
+    vertColorShaderReflection = reflections[3];
+
+    // Create pipeline layout, shared by all variants
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+
+    logDebug("Creating pipeline layout");
+    VkResult result = vkCreatePipelineLayout(
+        logicalDevice,
+        &pipelineLayoutInfo,
+        NULL,
+        &pipelineLayout
+    );
+    if (result != VK_SUCCESS) {
+        logError("Failed to create pipeline layout");
+    }
 
-    VulkanShaderCode vertShaderCode = loadShaderCodeByPath("./shader/vert.spv");
-    VulkanShaderCode fragShaderCode = loadShaderCodeByPath("./shader/frag.spv");
+    // Variants are compiled in the background, fallbacks are requested right after
+    pipelineVariantCount = 0;
+}
 
-    // Create modules
-    printf("Creating shader module\n");
-    VkShaderModule vertShaderModule = createVulkanShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createVulkanShaderModule(fragShaderCode);
+// Pipeline of one pass kind (RENDER_PIPELINE_*) with shader features baked in
+VkPipeline createPipelineVariant(u32 kind, u32 features) {
+    logDebug("Creating pipeline variant %u with features 0x%x", kind, features);
+    u64 traceStart = traceBegin();
+
+    // Feature toggles become constants, so the driver compiles out unused paths
+    ShaderSpecialization specialization = {
+        .useTexture = (features & SHADER_FEATURE_TEXTURE) != 0 ? VK_TRUE : VK_FALSE,
+        .useVertexColor = (features & SHADER_FEATURE_VERTEX_COLOR) != 0 ? VK_TRUE : VK_FALSE,
+        .useAlphaTest = (features & SHADER_FEATURE_ALPHA_TEST) != 0 ? VK_TRUE : VK_FALSE,
+        .alphaCutoff = SHADER_ALPHA_CUTOFF
+    };
+    VkSpecializationMapEntry specializationEntries[4] = {
+        {
+            .constantID = SHADER_CONSTANT_USE_TEXTURE,
+            .offset = offsetof(ShaderSpecialization, useTexture),
+            .size = sizeof(VkBool32)
+        },
+        {
+            .constantID = SHADER_CONSTANT_USE_VERTEX_COLOR,
+            .offset = offsetof(ShaderSpecialization, useVertexColor),
+            .size = sizeof(VkBool32)
+        },
+        {
+            .constantID = SHADER_CONSTANT_USE_ALPHA_TEST,
+            .offset = offsetof(ShaderSpecialization, useAlphaTest),
+            .size = sizeof(VkBool32)
+        },
+        {
+            .constantID = SHADER_CONSTANT_ALPHA_CUTOFF,
+            .offset = offsetof(ShaderSpecialization, alphaCutoff),
+            .size = sizeof(f32)
+        }
+    };
+    VkSpecializationInfo specializationInfo = {
+        .mapEntryCount = 4,
+        .pMapEntries = specializationEntries,
+        .dataSize = sizeof(ShaderSpecialization),
+        .pData = &specialization
+    };
 
-    // Vertex shader
-    printf("Assigning shaders to pipeline states\n");
+    // Vertex shader, vertex color input exists only in its own module
+    // (attribute gated by a constant would still be fetched)
+    b32 usesVertexColor = (features & SHADER_FEATURE_VERTEX_COLOR) != 0;
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vertShaderModule,
-        .pName = "main"
+        .module = usesVertexColor == QQ_TRUE ? vertColorShaderModule : vertShaderModule,
+        .pName = "main",
+        .pSpecializationInfo = &specializationInfo
     };
 
     // Fragment shader
-    printf("Frag shader stage create info\n");
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
         .module = fragShaderModule,
-        .pName = "main"
+        .pName = "main",
+        .pSpecializationInfo = &specializationInfo
     };
 
     // Declare pipeline as an array
-    printf("Shader stage create info\n");
     VkPipelineShaderStageCreateInfo shaderStages[] = {
         vertShaderStageInfo,
         fragShaderStageInfo
     };
 
-    // Describe vertex data format
-    printf("Binding vertex descriptors\n");
-    VkVertexInputBindingDescription bindingDescription = getVertexBindingDescription();
-    u32 bindingDescriptionCount = 1;
-    u32 vertexAttrDescriptionCount = 3;
+    // Depth pre-pass has no fragment stage, only depth is written
+    VkPipelineShaderStageCreateInfo depthPrepassStageInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+        .stage = VK_SHADER_STAGE_VERTEX_BIT,
+        .module = depthVertShaderModule,
+        .pName = "main"
+    };
 
-    VkVertexInputAttributeDescription* attributeDescriptions = getVertexAttributeDescription();
-    
+    // Describe vertex data format, reflected from vertex shader
+    // (depth pre-pass reads position stream only)
+    VertexInputDescription vertexInput;
+    if (getVertexInputDescription(
+        kind == RENDER_PIPELINE_DEPTH_PREPASS
+            ? &depthVertShaderReflection
+            : (usesVertexColor == QQ_TRUE ? &vertColorShaderReflection : &vertShaderReflection),
+        features,
+        &vertexInput
+    ) == QQ_FALSE) {
+        logError("Vertex shader does not match mesh vertex layout");
+    }
     VkPipelineVertexInputStateCreateInfo vertexInputInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        // TODO: This is HARDCODED!!!1 BIG OOOF!1
-        .vertexBindingDescriptionCount = bindingDescriptionCount,
-        .pVertexBindingDescriptions = &bindingDescription, 
-        // TODO: This is HARDCODED!!!1 BIG OOOF!1
-        .vertexAttributeDescriptionCount = vertexAttrDescriptionCount,
-        .pVertexAttributeDescriptions = attributeDescriptions
+        .vertexBindingDescriptionCount = vertexInput.bindingCount,
+        .pVertexBindingDescriptions = vertexInput.bindings,
+        .vertexAttributeDescriptionCount = vertexInput.attributeCount,
+        .pVertexAttributeDescriptions = vertexInput.attributes
     };
 
     // Describe what kind of geometry to draw from provided vertices
@@ -1359,6 +2546,12 @@ void createGraphicsPipeline() {
         .front = {},
         .back = {}
     };
+
+    // After pre-pass, depth buffer already holds the closest surfaces,
+    // so only fragments matching it exactly are shaded
+    VkPipelineDepthStencilStateCreateInfo depthStencilEqual = depthStencil;
+    depthStencilEqual.depthWriteEnable = VK_FALSE;
+    depthStencilEqual.depthCompareOp = VK_COMPARE_OP_EQUAL;
     
     // Define how resulting colors should be blended with existing colors
     VkPipelineColorBlendAttachmentState colorBlendAttachment = {
@@ -1387,28 +2580,12 @@ void createGraphicsPipeline() {
         .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f}
     };
 
-    // Define dynamic component of pipeline
-    // TODO: this is skipped for now
+    // Pre-pass shares the subpass, but leaves color attachment untouched
+    VkPipelineColorBlendAttachmentState depthPrepassBlendAttachment = colorBlendAttachment;
+    depthPrepassBlendAttachment.colorWriteMask = 0;
 
-    // Create pipeline layout
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &descriptorSetLayout,
-        .pushConstantRangeCount = 0,
-        .pPushConstantRanges = NULL
-    };
-
-    printf("Creating pipeline layout\n");
-    VkResult result = vkCreatePipelineLayout(
-        logicalDevice,
-        &pipelineLayoutInfo,
-        NULL,
-        &pipelineLayout
-    );
-    if (result != VK_SUCCESS) {
-        printf("[ERROR] Failed to create pipeline layout\n");
-    }
+    VkPipelineColorBlendStateCreateInfo depthPrepassColorBlending = colorBlending;
+    depthPrepassColorBlending.pAttachments = &depthPrepassBlendAttachment;
 
     // Creat graphics pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo = {
@@ -1439,32 +2616,288 @@ void createGraphicsPipeline() {
         .basePipelineIndex = -1
     };
 
-    VkResult createGraphicsPipelineResult = vkCreateGraphicsPipelines(
-        logicalDevice,
-        VK_NULL_HANDLE,
-        1,
-        &pipelineInfo,
-        NULL,
-        &graphicsPipeline
+    if (kind == RENDER_PIPELINE_MAIN_DEPTH_EQUAL) {
+        // Main pass variant for rendering after depth pre-pass
+        pipelineInfo.pDepthStencilState = &depthStencilEqual;
+    } else if (kind == RENDER_PIPELINE_DEPTH_PREPASS) {
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &depthPrepassStageInfo;
+        pipelineInfo.pColorBlendState = &depthPrepassColorBlending;
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(logicalDevice, pipelineCache, 1, &pipelineInfo, NULL, &pipeline) != VK_SUCCESS) {
+        logError("Failed to create graphics pipeline");
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    traceEnd("create pipeline variant", traceStart);
+    return pipeline;
+}
+
+void compilePipelineVariantJob(void* userData) {
+    PipelineVariant* variant = userData;
+
+    f64 startTime = getTimeMs();
+    variant->pipeline = createPipelineVariant(variant->kind, variant->features);
+    variant->readyTimeMs = getTimeMs();
+    variant->compileMs = variant->readyTimeMs - startTime;
+
+    // Render thread reads the pipeline only after it sees the new state
+    atomic_store_explicit(
+        &variant->state,
+        variant->pipeline != VK_NULL_HANDLE ? PIPELINE_VARIANT_READY : PIPELINE_VARIANT_FAILED,
+        memory_order_release
     );
-    if (createGraphicsPipelineResult != VK_SUCCESS) {
-        printf("[ERROR] Failed to create graphics pipeline\n");
+}
+
+// Adds compiles finished since the last call to the stats, render thread only
+void updatePipelineCompileStats() {
+    PipelineCompileStats* stats = &pipelineCompileStats;
+    for (u32 i = 0; i < pipelineVariantCount; i++) {
+        PipelineVariant* variant = &pipelineVariants[i];
+        if (variant->isReported == QQ_TRUE) {
+            continue;
+        }
+        u32 state = atomic_load_explicit(&variant->state, memory_order_acquire);
+        if (state == PIPELINE_VARIANT_COMPILING) {
+            continue;
+        }
+
+        variant->isReported = QQ_TRUE;
+        stats->queueDepth -= 1;
+        if (state == PIPELINE_VARIANT_FAILED) {
+            stats->failedCount += 1;
+            continue;
+        }
+
+        f64 latencyMs = variant->readyTimeMs - variant->requestTimeMs;
+        stats->compiledCount += 1;
+        stats->totalCompileMs += variant->compileMs;
+        stats->maxCompileMs = max(stats->maxCompileMs, variant->compileMs);
+        stats->totalLatencyMs += latencyMs;
+        stats->maxLatencyMs = max(stats->maxLatencyMs, latencyMs);
+        logDebug(
+            "[PIPELINES] Variant %u with features 0x%x compiled in %.2f ms (ready after %.2f ms)",
+            variant->kind,
+            variant->features,
+            variant->compileMs,
+            latencyMs
+        );
     }
+}
 
-    // Destroy modules
-    vkDestroyShaderModule(logicalDevice, fragShaderModule, NULL);
-    vkDestroyShaderModule(logicalDevice, vertShaderModule, NULL);
+void printPipelineCompileStats() {
+    const PipelineCompileStats* stats = &pipelineCompileStats;
+    logInfo(
+        "[PIPELINES] Compiled: %lu (%lu failed) | compile avg: %.2f ms, max: %.2f ms | ready after avg: %.2f ms, max: %.2f ms",
+        stats->compiledCount,
+        stats->failedCount,
+        stats->compiledCount != 0 ? stats->totalCompileMs / (f64)stats->compiledCount : 0.0,
+        stats->maxCompileMs,
+        stats->compiledCount != 0 ? stats->totalLatencyMs / (f64)stats->compiledCount : 0.0,
+        stats->maxLatencyMs
+    );
+    logInfo(
+        "[PIPELINES] Queue depth: %u (max %u) | fallback draws: %lu | skipped draws: %lu | %s",
+        stats->queueDepth,
+        stats->maxQueueDepth,
+        stats->fallbackDrawCount,
+        stats->skippedDrawCount,
+        asyncPipelinesEnabled == QQ_TRUE ? "async" : "sync"
+    );
+}
 
-    // Free loaded shader memory
-    unloadShaderCode(vertShaderCode);
-    unloadShaderCode(fragShaderCode);
+// Returns index of the variant, queueing its compile when it is requested first
+u32 requestPipelineVariant(u32 kind, u32 features) {
+    // Depth pre-pass shades nothing, only position format changes it
+    if (kind == RENDER_PIPELINE_DEPTH_PREPASS) {
+        features &= SHADER_FEATURE_QUANTIZED_POSITIONS;
+    }
+
+    for (u32 i = 0; i < pipelineVariantCount; i++) {
+        if (pipelineVariants[i].kind == kind && pipelineVariants[i].features == features) {
+            return i;
+        }
+    }
+
+    // Kinds times feature combinations fit, so this means a new kind or feature was not counted
+    if (pipelineVariantCount == MAX_PIPELINE_VARIANTS) {
+        logError("Pipeline variant cache is full (%u variants)", MAX_PIPELINE_VARIANTS);
+        return U32_MAX;
+    }
+
+    u32 index = pipelineVariantCount;
+    PipelineVariant* variant = &pipelineVariants[index];
+    *variant = (PipelineVariant){
+        .kind = kind,
+        .features = features,
+        .pipeline = VK_NULL_HANDLE,
+        .requestTimeMs = getTimeMs(),
+        .isReported = QQ_FALSE
+    };
+    atomic_store(&variant->state, PIPELINE_VARIANT_COMPILING);
+    pipelineVariantCount += 1;
+
+    pipelineCompileStats.queueDepth += 1;
+    pipelineCompileStats.maxQueueDepth = max(pipelineCompileStats.maxQueueDepth, pipelineCompileStats.queueDepth);
+
+    // Synchronous mode compiles on the render thread, as a baseline for hitch measurements
+    if (asyncPipelinesEnabled == QQ_FALSE) {
+        compilePipelineVariantJob(variant);
+    } else {
+        jobPoolSubmit(&pipelineJobPool, &compilePipelineVariantJob, variant, &pipelineCompileCounter);
+    }
+    return index;
+}
+
+// Blocks until queued compiles are finished (they may be executed by the caller)
+void waitForPipelineCompiles() {
+    u64 traceStart = traceBegin();
+    jobPoolWait(&pipelineJobPool, &pipelineCompileCounter);
+    updatePipelineCompileStats();
+    traceEnd("wait for pipeline compiles", traceStart);
+}
+
+b32 isPipelineVariantReady(u32 variant) {
+    return variant != U32_MAX
+        && atomic_load_explicit(&pipelineVariants[variant].state, memory_order_acquire) == PIPELINE_VARIANT_READY;
+}
+
+/**
+ * Returns render queue pipeline id for the draw, U32_MAX when draw has to be skipped.
+ * Variant which is still compiling is replaced by its textured fallback, or by the
+ * generic one compiled at startup, so a new material or feature combination never
+ * stalls the frame
+ */
+u32 getPipelineVariant(u32 kind, u32 features) {
+    u32 variant = requestPipelineVariant(kind, features);
+    if (isPipelineVariantReady(variant) == QQ_TRUE) {
+        return variant;
+    }
+
+    // Opaque fallback would draw texels alpha test cuts out, such draws wait instead
+    if ((features & SHADER_FEATURE_ALPHA_TEST) != 0) {
+        pipelineCompileStats.skippedDrawCount += 1;
+        return U32_MAX;
+    }
+
+    u32 fallback = requestPipelineVariant(kind, features & SHADER_FEATURE_FALLBACK & shaderFeatureMask);
+    if (isPipelineVariantReady(fallback) == QQ_FALSE) {
+        fallback = requestPipelineVariant(kind, features & SHADER_FEATURE_GENERIC_FALLBACK & shaderFeatureMask);
+    }
+    if (isPipelineVariantReady(fallback) == QQ_TRUE) {
+        pipelineCompileStats.fallbackDrawCount += 1;
+        return fallback;
+    }
+
+    pipelineCompileStats.skippedDrawCount += 1;
+    return U32_MAX;
+}
+
+/**
+ * Fallback variants of every pass kind. Generic ones are compiled before returning,
+ * textured ones by pipeline workers and are waited for before the first frame
+ */
+void createFallbackPipelines() {
+    b32 hasQuantizedPositions = quantizedPositionsEnabled == QQ_TRUE
+        && (shaderFeatureMask & SHADER_FEATURE_QUANTIZED_POSITIONS) != 0;
+
+    for (u32 kind = RENDER_PIPELINE_DEPTH_PREPASS; kind <= RENDER_PIPELINE_MAIN_DEPTH_EQUAL; kind++) {
+        requestPipelineVariant(kind, 0);
+        if (hasQuantizedPositions == QQ_TRUE) {
+            requestPipelineVariant(kind, SHADER_FEATURE_QUANTIZED_POSITIONS);
+        }
+    }
+    waitForPipelineCompiles();
+
+    u32 features = SHADER_FEATURE_TEXTURE & shaderFeatureMask;
+    for (u32 kind = RENDER_PIPELINE_DEPTH_PREPASS; kind <= RENDER_PIPELINE_MAIN_DEPTH_EQUAL; kind++) {
+        requestPipelineVariant(kind, features);
+        if (hasQuantizedPositions == QQ_TRUE) {
+            requestPipelineVariant(kind, features | SHADER_FEATURE_QUANTIZED_POSITIONS);
+        }
+    }
+}
+
+void destroyPipelineVariants() {
+    // Workers may still be compiling with the layout and render pass
+    waitForPipelineCompiles();
+
+    for (u32 i = 0; i < pipelineVariantCount; i++) {
+        if (pipelineVariants[i].pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(logicalDevice, pipelineVariants[i].pipeline, NULL);
+        }
+    }
+    pipelineVariantCount = 0;
+}
+
+void createPipelineCache() {
+    logDebug("Creating pipeline cache");
+
+    // Driver validates the header and starts empty when data is from other device or driver
+    void* data = NULL;
+    u64 dataSize = 0;
+    if (pipelineCachePath != NULL) {
+        FILE* file = fopen(pipelineCachePath, "rb");
+        if (file != NULL) {
+            fseek(file, 0, SEEK_END);
+            dataSize = (u64)ftell(file);
+            fseek(file, 0, SEEK_SET);
+            data = malloc(dataSize);
+            if (fread(data, 1, dataSize, file) != dataSize) {
+                logWarning("Failed to read pipeline cache %s", pipelineCachePath);
+                dataSize = 0;
+            }
+            fclose(file);
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = (size_t)dataSize,
+        .pInitialData = dataSize != 0 ? data : NULL
+    };
+    if (vkCreatePipelineCache(logicalDevice, &cacheInfo, NULL, &pipelineCache) != VK_SUCCESS) {
+        logError("Failed to create pipeline cache");
+        pipelineCache = VK_NULL_HANDLE;
+    } else if (dataSize != 0) {
+        logInfo("[PIPELINES] Loaded %lu bytes of pipeline cache from %s", dataSize, pipelineCachePath);
+    }
+    free(data);
+}
 
-    // Free vertex attribute description info
-    free(attributeDescriptions);
+void shutdownPipelineCache() {
+    if (pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    if (pipelineCachePath != NULL) {
+        size_t dataSize = 0;
+        vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, NULL);
+        void* data = malloc(dataSize);
+        FILE* file = fopen(pipelineCachePath, "wb");
+        if (
+            vkGetPipelineCacheData(logicalDevice, pipelineCache, &dataSize, data) == VK_SUCCESS
+            && file != NULL
+            && fwrite(data, 1, dataSize, file) == dataSize
+        ) {
+            logInfo("[PIPELINES] Saved %lu bytes of pipeline cache into %s", (u64)dataSize, pipelineCachePath);
+        } else {
+            logWarning("Failed to save pipeline cache %s", pipelineCachePath);
+        }
+        if (file != NULL) {
+            fclose(file);
+        }
+        free(data);
+    }
+
+    vkDestroyPipelineCache(logicalDevice, pipelineCache, NULL);
+    pipelineCache = VK_NULL_HANDLE;
 }
 
 void createRenderPass() {
-    printf("Creating render pass\n");
+    logDebug("Creating render pass");
 
     // Create depth attachment
     VkAttachmentDescription depthAttachment = {
@@ -1492,7 +2925,9 @@ void createRenderPass() {
         .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+
+        // Headless frames can be read back (`--capture`)
+        .finalLayout = headlessEnabled == QQ_TRUE ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
     };
     VkAttachmentReference colorAttachmentResolveRef = {
         .attachment = 2,
@@ -1590,12 +3025,12 @@ void createRenderPass() {
     );
 
     if (result != VK_SUCCESS) {
-        printf("[ERROR] Cannot create render pass\n");
+        logError("Cannot create render pass");
     }
 }
 
 void createFramebuffers() {
-    printf("Creating framebuffers\n");
+    logDebug("Creating framebuffers");
 
     // Allocate memory to store frambuffers
     swapchainFramebuffers = (VkFramebuffer*)malloc(
@@ -1628,13 +3063,13 @@ void createFramebuffers() {
             &swapchainFramebuffers[i]
         );
         if (result != VK_SUCCESS) {
-            printf("[ERROR] Failed to create framebuffer");
+            logError("Failed to create framebuffer");
         }
     }
 }
 
 void createCommandPool() {
-    printf("Creating command pool\n");
+    logDebug("Creating command pool");
 
     QueueFamilyIndices queueFamilyIndices = findVulkanQueueFamilies(
         physicalDevice
@@ -1644,1038 +3079,4505 @@ void createCommandPool() {
     VkCommandPoolCreateInfo poolInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .queueFamilyIndex = queueFamilyIndices.graphics,
-        .flags = 0
+
+        // Command buffers are re-recorded every frame
+        .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT
     };
     VkResult result = vkCreateCommandPool(logicalDevice, &poolInfo, NULL, &commandPool);
     if (result != VK_SUCCESS) {
-        printf("[ERROR] Failed to create graphics command pool\n");
+        logError("Failed to create graphics command pool");
     }
 }
 
-void transitionImageLayout(
-    VkImage image,
-    VkFormat format,
-    VkImageLayout oldLayout,
-    VkImageLayout newLayout
-) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (
-        oldLayout == VK_IMAGE_LAYOUT_UNDEFINED
-        && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    ) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+void createMipGenerator() {
+    if (isMipGenerationSupported == QQ_FALSE) {
+        logWarning("Compute mip generation is not supported by device");
+        return;
+    }
+    logDebug("Creating compute mip generator");
 
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (
-        oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-        && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    ) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    // Storage view of every level and workgroup counter, as declared by the shader
+    SpirvReflection reflection;
+    getShaderReflection("shader/downsample_comp.spv", &reflection);
+    VkDescriptorSetLayoutBinding bindings[SPIRV_REFLECT_MAX_BINDINGS];
+    u32 bindingCount = mergeShaderBindings(&reflection, 1, 0, bindings);
 
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        printf("[ERROR] Unsupported image transition");
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = bindingCount,
+        .pBindings = bindings
+    };
+    if (vkCreateDescriptorSetLayout(logicalDevice, &layoutInfo, NULL, &mipGenerationSetLayout) != VK_SUCCESS) {
+        logError("Failed to create mip generation descriptor set layout");
     }
 
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage, destinationStage,
-        0,
-        0, NULL,
-        0, NULL,
-        1, &barrier
-    );
+    VkPushConstantRange pushConstantRange = getShaderPushConstantRange(&reflection, 1);
+    if (pushConstantRange.size != sizeof(MipPushConstants)) {
+        logError(
+            "Mip generation shader declares %u bytes of push constants, MipPushConstants has %u",
+            pushConstantRange.size,
+            (u32)sizeof(MipPushConstants)
+        );
+    }
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = 1,
+        .pSetLayouts = &mipGenerationSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges = &pushConstantRange
+    };
+    if (vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, NULL, &mipGenerationPipelineLayout) != VK_SUCCESS) {
+        logError("Failed to create mip generation pipeline layout");
+    }
 
-    endSingleTimeCommands(commandBuffer);
-}
+    VulkanShaderCode shaderCode = takeStartupShaderCode("shader/downsample_comp.spv");
+    VkShaderModule shaderModule = createVulkanShaderModule(shaderCode);
+    VkComputePipelineCreateInfo pipelineInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = shaderModule,
+            .pName = "main"
+        },
+        .layout = mipGenerationPipelineLayout
+    };
+    if (vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &mipGenerationPipeline) != VK_SUCCESS) {
+        logError("Failed to create mip generation pipeline");
+    }
+    vkDestroyShaderModule(logicalDevice, shaderModule, NULL);
+    unloadShaderCode(shaderCode);
 
-void createColorResources() {
-    VkFormat colorFormat = swapchainImageFormat;
+    // Sets are freed together with their targets
+    VkDescriptorPoolSize poolSizes[SPIRV_REFLECT_MAX_BINDINGS];
+    u32 poolSizeCount = getDescriptorPoolSizes(bindings, bindingCount, MIP_GENERATION_MAX_TARGETS, poolSizes);
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+        .poolSizeCount = poolSizeCount,
+        .pPoolSizes = poolSizes,
+        .maxSets = MIP_GENERATION_MAX_TARGETS
+    };
+    if (vkCreateDescriptorPool(logicalDevice, &poolInfo, NULL, &mipGenerationDescriptorPool) != VK_SUCCESS) {
+        logError("Failed to create mip generation descriptor pool");
+    }
 
-    createImage(
-        swapchainExtent.width,
-        swapchainExtent.height,
-        1,
-        msaaSamples,
-        colorFormat,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+    // One counter per target, each at storage buffer offset alignment
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    mipGenerationCounterStride = max(properties.limits.minStorageBufferOffsetAlignment, sizeof(u32));
+    createBuffer(
+        mipGenerationCounterStride * MIP_GENERATION_MAX_TARGETS,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &colorImage,
-        &colorImageMemory
+        &mipGenerationCounterBuffer,
+        &mipGenerationCounterBufferMemory
     );
-    colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-}
-
-void createDepthResources() {
-    printf("Creationg depth resources\n");
-
-    VkFormat depthFormat = findDepthFormat();
 
-    createImage(
-        swapchainExtent.width,
-        swapchainExtent.height,
-        1,
-        msaaSamples,
-        depthFormat,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &depthImage,
-        &depthImageMemory
-    );
-    depthImageView = createImageView(
-        depthImage,
-        depthFormat,
-        VK_IMAGE_ASPECT_DEPTH_BIT,
-        1
-    );
+    // Last workgroup resets its counter, so counters are cleared only once
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    vkCmdFillBuffer(commandBuffer, mipGenerationCounterBuffer, 0, VK_WHOLE_SIZE, 0);
+    endSingleTimeCommands(commandBuffer);
 }
 
-void generateMipmaps(VkImage image, VkFormat format, u32 texWidth, u32 texHeight, u32 mLevels) {
+// Image must be created with VK_IMAGE_USAGE_STORAGE_BIT, sRGB images also need
+// VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT and VK_IMAGE_CREATE_EXTENDED_USAGE_BIT (storage goes through UNORM views)
+b32 createMipGenerationTarget(
+    VkImage image,
+    VkFormat format,
+    u32 width,
+    u32 height,
+    u32 levelCount,
+    MipGenerationTarget* target
+) {
+    if (isMipGenerationSupported == QQ_FALSE) {
+        return QQ_FALSE;
+    }
+    if (format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB) {
+        logError("Compute mip generation supports RGBA8 images only");
+        return QQ_FALSE;
+    }
+    if (
+        max(width, height) > MIP_GENERATION_MAX_DIMENSION
+        || levelCount > MIP_GENERATION_MAX_LEVELS
+        || levelCount < 2
+    ) {
+        logError("Compute mip generation supports 2-%u levels up to %u texels", MIP_GENERATION_MAX_LEVELS, MIP_GENERATION_MAX_DIMENSION);
+        return QQ_FALSE;
+    }
 
-    // Check if image format supports linear blitting
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(
-        physicalDevice,
-        format,
-        &formatProperties
-    );
-    if (!(
-        formatProperties.optimalTilingFeatures
-        & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT
-    )) {
-        printf("[ERROR] Texture image format does not support linear blitting\n");
+    u32 counterSlot = 0;
+    while (counterSlot < MIP_GENERATION_MAX_TARGETS && mipGenerationCounterSlots[counterSlot] == QQ_TRUE) {
+        counterSlot += 1;
+    }
+    if (counterSlot == MIP_GENERATION_MAX_TARGETS) {
+        logError("Too many mip generation targets (%u)", MIP_GENERATION_MAX_TARGETS);
+        return QQ_FALSE;
     }
 
+    *target = (MipGenerationTarget){
+        .image = image,
+        .width = width,
+        .height = height,
+        .levelCount = levelCount,
+        .isSrgb = format == VK_FORMAT_R8G8B8A8_SRGB,
+        .counterSlot = counterSlot
+    };
 
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    for (u32 level = 0; level < levelCount; level++) {
+        VkImageViewCreateInfo viewInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = image,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = level,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+        if (vkCreateImageView(logicalDevice, &viewInfo, NULL, &target->levelViews[level]) != VK_SUCCESS) {
+            logError("Failed to create mip generation level view");
+        }
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = mipGenerationDescriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &mipGenerationSetLayout
+    };
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &target->descriptorSet) != VK_SUCCESS) {
+        logError("Failed to allocate mip generation descriptor set");
+    }
+
+    // Levels past the chain are never accessed, they repeat the last view to keep set valid
+    VkDescriptorImageInfo imageInfos[MIP_GENERATION_MAX_LEVELS];
+    for (u32 level = 0; level < MIP_GENERATION_MAX_LEVELS; level++) {
+        imageInfos[level] = (VkDescriptorImageInfo){
+            .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .imageView = target->levelViews[min(level, levelCount - 1)]
+        };
+    }
+    VkDescriptorBufferInfo counterInfo = {
+        .buffer = mipGenerationCounterBuffer,
+        .offset = mipGenerationCounterStride * counterSlot,
+        .range = sizeof(u32)
+    };
+    VkWriteDescriptorSet descriptorWrites[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = target->descriptorSet,
+            .dstBinding = 0,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = MIP_GENERATION_MAX_LEVELS,
+            .pImageInfo = imageInfos
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = target->descriptorSet,
+            .dstBinding = 1,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &counterInfo
+        }
+    };
+    vkUpdateDescriptorSets(logicalDevice, 2, descriptorWrites, 0, NULL);
+
+    mipGenerationCounterSlots[counterSlot] = QQ_TRUE;
+    return QQ_TRUE;
+}
+
+void destroyMipGenerationTarget(MipGenerationTarget* target) {
+    vkFreeDescriptorSets(logicalDevice, mipGenerationDescriptorPool, 1, &target->descriptorSet);
+    for (u32 level = 0; level < target->levelCount; level++) {
+        vkDestroyImageView(logicalDevice, target->levelViews[level], NULL);
+    }
+    mipGenerationCounterSlots[target->counterSlot] = QQ_FALSE;
+}
+
+// Generates all levels from level 0 with one dispatch, level 0 is expected to be written
+// by rendering or transfer in `level0Layout`, whole image ends in shader read layout
+// Dispatches using the same target must not overlap (they share the workgroup counter)
+void recordMipGeneration(VkCommandBuffer commandBuffer, const MipGenerationTarget* target, VkImageLayout level0Layout) {
+    VkImageMemoryBarrier barriers[2] = {
+        {
+            // Level 0 keeps its contents
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = level0Layout,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = target->image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        },
+        {
+            // Other levels are fully overwritten
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = target->image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 1,
+                .levelCount = target->levelCount - 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        }
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        2, barriers
+    );
+
+    u32 workgroupsX = (target->width + MIP_GENERATION_BLOCK_SIZE - 1) / MIP_GENERATION_BLOCK_SIZE;
+    u32 workgroupsY = (target->height + MIP_GENERATION_BLOCK_SIZE - 1) / MIP_GENERATION_BLOCK_SIZE;
+    MipPushConstants pushConstants = {
+        .width = target->width,
+        .height = target->height,
+        .levelCount = target->levelCount,
+        .isSrgb = target->isSrgb,
+        .workgroupCount = workgroupsX * workgroupsY
+    };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mipGenerationPipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        mipGenerationPipelineLayout,
+        0,
+        1,
+        &target->descriptorSet,
+        0,
+        NULL
+    );
+    vkCmdPushConstants(
+        commandBuffer,
+        mipGenerationPipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(MipPushConstants),
+        &pushConstants
+    );
+    vkCmdDispatch(commandBuffer, workgroupsX, workgroupsY, 1);
+
+    VkImageMemoryBarrier readBarrier = barriers[0];
+    readBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    readBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    readBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    readBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    readBarrier.subresourceRange.levelCount = target->levelCount;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &readBarrier
+    );
+}
+
+void shutdownMipGenerator() {
+    if (isMipGenerationSupported == QQ_FALSE) {
+        return;
+    }
+    vkDestroyBuffer(logicalDevice, mipGenerationCounterBuffer, NULL);
+    vkFreeMemory(logicalDevice, mipGenerationCounterBufferMemory, NULL);
+    vkDestroyDescriptorPool(logicalDevice, mipGenerationDescriptorPool, NULL);
+    vkDestroyPipeline(logicalDevice, mipGenerationPipeline, NULL);
+    vkDestroyPipelineLayout(logicalDevice, mipGenerationPipelineLayout, NULL);
+    vkDestroyDescriptorSetLayout(logicalDevice, mipGenerationSetLayout, NULL);
+}
 
+// Classic cascade for comparison, one blit and two barriers per level
+void recordBlitMipChain(VkCommandBuffer commandBuffer, VkImage image, u32 width, u32 height, u32 levelCount) {
     VkImageMemoryBarrier barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .image = image,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
         .subresourceRange = {
             .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 1,
+            .levelCount = levelCount - 1,
             .baseArrayLayer = 0,
-            .layerCount = 1,
-            .levelCount = 1
-        }
+            .layerCount = 1
+        },
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT
     };
-
-    u32 mipWidth = texWidth;
-    u32 mipHeight = texHeight;
-
-    for (u32 i = 1; i < mLevels; i++) {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
+    barrier.subresourceRange.levelCount = 1;
+
+    i32 levelWidth = width;
+    i32 levelHeight = height;
+    for (u32 level = 1; level < levelCount; level++) {
+        // Previous level becomes blit source
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout = level == 1 ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcAccessMask = level == 1 ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
         barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
         vkCmdPipelineBarrier(
             commandBuffer,
+            level == 1 ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
             VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            0,
             0,
-            NULL,
-            0,
-            NULL,
-            1,
-            &barrier
+            0, NULL,
+            0, NULL,
+            1, &barrier
         );
 
-        // Record all blits
+        i32 nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+        i32 nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
         VkImageBlit blit = {
-            .srcOffsets = {
-                {0, 0, 0},
-                {mipWidth, mipHeight, 1}
-            },
-            .srcSubresource = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .mipLevel = i - 1,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            },
-            .dstOffsets = {
-                {0, 0, 0},
-                {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1}
-            },
-            .dstSubresource = {
-                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-                .mipLevel = i,
-                .baseArrayLayer = 0,
-                .layerCount = 1,
-            }
+            .srcOffsets = {{0, 0, 0}, {levelWidth, levelHeight, 1}},
+            .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1},
+            .dstOffsets = {{0, 0, 0}, {nextWidth, nextHeight, 1}},
+            .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1}
         };
         vkCmdBlitImage(
             commandBuffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &blit,
+            image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1, &blit,
             VK_FILTER_LINEAR
         );
 
-        // Reapply barrier
+        // Source level is done
         barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
         barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
         barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
         barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
         vkCmdPipelineBarrier(
             commandBuffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
             0,
-            0,
-            NULL,
-            0,
-            NULL,
-            1,
-            &barrier
+            0, NULL,
+            0, NULL,
+            1, &barrier
         );
 
-        // Divide dimentions by 2
-        mipWidth = mipWidth > 1 ? mipWidth / 2 : mipWidth;
-        mipHeight = mipHeight > 1 ? mipHeight / 2 : mipHeight;
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
 
-        // Add more barriers
-        barrier.subresourceRange.baseMipLevel = mLevels - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.subresourceRange.baseMipLevel = levelCount - 1;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
+}
 
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT,
-            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-            0,
-            0,
-            NULL,
-            0,
-            NULL,
-            1,
-            &barrier
-        );
+// sRGB image usable by both blits and compute mip generation, level 0 filled with noisy gradient
+void createMipBenchmarkImage(u32 size, u32 levelCount, VkBuffer pixelBuffer, VkImage* image, VkDeviceMemory* imageMemory) {
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .extent = {size, size, 1},
+        .mipLevels = levelCount,
+        .arrayLayers = 1,
+        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+            | VK_IMAGE_USAGE_TRANSFER_DST_BIT
+            | VK_IMAGE_USAGE_SAMPLED_BIT
+            | VK_IMAGE_USAGE_STORAGE_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .samples = VK_SAMPLE_COUNT_1_BIT
+    };
+    if (vkCreateImage(logicalDevice, &imageInfo, NULL, image) != VK_SUCCESS) {
+        logError("Failed to create mip benchmark image");
+    }
 
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(logicalDevice, *image, &memRequirements);
+    VkMemoryAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memRequirements.size,
+        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    if (vkAllocateMemory(logicalDevice, &allocInfo, NULL, imageMemory) != VK_SUCCESS) {
+        logError("Failed to allocate mip benchmark image memory");
     }
+    vkBindImageMemory(logicalDevice, *image, *imageMemory, 0);
 
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = *image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+    VkBufferImageCopy region = {
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageExtent = {size, size, 1}
+    };
+    vkCmdCopyBufferToImage(commandBuffer, pixelBuffer, *image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
     endSingleTimeCommands(commandBuffer);
 }
 
-// Helper to copy buffer to image
-void copyBufferToImage(VkBuffer buffer, VkImage image, u32 width, u32 height) {
+// Reads level back into `readbackBuffer`, image stays in shader read layout
+void readMipBenchmarkLevel(VkImage image, u32 level, u32 size, VkBuffer readbackBuffer) {
     VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-    // Specify which part of the buffer will be copied to which part of the image
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1}
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+    u32 levelSize = max(size >> level, 1);
     VkBufferImageCopy region = {
-        .bufferOffset = 0,
-        .bufferRowLength = 0,
-        .bufferImageHeight = 0,
-
-        .imageSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .mipLevel = 0,
-            .baseArrayLayer = 0,
-            .layerCount = 1
-        },
-
-        .imageOffset = {0,0,0},
-        .imageExtent = {width, height, 1}
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1},
+        .imageExtent = {levelSize, levelSize, 1}
     };
-
-    vkCmdCopyBufferToImage(
-        commandBuffer,
-        buffer,
-        image,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        1,
-        &region
-    );
-
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
     endSingleTimeCommands(commandBuffer);
 }
 
-void createTextureImage() {
-    printf("Loading texture\n");
-
-    u32 textureWidth, textureHeight, textureChannels;
-    stbi_uc* pixels = stbi_load(
-        MESH_TEXTURE_PATH,
-        &textureWidth,
-        &textureHeight,
-        &textureChannels,
-        STBI_rgb_alpha
-    );
-    VkDeviceSize imageSize = textureWidth * textureHeight * 4;
+// Times blit cascade against single pass compute generation with GPU timestamps,
+// then compares their results against each other
+void benchmarkMipGeneration() {
+    if (isMipGenerationSupported == QQ_FALSE) {
+        logInfo("[MIP BENCH] Compute mip generation is not supported, nothing to compare");
+        return;
+    }
 
-    // Calculate mip levels
-    mipLevels = (u32)floor(log2(max(textureWidth, textureHeight)));
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+    b32 isBlitSupported = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) != 0;
 
-    if (!pixels) {
-        printf("[ERROR] Failed to load texture image");
-    }
+    u32 size = MIP_GENERATION_BENCHMARK_DIMENSION;
+    u32 levelCount = mipmapGetLevelCount(size, size);
+    VkDeviceSize pixelSize = (VkDeviceSize)size * size * 4;
 
-    // Prepare to load into optimized buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
+    // Same level 0 for both images
+    VkBuffer pixelBuffer;
+    VkDeviceMemory pixelBufferMemory;
     createBuffer(
-        imageSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        pixelSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer,
-        &stagingBufferMemory
+        &pixelBuffer,
+        &pixelBufferMemory
     );
+    u8* pixels;
+    vkMapMemory(logicalDevice, pixelBufferMemory, 0, pixelSize, 0, (void**)&pixels);
+    srand(1);
+    for (u32 y = 0; y < size; y++) {
+        for (u32 x = 0; x < size; x++) {
+            u8* texel = &pixels[((VkDeviceSize)y * size + x) * 4];
+            texel[0] = (u8)(x * 255 / size);
+            texel[1] = (u8)(y * 255 / size);
+            texel[2] = (u8)(rand() & 255);
+            texel[3] = 255;
+        }
+    }
 
-    // Copy to staging buffer
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, imageSize);
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+    VkImage blitImage, computeImage;
+    VkDeviceMemory blitImageMemory, computeImageMemory;
+    createMipBenchmarkImage(size, levelCount, pixelBuffer, &blitImage, &blitImageMemory);
+    createMipBenchmarkImage(size, levelCount, pixelBuffer, &computeImage, &computeImageMemory);
 
-    // Free stb image buffer
-    stbi_image_free(pixels);
+    MipGenerationTarget target;
+    createMipGenerationTarget(computeImage, VK_FORMAT_R8G8B8A8_SRGB, size, size, levelCount, &target);
 
-    // Create image via helper
-    createImage(
-        textureWidth,
-        textureHeight,
-        mipLevels,
-        VK_SAMPLE_COUNT_1_BIT,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-            | VK_IMAGE_USAGE_TRANSFER_DST_BIT
-            | VK_IMAGE_USAGE_SAMPLED_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &textureImage,
-        &textureImageMemory
+    VkQueryPoolCreateInfo queryPoolInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2
+    };
+    VkQueryPool queryPool;
+    vkCreateQueryPool(logicalDevice, &queryPoolInfo, NULL, &queryPool);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    logInfo(
+        "[MIP BENCH] %ux%u sRGB, %u levels, %u iterations",
+        size,
+        size,
+        levelCount,
+        MIP_GENERATION_BENCHMARK_ITERATIONS
     );
 
-    // Transition to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    transitionImageLayout(
-        textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_LAYOUT_UNDEFINED,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    );
+    // Every run is submitted and waited alone, so runs never overlap on GPU
+    for (u32 method = 0; method < 2; method++) {
+        if (method == 0 && isBlitSupported == QQ_FALSE) {
+            logInfo("[MIP BENCH] Blit cascade: skipped, no linear filtering for sRGB RGBA8");
+            continue;
+        }
 
-    // Execute buffer to image copy operation
-    copyBufferToImage(
-        stagingBuffer,
-        textureImage,
-        textureWidth,
-        textureHeight
-    );
+        f64 bestGpuTimeMs = 0.0;
+        f64 totalGpuTimeMs = 0.0;
+        f64 totalCpuTimeMs = 0.0;
+        for (u32 iteration = 0; iteration < MIP_GENERATION_BENCHMARK_ITERATIONS; iteration++) {
+            f64 startTime = getTimeMs();
+            VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+            if (method == 0) {
+                recordBlitMipChain(commandBuffer, blitImage, size, size, levelCount);
+            } else {
+                recordMipGeneration(commandBuffer, &target, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            }
+            vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+            endSingleTimeCommands(commandBuffer);
+            totalCpuTimeMs += getTimeMs() - startTime;
+
+            u64 timestamps[2];
+            vkGetQueryPoolResults(
+                logicalDevice,
+                queryPool,
+                0,
+                2,
+                sizeof(timestamps),
+                timestamps,
+                sizeof(u64),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+            );
+            f64 gpuTimeMs = (f64)(timestamps[1] - timestamps[0]) * properties.limits.timestampPeriod / 1000000.0;
+            totalGpuTimeMs += gpuTimeMs;
+            if (iteration == 0 || gpuTimeMs < bestGpuTimeMs) {
+                bestGpuTimeMs = gpuTimeMs;
+            }
+        }
 
-    // Prepare image for reading from shader
-    // M: COMM
-    /*transitionImageLayout(
-        textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-    );*/
-    generateMipmaps(
-        textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        textureWidth,
-        textureHeight,
-        mipLevels
-    );
+        logInfo(
+            "[MIP BENCH] %s: GPU avg %.3f ms, best %.3f ms | submit to idle avg %.3f ms",
+            method == 0 ? "Blit cascade (1 blit + 2 barriers per level)" : "Compute single pass (1 dispatch)",
+            totalGpuTimeMs / MIP_GENERATION_BENCHMARK_ITERATIONS,
+            bestGpuTimeMs,
+            totalCpuTimeMs / MIP_GENERATION_BENCHMARK_ITERATIONS
+        );
+    }
 
-    // Cleanup staging buffer
-    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+    // Compute result against the CPU reference filter (mipmap.c), and against blits
+    u8* reference = malloc(mipmapGetChainSize(size, size, levelCount));
+    mipmapGenerateChain(pixels, size, size, levelCount, reference, QQ_TRUE);
+    u8* referenceLevel = reference;
+    u32 checkedLevels[3] = {1, 6, levelCount - 1};
+    u32 checkedIndex = 0;
+    for (u32 level = 0; level < levelCount && checkedIndex < 3; level++) {
+        u32 levelSize = max(size >> level, 1);
+        if (level == checkedLevels[checkedIndex]) {
+            u32 computeDifference = 0;
+            u32 blitDifference = 0;
+            readMipBenchmarkLevel(computeImage, level, size, pixelBuffer);
+            for (u64 i = 0; i < (u64)levelSize * levelSize * 4; i++) {
+                computeDifference = max(computeDifference, (u32)abs((i32)pixels[i] - (i32)referenceLevel[i]));
+            }
+            if (isBlitSupported == QQ_TRUE) {
+                readMipBenchmarkLevel(blitImage, level, size, pixelBuffer);
+                for (u64 i = 0; i < (u64)levelSize * levelSize * 4; i++) {
+                    blitDifference = max(blitDifference, (u32)abs((i32)pixels[i] - (i32)referenceLevel[i]));
+                }
+            }
+            logInfo(
+                "[MIP BENCH] Level %u (%ux%u) max difference to CPU filter: compute %u, blit %u",
+                level,
+                levelSize,
+                levelSize,
+                computeDifference,
+                blitDifference
+            );
+            checkedIndex += 1;
+        }
+        referenceLevel += (u64)levelSize * levelSize * 4;
+    }
+    free(reference);
+
+    vkDestroyQueryPool(logicalDevice, queryPool, NULL);
+    destroyMipGenerationTarget(&target);
+    vkDestroyImage(logicalDevice, blitImage, NULL);
+    vkFreeMemory(logicalDevice, blitImageMemory, NULL);
+    vkDestroyImage(logicalDevice, computeImage, NULL);
+    vkFreeMemory(logicalDevice, computeImageMemory, NULL);
+    vkUnmapMemory(logicalDevice, pixelBufferMemory);
+    vkDestroyBuffer(logicalDevice, pixelBuffer, NULL);
+    vkFreeMemory(logicalDevice, pixelBufferMemory, NULL);
 }
 
-void createTextureImageView() {
-    printf("Creating texture image view\n");
-    textureImageView = createImageView(
-        textureImage,
-        VK_FORMAT_R8G8B8A8_SRGB,
-        VK_IMAGE_ASPECT_COLOR_BIT,
-        mipLevels
+void createColorResources() {
+    VkFormat colorFormat = swapchainImageFormat;
+
+    createImage(
+        swapchainExtent.width,
+        swapchainExtent.height,
+        1,
+        msaaSamples,
+        colorFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &colorImage,
+        &colorImageMemory
     );
+    colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 }
 
-void createTextureSampler() {
-    printf("Create texture sampler\n");
+void createDepthResources() {
+    logDebug("Creationg depth resources");
 
-    VkSamplerCreateInfo samplerInfo = {
-        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
-        .magFilter = VK_FILTER_LINEAR,
-        .minFilter = VK_FILTER_LINEAR,
+    VkFormat depthFormat = findDepthFormat();
 
-        // U, V, W === X, Y, Z coordinates
-        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
-        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+    createImage(
+        swapchainExtent.width,
+        swapchainExtent.height,
+        1,
+        msaaSamples,
+        depthFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &depthImage,
+        &depthImageMemory
+    );
+    depthImageView = createImageView(
+        depthImage,
+        depthFormat,
+        VK_IMAGE_ASPECT_DEPTH_BIT,
+        1
+    );
+}
 
-        // Setup anisotropic filtering
-        .anisotropyEnable = VK_TRUE,
-        .maxAnisotropy = 16.0f,
+// Uploads tightly packed levels [firstLevel, firstLevel + levelCount) with one region per level,
+// `levelOffsets` are in bytes. Layout transitions and the copy go into one submission,
+// so whole chain costs one round trip. Whole mip range ends up in shader read layout,
+// so the full range view is valid. Levels before `firstLevel` are left for streaming,
+// their contents are undefined until then (minimum LOD keeps them from being sampled)
+void copyBufferToImageLevels(
+    VkBuffer buffer,
+    VkImage image,
+    u32 width,
+    u32 height,
+    u32 firstLevel,
+    u32 levelCount,
+    const VkDeviceSize* levelOffsets
+) {
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
-        // Color returned when sampling beyond the image with
-        // "clamp to border" addressing mode
-        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = firstLevel,
+            .levelCount = levelCount,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
 
-        // Flag is addressing should be in normalized coordinates
-        .unnormalizedCoordinates = VK_FALSE,
+    VkBufferImageCopy* regions = malloc(sizeof(VkBufferImageCopy) * levelCount);
+    for (u32 i = 0; i < levelCount; i++) {
+        u32 level = firstLevel + i;
+        VkBufferImageCopy region = {
+            .bufferOffset = levelOffsets[i],
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
 
-        // If enabled, texels will be first compared to a value, and result
-        // of the comparison is used in filtering operation
-        .compareEnable = VK_FALSE,
-        .compareOp = VK_COMPARE_OP_ALWAYS,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
 
-        // Setup mipmapping
-        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
-        .mipLodBias = 0.0f,
-        .minLod = 0.0f,
-        .maxLod = (f32)mipLevels
-    };
+            .imageOffset = {0,0,0},
+            .imageExtent = {max(width >> level, 1), max(height >> level, 1), 1}
+        };
+        regions[i] = region;
+    }
 
-    if (vkCreateSampler(logicalDevice, &samplerInfo, NULL, &textureSampler) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create texture sampler\n");
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        buffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        levelCount,
+        regions
+    );
+
+    // Prepare all levels for reading from shader, streamed ones skip transfer layout
+    // until their own upload
+    VkImageMemoryBarrier readBarriers[2];
+    u32 readBarrierCount = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    readBarriers[readBarrierCount++] = barrier;
+    if (firstLevel > 0) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.srcAccessMask = 0;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = firstLevel;
+        readBarriers[readBarrierCount++] = barrier;
     }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        readBarrierCount, readBarriers
+    );
+
+    endSingleTimeCommands(commandBuffer);
+
+    free(regions);
 }
 
-// Helper function to copy data between 2 buffers
-void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+// Checks if format can be sampled with linear filtering from optimal tiling images
+b32 isTextureFormatSupported(VkFormat format) {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
 
-    // Memory transfer operations are executed through command buffers
-    // So allocate temp command buffer
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT
+        | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
 
-    // Record command for transfering contents of the buffer
-    VkBufferCopy copyRegion = {
-        .srcOffset = 0,
-        .dstOffset = 0,
-        .size = size
+// Maps KTX2 format to block format and RGBA format used when device cannot sample it
+b32 getBlockCompressedFormat(u32 format, BcnFormat* bcnFormat, VkFormat* fallbackFormat) {
+    switch (format) {
+        case KTX2_FORMAT_BC1_RGB_UNORM:
+        case KTX2_FORMAT_BC1_RGBA_UNORM:
+            *bcnFormat = BCN_FORMAT_BC1;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_UNORM;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC1_RGB_SRGB:
+        case KTX2_FORMAT_BC1_RGBA_SRGB:
+            *bcnFormat = BCN_FORMAT_BC1;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_SRGB;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC3_UNORM:
+            *bcnFormat = BCN_FORMAT_BC3;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_UNORM;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC3_SRGB:
+            *bcnFormat = BCN_FORMAT_BC3;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_SRGB;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC5_UNORM:
+            *bcnFormat = BCN_FORMAT_BC5;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_UNORM;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC7_UNORM:
+            *bcnFormat = BCN_FORMAT_BC7;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_UNORM;
+            return QQ_TRUE;
+        case KTX2_FORMAT_BC7_SRGB:
+            *bcnFormat = BCN_FORMAT_BC7;
+            *fallbackFormat = VK_FORMAT_R8G8B8A8_SRGB;
+            return QQ_TRUE;
+        default:
+            return QQ_FALSE;
+    }
+}
+
+// Size of one level as stored in KTX2, RGBA8 when not block compressed
+VkDeviceSize getKtx2LevelSize(b32 isBlockCompressed, BcnFormat bcnFormat, u32 width, u32 height) {
+    if (isBlockCompressed == QQ_TRUE) {
+        return bcnGetLevelSize(bcnFormat, width, height);
+    }
+    return (VkDeviceSize)width * height * 4;
+}
+
+// Accounts host visible memory held for texture uploads
+void trackTextureStagingBytes(VkDeviceSize size, b32 isAllocated) {
+    if (isAllocated == QQ_TRUE) {
+        textureStagingBytes += size;
+        textureStagingPeakBytes = max(textureStagingPeakBytes, textureStagingBytes);
+    } else {
+        textureStagingBytes -= size;
+    }
+}
+
+// Size of streamed level as it is copied into the image
+VkDeviceSize getTextureStreamLevelSize(const TextureStream* stream, u32 level) {
+    const Ktx2Level* levelInfo = &stream->source.levels[level];
+    if (stream->decompress == QQ_TRUE) {
+        return (VkDeviceSize)levelInfo->width * levelInfo->height * 4;
+    }
+    return getKtx2LevelSize(stream->isBlockCompressed, stream->bcnFormat, levelInfo->width, levelInfo->height);
+}
+
+void destroyStreamStagingBuffer() {
+    if (streamStagingBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkUnmapMemory(logicalDevice, streamStagingBufferMemory);
+    vkDestroyBuffer(logicalDevice, streamStagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, streamStagingBufferMemory, NULL);
+    trackTextureStagingBytes(streamStagingSize, QQ_FALSE);
+
+    streamStagingBuffer = VK_NULL_HANDLE;
+    streamStagingBufferMemory = VK_NULL_HANDLE;
+    streamStagingMapped = NULL;
+    streamStagingSize = 0;
+}
+
+// Staging buffer only ever holds one level, so it is sized by the largest one
+void createTextureStreamResources(TextureStream* stream) {
+    VkDeviceSize levelSize = getTextureStreamLevelSize(stream, 0);
+    if (levelSize > streamStagingSize) {
+        destroyStreamStagingBuffer();
+
+        createBuffer(
+            levelSize,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &streamStagingBuffer,
+            &streamStagingBufferMemory
+        );
+        vkMapMemory(logicalDevice, streamStagingBufferMemory, 0, levelSize, 0, (void**)&streamStagingMapped);
+        streamStagingSize = levelSize;
+        trackTextureStagingBytes(levelSize, QQ_TRUE);
+    }
+
+    // Upload of every level is submitted without waiting, completion is polled every frame
+    VkCommandBufferAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandPool = commandPool,
+        .commandBufferCount = 1
     };
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, &stream->uploadCommandBuffer) != VK_SUCCESS) {
+        logError("Failed to allocate texture stream command buffer");
+    }
+}
 
-    // Stop recording
-    endSingleTimeCommands(commandBuffer);
+// Runs on streaming thread, fills staging buffer with the next level
+void prepareTextureLevelJob(void* userData) {
+    TextureStream* stream = (TextureStream*)userData;
+    u32 level = stream->streamingLevel;
+    const Ktx2Level* levelInfo = &stream->source.levels[level];
+    u64 traceStart = traceBegin();
+
+    if (stream->decompress == QQ_TRUE) {
+        bcnDecodeImage(
+            stream->bcnFormat,
+            ktx2GetLevelData(&stream->source, level),
+            levelInfo->width,
+            levelInfo->height,
+            streamStagingMapped
+        );
+    } else {
+        memcpy(
+            streamStagingMapped,
+            ktx2GetLevelData(&stream->source, level),
+            getTextureStreamLevelSize(stream, level)
+        );
+    }
+    traceEnd("prepare texture level", traceStart);
 }
 
-// Custom OBJ loader
-void loadModel() {
-    printf("Loading model\n");
+// Copies prepared level into the image. Only this level leaves shader read layout for the copy,
+// it is not sampled yet (minimum LOD), so earlier frames need no access ordering against it
+void submitTextureLevelUpload(TextureStream* stream) {
+    u32 level = stream->streamingLevel;
+    const Ktx2Level* levelInfo = &stream->source.levels[level];
+    VkCommandBuffer commandBuffer = stream->uploadCommandBuffer;
 
-    // Read file
-    FILE* file = fopen(MESH_MODEL_PATH, "r");
+    vkResetCommandBuffer(commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+    };
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-    // Buffer for line
-    char line[128];
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = stream->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
 
-    // Get verticies and indicies count
-    u32 vertexCount = 0;
-    u32 uvCount = 0;
-    u32 indexCount = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        char header[128];
-        sscanf(line, "%s", header);
+    VkBufferImageCopy region = {
+        .bufferOffset = 0,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = level,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .imageOffset = {0,0,0},
+        .imageExtent = {levelInfo->width, levelInfo->height, 1}
+    };
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        streamStagingBuffer,
+        stream->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &region
+    );
 
-        if (strcmp(header, "v") == 0) {
-            vertexCount += 1;
-            continue;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
+
+    vkEndCommandBuffer(commandBuffer);
+
+    // Frames submitted later see the level, earlier ones never sample it
+    stream->uploadTimelineValue = submitGraphicsCommands(commandBuffer, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+    stream->isUploading = QQ_TRUE;
+}
+
+// Advances every stream by at most one step, never blocks
+void updateTextureStreams() {
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        TextureStream* stream = &textureStreams[i];
+
+        // Level landed, clamp is lowered for the next recorded frame
+        if (
+            stream->isUploading == QQ_TRUE
+            && isTimelineValueReached(stream->uploadTimelineValue) == QQ_TRUE
+        ) {
+            stream->isUploading = QQ_FALSE;
+            stream->residentLevel = stream->streamingLevel;
+            stream->residentBytes += getTextureStreamLevelSize(stream, stream->residentLevel);
+            isStreamStagingBusy = QQ_FALSE;
+
+            if (stream->residentLevel == 0) {
+                stream->completeTime = getTimeMs();
+                logInfo(
+                    "[STREAM] Texture %u fully resident after %.2f ms",
+                    stream->textureIndex,
+                    stream->completeTime - stream->startTime
+                );
+                ktx2Free(&stream->source);
+            }
         }
 
-        if (strcmp(header, "vt") == 0) {
-            uvCount += 1;
-            continue;
+        // Level decoded, copy it on GPU
+        if (stream->isPreparing == QQ_TRUE && jobCounterIsDone(&stream->prepareCounter) == QQ_TRUE) {
+            stream->isPreparing = QQ_FALSE;
+            submitTextureLevelUpload(stream);
         }
 
-        // Indices (face)
-        if (strcmp(header, "f") == 0) {
-            indexCount += 3;
-            continue;
+        // Staging buffer is shared, so only one level is in flight at a time
+        if (
+            stream->residentLevel > 0
+            && stream->isPreparing == QQ_FALSE
+            && stream->isUploading == QQ_FALSE
+            && isStreamStagingBusy == QQ_FALSE
+        ) {
+            isStreamStagingBusy = QQ_TRUE;
+            stream->streamingLevel = stream->residentLevel - 1;
+            stream->isPreparing = QQ_TRUE;
+            jobPoolSubmit(&streamingJobPool, &prepareTextureLevelJob, stream, &stream->prepareCounter);
         }
     }
 
-    // Allocate memory for verticies
-    meshVertexCount = vertexCount;
-    meshVertices = malloc(sizeof(Vertex) * vertexCount);
+    // Staging memory is only needed while something streams
+    b32 isStreaming = QQ_FALSE;
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        isStreaming |= textureStreams[i].residentLevel > 0;
+    }
+    if (isStreaming == QQ_FALSE) {
+        destroyStreamStagingBuffer();
+    }
+}
 
-    // Allocate temp storage for UV coordinates
-    vec2* uvs = malloc(sizeof(vec2) * uvCount);
+// Slice of the frame is free, its timeline value was waited at the start of the frame
+void updateTextureResidency(u32 frameIndex) {
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        const TextureStream* stream = &textureStreams[i];
+        if (stream->textureIndex != U32_MAX) {
+            textureResidencyMapped[stream->textureIndex * MAX_FRAMES_IN_FLIGHT + frameIndex] =
+                (f32)stream->residentLevel;
+        }
+    }
+}
 
-    // Allocate memory for indices
-    meshIndexCount = indexCount;
-    meshIndices = malloc(sizeof(u32) * indexCount);
+// Links stream of the image to its slot in the global texture array
+void setTextureStreamIndex(VkImage image, u32 textureIndex) {
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        if (textureStreams[i].image == image) {
+            textureStreams[i].textureIndex = textureIndex;
+        }
+    }
+}
 
+void printTextureStreamingStats() {
+    logInfo(
+        "[STREAM] Texture staging: %lu KiB in use, peak %lu KiB",
+        textureStagingBytes / 1024,
+        textureStagingPeakBytes / 1024
+    );
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        const TextureStream* stream = &textureStreams[i];
+        char progress[64];
+        if (stream->residentLevel == 0) {
+            snprintf(progress, sizeof(progress), "done in %.2f ms", stream->completeTime - stream->startTime);
+        } else {
+            snprintf(progress, sizeof(progress), "streaming level %u", stream->streamingLevel);
+        }
+        logInfo(
+            "[STREAM]   texture %u: levels %u-%u of %u resident, %lu / %lu KiB, %s",
+            stream->textureIndex,
+            stream->residentLevel,
+            stream->levelCount - 1,
+            stream->levelCount,
+            stream->residentBytes / 1024,
+            stream->totalBytes / 1024,
+            progress
+        );
+    }
+}
 
-    // Rewind file and start to populate data
-    rewind(file);
-    u32 currentVertexIndex = 0;
-    u32 currentUvIndex = 0;
+// Waits for in flight work, device must be idle
+void shutdownTextureStreams() {
+    for (u32 i = 0; i < textureStreamCount; i++) {
+        TextureStream* stream = &textureStreams[i];
+        jobPoolWait(&streamingJobPool, &stream->prepareCounter);
+        vkFreeCommandBuffers(logicalDevice, commandPool, 1, &stream->uploadCommandBuffer);
+        if (stream->residentLevel > 0) {
+            ktx2Free(&stream->source);
+        }
+    }
+    textureStreamCount = 0;
+    destroyStreamStagingBuffer();
+}
+
+// Uploads pre-baked mip chain as is, block compressed one is decompressed to RGBA8
+// if format is not supported. Takes ownership of `texture` on success
+b32 createTextureImageFromKtx2(Ktx2Texture* texture) {
+    BcnFormat bcnFormat = BCN_FORMAT_BC1;
+    VkFormat fallbackFormat = (VkFormat)texture->format;
+    b32 isBlockCompressed = getBlockCompressedFormat(texture->format, &bcnFormat, &fallbackFormat);
+    if (
+        isBlockCompressed == QQ_FALSE
+        && texture->format != KTX2_FORMAT_R8G8B8A8_UNORM
+        && texture->format != KTX2_FORMAT_R8G8B8A8_SRGB
+    ) {
+        logError("Unsupported KTX2 texture format: %u", texture->format);
+        return QQ_FALSE;
+    }
+
+    // Levels must be complete, decoder and copy regions rely on it
+    for (u32 level = 0; level < texture->levelCount; level++) {
+        const Ktx2Level* levelInfo = &texture->levels[level];
+        if (levelInfo->size < getKtx2LevelSize(isBlockCompressed, bcnFormat, levelInfo->width, levelInfo->height)) {
+            logError("KTX2 level %u is smaller than expected", level);
+            return QQ_FALSE;
+        }
+    }
+
+    // RGBA8 sampling with linear filter is mandatory, only block formats may need decoding
+    b32 decompress = isBlockCompressed == QQ_TRUE
+        && isTextureFormatSupported((VkFormat)texture->format) == QQ_FALSE;
+    textureFormat = decompress == QQ_TRUE ? fallbackFormat : (VkFormat)texture->format;
+    mipLevels = texture->levelCount;
+
+    // Only the smallest levels are uploaded now, larger ones are streamed in afterwards
+    u32 firstResidentLevel = 0;
+    if (textureStreamingEnabled == QQ_TRUE && textureStreamCount < MAX_TEXTURE_STREAMS) {
+        while (
+            firstResidentLevel + 1 < mipLevels
+            && max(
+                texture->levels[firstResidentLevel].width,
+                texture->levels[firstResidentLevel].height
+            ) > TEXTURE_STREAM_RESIDENT_DIMENSION
+        ) {
+            firstResidentLevel++;
+        }
+    }
+    u32 residentLevelCount = mipLevels - firstResidentLevel;
+
+    // Levels are packed one after another, both block and RGBA8 sizes keep 4 byte alignment
+    VkDeviceSize* levelOffsets = malloc(sizeof(VkDeviceSize) * residentLevelCount);
+    VkDeviceSize imageSize = 0;
+    VkDeviceSize totalSize = 0;
+    VkDeviceSize uncompressedSize = 0;
+    for (u32 level = 0; level < mipLevels; level++) {
+        const Ktx2Level* levelInfo = &texture->levels[level];
+        VkDeviceSize rgbaSize = (VkDeviceSize)levelInfo->width * levelInfo->height * 4;
+        VkDeviceSize levelSize = decompress == QQ_TRUE
+            ? rgbaSize
+            : getKtx2LevelSize(isBlockCompressed, bcnFormat, levelInfo->width, levelInfo->height);
+
+        if (level >= firstResidentLevel) {
+            levelOffsets[level - firstResidentLevel] = imageSize;
+            imageSize += levelSize;
+        }
+        totalSize += levelSize;
+        uncompressedSize += rgbaSize;
+    }
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        imageSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer,
+        &stagingBufferMemory
+    );
+    trackTextureStagingBytes(imageSize, QQ_TRUE);
+
+    // Fill staging buffer directly, decoding levels if needed
+    u8* data;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, (void**)&data);
+    for (u32 level = firstResidentLevel; level < mipLevels; level++) {
+        const Ktx2Level* levelInfo = &texture->levels[level];
+        u8* levelData = data + levelOffsets[level - firstResidentLevel];
+        if (decompress == QQ_TRUE) {
+            bcnDecodeImage(
+                bcnFormat,
+                ktx2GetLevelData(texture, level),
+                levelInfo->width,
+                levelInfo->height,
+                levelData
+            );
+        } else {
+            memcpy(
+                levelData,
+                ktx2GetLevelData(texture, level),
+                getKtx2LevelSize(isBlockCompressed, bcnFormat, levelInfo->width, levelInfo->height)
+            );
+        }
+    }
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+    // Mip chain comes from the file, no blits needed
+    createImage(
+        texture->width,
+        texture->height,
+        mipLevels,
+        VK_SAMPLE_COUNT_1_BIT,
+        textureFormat,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &textureImage,
+        &textureImageMemory
+    );
+
+    copyBufferToImageLevels(
+        stagingBuffer,
+        textureImage,
+        texture->width,
+        texture->height,
+        firstResidentLevel,
+        residentLevelCount,
+        levelOffsets
+    );
+
+    logInfo(
+        "[TEXTURE] %ux%u, %u levels (%u at startup), format %u%s | %lu of %lu KiB uploaded (RGBA8: %lu KiB)",
+        texture->width,
+        texture->height,
+        mipLevels,
+        residentLevelCount,
+        textureFormat,
+        decompress == QQ_TRUE ? " (decompressed on CPU)" : "",
+        imageSize / 1024,
+        totalSize / 1024,
+        uncompressedSize / 1024
+    );
+
+    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+    trackTextureStagingBytes(imageSize, QQ_FALSE);
+    free(levelOffsets);
+
+    // Rest of the chain is streamed, stream keeps the file
+    if (firstResidentLevel > 0) {
+        TextureStream* stream = &textureStreams[textureStreamCount++];
+        *stream = (TextureStream){
+            .source = *texture,
+            .bcnFormat = bcnFormat,
+            .isBlockCompressed = isBlockCompressed,
+            .decompress = decompress,
+            .image = textureImage,
+            .levelCount = mipLevels,
+            .textureIndex = U32_MAX,
+            .residentLevel = firstResidentLevel,
+            .residentBytes = imageSize,
+            .totalBytes = totalSize,
+            .startTime = getTimeMs()
+        };
+        createTextureStreamResources(stream);
+        return QQ_TRUE;
+    }
+
+    ktx2Free(texture);
+    return QQ_TRUE;
+}
+
+// Builds mip chain on the CPU (gamma correct box filter), so any RGBA8 device works without blits
+void decodeMeshTexturePng(MeshTextureSource* source) {
+    logDebug("Loading texture");
+
+    u32 textureChannels;
+    stbi_uc* pixels;
+    const EmbeddedFile* embeddedFile = embeddedFind(MESH_TEXTURE_PATH);
+    if (embeddedFile != NULL) {
+        pixels = stbi_load_from_memory(
+            (const stbi_uc*)embeddedFile->words,
+            (i32)embeddedFile->size,
+            &source->width,
+            &source->height,
+            &textureChannels,
+            STBI_rgb_alpha
+        );
+    } else {
+        pixels = stbi_load(
+            MESH_TEXTURE_PATH,
+            &source->width,
+            &source->height,
+            &textureChannels,
+            STBI_rgb_alpha
+        );
+    }
+    if (!pixels) {
+        source->chain = NULL;
+        return;
+    }
+
+    // Calculate mip levels, down to 1x1
+    source->levelCount = mipmapGetLevelCount(source->width, source->height);
+
+    u64 chainSize = 0;
+    for (u32 level = 0; level < source->levelCount; level++) {
+        chainSize += (u64)mipmapGetLevelDimension(source->width, level)
+            * mipmapGetLevelDimension(source->height, level) * 4;
+    }
+
+    // Generated in system memory, staging memory may be uncached for reads
+    f64 startTime = getTimeMs();
+    source->chain = malloc(chainSize);
+    mipmapGenerateChain(pixels, source->width, source->height, source->levelCount, source->chain, QQ_TRUE);
+    source->mipTimeMs = getTimeMs() - startTime;
+
+    // Free stb image buffer
+    stbi_image_free(pixels);
+}
+
+// Texture takes ownership of its data, so embedded file is copied
+b32 loadMeshTextureKtx2(Ktx2Texture* texture) {
+    const EmbeddedFile* embeddedFile = embeddedFind(MESH_TEXTURE_KTX2_PATH);
+    if (embeddedFile == NULL) {
+        return ktx2Load(MESH_TEXTURE_KTX2_PATH, texture);
+    }
+
+    u8* data = malloc(embeddedFile->size);
+    memcpy(data, embeddedFile->words, embeddedFile->size);
+    if (ktx2Parse(data, embeddedFile->size, texture) == QQ_FALSE) {
+        free(data);
+        return QQ_FALSE;
+    }
+    return QQ_TRUE;
+}
+
+// Reads the mesh texture without the device, runs on worker during startup
+void decodeMeshTextureJob(void* userData) {
+    MeshTextureSource* source = &meshTextureSource;
+    *source = (MeshTextureSource){.isKtx2 = QQ_FALSE, .chain = NULL};
+
+    // Prefer pre-baked texture, PNG gets mipmapped on the CPU at load time
+    if (loadMeshTextureKtx2(&source->ktx2) == QQ_TRUE) {
+        source->isKtx2 = QQ_TRUE;
+        return;
+    }
+    decodeMeshTexturePng(source);
+}
+
+void createTextureImageFromPng(MeshTextureSource* source) {
+    if (source->chain == NULL) {
+        logError("Failed to load texture image");
+        return;
+    }
+
+    textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    u32 textureWidth = source->width;
+    u32 textureHeight = source->height;
+    mipLevels = source->levelCount;
+
+    // Levels are packed one after another, RGBA8 keeps them 4 byte aligned
+    VkDeviceSize* levelOffsets = malloc(sizeof(VkDeviceSize) * mipLevels);
+    VkDeviceSize imageSize = 0;
+    for (u32 level = 0; level < mipLevels; level++) {
+        levelOffsets[level] = imageSize;
+        imageSize += (VkDeviceSize)mipmapGetLevelDimension(textureWidth, level)
+            * mipmapGetLevelDimension(textureHeight, level) * 4;
+    }
+
+    // Prepare to load into optimized buffer
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        imageSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer,
+        &stagingBufferMemory
+    );
+
+    trackTextureStagingBytes(imageSize, QQ_TRUE);
+
+    // Copy to staging buffer
+    void* data;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, imageSize, 0, &data);
+    memcpy(data, source->chain, imageSize);
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+    free(source->chain);
+    source->chain = NULL;
+
+    // Create image via helper
+    createImage(
+        textureWidth,
+        textureHeight,
+        mipLevels,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &textureImage,
+        &textureImageMemory
+    );
+
+    // Whole chain in one copy
+    copyBufferToImageLevels(
+        stagingBuffer,
+        textureImage,
+        textureWidth,
+        textureHeight,
+        0,
+        mipLevels,
+        levelOffsets
+    );
+
+    logInfo(
+        "[TEXTURE] %ux%u, %u levels generated on CPU in %.2f ms",
+        textureWidth,
+        textureHeight,
+        mipLevels,
+        source->mipTimeMs
+    );
+
+    // Cleanup staging buffer
+    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+    trackTextureStagingBytes(imageSize, QQ_FALSE);
+    free(levelOffsets);
+}
+
+void createTextureImage() {
+    // Read by worker while the device was created
+    finishStartupTask(&meshTextureTask);
+    MeshTextureSource* source = &meshTextureSource;
+
+    if (source->isKtx2 == QQ_TRUE) {
+        logDebug("Loading compressed texture");
+        if (createTextureImageFromKtx2(&source->ktx2) == QQ_TRUE) {
+            return;
+        }
+        ktx2Free(&source->ktx2);
+
+        // Format is not supported by the device, PNG is decoded now
+        decodeMeshTexturePng(source);
+    }
+
+    createTextureImageFromPng(source);
+}
+
+void createTextureImageView() {
+    logDebug("Creating texture image view");
+    textureImageView = createImageView(
+        textureImage,
+        textureFormat,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        mipLevels
+    );
+}
+
+void createTextureSampler() {
+    logDebug("Create texture sampler");
+
+    VkSamplerCreateInfo samplerInfo = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = VK_FILTER_LINEAR,
+        .minFilter = VK_FILTER_LINEAR,
+
+        // U, V, W === X, Y, Z coordinates
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+
+        // Setup anisotropic filtering
+        .anisotropyEnable = VK_TRUE,
+        .maxAnisotropy = 16.0f,
+
+        // Color returned when sampling beyond the image with
+        // "clamp to border" addressing mode
+        .borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+
+        // Flag is addressing should be in normalized coordinates
+        .unnormalizedCoordinates = VK_FALSE,
+
+        // If enabled, texels will be first compared to a value, and result
+        // of the comparison is used in filtering operation
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+
+        // Setup mipmapping
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .mipLodBias = 0.0f,
+        .minLod = 0.0f,
+        .maxLod = (f32)mipLevels
+    };
+
+    if (vkCreateSampler(logicalDevice, &samplerInfo, NULL, &textureSampler) != VK_SUCCESS) {
+        logError("Failed to create texture sampler");
+    }
+}
+
+// Helper function to copy data between 2 buffers
+void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+
+    // Memory transfer operations are executed through command buffers
+    // So allocate temp command buffer
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+
+    // Record command for transfering contents of the buffer
+    VkBufferCopy copyRegion = {
+        .srcOffset = 0,
+        .dstOffset = 0,
+        .size = size
+    };
+    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+
+    // Stop recording
+    endSingleTimeCommands(commandBuffer);
+}
+
+// Custom OBJ loader
+void loadModel() {
+    logDebug("Loading model");
+
+    // Read file, default model may be compiled into the binary
+    FILE* file = embeddedOpen(MESH_MODEL_PATH, "r");
+
+    // Buffer for line
+    char line[128];
+
+    // Get verticies and indicies count
+    u32 vertexCount = 0;
+    u32 uvCount = 0;
+    u32 indexCount = 0;
     while (fgets(line, sizeof(line), file) != NULL) {
         char header[128];
         sscanf(line, "%s", header);
-        
-        // Vertex positional data
+
         if (strcmp(header, "v") == 0) {
-            // Save positional data
-            sscanf(
-                line,
-                "%s %f %f %f\n",
-                header,
-                &meshVertices[currentVertexIndex].position[0],
-                &meshVertices[currentVertexIndex].position[1],
-                &meshVertices[currentVertexIndex].position[2]
-            );
+            vertexCount += 1;
+            continue;
+        }
+
+        if (strcmp(header, "vt") == 0) {
+            uvCount += 1;
+            continue;
+        }
+
+        // Indices (face)
+        if (strcmp(header, "f") == 0) {
+            indexCount += 3;
+            continue;
+        }
+    }
+
+    // Allocate memory for verticies
+    meshVertexCount = vertexCount;
+    meshVertices = malloc(sizeof(Vertex) * vertexCount);
+
+    // Allocate temp storage for UV coordinates
+    vec2* uvs = malloc(sizeof(vec2) * uvCount);
+
+    // Allocate memory for indices
+    meshIndexCount = indexCount;
+    meshIndices = malloc(sizeof(u32) * indexCount);
+
+
+    // Rewind file and start to populate data
+    rewind(file);
+    u32 currentVertexIndex = 0;
+    u32 currentUvIndex = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char header[128];
+        sscanf(line, "%s", header);
+        
+        // Vertex positional data
+        if (strcmp(header, "v") == 0) {
+            // Save positional data
+            sscanf(
+                line,
+                "%s %f %f %f\n",
+                header,
+                &meshVertices[currentVertexIndex].position[0],
+                &meshVertices[currentVertexIndex].position[1],
+                &meshVertices[currentVertexIndex].position[2]
+            );
+
+            meshVertices[currentVertexIndex].color[0] = 1.0f;
+            meshVertices[currentVertexIndex].color[1] = 1.0f;
+            meshVertices[currentVertexIndex].color[2] = 1.0f;
+
+            currentVertexIndex += 1;
+            continue;
+        }
+
+        // Vertex UV data
+        if (strcmp(header, "vt") == 0) {
+            // Save UV data
+            sscanf(
+                line,
+                "%s %f %f\n",
+                header,
+                &uvs[currentUvIndex][0],
+                &uvs[currentUvIndex][1]
+            );
+            currentUvIndex += 1;
+            continue;
+        }
+    }
+
+    // TEMP: Scale down verticies position
+    f32 scaleFactor = 0.01f;
+    for (u32 i = 0; i < meshVertexCount; i++) {
+        meshVertices[i].position[0] = meshVertices[i].position[0] * scaleFactor;
+        meshVertices[i].position[1] = meshVertices[i].position[1] * scaleFactor;
+        meshVertices[i].position[2] = meshVertices[i].position[2] * scaleFactor;
+    }
+
+    // Rewind file one more time and write indicies
+    rewind(file);
+    u32 currentIndex = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char header[128];
+        sscanf(line, "%s", header);
+        // Indices (face)
+        if (strcmp(header, "f") == 0) {
+            // Face info
+            i32 vertexIndex[3];
+            i32 uvIndex[3];
+            i32 normalIndex[3];
+
+            i32 matches = sscanf(
+                line,
+                "%s %d/%d/%d %d/%d/%d %d/%d/%d\n",
+                header,
+                &vertexIndex[0],
+                &uvIndex[0],
+                &normalIndex[0],
+                &vertexIndex[1],
+                &uvIndex[1],
+                &normalIndex[1],
+                &vertexIndex[2],
+                &uvIndex[2],
+                &normalIndex[2]
+            );
+
+            if (matches != 10) {
+                logWarning("To many face data provided");
+                continue;
+            }
+
+            // Fill index array
+            for (u32 i = 0; i < 3; i++) {
+                meshVertices[vertexIndex[i] - 1].uv[0] = uvs[uvIndex[i] - 1][0];
+                meshVertices[vertexIndex[i] - 1].uv[1] = 1.0f - uvs[uvIndex[i] - 1][1];
+                meshIndices[currentIndex + i] = vertexIndex[i] - 1;
+            }
+            currentIndex += 3;
+        }
+    }
+
+    free(uvs);
+
+    fclose(file);
+}
+
+void loadModelJob(void* userData) {
+    loadModel();
+}
+
+// Computes object space bounds of the loaded mesh
+void computeMeshBounds() {
+    if (meshVertexCount == 0) {
+        return;
+    }
+
+    glm_vec3_copy(meshVertices[0].position, meshBoundsMin);
+    glm_vec3_copy(meshVertices[0].position, meshBoundsMax);
+    for (u32 i = 1; i < meshVertexCount; i++) {
+        for (u32 axis = 0; axis < 3; axis++) {
+            meshBoundsMin[axis] = min(meshBoundsMin[axis], meshVertices[i].position[axis]);
+            meshBoundsMax[axis] = max(meshBoundsMax[axis], meshVertices[i].position[axis]);
+        }
+    }
+}
+
+/**
+ * Loaded mesh is both occluder and tested object. Bounds are tested with their
+ * nearest depth, which is never behind the mesh surface, so the mesh cannot hide itself
+ */
+void createOcclusionCuller() {
+    logDebug("Creating occlusion culler");
+
+    occlusionCullerCreate(
+        &occlusionCuller,
+        OCCLUSION_BUFFER_WIDTH,
+        OCCLUSION_BUFFER_HEIGHT
+    );
+
+    computeMeshBounds();
+
+    OcclusionBounds bounds;
+    glm_vec3_copy(meshBoundsMin, bounds.min);
+    glm_vec3_copy(meshBoundsMax, bounds.max);
+    meshOcclusionObject = occlusionCullerAddObject(&occlusionCuller, &bounds);
+
+    // Vertices stay loaded for the whole run, culler references them
+    OcclusionMesh occluder = {
+        .positions = (const f32*)meshVertices[0].position,
+        .positionStride = sizeof(Vertex),
+        .vertexCount = meshVertexCount,
+        .indices = meshIndices,
+        .indexCount = meshIndexCount
+    };
+    glm_mat4_identity(*(mat4*)occluder.model);
+    meshOccluder = occlusionCullerAddOccluder(&occlusionCuller, &occluder);
+}
+
+void shutdownOcclusionCuller() {
+    if (occlusionCuller.totalPasses != 0) {
+        logInfo(
+            "[OCCLUSION] Passes: %lu | avg time: %f ms | culled %lu of %lu tested (%.1f%%)",
+            occlusionCuller.totalPasses,
+            occlusionCuller.totalTimeMs / (f64)occlusionCuller.totalPasses,
+            occlusionCuller.totalCulled,
+            occlusionCuller.totalTested,
+            occlusionCuller.totalTested != 0
+                ? 100.0 * (f64)occlusionCuller.totalCulled / (f64)occlusionCuller.totalTested
+                : 0.0
+        );
+    }
+
+    occlusionCullerDestroy(&occlusionCuller);
+}
+
+void debugLoadedModel() {
+    logDebug("[MODEL] Indices: %d", meshIndexCount);
+    logDebug("[MODEL] Vertices: %d", meshVertexCount);
+
+    u32 debugIndexAmount = 12;
+    logDebug("[MODEL] Last %d indices:", debugIndexAmount);
+    for (u32 i = meshIndexCount - debugIndexAmount; i < meshIndexCount; i++) {
+        logDebug(" - %d", meshIndices[i]);
+    }
+
+    u32 debugVertexAmount = 12;
+    logDebug("[MODEL] Last %d vertices:", debugVertexAmount);
+    for (u32 i = meshVertexCount - debugVertexAmount; i < meshVertexCount; i++) {
+        Vertex* vert = &meshVertices[i];
+        logDebug(
+            " - #%d pos: (%f,%f,%f) | color: (%f,%f,%f) | uv: (%f,%f)",
+            i,
+            vert->position[0],
+            vert->position[1],
+            vert->position[2],
+            vert->color[0],
+            vert->color[1],
+            vert->color[2],
+            vert->uv[0],
+            vert->uv[1]
+        );
+    }
+
+}
+
+// Creates device local buffer and fills it through temporary staging buffer
+void createBufferWithData(
+    const void* sourceData,
+    VkDeviceSize bufferSize,
+    VkBufferUsageFlags usage,
+    VkBuffer* buffer,
+    VkDeviceMemory* bufferMemory
+) {
+    // Create staging (temp) buffer
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer,
+        &stagingBufferMemory
+    );
+
+    // Map staging buffer memory into CPU accessible memory
+    void* data;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
+    // Copy data into mapped area
+    memcpy(data, sourceData, bufferSize);
+    // Unmap memory
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+    // Data will be copied into this buffer from temp buffer
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        buffer,
+        bufferMemory
+    );
+
+    // Copy data from staging(CPU accessible memory) to GPU buffer
+    copyBuffer(stagingBuffer, *buffer, bufferSize);
+
+    // Clean temp buffer data
+    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+}
+
+/**
+ * Positions relative to mesh bounds in 16 bit UNORM, 8 bytes per vertex instead of 12.
+ * Vertex shader reads them in [0, 1], bounds are folded into the model matrix of the draw
+ */
+void createQuantizedPositionBuffer() {
+    logDebug("Creating quantized position buffer");
+
+    vec3 extent;
+    glm_vec3_sub(meshBoundsMax, meshBoundsMin, extent);
+
+    u16* positions = malloc(sizeof(u16) * 4 * meshVertexCount);
+    for (u32 i = 0; i < meshVertexCount; i++) {
+        for (u32 axis = 0; axis < 3; axis++) {
+            f32 fraction = extent[axis] > 0.0f
+                ? (meshVertices[i].position[axis] - meshBoundsMin[axis]) / extent[axis]
+                : 0.0f;
+            positions[i * 4 + axis] = (u16)(min(max(fraction, 0.0f), 1.0f) * 65535.0f + 0.5f);
+        }
+        // Padding, R16G16B16 formats are rarely supported for vertex input
+        positions[i * 4 + 3] = 0;
+    }
+
+    createBufferWithData(
+        positions,
+        sizeof(u16) * 4 * meshVertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        &vertexQuantizedPositionBuffer,
+        &vertexQuantizedPositionBufferMemory
+    );
+    free(positions);
+
+    logInfo(
+        "[VERTEX] Quantized positions: %u bytes instead of %u",
+        (u32)(sizeof(u16) * 4 * meshVertexCount),
+        (u32)(sizeof(vec3) * meshVertexCount)
+    );
+}
+
+void createVertexBuffer() {
+    logDebug("Creating vertex buffers");
+
+    // Split loaded vertices into position and attribute streams,
+    // so depth pre-pass fetches only 12 bytes per vertex
+    vec3* positions = malloc(sizeof(vec3) * meshVertexCount);
+    VertexAttributes* attributes = malloc(sizeof(VertexAttributes) * meshVertexCount);
+    for (u32 i = 0; i < meshVertexCount; i++) {
+        glm_vec3_copy(meshVertices[i].position, positions[i]);
+        glm_vec3_copy(meshVertices[i].color, attributes[i].color);
+        attributes[i].uv[0] = meshVertices[i].uv[0];
+        attributes[i].uv[1] = meshVertices[i].uv[1];
+    }
+
+    createBufferWithData(
+        positions,
+        sizeof(vec3) * meshVertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        &vertexPositionBuffer,
+        &vertexPositionBufferMemory
+    );
+    createBufferWithData(
+        attributes,
+        sizeof(VertexAttributes) * meshVertexCount,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        &vertexAttributeBuffer,
+        &vertexAttributeBufferMemory
+    );
+
+    free(positions);
+    free(attributes);
+
+    // White vertex colors do not change the result, variant without them is used
+    meshHasVertexColors = QQ_FALSE;
+    for (u32 i = 0; i < meshVertexCount; i++) {
+        for (u32 channel = 0; channel < 3; channel++) {
+            if (meshVertices[i].color[channel] != 1.0f) {
+                meshHasVertexColors = QQ_TRUE;
+            }
+        }
+    }
+
+    if (quantizedPositionsEnabled == QQ_TRUE) {
+        createQuantizedPositionBuffer();
+    }
+}
+
+void createIndexBuffer() {
+    logDebug("Creating index buffer");
+
+    VkDeviceSize bufferSize = sizeof(meshIndices[0]) * meshIndexCount;
+
+    // Create temp buffer
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer,
+        &stagingBufferMemory
+    );
+
+    // Copy to temp buffer
+    void* data;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
+    memcpy(data, meshIndices, bufferSize);
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+
+    // Create optimized storage buffer
+    createBuffer(
+        bufferSize,
+        // Using ..._INDEX_BUFFER_BIT this time
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &indexBuffer,
+        &indexBufferMemory
+    );
+
+    // Copy from temp to optimized(GPU)
+    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+
+    // Free temp buffer
+    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+}
+
+void createUniformBuffers() {
+    logDebug("Creating uniform buffer");
+
+    // Slices live in one buffer, so descriptor never changes
+    VkDeviceSize bufferSize = sizeof(UniformBufferObject) * MAX_FRAMES_IN_FLIGHT;
+
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &uniformBuffer,
+        &uniformBufferMemory
+    );
+
+    // Memory is host coherent, so mapping once is enough
+    vkMapMemory(
+        logicalDevice,
+        uniformBufferMemory,
+        0,
+        bufferSize,
+        0,
+        (void**)&uniformBufferMapped
+    );
+}
+
+void createMaterialBuffer() {
+    logDebug("Creating material buffer");
+
+    VkDeviceSize bufferSize = sizeof(MaterialData) * GLOBAL_MATERIAL_CAPACITY;
+
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &materialBuffer,
+        &materialBufferMemory
+    );
+
+    vkMapMemory(
+        logicalDevice,
+        materialBufferMemory,
+        0,
+        bufferSize,
+        0,
+        (void**)&materialsMapped
+    );
+}
+
+void createTextureResidencyBuffer() {
+    logDebug("Creating texture residency buffer");
+
+    VkDeviceSize bufferSize = sizeof(f32) * globalTextureCapacity * MAX_FRAMES_IN_FLIGHT;
+
+    createBuffer(
+        bufferSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &textureResidencyBuffer,
+        &textureResidencyBufferMemory
+    );
+
+    vkMapMemory(
+        logicalDevice,
+        textureResidencyBufferMemory,
+        0,
+        bufferSize,
+        0,
+        (void**)&textureResidencyMapped
+    );
+
+    // Textures which are not streamed can use all levels
+    memset(textureResidencyMapped, 0, bufferSize);
+}
+
+void createVirtualTextureBuffers() {
+    logDebug("Creating virtual texture buffers");
+
+    createBuffer(
+        sizeof(VirtualTextureData) * MAX_VIRTUAL_TEXTURES,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &virtualTextureBuffer,
+        &virtualTextureBufferMemory
+    );
+    vkMapMemory(
+        logicalDevice,
+        virtualTextureBufferMemory,
+        0,
+        sizeof(VirtualTextureData) * MAX_VIRTUAL_TEXTURES,
+        0,
+        (void**)&virtualTexturesMapped
+    );
+
+    // Feedback is scanned by CPU every frame, so cached memory is preferred
+    VkDeviceSize feedbackSize = sizeof(u32) * VIRTUAL_FEEDBACK_CAPACITY * MAX_FRAMES_IN_FLIGHT;
+    VkMemoryPropertyFlags feedbackProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+        | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (isMemoryTypeAvailable(feedbackProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) == QQ_TRUE) {
+        feedbackProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    }
+    createBuffer(
+        feedbackSize,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        feedbackProperties,
+        &virtualFeedbackBuffer,
+        &virtualFeedbackBufferMemory
+    );
+    vkMapMemory(
+        logicalDevice,
+        virtualFeedbackBufferMemory,
+        0,
+        feedbackSize,
+        0,
+        (void**)&virtualFeedbackMapped
+    );
+    memset(virtualFeedbackMapped, 0, feedbackSize);
+}
+
+void createDescriptorPool() {
+    logDebug("Creating descriptor pool");
+
+    // Sized by the reflected layout
+    VkDescriptorPoolSize poolSizes[SPIRV_REFLECT_MAX_BINDINGS];
+    u32 poolSizeCount = getDescriptorPoolSizes(globalBindings, globalBindingCount, 1, poolSizes);
+
+    VkDescriptorPoolCreateInfo poolInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+
+        // Required by update-after-bind texture array
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .poolSizeCount = poolSizeCount,
+        .pPoolSizes = poolSizes,
+
+        // Only the global set is allocated
+        .maxSets = 1
+    };
+
+    if (vkCreateDescriptorPool(logicalDevice, &poolInfo, NULL, &descriptorPool) != VK_SUCCESS) {
+        logError("Failed to create descriptor pool");
+    }
+}
+
+// Model transform of the mesh at current frame time
+void getMeshModelMatrix(mat4 model) {
+    glm_mat4_identity(model);
+
+    // Apply transform
+    vec3 translation = {0.0f, 0.7f, 0.0f};
+    glm_translate(model, translation);
+
+    // Pretrasform model
+    // TODO: This is not proper way of doing this
+    //       and usualy must be done before constructing UBO
+    vec3 preRotationPivot = {0.0f, -1.0f, 0.0f};
+    vec3 preRotationAxis = {0.55f, 0.0f, 1.0f};
+    glm_rotate_at(
+        model,
+        preRotationPivot,
+        0.0f,
+        preRotationAxis
+    );
+
+    f64 rotationAngleRads = 0.2;
+    vec3 rotationPivot = {0.0f, 0.0f, 0.0f};
+    vec3 rotationAxis = {0.0f, 1.0f, 0.0f};
+    glm_rotate_at(
+        model,
+        rotationPivot,
+        currentFrameTime * rotationAngleRads,
+        rotationAxis
+    );
+}
+
+void getCameraViewMatrix(mat4 view) {
+    glm_lookat(
+        eyeVector,
+        lookCenter,
+        lookUp,
+        view
+    );
+}
+
+void getCameraProjectionMatrix(mat4 projection) {
+    f64 fieldOfViewRads = 0.785398f;
+    f64 projectionAspect = (f64)swapchainExtent.width / (f64)swapchainExtent.height;
+    glm_perspective(
+        fieldOfViewRads,
+        projectionAspect,
+        0.1f, // Near clipping plane
+        10.0f, // Far clipping plane
+        projection
+    );
+
+    projection[1][1] *= -1.0f;
+}
+
+// Camera projection * view, computed once per frame
+void getCameraViewProjectionMatrix(mat4 viewProjection) {
+    mat4 view, projection;
+    getCameraViewMatrix(view);
+    getCameraProjectionMatrix(projection);
+    glm_mat4_mul(projection, view, viewProjection);
+}
+
+void createCommandBuffers() {
+    logDebug("Creating command buffer");
+
+    // Allocate memory to contain command buffers
+    commandBuffers = (VkCommandBuffer*)malloc(
+        swapchainImageCount * sizeof(VkCommandBuffer)
+    );
+
+    // Allocate buffers
+    VkCommandBufferAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = commandPool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = swapchainImageCount
+    };
+    VkResult result = vkAllocateCommandBuffers(
+        logicalDevice,
+        &allocateInfo,
+        commandBuffers
+    );
+    if (result != VK_SUCCESS) {
+        logError("Cannot allocate command buffers");
+    }
+}
+
+// Maps render queue pipeline id (variant index) to pipeline object
+VkPipeline getRenderPipeline(u32 pipelineId) {
+    return pipelineVariants[pipelineId].pipeline;
+}
+
+// Fills render queue with draws of the current frame
+void buildRenderQueue() {
+    renderQueueReset(&renderQueue);
+    updatePipelineCompileStats();
+
+    // Skip mesh completely if it is hidden behind occluders or has no material
+    if (meshMaterial == U32_MAX || occlusionCullerIsVisible(&occlusionCuller, meshOcclusionObject) == QQ_FALSE) {
+        return;
+    }
+
+    RenderDraw draw = {
+        .material = meshMaterial,
+        .mesh = RENDER_MESH_MODEL
+    };
+    getMeshModelMatrix(*(mat4*)draw.model);
+
+    // Depth of bounds center, orders draws sharing state front to back
+    mat4 viewProjection;
+    vec4 center = {
+        (meshBoundsMin[0] + meshBoundsMax[0]) * 0.5f,
+        (meshBoundsMin[1] + meshBoundsMax[1]) * 0.5f,
+        (meshBoundsMin[2] + meshBoundsMax[2]) * 0.5f,
+        1.0f
+    };
+    getCameraViewProjectionMatrix(viewProjection);
+    glm_mat4_mulv(*(mat4*)draw.model, center, center);
+    glm_mat4_mulv(viewProjection, center, center);
+    draw.depth = center[3] > 0.0f ? center[2] / center[3] : 0.0f;
+
+    // Features of the material and the mesh select shader variant
+    u32 features = materialFeatures[meshMaterial];
+    if (meshHasVertexColors == QQ_TRUE) {
+        features |= SHADER_FEATURE_VERTEX_COLOR;
+    }
+    if (vertexQuantizedPositionBuffer != VK_NULL_HANDLE) {
+        features |= SHADER_FEATURE_QUANTIZED_POSITIONS;
+    }
+    features &= shaderFeatureMask;
+
+    // Quantized positions are in [0, 1] of the bounds, model matrix maps them back
+    if ((features & SHADER_FEATURE_QUANTIZED_POSITIONS) != 0) {
+        vec3 extent;
+        glm_vec3_sub(meshBoundsMax, meshBoundsMin, extent);
+        glm_translate(*(mat4*)draw.model, meshBoundsMin);
+        glm_scale(*(mat4*)draw.model, extent);
+        draw.mesh = RENDER_MESH_MODEL_QUANTIZED;
+    }
+
+    // Alpha tested fragments are discarded after the depth test, pre-pass would write
+    // depth of the holes, so such draws test depth in the main pass only
+    b32 isPrepassed = depthPrepassEnabled == QQ_TRUE && (features & SHADER_FEATURE_ALPHA_TEST) == 0;
+    if (isPrepassed == QQ_TRUE) {
+        draw.pass = RENDER_PASS_DEPTH_PREPASS;
+        draw.pipeline = getPipelineVariant(RENDER_PIPELINE_DEPTH_PREPASS, features);
+
+        // Without pre-pass depth EQUAL would reject everything, main pass tests depth itself
+        if (draw.pipeline != U32_MAX) {
+            renderQueuePush(&renderQueue, &draw);
+        } else {
+            isPrepassed = QQ_FALSE;
+        }
+    }
+
+    // Variant which is still compiling and has no fallback leaves the draw out
+    draw.pass = RENDER_PASS_OPAQUE;
+    draw.pipeline = getPipelineVariant(
+        isPrepassed == QQ_TRUE ? RENDER_PIPELINE_MAIN_DEPTH_EQUAL : RENDER_PIPELINE_MAIN,
+        features
+    );
+    if (draw.pipeline != U32_MAX) {
+        renderQueuePush(&renderQueue, &draw);
+    }
+}
+
+// Returns index of the named scope, adding it when first seen (U32_MAX when scopes are full)
+// Scopes are looked up by name, there are only a few per frame
+u32 getGpuProfileScope(const char* name) {
+    for (u32 i = 0; i < gpuProfileScopeCount; i++) {
+        if (strcmp(gpuProfileScopes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    if (gpuProfileScopeCount == GPU_PROFILER_MAX_SCOPES) {
+        return U32_MAX;
+    }
+
+    gpuProfileScopes[gpuProfileScopeCount] = (GpuProfileScope){
+        .name = name,
+        .depth = gpuProfileDepth
+    };
+    return gpuProfileScopeCount++;
+}
+
+// Query pool holds timestamp pairs of every frame slot, so reading one slot never waits for another
+void createGpuProfiler() {
+    logDebug("Creating GPU profiler");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    u32 queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, NULL);
+    VkQueueFamilyProperties* queueFamilies = (VkQueueFamilyProperties*)malloc(queueFamilyCount * sizeof(VkQueueFamilyProperties));
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies);
+    u32 timestampValidBits = queueFamilies[findVulkanQueueFamilies(physicalDevice).graphics].timestampValidBits;
+    free(queueFamilies);
+
+    if (properties.limits.timestampComputeAndGraphics == VK_FALSE || timestampValidBits == 0) {
+        logWarning("Timestamps are not supported, GPU profiler is disabled");
+        return;
+    }
+    timestampPeriodNs = properties.limits.timestampPeriod;
+    timestampMask = timestampValidBits >= 64 ? U64_MAX : ((u64)1 << timestampValidBits) - 1;
+
+    VkQueryPoolCreateInfo queryPoolInfo = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = 2 * GPU_PROFILER_MAX_FRAME_SCOPES * MAX_FRAMES_IN_FLIGHT
+    };
+    if (vkCreateQueryPool(logicalDevice, &queryPoolInfo, NULL, &gpuProfilerQueryPool) != VK_SUCCESS) {
+        logError("Failed to create GPU profiler query pool");
+        gpuProfilerQueryPool = VK_NULL_HANDLE;
+        return;
+    }
+
+    // Whole frame is always the first scope, benchmark reads it as GPU frame time
+    getGpuProfileScope(GPU_PROFILE_SCOPE_FRAME_NAME);
+}
+
+// Resets queries of current frame slot, must be recorded outside of render pass
+void gpuProfilerBeginFrame(VkCommandBuffer commandBuffer) {
+    if (gpuProfilerQueryPool == VK_NULL_HANDLE) {
+        return;
+    }
+
+    vkCmdResetQueryPool(
+        commandBuffer,
+        gpuProfilerQueryPool,
+        currentFrame * GPU_PROFILER_MAX_FRAME_SCOPES * 2,
+        GPU_PROFILER_MAX_FRAME_SCOPES * 2
+    );
+    gpuProfileFrameScopeCounts[currentFrame] = 0;
+    gpuProfileFrames[currentFrame] = submittedFrameCount;
+    gpuProfileDepth = 0;
+}
+
+// Returns handle for gpuProfilerEndScope (U32_MAX when profiler is off or full)
+u32 gpuProfilerBeginScope(VkCommandBuffer commandBuffer, const char* name) {
+    if (gpuProfilerQueryPool == VK_NULL_HANDLE || gpuProfileFrameScopeCounts[currentFrame] == GPU_PROFILER_MAX_FRAME_SCOPES) {
+        return U32_MAX;
+    }
+    u32 scope = getGpuProfileScope(name);
+    if (scope == U32_MAX) {
+        return U32_MAX;
+    }
+
+    u32 pair = gpuProfileFrameScopeCounts[currentFrame]++;
+    gpuProfileFrameScopes[currentFrame][pair] = scope;
+    gpuProfileDepth += 1;
+    vkCmdWriteTimestamp(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        gpuProfilerQueryPool,
+        (currentFrame * GPU_PROFILER_MAX_FRAME_SCOPES + pair) * 2
+    );
+    return pair;
+}
+
+// Closes scope opened by gpuProfilerBeginScope, scopes must be closed in reverse order
+void gpuProfilerEndScope(VkCommandBuffer commandBuffer, u32 pair) {
+    if (pair == U32_MAX) {
+        return;
+    }
+
+    gpuProfileDepth -= 1;
+    vkCmdWriteTimestamp(
+        commandBuffer,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        gpuProfilerQueryPool,
+        (currentFrame * GPU_PROFILER_MAX_FRAME_SCOPES + pair) * 2 + 1
+    );
+}
+
+// Reads scopes of the last frame of the slot, called once its timeline value is reached,
+// so results are available and reading never stalls
+void collectGpuProfile(u32 frameSlot) {
+    u32 pairCount = gpuProfileFrameScopeCounts[frameSlot];
+    if (gpuProfilerQueryPool == VK_NULL_HANDLE || pairCount == 0) {
+        return;
+    }
+    gpuProfileFrameScopeCounts[frameSlot] = 0;
+
+    u64 timestamps[GPU_PROFILER_MAX_FRAME_SCOPES * 2];
+    VkResult result = vkGetQueryPoolResults(
+        logicalDevice,
+        gpuProfilerQueryPool,
+        frameSlot * GPU_PROFILER_MAX_FRAME_SCOPES * 2,
+        pairCount * 2,
+        pairCount * 2 * sizeof(u64),
+        timestamps,
+        sizeof(u64),
+        VK_QUERY_RESULT_64_BIT
+    );
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    u64 frame = gpuProfileFrames[frameSlot];
+    for (u32 i = 0; i < pairCount; i++) {
+        GpuProfileScope* scope = &gpuProfileScopes[gpuProfileFrameScopes[frameSlot][i]];
+        f64 timeMs = (f64)((timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask) * timestampPeriodNs / 1000000.0;
+
+        scope->lastMs = timeMs;
+        scope->averageMs = scope->sampleCount == 0
+            ? timeMs
+            : scope->averageMs + (timeMs - scope->averageMs) * GPU_PROFILER_AVERAGE_WEIGHT;
+        scope->maxMs = max(scope->maxMs, timeMs);
+        scope->sampleCount += 1;
+
+        if (
+            benchmarkEnabled == QQ_TRUE
+            && gpuProfileFrameScopes[frameSlot][i] == GPU_PROFILE_SCOPE_FRAME
+            && frame >= BENCHMARK_WARMUP_FRAMES
+            && frame < BENCHMARK_WARMUP_FRAMES + benchmarkFrameCount
+        ) {
+            benchmarkGpuTimesMs[benchmarkGpuSampleCount++] = timeMs;
+        }
+    }
+}
+
+// Logs scope times indented by nesting depth
+void printGpuProfile() {
+    if (gpuProfilerQueryPool == VK_NULL_HANDLE) {
+        logInfo("[GPU] Profiler is disabled");
+        return;
+    }
+
+    logInfo("[GPU] Scope times (last / average / max ms):");
+    for (u32 i = 0; i < gpuProfileScopeCount; i++) {
+        const GpuProfileScope* scope = &gpuProfileScopes[i];
+        logInfo(
+            "[GPU] %*s%-*s %7.3f %7.3f %7.3f",
+            scope->depth * 2,
+            "",
+            32 - scope->depth * 2,
+            scope->name,
+            scope->lastMs,
+            scope->averageMs,
+            scope->maxMs
+        );
+    }
+}
+
+// Scopes as JSON array, shared by profile dump and benchmark report
+void writeGpuProfileScopes(FILE* file) {
+    fprintf(file, "[");
+    for (u32 i = 0; i < gpuProfileScopeCount; i++) {
+        const GpuProfileScope* scope = &gpuProfileScopes[i];
+        fprintf(
+            file,
+            "%s\n    {\"name\": \"%s\", \"depth\": %u, \"samples\": %lu, \"last_ms\": %.4f, \"avg_ms\": %.4f, \"max_ms\": %.4f}",
+            i == 0 ? "" : ",",
+            scope->name,
+            scope->depth,
+            scope->sampleCount,
+            scope->lastMs,
+            scope->averageMs,
+            scope->maxMs
+        );
+    }
+    fprintf(file, gpuProfileScopeCount > 0 ? "\n  ]" : "]");
+}
+
+// Writes scope times with the timestamp period as JSON file
+void writeGpuProfile(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        logError("Failed to open GPU profile output: %s", path);
+        return;
+    }
+
+    fprintf(file, "{\n  \"timestamp_period_ns\": %.4f,\n  \"scopes\": ", timestampPeriodNs);
+    writeGpuProfileScopes(file);
+    fprintf(file, "\n}\n");
+    fclose(file);
+    logInfo("[GPU] Profile written into %s", path);
+}
+
+// Records sorted render queue, skipping binds of state that is already bound
+void recordRenderQueue(VkCommandBuffer commandBuffer) {
+    RenderQueueStats stats = {0};
+
+    // Every queue pass gets its own profiler scope, passes are contiguous after sorting
+    u32 currentPass = U32_MAX;
+    u32 passScope = U32_MAX;
+
+    // Everything draws reference lives in the global set, so it is bound once per frame
+    // (layout is shared by all pipelines, set stays bound across pipeline changes)
+    if (renderQueue.drawCount != 0) {
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0,
+            1,
+            &globalDescriptorSet,
+            0,
+            NULL
+        );
+        stats.descriptorSetBinds += 1;
+    }
+
+    for (u32 i = 0; i < renderQueue.drawCount; i++) {
+        const RenderDraw* draw = renderQueueGetSorted(&renderQueue, i);
+        u32 changes = renderQueueGetChanges(&renderQueue, i);
+
+        if (draw->pass != currentPass) {
+            gpuProfilerEndScope(commandBuffer, passScope);
+            passScope = gpuProfilerBeginScope(
+                commandBuffer,
+                draw->pass == RENDER_PASS_DEPTH_PREPASS ? "depth pre-pass" : "opaque"
+            );
+            currentPass = draw->pass;
+        }
+
+        if ((changes & RENDER_QUEUE_CHANGE_PIPELINE) != 0) {
+            vkCmdBindPipeline(
+                commandBuffer,
+                VK_PIPELINE_BIND_POINT_GRAPHICS,
+                getRenderPipeline(draw->pipeline)
+            );
+            stats.pipelineBinds += 1;
+        }
+
+        // Both streams are bound even for pre-pass, which just ignores the attributes
+        if ((changes & RENDER_QUEUE_CHANGE_MESH) != 0) {
+            VkBuffer vertexBuffers[] = {
+                draw->mesh == RENDER_MESH_MODEL_QUANTIZED ? vertexQuantizedPositionBuffer : vertexPositionBuffer,
+                vertexAttributeBuffer
+            };
+            VkDeviceSize offsets[] = {0, 0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+            stats.vertexBufferBinds += 1;
+        }
+
+        // Material switch is just a different index
+        DrawPushConstants drawConstants = {
+            .materialIndex = draw->material,
+            .frameIndex = currentFrame
+        };
+        memcpy(drawConstants.model, draw->model, sizeof(drawConstants.model));
+        vkCmdPushConstants(
+            commandBuffer,
+            pipelineLayout,
+            drawPushConstantStages,
+            0,
+            sizeof(drawConstants),
+            &drawConstants
+        );
+
+        // Draw using attached vertex and index buffers
+        vkCmdDrawIndexed(
+            commandBuffer,
+
+            // Vertex count
+            meshIndexCount,
+
+            // Instance count
+            1,
+
+            // First index in index buffer
+            0,
+
+            // Offset between indices
+            0,
+
+            // Instancing offset (not used)
+            0
+        );
+        stats.drawCount += 1;
+    }
+    gpuProfilerEndScope(commandBuffer, passScope);
+
+    renderQueueFrameStats = stats;
+    renderQueueTotalStats.drawCount += stats.drawCount;
+    renderQueueTotalStats.pipelineBinds += stats.pipelineBinds;
+    renderQueueTotalStats.descriptorSetBinds += stats.descriptorSetBinds;
+    renderQueueTotalStats.vertexBufferBinds += stats.vertexBufferBinds;
+    renderQueueFrameCount += 1;
+}
+
+void printRenderQueueStats() {
+    logInfo(
+        "[RENDER QUEUE] Last frame: %lu draws | binds: %lu pipeline, %lu descriptor set, %lu vertex buffer",
+        renderQueueFrameStats.drawCount,
+        renderQueueFrameStats.pipelineBinds,
+        renderQueueFrameStats.descriptorSetBinds,
+        renderQueueFrameStats.vertexBufferBinds
+    );
+}
+
+void shutdownRenderQueue() {
+    if (renderQueueFrameCount != 0) {
+        f64 frameCount = (f64)renderQueueFrameCount;
+        logInfo(
+            "[RENDER QUEUE] Frames: %lu | per frame: %.2f draws, binds: %.2f pipeline, %.2f descriptor set, %.2f vertex buffer",
+            renderQueueFrameCount,
+            (f64)renderQueueTotalStats.drawCount / frameCount,
+            (f64)renderQueueTotalStats.pipelineBinds / frameCount,
+            (f64)renderQueueTotalStats.descriptorSetBinds / frameCount,
+            (f64)renderQueueTotalStats.vertexBufferBinds / frameCount
+        );
+    }
+
+    renderQueueDestroy(&renderQueue);
+}
+
+// Barrier moving first `levelCount` mips of a color image between shader read and transfer
+// destination, access masks follow the direction of the transition
+VkImageMemoryBarrier getVirtualImageBarrier(
+    VkImage image,
+    u32 levelCount,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout
+) {
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcAccessMask = newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+            ? VK_ACCESS_TRANSFER_WRITE_BIT
+            : VK_ACCESS_SHADER_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = levelCount,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    return barrier;
+}
+
+// Copies pages and page tables prepared by `updateVirtualTextures` from the frame staging slice
+// Barriers also order the copies after previous frames, which still sample old contents
+void recordVirtualTextureUploads(VkCommandBuffer commandBuffer, u32 frameIndex) {
+    if (virtualPageUploadCount == 0 && virtualPageTableUploadMask == 0) {
+        return;
+    }
+
+    VkImageMemoryBarrier barriers[MAX_VIRTUAL_TEXTURES + 1];
+    u32 barrierCount = 0;
+    if (virtualPageUploadCount > 0) {
+        barriers[barrierCount++] = getVirtualImageBarrier(
+            virtualPageCacheImage,
+            1,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        );
+    }
+    for (u32 i = 0; i < virtualTextureCount; i++) {
+        if ((virtualPageTableUploadMask & (1u << i)) != 0) {
+            barriers[barrierCount++] = getVirtualImageBarrier(
+                virtualPageTableImages[i],
+                virtualTextures[i].file.levelCount,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+            );
+        }
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        barrierCount, barriers
+    );
+
+    VkDeviceSize frameOffset = virtualStagingFrameSize * frameIndex;
+
+    // Every page goes to its slot of the cache grid
+    VkBufferImageCopy pageRegions[VIRTUAL_PAGE_UPLOADS_PER_FRAME];
+    for (u32 i = 0; i < virtualPageUploadCount; i++) {
+        u32 slot = virtualPageUploadSlots[i];
+        pageRegions[i] = (VkBufferImageCopy){
+            .bufferOffset = frameOffset + (VkDeviceSize)i * VIRTUAL_TEXTURE_PAGE_BYTES,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {
+                (i32)((slot % VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE) * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE),
+                (i32)((slot / VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE) * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE),
+                0
+            },
+            .imageExtent = {VIRTUAL_TEXTURE_PAGE_SLOT_SIZE, VIRTUAL_TEXTURE_PAGE_SLOT_SIZE, 1}
+        };
+    }
+    if (virtualPageUploadCount > 0) {
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            virtualStagingBuffer,
+            virtualPageCacheImage,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            virtualPageUploadCount,
+            pageRegions
+        );
+    }
+
+    // Whole page table of changed textures, entries follow the page numbering
+    VkDeviceSize pageTableOffset = frameOffset + (VkDeviceSize)VIRTUAL_PAGE_UPLOADS_PER_FRAME * VIRTUAL_TEXTURE_PAGE_BYTES;
+    for (u32 i = 0; i < virtualTextureCount; i++) {
+        if ((virtualPageTableUploadMask & (1u << i)) == 0) {
+            continue;
+        }
+
+        const VirtualTexture* texture = &virtualTextures[i];
+        VkBufferImageCopy levelRegions[VIRTUAL_TEXTURE_MAX_LEVELS];
+        for (u32 level = 0; level < texture->file.levelCount; level++) {
+            u32 levelSize = texture->pageTableSize >> level;
+            levelRegions[level] = (VkBufferImageCopy){
+                .bufferOffset = pageTableOffset
+                    + sizeof(u32) * (virtualTexturesMapped[i].feedbackOffset + texture->pageTableLevelOffsets[level]),
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                },
+                .imageOffset = {0, 0, 0},
+                .imageExtent = {levelSize, levelSize, 1}
+            };
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            virtualStagingBuffer,
+            virtualPageTableImages[i],
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            texture->file.levelCount,
+            levelRegions
+        );
+    }
+
+    for (u32 i = 0; i < barrierCount; i++) {
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        barrierCount, barriers
+    );
+}
+
+// Records draw commands for swapchain image (image must not be in flight)
+void recordCommandBuffer(u32 imageIndex) {
+    VkCommandBuffer commandBuffer = commandBuffers[imageIndex];
+
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+
+    // Begin implicitly resets the buffer (pool is created with reset flag)
+    VkResult beginBufferResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (beginBufferResult != VK_SUCCESS) {
+        logError("Failed to begin command buffer");
+    }
+
+    gpuProfilerBeginFrame(commandBuffer);
+    u32 frameScope = gpuProfilerBeginScope(commandBuffer, GPU_PROFILE_SCOPE_FRAME_NAME);
+
+    // Virtual texture pages land before the render pass samples them
+    u32 uploadScope = gpuProfilerBeginScope(commandBuffer, "virtual texture uploads");
+    recordVirtualTextureUploads(commandBuffer, currentFrame);
+    gpuProfilerEndScope(commandBuffer, uploadScope);
+
+    // Define clear color
+    u32 clearValueCount = 2;
+    VkClearValue clearValues[2] = {
+        { .color = {0.05f,0.05f,0.05f,1.0f} },
+        { .depthStencil = {1.0f, 0} }
+    };
+
+    // Start render pass
+    VkRenderPassBeginInfo renderPassInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .renderPass = renderPass,
+        .framebuffer = swapchainFramebuffers[imageIndex],
+        .renderArea = {
+            .offset = {0, 0},
+            .extent = swapchainExtent
+        },
+        .clearValueCount = clearValueCount,
+        .pClearValues = clearValues
+    };
+    u32 renderPassScope = gpuProfilerBeginScope(commandBuffer, "render pass");
+    vkCmdBeginRenderPass(
+        commandBuffer,
+        &renderPassInfo,
+        VK_SUBPASS_CONTENTS_INLINE
+    );
+
+    // Draws are recorded in key order, binding only state that changed
+    buildRenderQueue();
+    renderQueueSort(&renderQueue);
+    recordRenderQueue(commandBuffer);
+
+    // End render pass
+    vkCmdEndRenderPass(commandBuffer);
+    gpuProfilerEndScope(commandBuffer, renderPassScope);
+
+    // Virtual texture feedback is read on CPU once the frame timeline value is reached
+    if (virtualTextureCount > 0) {
+        VkMemoryBarrier feedbackBarrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT
+        };
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            VK_PIPELINE_STAGE_HOST_BIT,
+            0,
+            1, &feedbackBarrier,
+            0, NULL,
+            0, NULL
+        );
+    }
+
+    gpuProfilerEndScope(commandBuffer, frameScope);
+
+    // Stop recording
+    VkResult stopRecordingResult = vkEndCommandBuffer(commandBuffer);
+    if (stopRecordingResult != VK_SUCCESS) {
+        logError("Error while stopping buffer cmd recording!");
+    }
+}
+
+void createSyncObjects() {
+    logDebug("Creating semaphores");
+
+    // Nothing was submitted with any image yet (value 0 is always reached)
+    imageTimelineValues = (u64*)calloc(swapchainImageCount, sizeof(u64));
+
+    // Allocate memory for semaphores
+    imageAvailableSemaphores = (VkSemaphore*)malloc(
+        framesInFlight * sizeof(VkSemaphore)
+    );
+    renderFinishedSemaphores = (VkSemaphore*)malloc(
+        framesInFlight * sizeof(VkSemaphore)
+    );
+
+    VkSemaphoreCreateInfo semaphoreInfo = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+    };
+
+    VkResult result;
+
+    // Create semaphore pairs
+    for (u32 i = 0; i < framesInFlight; i++) {
+        result = vkCreateSemaphore(
+            logicalDevice,
+            &semaphoreInfo,
+            NULL,
+            &imageAvailableSemaphores[i]
+        );
+        if (result != VK_SUCCESS) {
+            logError("Failed to create image available semaphore");
+        }
+
+        result = vkCreateSemaphore(
+            logicalDevice,
+            &semaphoreInfo,
+            NULL,
+            &renderFinishedSemaphores[i]
+        );
+        if (result != VK_SUCCESS) {
+            logError("Failed to create render finished semaphore");
+        }
+    }
+}
+
+void createGlobalDescriptorSet() {
+    logDebug("Creating global descriptor set");
+
+    VkDescriptorSetAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool = descriptorPool,
+        .descriptorSetCount = 1,
+        .pSetLayouts = &descriptorSetLayout
+    };
+    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, &globalDescriptorSet) != VK_SUCCESS) {
+        logError("Failed to allocate global descriptor set");
+    }
+
+    // Everything except textures is written once
+    VkDescriptorBufferInfo framesInfo = {
+        .buffer = uniformBuffer,
+        .offset = 0,
+        .range = sizeof(UniformBufferObject) * MAX_FRAMES_IN_FLIGHT
+    };
+
+    VkDescriptorBufferInfo materialsInfo = {
+        .buffer = materialBuffer,
+        .offset = 0,
+        .range = sizeof(MaterialData) * GLOBAL_MATERIAL_CAPACITY
+    };
+
+    VkDescriptorImageInfo samplerInfo = {
+        .sampler = textureSampler
+    };
+
+    VkDescriptorBufferInfo textureResidencyInfo = {
+        .buffer = textureResidencyBuffer,
+        .offset = 0,
+        .range = sizeof(f32) * globalTextureCapacity * MAX_FRAMES_IN_FLIGHT
+    };
+
+    VkDescriptorBufferInfo virtualTexturesInfo = {
+        .buffer = virtualTextureBuffer,
+        .offset = 0,
+        .range = sizeof(VirtualTextureData) * MAX_VIRTUAL_TEXTURES
+    };
+
+    VkDescriptorBufferInfo virtualFeedbackInfo = {
+        .buffer = virtualFeedbackBuffer,
+        .offset = 0,
+        .range = sizeof(u32) * VIRTUAL_FEEDBACK_CAPACITY * MAX_FRAMES_IN_FLIGHT
+    };
+
+    u32 descriptorWriteCount = 6;
+    VkWriteDescriptorSet descriptorWrites[6] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_FRAMES,
+            // Not using as array
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &framesInfo
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_MATERIALS,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &materialsInfo
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_SAMPLER,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+            .descriptorCount = 1,
+            .pImageInfo = &samplerInfo
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_TEXTURE_RESIDENCY,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &textureResidencyInfo
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_VIRTUAL_TEXTURES,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &virtualTexturesInfo
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = globalDescriptorSet,
+            .dstBinding = GLOBAL_BINDING_VIRTUAL_FEEDBACK,
+            .dstArrayElement = 0,
+            .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .pBufferInfo = &virtualFeedbackInfo
+        }
+    };
+
+    vkUpdateDescriptorSets(
+        logicalDevice,
+        descriptorWriteCount,
+        descriptorWrites,
+        0,
+        NULL
+    );
+}
+
+// Writes image view into the next free slot of global texture array, returns its index
+// (U32_MAX when the array is full, caller leaves the texture out)
+// Slot is not used by frames in flight yet, so it is safe to write at any time
+u32 registerGlobalTexture(VkImageView imageView) {
+    if (globalTextureCount == globalTextureCapacity) {
+        logError("Global texture array is full (%u textures)", globalTextureCapacity);
+        return U32_MAX;
+    }
+
+    u32 textureIndex = globalTextureCount++;
+
+    VkDescriptorImageInfo imageInfo = {
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .imageView = imageView
+    };
+
+    VkWriteDescriptorSet descriptorWrite = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = globalDescriptorSet,
+        .dstBinding = GLOBAL_BINDING_TEXTURES,
+        .dstArrayElement = textureIndex,
+        .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        .descriptorCount = 1,
+        .pImageInfo = &imageInfo
+    };
+    vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, NULL);
+
+    return textureIndex;
+}
+
+// Appends material to material buffer, returns its index (U32_MAX when the buffer is full)
+// Alpha tested material discards fragments below SHADER_ALPHA_CUTOFF
+u32 createMaterial(vec4 baseColor, u32 albedoTexture, u32 virtualTexture, b32 isAlphaTested) {
+    if (materialCount == GLOBAL_MATERIAL_CAPACITY) {
+        logError("Material buffer is full (%u materials)", GLOBAL_MATERIAL_CAPACITY);
+        return U32_MAX;
+    }
+
+    u32 materialIndex = materialCount++;
+
+    // New slot is not read by frames in flight, so it is written directly
+    MaterialData* material = &materialsMapped[materialIndex];
+    glm_vec4_copy(baseColor, material->baseColor);
+    glm_vec4_copy((vec4){1.0f, 1.0f, 0.0f, 0.0f}, material->uvTransform);
+    material->albedoTexture = albedoTexture;
+    material->virtualTexture = virtualTexture;
+
+    // Untextured material samples nothing, its variant skips the texture path
+    u32 features = 0;
+    if (albedoTexture != U32_MAX || virtualTexture != U32_MAX) {
+        features |= SHADER_FEATURE_TEXTURE;
+    }
+    if (isAlphaTested == QQ_TRUE) {
+        features |= SHADER_FEATURE_ALPHA_TEST;
+    }
+    materialFeatures[materialIndex] = features;
+
+    return materialIndex;
+}
+
+void createVirtualPageCache() {
+    logDebug("Creating virtual page cache");
+
+    // Pages of all virtual textures are sRGB color
+    u32 cacheSize = VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE;
+    createImage(
+        cacheSize,
+        cacheSize,
+        1,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &virtualPageCacheImage,
+        &virtualPageCacheImageMemory
+    );
+    virtualPageCacheImageView = createImageView(
+        virtualPageCacheImage,
+        VK_FORMAT_R8G8B8A8_SRGB,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        1
+    );
+
+    // Slots are only sampled once a page was copied into them
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier = getVirtualImageBarrier(
+        virtualPageCacheImage,
+        1,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    );
+    barrier.srcAccessMask = 0;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
+    endSingleTimeCommands(commandBuffer);
+
+    virtualPageCacheTexture = registerGlobalTexture(virtualPageCacheImageView);
+    virtualPageCacheCreate(&virtualPageCache, VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE);
+
+    // Page table slice covers the whole feedback range, so any texture fits
+    virtualStagingFrameSize = (VkDeviceSize)VIRTUAL_PAGE_UPLOADS_PER_FRAME * VIRTUAL_TEXTURE_PAGE_BYTES
+        + sizeof(u32) * VIRTUAL_FEEDBACK_CAPACITY;
+    createBuffer(
+        virtualStagingFrameSize * MAX_FRAMES_IN_FLIGHT,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &virtualStagingBuffer,
+        &virtualStagingBufferMemory
+    );
+    vkMapMemory(
+        logicalDevice,
+        virtualStagingBufferMemory,
+        0,
+        virtualStagingFrameSize * MAX_FRAMES_IN_FLIGHT,
+        0,
+        (void**)&virtualStagingMapped
+    );
+    trackTextureStagingBytes(virtualStagingFrameSize * MAX_FRAMES_IN_FLIGHT, QQ_TRUE);
+
+    virtualPageRequests = malloc(sizeof(VirtualPageRequest) * VIRTUAL_PAGE_MAX_REQUESTS);
+    for (u32 i = 0; i < VIRTUAL_PAGE_MAX_PENDING_LOADS; i++) {
+        virtualPageLoads[i] = (VirtualPageLoad){
+            .texels = malloc(VIRTUAL_TEXTURE_PAGE_BYTES)
+        };
+    }
+
+    isVirtualPageCacheCreated = QQ_TRUE;
+}
+
+// Opens tiled file, coarsest level (single page) is uploaded right away and stays resident,
+// so every page table entry has something to point to
+// Returns index for materials, U32_MAX on failure
+u32 createVirtualTexture(const char* path) {
+    if (virtualTextureCount == MAX_VIRTUAL_TEXTURES) {
+        logError("Too many virtual textures (%u)", MAX_VIRTUAL_TEXTURES);
+        return U32_MAX;
+    }
+
+    u32 textureIndex = virtualTextureCount;
+    VirtualTexture* texture = &virtualTextures[textureIndex];
+    if (virtualTextureCreate(texture, path) == QQ_FALSE) {
+        return U32_MAX;
+    }
+    if (texture->file.isSrgb == QQ_FALSE) {
+        logError("Virtual texture %s is not sRGB, page cache holds sRGB color only", path);
+        virtualTextureDestroy(texture);
+        return U32_MAX;
+    }
+    if (virtualFeedbackUsed + texture->pageCount > VIRTUAL_FEEDBACK_CAPACITY) {
+        logError("Virtual texture %s does not fit into feedback buffer (%u pages)", path, texture->pageCount);
+        virtualTextureDestroy(texture);
+        return U32_MAX;
+    }
+
+    if (isVirtualPageCacheCreated == QQ_FALSE) {
+        createVirtualPageCache();
+    }
+
+    // Pages are sampled through the cache slot of global texture array
+    if (virtualPageCacheTexture == U32_MAX) {
+        virtualTextureDestroy(texture);
+        return U32_MAX;
+    }
+
+    u32 lastLevel = texture->file.levelCount - 1;
+    u32 lastPage = texture->pageCount - 1;
+    u8* pageTexels = malloc(VIRTUAL_TEXTURE_PAGE_BYTES);
+    if (virtualTextureFileReadPage(&texture->file, lastLevel, 0, 0, pageTexels) == QQ_FALSE) {
+        logError("Failed to read pages of virtual texture %s", path);
+        free(pageTexels);
+        virtualTextureDestroy(texture);
+        return U32_MAX;
+    }
+
+    // Pinned slot is never evicted
+    u32 evictedTexture, evictedPage;
+    u32 slot = virtualPageCacheAllocate(
+        &virtualPageCache,
+        textureIndex,
+        lastPage,
+        virtualFrameNumber,
+        QQ_TRUE,
+        &evictedTexture,
+        &evictedPage
+    );
+    if (slot == U32_MAX) {
+        logError("Virtual page cache has no slot for %s", path);
+        free(pageTexels);
+        virtualTextureDestroy(texture);
+        return U32_MAX;
+    }
+    if (evictedTexture != U32_MAX) {
+        virtualTextures[evictedTexture].pageSlots[evictedPage] = VIRTUAL_PAGE_NOT_RESIDENT;
+        virtualTextures[evictedTexture].isPageTableDirty = QQ_TRUE;
+    }
+    texture->pageSlots[lastPage] = slot;
+    virtualTextureUpdatePageTable(texture, &virtualPageCache);
+    texture->isPageTableDirty = QQ_FALSE;
+
+    // Page table, level per virtual texture level
+    createImage(
+        texture->pageTableSize,
+        texture->pageTableSize,
+        texture->file.levelCount,
+        VK_SAMPLE_COUNT_1_BIT,
+        VK_FORMAT_R8G8B8A8_UINT,
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &virtualPageTableImages[textureIndex],
+        &virtualPageTableImageMemories[textureIndex]
+    );
+    virtualPageTableImageViews[textureIndex] = createImageView(
+        virtualPageTableImages[textureIndex],
+        VK_FORMAT_R8G8B8A8_UINT,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        texture->file.levelCount
+    );
+
+    // Pinned page and initial page table go through temporary staging buffer
+    VkDeviceSize pageTableBytes = sizeof(u32) * texture->pageCount;
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingBufferMemory;
+    createBuffer(
+        VIRTUAL_TEXTURE_PAGE_BYTES + pageTableBytes,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &stagingBuffer,
+        &stagingBufferMemory
+    );
+    u8* stagingData;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, VIRTUAL_TEXTURE_PAGE_BYTES + pageTableBytes, 0, (void**)&stagingData);
+    memcpy(stagingData, pageTexels, VIRTUAL_TEXTURE_PAGE_BYTES);
+    memcpy(stagingData + VIRTUAL_TEXTURE_PAGE_BYTES, texture->pageTable, pageTableBytes);
+    vkUnmapMemory(logicalDevice, stagingBufferMemory);
+    free(pageTexels);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkImageMemoryBarrier barriers[2] = {
+        getVirtualImageBarrier(
+            virtualPageCacheImage,
+            1,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        ),
+        getVirtualImageBarrier(
+            virtualPageTableImages[textureIndex],
+            texture->file.levelCount,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        )
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        2, barriers
+    );
+
+    VkBufferImageCopy pageRegion = {
+        .bufferOffset = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .imageOffset = {
+            (i32)((slot % VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE) * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE),
+            (i32)((slot / VIRTUAL_PAGE_CACHE_SLOTS_PER_SIDE) * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE),
+            0
+        },
+        .imageExtent = {VIRTUAL_TEXTURE_PAGE_SLOT_SIZE, VIRTUAL_TEXTURE_PAGE_SLOT_SIZE, 1}
+    };
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        stagingBuffer,
+        virtualPageCacheImage,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1,
+        &pageRegion
+    );
+
+    VkBufferImageCopy levelRegions[VIRTUAL_TEXTURE_MAX_LEVELS];
+    for (u32 level = 0; level < texture->file.levelCount; level++) {
+        u32 levelSize = texture->pageTableSize >> level;
+        levelRegions[level] = (VkBufferImageCopy){
+            .bufferOffset = VIRTUAL_TEXTURE_PAGE_BYTES + sizeof(u32) * texture->pageTableLevelOffsets[level],
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = level,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {levelSize, levelSize, 1}
+        };
+    }
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        stagingBuffer,
+        virtualPageTableImages[textureIndex],
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        texture->file.levelCount,
+        levelRegions
+    );
+
+    for (u32 i = 0; i < 2; i++) {
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        2, barriers
+    );
+    endSingleTimeCommands(commandBuffer);
 
-            meshVertices[currentVertexIndex].color[0] = 1.0f;
-            meshVertices[currentVertexIndex].color[1] = 1.0f;
-            meshVertices[currentVertexIndex].color[2] = 1.0f;
+    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
 
-            currentVertexIndex += 1;
-            continue;
-        }
+    // Page table slot is not used by frames in flight yet
+    VkDescriptorImageInfo imageInfo = {
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        .imageView = virtualPageTableImageViews[textureIndex]
+    };
+    VkWriteDescriptorSet descriptorWrite = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = globalDescriptorSet,
+        .dstBinding = GLOBAL_BINDING_VIRTUAL_PAGE_TABLES,
+        .dstArrayElement = textureIndex,
+        .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        .descriptorCount = 1,
+        .pImageInfo = &imageInfo
+    };
+    vkUpdateDescriptorSets(logicalDevice, 1, &descriptorWrite, 0, NULL);
+
+    virtualTexturesMapped[textureIndex] = (VirtualTextureData){
+        .width = texture->file.width,
+        .height = texture->file.height,
+        .levelCount = texture->file.levelCount,
+        .pageTableSize = texture->pageTableSize,
+        .feedbackOffset = virtualFeedbackUsed,
+        .feedbackStride = VIRTUAL_FEEDBACK_CAPACITY,
+        .cacheTexture = virtualPageCacheTexture
+    };
+    virtualFeedbackUsed += texture->pageCount;
+    virtualTextureCount += 1;
+
+    logInfo(
+        "[VIRTUAL TEXTURE] %s: %ux%u, %u levels, %u pages, page table %ux%u",
+        path,
+        texture->file.width,
+        texture->file.height,
+        texture->file.levelCount,
+        texture->pageCount,
+        texture->pageTableSize,
+        texture->pageTableSize
+    );
 
-        // Vertex UV data
-        if (strcmp(header, "vt") == 0) {
-            // Save UV data
-            sscanf(
-                line,
-                "%s %f %f\n",
-                header,
-                &uvs[currentUvIndex][0],
-                &uvs[currentUvIndex][1]
-            );
-            currentUvIndex += 1;
-            continue;
-        }
+    return textureIndex;
+}
+
+// Runs on streaming thread
+void readVirtualPageJob(void* userData) {
+    VirtualPageLoad* load = (VirtualPageLoad*)userData;
+    u64 traceStart = traceBegin();
+    load->isRead = virtualTextureFileReadPage(
+        &virtualTextures[load->texture].file,
+        load->level,
+        load->x,
+        load->y,
+        load->texels
+    );
+    if (load->isRead == QQ_FALSE) {
+        logError("Failed to read virtual page %u (level %u)", load->page, load->level);
     }
+    traceEnd("read virtual page", traceStart);
+}
 
-    // TEMP: Scale down verticies position
-    f32 scaleFactor = 0.01f;
-    for (u32 i = 0; i < meshVertexCount; i++) {
-        meshVertices[i].position[0] = meshVertices[i].position[0] * scaleFactor;
-        meshVertices[i].position[1] = meshVertices[i].position[1] * scaleFactor;
-        meshVertices[i].position[2] = meshVertices[i].position[2] * scaleFactor;
+// Streams pages requested by the previous use of this frame slot, its timeline value is already waited
+// Uploads are recorded by `recordVirtualTextureUploads`
+void updateVirtualTextures(u32 frameIndex) {
+    virtualPageUploadCount = 0;
+    virtualPageTableUploadMask = 0;
+    if (virtualTextureCount == 0) {
+        return;
     }
 
-    // Rewind file one more time and write indicies
-    rewind(file);
-    u32 currentIndex = 0;
-    while (fgets(line, sizeof(line), file) != NULL) {
-        char header[128];
-        sscanf(line, "%s", header);
-        // Indices (face)
-        if (strcmp(header, "f") == 0) {
-            // Face info
-            i32 vertexIndex[3];
-            i32 uvIndex[3];
-            i32 normalIndex[3];
+    virtualFrameNumber += 1;
 
-            i32 matches = sscanf(
-                line,
-                "%s %d/%d/%d %d/%d/%d %d/%d/%d\n",
-                header,
-                &vertexIndex[0],
-                &uvIndex[0],
-                &normalIndex[0],
-                &vertexIndex[1],
-                &uvIndex[1],
-                &normalIndex[1],
-                &vertexIndex[2],
-                &uvIndex[2],
-                &normalIndex[2]
-            );
+    // Resident pages are kept alive, missing ones are requested (cleared for the next use of the slice)
+    u32 requestCount = 0;
+    for (u32 i = 0; i < virtualTextureCount; i++) {
+        VirtualTexture* texture = &virtualTextures[i];
+        u32* feedback = &virtualFeedbackMapped[
+            frameIndex * VIRTUAL_FEEDBACK_CAPACITY + virtualTexturesMapped[i].feedbackOffset
+        ];
 
-            if (matches != 10) {
-                printf("[WARNING] To many face data provided\n");
+        for (u32 page = 0; page < texture->pageCount; page++) {
+            if (feedback[page] == 0) {
                 continue;
             }
+            feedback[page] = 0;
+
+            u32 slot = texture->pageSlots[page];
+            if (slot < VIRTUAL_PAGE_LOADING) {
+                virtualPageCacheTouch(&virtualPageCache, slot, virtualFrameNumber);
+            } else if (slot == VIRTUAL_PAGE_NOT_RESIDENT && requestCount < VIRTUAL_PAGE_MAX_REQUESTS) {
+                u32 level, x, y;
+                if (virtualTextureGetPageLocation(texture, page, &level, &x, &y) == QQ_TRUE) {
+                    virtualPageRequests[requestCount++] = (VirtualPageRequest){
+                        .texture = i,
+                        .page = page,
+                        .level = level
+                    };
+                }
+            }
+        }
+    }
 
-            // Fill index array
-            for (u32 i = 0; i < 3; i++) {
-                meshVertices[vertexIndex[i] - 1].uv[0] = uvs[uvIndex[i] - 1][0];
-                meshVertices[vertexIndex[i] - 1].uv[1] = 1.0f - uvs[uvIndex[i] - 1][1];
-                meshIndices[currentIndex + i] = vertexIndex[i] - 1;
+    // Coarse pages first, they are what finer pages fall back to
+    u32 loadIndex = 0;
+    for (i32 level = VIRTUAL_TEXTURE_MAX_LEVELS - 1; level >= 0 && loadIndex < VIRTUAL_PAGE_MAX_PENDING_LOADS; level--) {
+        for (u32 i = 0; i < requestCount; i++) {
+            const VirtualPageRequest* request = &virtualPageRequests[i];
+            if (request->level != (u32)level) {
+                continue;
             }
-            currentIndex += 3;
+
+            while (loadIndex < VIRTUAL_PAGE_MAX_PENDING_LOADS && virtualPageLoads[loadIndex].isActive == QQ_TRUE) {
+                loadIndex += 1;
+            }
+            if (loadIndex == VIRTUAL_PAGE_MAX_PENDING_LOADS) {
+                break;
+            }
+
+            VirtualTexture* texture = &virtualTextures[request->texture];
+            VirtualPageLoad* load = &virtualPageLoads[loadIndex];
+            load->texture = request->texture;
+            load->page = request->page;
+            virtualTextureGetPageLocation(texture, request->page, &load->level, &load->x, &load->y);
+            load->isActive = QQ_TRUE;
+            load->isRead = QQ_FALSE;
+            texture->pageSlots[request->page] = VIRTUAL_PAGE_LOADING;
+            jobPoolSubmit(&streamingJobPool, &readVirtualPageJob, load, &load->readCounter);
         }
     }
 
-    free(uvs);
+    // Finished reads are copied into the frame staging slice
+    u8* stagingPages = virtualStagingMapped + virtualStagingFrameSize * frameIndex;
+    for (u32 i = 0; i < VIRTUAL_PAGE_MAX_PENDING_LOADS && virtualPageUploadCount < VIRTUAL_PAGE_UPLOADS_PER_FRAME; i++) {
+        VirtualPageLoad* load = &virtualPageLoads[i];
+        if (load->isActive == QQ_FALSE || jobCounterIsDone(&load->readCounter) == QQ_FALSE) {
+            continue;
+        }
+        load->isActive = QQ_FALSE;
+
+        VirtualTexture* texture = &virtualTextures[load->texture];
+        u32 evictedTexture, evictedPage;
+        u32 slot = load->isRead == QQ_TRUE
+            ? virtualPageCacheAllocate(
+                &virtualPageCache,
+                load->texture,
+                load->page,
+                virtualFrameNumber,
+                QQ_FALSE,
+                &evictedTexture,
+                &evictedPage
+            )
+            : U32_MAX;
 
-    fclose(file);
-}
+        // Page is requested again if it is still visible
+        if (slot == U32_MAX) {
+            texture->pageSlots[load->page] = VIRTUAL_PAGE_NOT_RESIDENT;
+            continue;
+        }
 
-void debugLoadedModel() {
-    printf("[MODEL] Indices: %d\n", meshIndexCount);
-    printf("[MODEL] Vertices: %d\n", meshVertexCount);
+        if (evictedTexture != U32_MAX) {
+            virtualTextures[evictedTexture].pageSlots[evictedPage] = VIRTUAL_PAGE_NOT_RESIDENT;
+            virtualTextures[evictedTexture].isPageTableDirty = QQ_TRUE;
+        }
 
-    u32 debugIndexAmount = 12;
-    printf("[MODEL] Last %d indices:\n", debugIndexAmount);
-    for (u32 i = meshIndexCount - debugIndexAmount; i < meshIndexCount; i++) {
-        printf(" - %d\n", meshIndices[i]);
+        memcpy(
+            stagingPages + (VkDeviceSize)virtualPageUploadCount * VIRTUAL_TEXTURE_PAGE_BYTES,
+            load->texels,
+            VIRTUAL_TEXTURE_PAGE_BYTES
+        );
+        virtualPageUploadSlots[virtualPageUploadCount++] = slot;
+        texture->pageSlots[load->page] = slot;
+        texture->isPageTableDirty = QQ_TRUE;
+        virtualPagesUploaded += 1;
     }
 
-    u32 debugVertexAmount = 12;
-    printf("[MODEL] Last %d vertices:\n", debugVertexAmount);
-    for (u32 i = meshVertexCount - debugVertexAmount; i < meshVertexCount; i++) {
-        Vertex* vert = &meshVertices[i];
-        printf(
-            " - #%d pos: (%f,%f,%f) | color: (%f,%f,%f) | uv: (%f,%f)\n",
-            i,
-            vert->position[0],
-            vert->position[1],
-            vert->position[2],
-            vert->color[0],
-            vert->color[1],
-            vert->color[2],
-            vert->uv[0],
-            vert->uv[1]
+    // Page tables are rebuilt as a whole, entries of missing pages depend on their ancestors
+    u8* stagingPageTables = stagingPages + (VkDeviceSize)VIRTUAL_PAGE_UPLOADS_PER_FRAME * VIRTUAL_TEXTURE_PAGE_BYTES;
+    for (u32 i = 0; i < virtualTextureCount; i++) {
+        VirtualTexture* texture = &virtualTextures[i];
+        if (texture->isPageTableDirty == QQ_FALSE) {
+            continue;
+        }
+
+        virtualTextureUpdatePageTable(texture, &virtualPageCache);
+        memcpy(
+            stagingPageTables + sizeof(u32) * virtualTexturesMapped[i].feedbackOffset,
+            texture->pageTable,
+            sizeof(u32) * texture->pageCount
         );
+        texture->isPageTableDirty = QQ_FALSE;
+        virtualPageTableUploadMask |= 1u << i;
     }
-
 }
 
-void createVertexBuffer() {
-    printf("Creating vertex buffers\n");
+void printVirtualTextureStats() {
+    if (virtualTextureCount == 0) {
+        return;
+    }
 
-    VkDeviceSize bufferSize = sizeof(meshVertices[0]) * meshVertexCount;
+    u32 pendingCount = 0;
+    for (u32 i = 0; i < VIRTUAL_PAGE_MAX_PENDING_LOADS; i++) {
+        pendingCount += virtualPageLoads[i].isActive == QQ_TRUE;
+    }
 
-    // Create staging (temp) buffer
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer,
-        &stagingBufferMemory
+    logInfo(
+        "[VIRTUAL TEXTURE] %u textures, cache %u/%u slots used, %lu pages uploaded, %lu evicted, %u loading",
+        virtualTextureCount,
+        virtualPageCache.slotCount - virtualPageCache.freeCount,
+        virtualPageCache.slotCount,
+        virtualPagesUploaded,
+        virtualPageCache.evictionCount,
+        pendingCount
     );
+}
 
+// Device must be idle
+void shutdownVirtualTextures() {
+    if (isVirtualPageCacheCreated == QQ_FALSE) {
+        return;
+    }
 
-    // Map staging buffer memory into CPU accessible memory
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    // Copy data into mapped area
-    memcpy(data, meshVertices, bufferSize);
-    // Unmap memory
-    vkUnmapMemory(logicalDevice, stagingBufferMemory);
-    // TODO: Driver may actualy not copy data to buffer straight away, read about that
+    for (u32 i = 0; i < VIRTUAL_PAGE_MAX_PENDING_LOADS; i++) {
+        if (virtualPageLoads[i].isActive == QQ_TRUE) {
+            jobPoolWait(&streamingJobPool, &virtualPageLoads[i].readCounter);
+        }
+        free(virtualPageLoads[i].texels);
+    }
+    free(virtualPageRequests);
 
-    // Create buffer using helper above
-    // Data will be copied into this buffer from temp buffer
-    createBuffer(
-        bufferSize,
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &vertexBuffer,
-        &vertexBufferMemory
-    );
+    for (u32 i = 0; i < virtualTextureCount; i++) {
+        vkDestroyImageView(logicalDevice, virtualPageTableImageViews[i], NULL);
+        vkDestroyImage(logicalDevice, virtualPageTableImages[i], NULL);
+        vkFreeMemory(logicalDevice, virtualPageTableImageMemories[i], NULL);
+        virtualTextureDestroy(&virtualTextures[i]);
+    }
+    virtualTextureCount = 0;
 
-    // Copy data from staging(CPU accessible memory) to GPU buffer
-    copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+    vkDestroyImageView(logicalDevice, virtualPageCacheImageView, NULL);
+    vkDestroyImage(logicalDevice, virtualPageCacheImage, NULL);
+    vkFreeMemory(logicalDevice, virtualPageCacheImageMemory, NULL);
+    virtualPageCacheDestroy(&virtualPageCache);
 
-    // Clean temp buffer data
-    vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
-    vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
+    vkUnmapMemory(logicalDevice, virtualStagingBufferMemory);
+    vkDestroyBuffer(logicalDevice, virtualStagingBuffer, NULL);
+    vkFreeMemory(logicalDevice, virtualStagingBufferMemory, NULL);
+    trackTextureStagingBytes(virtualStagingFrameSize * MAX_FRAMES_IN_FLIGHT, QQ_FALSE);
 
+    isVirtualPageCacheCreated = QQ_FALSE;
 }
 
-void createIndexBuffer() {
-    printf("Creating index buffer\n");
+// Mesh is drawn untextured when its texture does not fit and not at all without a material
+void createMeshMaterial() {
+    vec4 baseColor = {1.0f, 1.0f, 1.0f, 1.0f};
+    u32 textureIndex = registerGlobalTexture(textureImageView);
+    setTextureStreamIndex(textureImage, textureIndex);
 
-    VkDeviceSize bufferSize = sizeof(meshIndices[0]) * meshIndexCount;
+    // Virtual texture replaces albedo, regular texture stays as fallback when it fails to load
+    u32 virtualTexture = U32_MAX;
+    if (virtualTexturePath != NULL) {
+        virtualTexture = createVirtualTexture(virtualTexturePath);
+    }
+    meshMaterial = createMaterial(baseColor, textureIndex, virtualTexture, QQ_FALSE);
+}
+
+void decodeAtlasImageJob(void* userData) {
+    AtlasImage* image = userData;
+
+    i32 width, height, channels;
+    u64 traceStart = traceBegin();
+    image->pixels = stbi_load(image->path, &width, &height, &channels, STBI_rgb_alpha);
+    traceEnd("decode atlas image", traceStart);
+    if (image->pixels == NULL) {
+        logError("Failed to decode %s", image->path);
+        return;
+    }
+    image->width = width;
+    image->height = height;
+
+    // Images with cut out pixels get alpha tested material
+    image->hasTransparency = QQ_FALSE;
+    for (u64 i = 0; i < (u64)width * (u64)height; i++) {
+        if (image->pixels[i * 4 + 3] < 255) {
+            image->hasTransparency = QQ_TRUE;
+            break;
+        }
+    }
+}
+
+// Packs small images of directory into layers of one array image, every image
+// gets material with its UV remap, so meshes sample atlas like any other texture
+void createTextureAtlas(const char* path) {
+    DIR* directory = opendir(path);
+    if (directory == NULL) {
+        logError("Failed to open atlas directory %s", path);
+        return;
+    }
+
+    f64 startTime = getTimeMs();
+    atlasImages = calloc(ATLAS_MAX_IMAGES, sizeof(AtlasImage));
+
+    // Block compressed KTX2 cannot be repacked, only decoded formats are collected
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL && atlasImageCount < ATLAS_MAX_IMAGES) {
+        const char* extension = strrchr(entry->d_name, '.');
+        if (
+            extension == NULL
+            || (
+                strcmp(extension, ".png") != 0
+                && strcmp(extension, ".jpg") != 0
+                && strcmp(extension, ".jpeg") != 0
+            )
+        ) {
+            continue;
+        }
+
+        AtlasImage* image = &atlasImages[atlasImageCount++];
+        snprintf(image->path, sizeof(image->path), "%s/%s", path, entry->d_name);
+        jobPoolSubmit(&jobPool, &decodeAtlasImageJob, image, &image->decodeCounter);
+    }
+    closedir(directory);
+
+    u32* widths = malloc(sizeof(u32) * atlasImageCount);
+    u32* heights = malloc(sizeof(u32) * atlasImageCount);
+    for (u32 i = 0; i < atlasImageCount; i++) {
+        AtlasImage* image = &atlasImages[i];
+        jobPoolWait(&jobPool, &image->decodeCounter);
+
+        // Zero size is never packed
+        b32 isSmall = image->width <= ATLAS_MAX_IMAGE_DIMENSION && image->height <= ATLAS_MAX_IMAGE_DIMENSION;
+        if (image->pixels != NULL && isSmall == QQ_FALSE) {
+            logWarning("%s is too large for atlas (%ux%u), load it with --load-textures", image->path, image->width, image->height);
+        }
+        widths[i] = isSmall == QQ_TRUE ? image->width : 0;
+        heights[i] = isSmall == QQ_TRUE ? image->height : 0;
+    }
+
+    AtlasPacker packer;
+    atlasPackerCreate(&packer, ATLAS_LAYER_SIZE, ATLAS_PADDING, ATLAS_MAX_LAYERS);
+    AtlasRect* rects = malloc(sizeof(AtlasRect) * atlasImageCount);
+    u32 packedCount = atlasPackerInsertAll(&packer, widths, heights, atlasImageCount, rects);
+    atlasLayerCount = packer.layerCount;
+    free(widths);
+    free(heights);
+
+    if (packedCount == 0) {
+        logError("No image of %s was packed into atlas", path);
+        atlasPackerDestroy(&packer);
+        free(rects);
+        return;
+    }
+
+    // Gutters keep only the first levels separated, copy regions hold ATLAS_MAX_LEVELS per layer
+    u32 levelCount = min(atlasGetLevelCount(ATLAS_LAYER_SIZE, ATLAS_PADDING), ATLAS_MAX_LEVELS);
+    VkDeviceSize layerChainSize = mipmapGetChainSize(ATLAS_LAYER_SIZE, ATLAS_LAYER_SIZE, levelCount);
+    VkDeviceSize stagingSize = layerChainSize * atlasLayerCount;
 
-    // Create temp buffer
     VkBuffer stagingBuffer;
     VkDeviceMemory stagingBufferMemory;
     createBuffer(
-        bufferSize,
+        stagingSize,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         &stagingBuffer,
         &stagingBufferMemory
     );
+    trackTextureStagingBytes(stagingSize, QQ_TRUE);
 
-    // Copy to temp buffer
-    void* data;
-    vkMapMemory(logicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-    memcpy(data, meshIndices, bufferSize);
+    u8* staging;
+    vkMapMemory(logicalDevice, stagingBufferMemory, 0, stagingSize, 0, (void**)&staging);
+    for (u32 layer = 0; layer < atlasLayerCount; layer++) {
+        memset(&staging[layerChainSize * layer], 0, (VkDeviceSize)ATLAS_LAYER_SIZE * ATLAS_LAYER_SIZE * 4);
+    }
+    for (u32 i = 0; i < atlasImageCount; i++) {
+        AtlasImage* image = &atlasImages[i];
+        image->rect = rects[i];
+        if (image->rect.isPacked == QQ_TRUE) {
+            atlasCopyImage(&staging[layerChainSize * image->rect.layer], ATLAS_LAYER_SIZE, ATLAS_PADDING, &image->rect, image->pixels);
+        }
+        if (image->pixels != NULL) {
+            stbi_image_free(image->pixels);
+            image->pixels = NULL;
+        }
+    }
+
+    // Levels are generated in place, right after level 0 of the layer
+    for (u32 layer = 0; layer < atlasLayerCount; layer++) {
+        u8* chain = &staging[layerChainSize * layer];
+        mipmapGenerateChain(chain, ATLAS_LAYER_SIZE, ATLAS_LAYER_SIZE, levelCount, chain, QQ_TRUE);
+    }
     vkUnmapMemory(logicalDevice, stagingBufferMemory);
 
-    // Create optimized storage buffer
-    createBuffer(
-        bufferSize,
-        // Using ..._INDEX_BUFFER_BIT this time
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        &indexBuffer,
-        &indexBufferMemory
+    // One image and one allocation for every packed image
+    VkImageCreateInfo imageInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .extent = {ATLAS_LAYER_SIZE, ATLAS_LAYER_SIZE, 1},
+        .mipLevels = levelCount,
+        .arrayLayers = atlasLayerCount,
+        .format = VK_FORMAT_R8G8B8A8_SRGB,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .samples = VK_SAMPLE_COUNT_1_BIT
+    };
+    if (vkCreateImage(logicalDevice, &imageInfo, NULL, &atlasImage) != VK_SUCCESS) {
+        logError("Failed to create atlas image");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(logicalDevice, atlasImage, &memRequirements);
+    VkMemoryAllocateInfo allocInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize = memRequirements.size,
+        .memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    };
+    if (vkAllocateMemory(logicalDevice, &allocInfo, NULL, &atlasImageMemory) != VK_SUCCESS) {
+        logError("Failed to allocate atlas image memory");
+    }
+    vkBindImageMemory(logicalDevice, atlasImage, atlasImageMemory, 0);
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = atlasImage,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = levelCount,
+            .baseArrayLayer = 0,
+            .layerCount = atlasLayerCount
+        }
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
     );
 
-    // Copy from temp to optimized(GPU)
-    copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+    VkBufferImageCopy regions[ATLAS_MAX_LAYERS * ATLAS_MAX_LEVELS];
+    u32 regionCount = 0;
+    for (u32 layer = 0; layer < atlasLayerCount; layer++) {
+        VkDeviceSize offset = layerChainSize * layer;
+        for (u32 level = 0; level < levelCount; level++) {
+            u32 levelSize = mipmapGetLevelDimension(ATLAS_LAYER_SIZE, level);
+            regions[regionCount++] = (VkBufferImageCopy){
+                .bufferOffset = offset,
+                .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, layer, 1},
+                .imageExtent = {levelSize, levelSize, 1}
+            };
+            offset += (VkDeviceSize)levelSize * levelSize * 4;
+        }
+    }
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, atlasImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+    );
+    endSingleTimeCommands(commandBuffer);
 
-    // Free temp buffer
     vkDestroyBuffer(logicalDevice, stagingBuffer, NULL);
     vkFreeMemory(logicalDevice, stagingBufferMemory, NULL);
-}
+    trackTextureStagingBytes(stagingSize, QQ_FALSE);
+
+    // Global texture array holds 2D textures, so every layer is registered through own view
+    u32 layerTextures[ATLAS_MAX_LAYERS];
+    for (u32 layer = 0; layer < atlasLayerCount; layer++) {
+        VkImageViewCreateInfo viewInfo = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+            .image = atlasImage,
+            .viewType = VK_IMAGE_VIEW_TYPE_2D,
+            .format = VK_FORMAT_R8G8B8A8_SRGB,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = levelCount,
+                .baseArrayLayer = layer,
+                .layerCount = 1
+            }
+        };
+        if (vkCreateImageView(logicalDevice, &viewInfo, NULL, &atlasLayerViews[layer]) != VK_SUCCESS) {
+            logError("Failed to create atlas layer view");
+        }
+        layerTextures[layer] = registerGlobalTexture(atlasLayerViews[layer]);
+    }
 
-void createUniformBuffers() {
-    printf("Creating uniform buffers\n");
+    // Images of layers or materials which do not fit stay without material (mesh keeps its own)
 
-    VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+    // UV remap table lives in materials, shader applies it to mesh coordinates
+    vec4 baseColor = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (u32 i = 0; i < atlasImageCount; i++) {
+        AtlasImage* image = &atlasImages[i];
+        image->material = U32_MAX;
+        if (image->rect.isPacked == QQ_FALSE || layerTextures[image->rect.layer] == U32_MAX) {
+            continue;
+        }
+
+        image->material = createMaterial(baseColor, layerTextures[image->rect.layer], U32_MAX, image->hasTransparency);
+        if (image->material != U32_MAX) {
+            atlasGetUvTransform(&image->rect, ATLAS_LAYER_SIZE, materialsMapped[image->material].uvTransform);
+        }
+    }
+
+    logInfo(
+        "[ATLAS] %u of %u images packed into %u layers of %ux%u (%.1f%% used, %u levels) in %.2f ms",
+        packedCount,
+        atlasImageCount,
+        atlasLayerCount,
+        ATLAS_LAYER_SIZE,
+        ATLAS_LAYER_SIZE,
+        100.0 * (f64)packer.usedArea / ((f64)atlasLayerCount * ATLAS_LAYER_SIZE * ATLAS_LAYER_SIZE),
+        levelCount,
+        getTimeMs() - startTime
+    );
+    logInfo(
+        "[ATLAS] 1 image and 1 allocation instead of %u, %u texture descriptors instead of %u",
+        packedCount,
+        atlasLayerCount,
+        packedCount
+    );
 
-    // Allocate memory for buffers and device memory handlers
-    uniformBuffers = malloc(sizeof(VkBuffer) * swapchainImageCount);
-    uniformBuffersMemory = malloc(sizeof(VkDeviceMemory) * swapchainImageCount);
+    atlasPackerDestroy(&packer);
+    free(rects);
+}
 
-    // Create buffers with memory
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &uniformBuffers[i],
-            &uniformBuffersMemory[i]
-        );
+// Device must be idle
+void shutdownTextureAtlas() {
+    if (atlasLayerCount > 0) {
+        for (u32 layer = 0; layer < atlasLayerCount; layer++) {
+            vkDestroyImageView(logicalDevice, atlasLayerViews[layer], NULL);
+        }
+        vkDestroyImage(logicalDevice, atlasImage, NULL);
+        vkFreeMemory(logicalDevice, atlasImageMemory, NULL);
+        atlasLayerCount = 0;
     }
+    free(atlasImages);
+    atlasImages = NULL;
+    atlasImageCount = 0;
 }
 
-void createDescriptorPool() {
-    printf("Creating descriptor pool\n");
+// Steps mesh material through packed atlas images and back to own texture
+void cycleMeshMaterial() {
+    static u32 ownMaterial = U32_MAX;
+    if (ownMaterial == U32_MAX) {
+        ownMaterial = meshMaterial;
+    }
 
-    u32 poolSizeCount = 2;
-    VkDescriptorPoolSize poolSizes[2] = {
-        {
-            .type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .descriptorCount = swapchainImageCount
-        },
-        {
-            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-            .descriptorCount = swapchainImageCount
+    for (u32 i = 0; i < atlasImageCount; i++) {
+        meshMaterialChoice = (meshMaterialChoice + 1) % (atlasImageCount + 1);
+        if (meshMaterialChoice == 0) {
+            break;
         }
-    };
+        if (atlasImages[meshMaterialChoice - 1].material != U32_MAX) {
+            meshMaterial = atlasImages[meshMaterialChoice - 1].material;
+            logInfo("[RUNTIME] Mesh material: atlas image %s", atlasImages[meshMaterialChoice - 1].path);
+            return;
+        }
+    }
 
-    VkDescriptorPoolCreateInfo poolInfo = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .poolSizeCount = poolSizeCount,
-        .pPoolSizes = poolSizes,
+    meshMaterialChoice = 0;
+    meshMaterial = ownMaterial;
+    logInfo("[RUNTIME] Mesh material: mesh texture");
+}
 
-        // Maximum about of descriptors that can be allocated
-        .maxSets = swapchainImageCount
-    };
+void createTextureLoader() {
+    logDebug("Creating texture loader");
 
-    if (vkCreateDescriptorPool(logicalDevice, &poolInfo, NULL, &descriptorPool) != VK_SUCCESS) {
-        printf("[ERROR] Failed to create descriptor pool\n");
+    // Workers read generated mip levels back, so cached memory is preferred
+    VkMemoryPropertyFlags ringProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+        | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (isMemoryTypeAvailable(ringProperties | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) == QQ_TRUE) {
+        ringProperties |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
     }
-}
-
-void createCommandBuffers() {
-    printf("Creating command buffer\n");
 
-    // Allocate memory to contain command buffers
-    commandBuffers = (VkCommandBuffer*)malloc(
-        swapchainImageCount * sizeof(VkCommandBuffer)
+    createBuffer(
+        TEXTURE_STAGING_RING_SIZE,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        ringProperties,
+        &textureStagingRingBuffer,
+        &textureStagingRingMemory
+    );
+    vkMapMemory(
+        logicalDevice,
+        textureStagingRingMemory,
+        0,
+        TEXTURE_STAGING_RING_SIZE,
+        0,
+        (void**)&textureStagingRingMapped
     );
+    stagingRingCreate(&textureStagingRing, TEXTURE_STAGING_RING_SIZE, TEXTURE_STAGING_RING_MAX_SLICES);
+    trackTextureStagingBytes(TEXTURE_STAGING_RING_SIZE, QQ_TRUE);
 
-    // Allocate buffers
-    VkCommandBufferAllocateInfo allocateInfo = {
+    VkCommandBufferAllocateInfo allocInfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = commandPool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = swapchainImageCount
+        .commandPool = commandPool,
+        .commandBufferCount = 1
     };
-    VkResult result = vkAllocateCommandBuffers(
-        logicalDevice,
-        &allocateInfo,
-        commandBuffers
-    );
-    if (result != VK_SUCCESS) {
-        printf("[ERROR] Cannot allocate command buffers\n");
+    for (u32 i = 0; i < TEXTURE_UPLOAD_BATCH_COUNT; i++) {
+        TextureUploadBatch* batch = &textureUploadBatches[i];
+        *batch = (TextureUploadBatch){0};
+        if (vkAllocateCommandBuffers(logicalDevice, &allocInfo, &batch->commandBuffer) != VK_SUCCESS) {
+            logError("Failed to allocate texture upload command buffer");
+        }
     }
 
-    // Start buffer recording
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        VkCommandBufferBeginInfo beginInfo = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-            .flags = 0,
-            .pInheritanceInfo = NULL
-        };
+    isTextureLoaderCreated = QQ_TRUE;
+}
 
-        VkResult beginBufferResult = vkBeginCommandBuffer(
-            commandBuffers[i], &beginInfo
-        );
-        if (beginBufferResult != VK_SUCCESS) {
-            printf("[ERROR] Failed to begin command buffer\n");
-        }
+// Reserves staging slice, time spent waiting for free space is not decode time
+u8* allocateTextureStaging(TextureLoadRequest* request, VkDeviceSize size, f64* waitTimeMs) {
+    f64 startTime = getTimeMs();
+    u64 offset;
+    if (stagingRingAllocate(&textureStagingRing, size, 16, &offset, &request->stagingSlice) == QQ_FALSE) {
+        logError("Texture %s does not fit into staging ring (%lu KiB)", request->path, size / 1024);
+        return NULL;
+    }
+    *waitTimeMs += getTimeMs() - startTime;
 
-        // Define clear color
-        u32 clearValueCount = 2;
-        VkClearValue clearValues[2] = {
-            { .color = {0.05f,0.05f,0.05f,1.0f} },
-            { .depthStencil = {1.0f, 0} }
-        };
+    // Level offsets are relative to the slice so far
+    for (u32 level = 0; level < request->levelCount; level++) {
+        request->levelOffsets[level] += offset;
+    }
+    request->uploadSize = size;
 
-        // Start render pass
-        VkRenderPassBeginInfo renderPassInfo = {
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .renderPass = renderPass,
-            .framebuffer = swapchainFramebuffers[i],
-            .renderArea = {
-                .offset = {0, 0},
-                .extent = swapchainExtent
-            },
-            .clearValueCount = clearValueCount,
-            .pClearValues = clearValues
-        };
-        vkCmdBeginRenderPass(
-            commandBuffers[i],
-            &renderPassInfo,
-            VK_SUBPASS_CONTENTS_INLINE
-        );
+    return textureStagingRingMapped + offset;
+}
 
-        // Bind graphics pipeline
-        vkCmdBindPipeline(
-            commandBuffers[i],
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            graphicsPipeline
-        );
+// PNG/JPEG, mip chain is generated right into the staging slice
+b32 decodeImageTexture(TextureLoadRequest* request, f64* waitTimeMs) {
+    i32 width, height, channels;
+    stbi_uc* pixels = stbi_load(request->path, &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == NULL) {
+        logError("Failed to decode %s", request->path);
+        return QQ_FALSE;
+    }
 
-        // Attach vertex buffers
-        VkBuffer vertexBuffers[] = {vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+    request->format = VK_FORMAT_R8G8B8A8_SRGB;
+    request->width = width;
+    request->height = height;
+    request->levelCount = min(mipmapGetLevelCount(width, height), TEXTURE_LOAD_MAX_LEVELS);
 
-        // Attach index buffers
-        vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    VkDeviceSize size = 0;
+    for (u32 level = 0; level < request->levelCount; level++) {
+        request->levelOffsets[level] = size;
+        size += (VkDeviceSize)mipmapGetLevelDimension(width, level)
+            * mipmapGetLevelDimension(height, level) * 4;
+    }
 
-        // Bind buffer
-        vkCmdBindDescriptorSets(
-            commandBuffers[i],
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0,
-            1,
-            &descriptorSets[i],
-            0,
-            NULL
-        );
+    u8* staging = allocateTextureStaging(request, size, waitTimeMs);
+    if (staging != NULL) {
+        mipmapGenerateChain(pixels, width, height, request->levelCount, staging, QQ_TRUE);
+    }
+    stbi_image_free(pixels);
 
-        // Draw using attached vertex and index buffers
-        vkCmdDrawIndexed(
-            commandBuffers[i],
-            
-            // Vertex count
-            meshIndexCount,
+    return staging != NULL;
+}
 
-            // Instance count
-            1,
+// KTX2 levels are copied as is, or decoded when device cannot sample the format
+b32 decodeKtx2Texture(TextureLoadRequest* request, f64* waitTimeMs) {
+    Ktx2Texture texture;
+    if (ktx2Load(request->path, &texture) == QQ_FALSE) {
+        return QQ_FALSE;
+    }
 
-            // First index in index buffer
-            0,
-            
-            // Offset between indices
-            0,
+    BcnFormat bcnFormat = BCN_FORMAT_BC1;
+    VkFormat fallbackFormat = (VkFormat)texture.format;
+    b32 isBlockCompressed = getBlockCompressedFormat(texture.format, &bcnFormat, &fallbackFormat);
+    if (
+        (
+            isBlockCompressed == QQ_FALSE
+            && texture.format != KTX2_FORMAT_R8G8B8A8_UNORM
+            && texture.format != KTX2_FORMAT_R8G8B8A8_SRGB
+        )
+        || texture.levelCount > TEXTURE_LOAD_MAX_LEVELS
+    ) {
+        logError("Unsupported KTX2 texture %s", request->path);
+        ktx2Free(&texture);
+        return QQ_FALSE;
+    }
 
-            // Instancing offset (not used)
-            0
-        );
+    b32 decompress = isBlockCompressed == QQ_TRUE
+        && isTextureFormatSupported((VkFormat)texture.format) == QQ_FALSE;
+    request->format = decompress == QQ_TRUE ? fallbackFormat : (VkFormat)texture.format;
+    request->width = texture.width;
+    request->height = texture.height;
+    request->levelCount = texture.levelCount;
+
+    VkDeviceSize size = 0;
+    for (u32 level = 0; level < texture.levelCount; level++) {
+        const Ktx2Level* levelInfo = &texture.levels[level];
+        VkDeviceSize fileLevelSize = getKtx2LevelSize(isBlockCompressed, bcnFormat, levelInfo->width, levelInfo->height);
+        if (levelInfo->size < fileLevelSize) {
+            logError("KTX2 level %u of %s is smaller than expected", level, request->path);
+            ktx2Free(&texture);
+            return QQ_FALSE;
+        }
 
-        // End render pass
-        vkCmdEndRenderPass(commandBuffers[i]);
+        request->levelOffsets[level] = size;
+        size += decompress == QQ_TRUE
+            ? (VkDeviceSize)levelInfo->width * levelInfo->height * 4
+            : fileLevelSize;
+    }
 
-        // Stop recording
-        VkResult stopRecordingResult = vkEndCommandBuffer(commandBuffers[i]);
-        if (stopRecordingResult != VK_SUCCESS) {
-            printf("[ERROR] Error while stopping buffer cmd recording!\n");
+    u8* staging = allocateTextureStaging(request, size, waitTimeMs);
+    for (u32 level = 0; staging != NULL && level < texture.levelCount; level++) {
+        const Ktx2Level* levelInfo = &texture.levels[level];
+        u8* levelData = textureStagingRingMapped + request->levelOffsets[level];
+        if (decompress == QQ_TRUE) {
+            bcnDecodeImage(bcnFormat, ktx2GetLevelData(&texture, level), levelInfo->width, levelInfo->height, levelData);
+        } else {
+            memcpy(
+                levelData,
+                ktx2GetLevelData(&texture, level),
+                getKtx2LevelSize(isBlockCompressed, bcnFormat, levelInfo->width, levelInfo->height)
+            );
         }
     }
+    ktx2Free(&texture);
+
+    return staging != NULL;
 }
 
-void createSyncObjects() {
-    printf("Creating semaphores\n");
+// Runs on worker thread
+void decodeTextureJob(void* userData) {
+    TextureLoadRequest* request = (TextureLoadRequest*)userData;
+    f64 startTime = getTimeMs();
+    f64 waitTimeMs = 0.0;
+    u64 traceStart = traceBegin();
 
-    // Allocate memory for fences
-    inFlightFences = (VkFence*)malloc(MAX_FRAMES_IN_FLIGHT * sizeof(VkFence));
+    const char* extension = strrchr(request->path, '.');
+    if (extension != NULL && strcmp(extension, ".ktx2") == 0) {
+        request->isDecoded = decodeKtx2Texture(request, &waitTimeMs);
+    } else {
+        request->isDecoded = decodeImageTexture(request, &waitTimeMs);
+    }
 
-    // Automatically initialize images in flight with null handles
-    imagesInFlight = (VkFence*)malloc(swapchainImageCount * sizeof(VkFence));
+    request->decodeTimeMs = getTimeMs() - startTime - waitTimeMs;
+    traceEnd("decode texture", traceStart);
+}
 
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        imagesInFlight[i] = VK_NULL_HANDLE;
+// Queues file for decoding on worker threads, texture is registered in global
+// texture array once uploaded (see `textureIndex`)
+TextureLoadRequest* requestTextureLoad(const char* path) {
+    if (isTextureLoaderCreated == QQ_FALSE) {
+        createTextureLoader();
     }
 
-    // Allocate memory for semaphores
-    imageAvailableSemaphores = (VkSemaphore*)malloc(
-        MAX_FRAMES_IN_FLIGHT * sizeof(VkSemaphore)
-    );
-    renderFinishedSemaphores = (VkSemaphore*)malloc(
-        MAX_FRAMES_IN_FLIGHT * sizeof(VkSemaphore)
-    );
+    // Requests are referenced by jobs, so only the pointer array grows
+    if (textureLoadRequestCount == textureLoadRequestCapacity) {
+        textureLoadRequestCapacity = max(textureLoadRequestCapacity * 2, 64);
+        textureLoadRequests = realloc(textureLoadRequests, sizeof(TextureLoadRequest*) * textureLoadRequestCapacity);
+    }
 
-    VkFenceCreateInfo fenceInfo = {
-        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-        .flags = VK_FENCE_CREATE_SIGNALED_BIT
-    };
+    TextureLoadRequest* request = calloc(1, sizeof(TextureLoadRequest));
+    snprintf(request->path, sizeof(request->path), "%s", path);
+    request->state = TEXTURE_LOAD_DECODING;
+    request->textureIndex = U32_MAX;
+    textureLoadRequests[textureLoadRequestCount++] = request;
 
-    VkSemaphoreCreateInfo semaphoreInfo = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+    jobPoolSubmit(&jobPool, &decodeTextureJob, request, &request->decodeCounter);
+
+    return request;
+}
+
+// Records copies of all decoded textures into one command buffer
+void submitTextureUploadBatch(TextureUploadBatch* batch) {
+    VkCommandBuffer commandBuffer = batch->commandBuffer;
+    vkResetCommandBuffer(commandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
     };
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-    VkResult result;
+    VkImageMemoryBarrier* barriers = malloc(sizeof(VkImageMemoryBarrier) * batch->requestCount);
+    for (u32 i = 0; i < batch->requestCount; i++) {
+        barriers[i] = (VkImageMemoryBarrier){
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = batch->requests[i]->image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = VK_REMAINING_MIP_LEVELS,
+                .baseArrayLayer = 0,
+                .layerCount = 1
+            }
+        };
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        batch->requestCount, barriers
+    );
 
-    // Create semaphore pairs
-    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        result = vkCreateSemaphore(
-            logicalDevice,
-            &semaphoreInfo,
-            NULL,
-            &imageAvailableSemaphores[i]
+    for (u32 i = 0; i < batch->requestCount; i++) {
+        TextureLoadRequest* request = batch->requests[i];
+        VkBufferImageCopy regions[TEXTURE_LOAD_MAX_LEVELS];
+        for (u32 level = 0; level < request->levelCount; level++) {
+            regions[level] = (VkBufferImageCopy){
+                .bufferOffset = request->levelOffsets[level],
+                .bufferRowLength = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource = {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel = level,
+                    .baseArrayLayer = 0,
+                    .layerCount = 1
+                },
+                .imageOffset = {0,0,0},
+                .imageExtent = {max(request->width >> level, 1), max(request->height >> level, 1), 1}
+            };
+        }
+        vkCmdCopyBufferToImage(
+            commandBuffer,
+            textureStagingRingBuffer,
+            request->image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            request->levelCount,
+            regions
         );
-        if (result != VK_SUCCESS) {
-            printf("[ERROR] Failed to create image available semaphore\n");
+    }
+
+    for (u32 i = 0; i < batch->requestCount; i++) {
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        batch->requestCount, barriers
+    );
+    free(barriers);
+
+    vkEndCommandBuffer(commandBuffer);
+
+    batch->timelineValue = submitGraphicsCommands(commandBuffer, VK_NULL_HANDLE, 0, VK_NULL_HANDLE);
+    batch->isInFlight = QQ_TRUE;
+    textureUploadBatchSubmitCount += 1;
+}
+
+// Publishes uploaded textures and batches decoded ones, never blocks
+// Returns QQ_TRUE if anything progressed
+b32 updateTextureLoads() {
+    if (isTextureLoaderCreated == QQ_FALSE) {
+        return QQ_FALSE;
+    }
+
+    b32 hasProgressed = QQ_FALSE;
+
+    // Finished batches free their staging slices, which unblocks waiting workers
+    TextureUploadBatch* freeBatch = NULL;
+    for (u32 i = 0; i < TEXTURE_UPLOAD_BATCH_COUNT; i++) {
+        TextureUploadBatch* batch = &textureUploadBatches[i];
+        if (batch->isInFlight == QQ_TRUE && isTimelineValueReached(batch->timelineValue) == QQ_TRUE) {
+            for (u32 j = 0; j < batch->requestCount; j++) {
+                TextureLoadRequest* request = batch->requests[j];
+                stagingRingRelease(&textureStagingRing, request->stagingSlice);
+                request->textureIndex = registerGlobalTexture(request->imageView);
+                request->state = TEXTURE_LOAD_READY;
+
+                // Texture without slot is never sampled, its upload is finished so it can go
+                if (request->textureIndex == U32_MAX) {
+                    vkDestroyImageView(logicalDevice, request->imageView, NULL);
+                    vkDestroyImage(logicalDevice, request->image, NULL);
+                    vkFreeMemory(logicalDevice, request->imageMemory, NULL);
+                    request->state = TEXTURE_LOAD_FAILED;
+                }
+            }
+            batch->isInFlight = QQ_FALSE;
+            batch->requestCount = 0;
+            hasProgressed = QQ_TRUE;
+        }
+        if (batch->isInFlight == QQ_FALSE && freeBatch == NULL) {
+            freeBatch = batch;
+        }
+    }
+
+    // Everything decoded since the last batch goes into the next one
+    if (freeBatch == NULL) {
+        return hasProgressed;
+    }
+    freeBatch->requests = realloc(freeBatch->requests, sizeof(TextureLoadRequest*) * textureLoadRequestCount);
+    for (u32 i = 0; i < textureLoadRequestCount; i++) {
+        TextureLoadRequest* request = textureLoadRequests[i];
+        if (request->state != TEXTURE_LOAD_DECODING || jobCounterIsDone(&request->decodeCounter) == QQ_FALSE) {
+            continue;
         }
 
-        result = vkCreateSemaphore(
-            logicalDevice,
-            &semaphoreInfo,
-            NULL,
-            &renderFinishedSemaphores[i]
-        );
-        if (result != VK_SUCCESS) {
-            printf("[ERROR] Failed to create render finished semaphore\n");
+        hasProgressed = QQ_TRUE;
+        if (request->isDecoded == QQ_FALSE) {
+            request->state = TEXTURE_LOAD_FAILED;
+            continue;
         }
 
-        result = vkCreateFence(
-            logicalDevice,
-            &fenceInfo,
-            NULL,
-            &inFlightFences[i]
+        createImage(
+            request->width,
+            request->height,
+            request->levelCount,
+            VK_SAMPLE_COUNT_1_BIT,
+            request->format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &request->image,
+            &request->imageMemory
         );
-        if (result != VK_SUCCESS) {
-            printf("[ERROR] Failed to create fence\n");
-        }
+        request->imageView = createImageView(
+            request->image,
+            request->format,
+            VK_IMAGE_ASPECT_COLOR_BIT,
+            request->levelCount
+        );
+        request->state = TEXTURE_LOAD_UPLOADING;
+        freeBatch->requests[freeBatch->requestCount++] = request;
+    }
 
+    if (freeBatch->requestCount > 0) {
+        submitTextureUploadBatch(freeBatch);
     }
+
+    return hasProgressed;
 }
 
-void createDescriptorSets() {
-    VkDescriptorSetLayout* layouts = malloc(sizeof(VkDescriptorSetLayout) * swapchainImageCount);
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        layouts[i] = descriptorSetLayout;
+// Loads every PNG/JPEG/KTX2 file of the directory, blocks until all are uploaded
+void loadTextureDirectory(const char* path) {
+    DIR* directory = opendir(path);
+    if (directory == NULL) {
+        logError("Failed to open texture directory %s", path);
+        return;
     }
 
-    VkDescriptorSetAllocateInfo allocInfo = {
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = descriptorPool,
-        .descriptorSetCount = swapchainImageCount,
-        .pSetLayouts = layouts
-    };
+    f64 startTime = getTimeMs();
+    u32 firstRequest = textureLoadRequestCount;
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        const char* extension = strrchr(entry->d_name, '.');
+        if (
+            extension == NULL
+            || (
+                strcmp(extension, ".png") != 0
+                && strcmp(extension, ".jpg") != 0
+                && strcmp(extension, ".jpeg") != 0
+                && strcmp(extension, ".ktx2") != 0
+            )
+        ) {
+            continue;
+        }
 
-    // Allocate memory for descriptor sets
-    descriptorSets = malloc(sizeof(VkDescriptorSet) * swapchainImageCount);
-    if (vkAllocateDescriptorSets(logicalDevice, &allocInfo, descriptorSets) != VK_SUCCESS) {
-        printf("[ERROR] Failed to allocate descriptor sets\n");
+        char filePath[512];
+        snprintf(filePath, sizeof(filePath), "%s/%s", path, entry->d_name);
+        requestTextureLoad(filePath);
     }
+    closedir(directory);
 
-    // Free temp layouts memory
-    free(layouts);
+    u32 requestCount = textureLoadRequestCount - firstRequest;
+    logInfo("[TEXTURE LOADER] Loading %u textures from %s on %u workers", requestCount, path, jobPool.threadCount);
 
-    // Configure descriptor sets
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        VkDescriptorBufferInfo bufferInfo = {
-            .buffer = uniformBuffers[i],
-            .offset = 0,
-            .range = sizeof(UniformBufferObject)
-        };
+    // Pump uploads until every request is finished
+    for (;;) {
+        b32 hasProgressed = updateTextureLoads();
 
-        VkDescriptorImageInfo imageInfo = {
-            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-            .imageView = textureImageView,
-            .sampler = textureSampler
-        };
+        u32 finishedCount = 0;
+        for (u32 i = firstRequest; i < textureLoadRequestCount; i++) {
+            TextureLoadState state = textureLoadRequests[i]->state;
+            finishedCount += state == TEXTURE_LOAD_READY || state == TEXTURE_LOAD_FAILED;
+        }
+        if (finishedCount == requestCount) {
+            break;
+        }
+        if (hasProgressed == QQ_FALSE) {
+            usleep(100);
+        }
+    }
 
-        u32 descriptorWriteCount = 2;
-        VkWriteDescriptorSet descriptorWrites[2] = {
-            {
-                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptorSets[i],
-                .dstBinding = 0,
-                // Not using as array
-                .dstArrayElement = 0,
-                .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-                .descriptorCount = 1,
-                .pBufferInfo = &bufferInfo,
-                .pImageInfo = NULL,
-                .pTexelBufferView = NULL
-            },
-            {
-                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                .dstSet = descriptorSets[i],
-                .dstBinding = 1,
-                // Not using as array
-                .dstArrayElement = 0,
-                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                .descriptorCount = 1,
-                .pImageInfo = &imageInfo,
-            }
-        };
+    f64 wallTimeMs = getTimeMs() - startTime;
+
+    // Per file and aggregate report
+    f64 decodeTimeSumMs = 0.0;
+    VkDeviceSize uploadedBytes = 0;
+    u32 failedCount = 0;
+    for (u32 i = firstRequest; i < textureLoadRequestCount; i++) {
+        const TextureLoadRequest* request = textureLoadRequests[i];
+        if (request->state == TEXTURE_LOAD_FAILED) {
+            failedCount += 1;
+            logInfo("[TEXTURE LOADER]   %s: failed", request->path);
+            continue;
+        }
 
-        vkUpdateDescriptorSets(
-            logicalDevice,
-            descriptorWriteCount,
-            descriptorWrites,
-            0,
-            NULL
+        decodeTimeSumMs += request->decodeTimeMs;
+        uploadedBytes += request->uploadSize;
+        logInfo(
+            "[TEXTURE LOADER]   %s: %ux%u, %u levels, %lu KiB, decode %.2f ms",
+            request->path,
+            request->width,
+            request->height,
+            request->levelCount,
+            request->uploadSize / 1024,
+            request->decodeTimeMs
         );
     }
+
+    logInfo(
+        "[TEXTURE LOADER] %u loaded, %u failed in %.2f ms | decode sum %.2f ms, speedup %.2fx",
+        requestCount - failedCount,
+        failedCount,
+        wallTimeMs,
+        decodeTimeSumMs,
+        wallTimeMs > 0.0 ? decodeTimeSumMs / wallTimeMs : 0.0
+    );
+    logInfo(
+        "[TEXTURE LOADER] %lu MiB uploaded in %u batches, staging ring peak %lu of %u MiB, %u allocation waits",
+        uploadedBytes / (1024 * 1024),
+        textureUploadBatchSubmitCount,
+        textureStagingRing.peakUsed / (1024 * 1024),
+        TEXTURE_STAGING_RING_SIZE / (1024 * 1024),
+        textureStagingRing.waitCount
+    );
+}
+
+// Device must be idle
+void shutdownTextureLoader() {
+    if (isTextureLoaderCreated == QQ_FALSE) {
+        return;
+    }
+
+    for (u32 i = 0; i < textureLoadRequestCount; i++) {
+        TextureLoadRequest* request = textureLoadRequests[i];
+        jobPoolWait(&jobPool, &request->decodeCounter);
+        if (request->state == TEXTURE_LOAD_UPLOADING || request->state == TEXTURE_LOAD_READY) {
+            vkDestroyImageView(logicalDevice, request->imageView, NULL);
+            vkDestroyImage(logicalDevice, request->image, NULL);
+            vkFreeMemory(logicalDevice, request->imageMemory, NULL);
+        }
+        free(request);
+    }
+    free(textureLoadRequests);
+
+    for (u32 i = 0; i < TEXTURE_UPLOAD_BATCH_COUNT; i++) {
+        TextureUploadBatch* batch = &textureUploadBatches[i];
+        vkFreeCommandBuffers(logicalDevice, commandPool, 1, &batch->commandBuffer);
+        free(batch->requests);
+    }
+
+    stagingRingDestroy(&textureStagingRing);
+    vkUnmapMemory(logicalDevice, textureStagingRingMemory);
+    vkDestroyBuffer(logicalDevice, textureStagingRingBuffer, NULL);
+    vkFreeMemory(logicalDevice, textureStagingRingMemory, NULL);
+    trackTextureStagingBytes(TEXTURE_STAGING_RING_SIZE, QQ_FALSE);
+
+    isTextureLoaderCreated = QQ_FALSE;
 }
 
 void shutdownSwapchain() {
-    printf("Shutting down color resources\n");
+    logDebug("Shutting down color resources");
     vkDestroyImageView(logicalDevice, colorImageView, NULL);
     vkDestroyImage(logicalDevice, colorImage, NULL);
     vkFreeMemory(logicalDevice, colorImageMemory, NULL);
 
-    printf("Shutting down depth images\n");
+    logDebug("Shutting down depth images");
     vkDestroyImageView(logicalDevice, depthImageView, NULL);
     vkDestroyImage(logicalDevice, depthImage, NULL);
     vkFreeMemory(logicalDevice, depthImageMemory, NULL);
 
-    printf("Shutting down framebuffers\n");
+    logDebug("Shutting down framebuffers");
     for (u32 i = 0; i < swapchainImageCount; i++) {
         vkDestroyFramebuffer(logicalDevice, swapchainFramebuffers[i], NULL);
     }
     free(swapchainFramebuffers);
 
-    printf("Freeing command buffers\n");
+    logDebug("Freeing command buffers");
     u32 commandBufferCount = swapchainImageCount;
     vkFreeCommandBuffers(
         logicalDevice,
@@ -2684,41 +7586,49 @@ void shutdownSwapchain() {
         commandBuffers
     );
 
-    printf("Freeing uniform buffers\n");
-    for (u32 i = 0; i < swapchainImageCount; i++) {
-        vkDestroyBuffer(logicalDevice, uniformBuffers[i], NULL);
-        vkFreeMemory(logicalDevice, uniformBuffersMemory[i], NULL);
-    }
-    free(uniformBuffers);
-    free(uniformBuffersMemory);
-
-    printf("Shutting down descriptor pool\n");
-    vkDestroyDescriptorPool(logicalDevice, descriptorPool, NULL);
 
-    printf("Shutting down graphics pipeline\n");
-    vkDestroyPipeline(logicalDevice, graphicsPipeline, NULL);
+    logDebug("Shutting down graphics pipeline");
+    destroyPipelineVariants();
+    vkDestroyShaderModule(logicalDevice, depthVertShaderModule, NULL);
+    vkDestroyShaderModule(logicalDevice, fragShaderModule, NULL);
+    vkDestroyShaderModule(logicalDevice, vertColorShaderModule, NULL);
+    vkDestroyShaderModule(logicalDevice, vertShaderModule, NULL);
 
-    printf("Shutting down pipeline\n");
+    logDebug("Shutting down pipeline");
     vkDestroyPipelineLayout(logicalDevice, pipelineLayout, NULL);
 
-    printf("Shutting down render pass\n");
+    logDebug("Shutting down render pass");
     vkDestroyRenderPass(logicalDevice, renderPass, NULL);
 
-    printf("Destroying image views\n");
+    logDebug("Destroying image views");
     for (u32 i = 0; i < swapchainImageCount; i++) {
         vkDestroyImageView(logicalDevice, swapchainImageViews[i], NULL);
     }
 
-    printf("Freeing image views memory\n");
+    logDebug("Freeing image views memory");
     free(swapchainImageViews);
 
-    printf("Destroying swapchain\n");
+    if (headlessEnabled == QQ_TRUE) {
+        logDebug("Destroying headless targets");
+        for (u32 i = 0; i < swapchainImageCount; i++) {
+            vkDestroyImage(logicalDevice, swapchainImages[i], NULL);
+            vkFreeMemory(logicalDevice, headlessImageMemories[i], NULL);
+        }
+        // Images are owned by headless targets, shutdownVulkan must not free them again
+        free(swapchainImages);
+        swapchainImages = NULL;
+        free(headlessImageMemories);
+        headlessImageMemories = NULL;
+        return;
+    }
+
+    logDebug("Destroying swapchain");
     vkDestroySwapchainKHR(logicalDevice, swapchain, NULL);
 
 }
 
 void recreateSwapchain() {
-    printf("[RUNTIME] Recreating swap chain\n");
+    logInfo("[RUNTIME] Recreating swap chain");
 
     // Get window dimentions from glfw
     u32 width;
@@ -2732,49 +7642,111 @@ void recreateSwapchain() {
     // Wait till currently used resources are free to manage
     vkDeviceWaitIdle(logicalDevice);
 
+    // Present ids belong to the old swapchain
+    pendingPresentCount = 0;
+
     shutdownSwapchain();
 
     createSwapchain();
     createImageViews();
     createRenderPass();
     createGraphicsPipeline();
+    createFallbackPipelines();
     createColorResources();
     createDepthResources();
     createFramebuffers();
-    createUniformBuffers();
-    createDescriptorPool();
-    createDescriptorSets();
     createCommandBuffers();
+    waitForPipelineCompiles();
+
+    // Image count may change, device is idle so every image is free
+    free(imageTimelineValues);
+    imageTimelineValues = (u64*)calloc(swapchainImageCount, sizeof(u64));
 }
 
 void initVulkan() {
-    printf("Initializing Vulkan\n");
+    logDebug("Initializing Vulkan");
+    u64 initStart = traceBegin();
+
+    u64 stageStart = traceBegin();
     createInstance();
     // TODO: Setup debug message pipe
-    createSurface();
+    if (headlessEnabled == QQ_FALSE) {
+        createSurface();
+    }
     pickPhysicalDevice();
     createLogicalDevice();
+    createGraphicsTimeline();
+    createPipelineCache();
+    endStartupStage("init device", stageStart);
+
+    stageStart = traceBegin();
     createSwapchain();
     createImageViews();
     createRenderPass();
     createDescriptorSetLayout();
     createGraphicsPipeline();
+    createFallbackPipelines();
     createCommandPool();
+    createMipGenerator();
     createColorResources();
     createDepthResources();
     createFramebuffers();
+    releaseStartupShaderCodes();
+    endStartupStage("init swapchain and pipelines", stageStart);
+
+    stageStart = traceBegin();
     createTextureImage();
     createTextureImageView();
     createTextureSampler();
-    loadModel();
+    endStartupStage("init mesh texture", stageStart);
+
+    // Parsed by worker while the device was created
+    stageStart = traceBegin();
+    finishStartupTask(&modelLoadTask);
     debugLoadedModel();
+    createOcclusionCuller();
+    endStartupStage("init model", stageStart);
+
+    // Two draws at most per mesh (pre-pass and main pass), queue grows when needed
+    stageStart = traceBegin();
+    renderQueueCreate(&renderQueue, 16);
     createVertexBuffer();
     createIndexBuffer();
     createUniformBuffers();
+    createMaterialBuffer();
+    createTextureResidencyBuffer();
+    createVirtualTextureBuffers();
+    endStartupStage("init buffers", stageStart);
+
+    stageStart = traceBegin();
     createDescriptorPool();
-    createDescriptorSets();
+    createGlobalDescriptorSet();
+    createMeshMaterial();
+    endStartupStage("init descriptors", stageStart);
+
+    if (textureDirectoryPath != NULL) {
+        stageStart = traceBegin();
+        loadTextureDirectory(textureDirectoryPath);
+        endStartupStage("init texture directory", stageStart);
+    }
+    if (atlasDirectoryPath != NULL) {
+        stageStart = traceBegin();
+        createTextureAtlas(atlasDirectoryPath);
+        endStartupStage("init texture atlas", stageStart);
+    }
+
+    stageStart = traceBegin();
     createCommandBuffers();
     createSyncObjects();
+    createGpuProfiler();
+    endStartupStage("init command buffers", stageStart);
+
+    // Textured fallbacks were compiled by pipeline workers meanwhile
+    stageStart = traceBegin();
+    waitForPipelineCompiles();
+    endStartupStage("init fallback pipelines", stageStart);
+
+    endStartupStage("initVulkan", initStart);
 }
 
 void shutdownVulkan() {
@@ -2782,201 +7754,401 @@ void shutdownVulkan() {
     // TODO: There is an errors, when resizing the window
     shutdownSwapchain();
 
-    printf("Shutting down sampler\n");
+    logDebug("Shutting down pipeline cache");
+    printPipelineCompileStats();
+    shutdownPipelineCache();
+
+    logDebug("Shutting down occlusion culler");
+    shutdownOcclusionCuller();
+
+    logDebug("Shutting down render queue");
+    shutdownRenderQueue();
+
+    logDebug("Shutting down texture streams");
+    shutdownTextureStreams();
+
+    logDebug("Shutting down texture loader");
+    shutdownTextureLoader();
+
+    logDebug("Shutting down texture atlas");
+    shutdownTextureAtlas();
+
+    logDebug("Shutting down virtual textures");
+    shutdownVirtualTextures();
+
+    logDebug("Shutting down mip generator");
+    shutdownMipGenerator();
+
+    logDebug("Shutting down sampler");
     vkDestroySampler(logicalDevice, textureSampler, NULL);
 
-    printf("Shutting down loaded image texture view\n");
+    logDebug("Shutting down loaded image texture view");
     vkDestroyImageView(logicalDevice, textureImageView, NULL);
 
-    printf("Shutting down loaded image texture\n");
+    logDebug("Shutting down loaded image texture");
     vkDestroyImage(logicalDevice, textureImage, NULL);
     vkFreeMemory(logicalDevice, textureImageMemory, NULL);
 
-    printf("Shutting down descriptor set layout\n");
+    logDebug("Shutting down descriptor pool");
+    vkDestroyDescriptorPool(logicalDevice, descriptorPool, NULL);
+
+    logDebug("Freeing uniform buffer");
+    vkUnmapMemory(logicalDevice, uniformBufferMemory);
+    vkDestroyBuffer(logicalDevice, uniformBuffer, NULL);
+    vkFreeMemory(logicalDevice, uniformBufferMemory, NULL);
+
+    logDebug("Freeing material buffer");
+    vkUnmapMemory(logicalDevice, materialBufferMemory);
+    vkDestroyBuffer(logicalDevice, materialBuffer, NULL);
+    vkFreeMemory(logicalDevice, materialBufferMemory, NULL);
+
+    logDebug("Freeing texture residency buffer");
+    vkUnmapMemory(logicalDevice, textureResidencyBufferMemory);
+    vkDestroyBuffer(logicalDevice, textureResidencyBuffer, NULL);
+    vkFreeMemory(logicalDevice, textureResidencyBufferMemory, NULL);
+
+    logDebug("Freeing virtual texture buffers");
+    vkUnmapMemory(logicalDevice, virtualTextureBufferMemory);
+    vkDestroyBuffer(logicalDevice, virtualTextureBuffer, NULL);
+    vkFreeMemory(logicalDevice, virtualTextureBufferMemory, NULL);
+    vkUnmapMemory(logicalDevice, virtualFeedbackBufferMemory);
+    vkDestroyBuffer(logicalDevice, virtualFeedbackBuffer, NULL);
+    vkFreeMemory(logicalDevice, virtualFeedbackBufferMemory, NULL);
+
+    logDebug("Shutting down descriptor set layout");
     vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, NULL);
 
-    printf("Shutting down index buffer\n");
+    logDebug("Shutting down index buffer");
     vkDestroyBuffer(logicalDevice, indexBuffer, NULL);
     vkFreeMemory(logicalDevice, indexBufferMemory, NULL);
 
-    printf("Shutting down vertex buffer\n");
-    vkDestroyBuffer(logicalDevice, vertexBuffer, NULL);
-    vkFreeMemory(logicalDevice, vertexBufferMemory, NULL);
+    logDebug("Shutting down vertex buffers");
+    vkDestroyBuffer(logicalDevice, vertexPositionBuffer, NULL);
+    vkFreeMemory(logicalDevice, vertexPositionBufferMemory, NULL);
+    vkDestroyBuffer(logicalDevice, vertexAttributeBuffer, NULL);
+    vkFreeMemory(logicalDevice, vertexAttributeBufferMemory, NULL);
+    if (vertexQuantizedPositionBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(logicalDevice, vertexQuantizedPositionBuffer, NULL);
+        vkFreeMemory(logicalDevice, vertexQuantizedPositionBufferMemory, NULL);
+    }
 
-    printf("Shutting down semaphores\n");
-    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    logDebug("Shutting down semaphores");
+    for (u32 i = 0; i < framesInFlight; i++) {
         vkDestroySemaphore(logicalDevice, renderFinishedSemaphores[i], NULL);
         vkDestroySemaphore(logicalDevice, imageAvailableSemaphores[i], NULL);
-        vkDestroyFence(logicalDevice, inFlightFences[i], NULL);
     }
     free(renderFinishedSemaphores);
     free(imageAvailableSemaphores);
-    free(inFlightFences);
+    free(imageTimelineValues);
+    vkDestroySemaphore(logicalDevice, graphicsTimeline, NULL);
+    if (gpuProfilerQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(logicalDevice, gpuProfilerQueryPool, NULL);
+    }
 
-    printf("Shutting down command pool\n");
+    logDebug("Shutting down command pool");
     vkDestroyCommandPool(logicalDevice, commandPool, NULL);
 
-    printf("Releasing swapchain images info\n");
+    logDebug("Releasing swapchain images info");
     free(swapchainImages);
 
-    printf("Shutting down Vulkan\n");
+    logDebug("Shutting down Vulkan");
     vkDestroyDevice(logicalDevice, NULL);
 
-    printf("Destroying window surface\n");
-    vkDestroySurfaceKHR(instance, surface, NULL);
+    if (headlessEnabled == QQ_FALSE) {
+        logDebug("Destroying window surface");
+        vkDestroySurfaceKHR(instance, surface, NULL);
+    }
 
-    printf("Destroying Vulkan virtual device\n");
+    logDebug("Destroying Vulkan virtual device");
     vkDestroyInstance(instance, NULL);
 
     if (debugModeEnabled) {
         // Free layer info data
-        printf("Freeing Vulkan layers info");
+        logDebug("Freeing Vulkan layers info");
         free(layerProperties);
     }
 }
 
-void updateUniformBuffer(u32 currentImage) {
-    UniformBufferObject ubo = {
-        .model = GLM_MAT4_IDENTITY_INIT,
-        .view = GLM_MAT4_IDENTITY_INIT,
-        .projection = GLM_MAT4_IDENTITY_INIT
-    };
+// Slice of the frame is free, its timeline value was waited at the start of the frame
+void updateUniformBuffer(u32 frameIndex) {
+    UniformBufferObject ubo;
+    getCameraViewProjectionMatrix(ubo.viewProjection);
 
-    // Apply transform
-    vec3 translation = {0.0f, 0.7f, 0.0f};
-    glm_translate(ubo.model, translation);
+    // Copy data to current (persistently mapped) uniform buffer slice
+    memcpy(&uniformBufferMapped[frameIndex], &ubo, sizeof(ubo));
+}
 
-    // Pretrasform model
-    // TODO: This is not proper way of doing this
-    //       and usualy must be done before constructing UBO
-    vec3 preRotationPivot = {0.0f, -1.0f, 0.0f};
-    vec3 preRotationAxis = {0.55f, 0.0f, 1.0f};
-    glm_rotate_at(
-        ubo.model,
-        preRotationPivot,
-        0.0f,
-        preRotationAxis
+// Starts occlusion pass for current frame on worker thread
+void kickOcclusionCulling() {
+    mat4 model, viewProjection;
+    getMeshModelMatrix(model);
+    getCameraViewProjectionMatrix(viewProjection);
+
+    // Mesh bounds follow its animation
+    OcclusionBounds bounds;
+    occlusionTransformBounds(
+        (f32*)model,
+        meshBoundsMin,
+        meshBoundsMax,
+        &bounds
     );
+    occlusionCullerSetObjectBounds(&occlusionCuller, meshOcclusionObject, &bounds);
+    occlusionCullerSetOccluderTransform(&occlusionCuller, meshOccluder, (f32*)model);
 
-    f64 rotationAngleRads = 0.2;
-    vec3 rotationPivot = {0.0f, 0.0f, 0.0f};
-    vec3 rotationAxis = {0.0f, 1.0f, 0.0f};
-    glm_rotate_at(
-        ubo.model,
-        rotationPivot,
-        glfwGetTime() * rotationAngleRads,
-        rotationAxis
-    );
+    occlusionCullerKick(&occlusionCuller, &jobPool, (f32*)viewProjection);
+}
 
-    glm_lookat(
-        eyeVector,
-        lookCenter,
-        lookUp,
-        ubo.view
-    );
+void recordFrameLatency(f64 latencyMs) {
+    frameStats.latencyCount += 1;
+    frameStats.latencySumMs += latencyMs;
+    frameStats.latencyMaxMs = max(frameStats.latencyMaxMs, latencyMs);
+}
 
-    f64 fieldOfViewRads = 0.785398f;
-    f64 projectionAspect = (f64)swapchainExtent.width / (f64)swapchainExtent.height;
-    glm_perspective(
-        fieldOfViewRads,
-        projectionAspect,
-        0.1f, // Near clipping plane
-        10.0f, // Far clipping plane
-        ubo.projection
-    );
+// Collects frames which reached the display, never blocks (swapchain may not be
+// used by other thread meanwhile, so waiting happens on the render thread)
+void pollPresentedFrames() {
+    while (pendingPresentCount > 0) {
+        PendingPresent* pending = &pendingPresents[pendingPresentHead];
+        VkResult result = waitForPresentKHR(logicalDevice, swapchain, pending->presentId, 0);
+        if (result == VK_TIMEOUT) {
+            return;
+        }
 
-    ubo.projection[1][1] *= -1.0f;
+        // Out of date or lost surface, frames will never be reported
+        if (result != VK_SUCCESS) {
+            pendingPresentCount = 0;
+            return;
+        }
 
-    // Copy data to current uniform buffer
-    void* data;
-    vkMapMemory(logicalDevice, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-    memcpy(data, &ubo, sizeof(ubo));
-    vkUnmapMemory(logicalDevice, uniformBuffersMemory[currentImage]);
+        recordFrameLatency(getTimeMs() - pending->inputTimeMs);
+        pendingPresentHead = (pendingPresentHead + 1) % PRESENT_WAIT_MAX_PENDING;
+        pendingPresentCount -= 1;
+    }
+}
 
+void trackPresentedFrame(u64 id, f64 inputTimeMs) {
+    // Oldest frame is dropped when display does not keep up
+    if (pendingPresentCount == PRESENT_WAIT_MAX_PENDING) {
+        pendingPresentHead = (pendingPresentHead + 1) % PRESENT_WAIT_MAX_PENDING;
+        pendingPresentCount -= 1;
+    }
+    u32 index = (pendingPresentHead + pendingPresentCount) % PRESENT_WAIT_MAX_PENDING;
+    pendingPresents[index] = (PendingPresent){id, inputTimeMs};
+    pendingPresentCount += 1;
 }
 
-void drawFrame() {
-    // Wait for the frame to be finished
-    vkWaitForFences(logicalDevice, 1, &inFlightFences[currentFrame], VK_TRUE, U64_MAX);
+void printFrameStats(const FrameStats* stats) {
+    if (stats->frameCount == 0) {
+        logInfo("[FRAME] No frames measured yet");
+        return;
+    }
 
-    // Aquire image from swap chain
-    u32 imageIndex;
-    VkResult acquireResult = vkAcquireNextImageKHR(
-        // Device and swap chain to aquire image from
-        logicalDevice,
-        swapchain,
+    // Optional parts are formatted first, logger takes whole lines
+    char limit[32] = "";
+    if (frameLimitFps > 0.0) {
+        snprintf(limit, sizeof(limit), ", limit %.0f FPS", frameLimitFps);
+    }
+    char latency[96] = "";
+    if (stats->latencyCount > 0) {
+        snprintf(
+            latency,
+            sizeof(latency),
+            " | input to %s %.2f ms avg %.2f ms max",
+            isPresentWaitSupported == QQ_TRUE ? "present" : "GPU finish",
+            stats->latencySumMs / stats->latencyCount,
+            stats->latencyMaxMs
+        );
+    }
 
-        // Timeout for image to become available (nanoseconds)
-        // "max" value disables timeout
-        U64_MAX,
+    f64 averageFrameTimeMs = stats->frameTimeSumMs / stats->frameCount;
+    logInfo(
+        "[FRAME] %.1f FPS, frame %.2f ms avg %.2f ms max | %u in flight, %s%s%s",
+        averageFrameTimeMs > 0.0 ? 1000.0 / averageFrameTimeMs : 0.0,
+        averageFrameTimeMs,
+        stats->frameTimeMaxMs,
+        framesInFlight,
+        getPresentModeName(swapchainPresentMode),
+        limit,
+        latency
+    );
+}
 
-        // Objects to signal when image will become available
-        imageAvailableSemaphores[currentFrame],
-        VK_NULL_HANDLE,
+// Runs once per frame before input is polled, sleeping here (not after input) keeps latency low
+void updateFramePacing(f64 frameTimeMs) {
+    f64 now = getTimeMs();
 
-        // Available image index (in swaphChainImages)
-        &imageIndex
-    );
+    frameStats.frameCount += 1;
+    frameStats.frameTimeSumMs += frameTimeMs;
+    frameStats.frameTimeMaxMs = max(frameStats.frameTimeMaxMs, frameTimeMs);
+    if (now - frameStats.startTimeMs >= FRAME_STATS_INTERVAL_MS) {
+        if (frameStatsEnabled == QQ_TRUE) {
+            printFrameStats(&frameStats);
+        }
+        lastFrameStats = frameStats;
+        frameStats = (FrameStats){.startTimeMs = now};
+    }
 
-    // Determine if swapchain needs to be recreated, based on result of image acquiring
-    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
-        recreateSwapchain();
+    if (frameLimitFps <= 0.0) {
         return;
-    } else if (acquireResult != VK_SUCCESS) {
-        printf("Failed to acquire swap chain image!\n");
     }
 
-    if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-        vkWaitForFences(logicalDevice, 1, &imagesInFlight[imageIndex], VK_TRUE, U64_MAX);
+    // Schedule keeps steady interval, but does not try to catch up after long frames
+    f64 intervalMs = 1000.0 / frameLimitFps;
+    nextFrameStartMs = max(nextFrameStartMs + intervalMs, now);
+    if (nextFrameStartMs - now > intervalMs) {
+        nextFrameStartMs = now + intervalMs;
+    }
+
+    // Sleep is coarse, last part is spun
+    f64 remainingMs = nextFrameStartMs - getTimeMs();
+    if (remainingMs > 1.0) {
+        usleep((u32)((remainingMs - 1.0) * 1000.0));
     }
-    imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+    while (getTimeMs() < nextFrameStartMs) {
+    }
+}
 
-    // Update uniform buffer for animation
-    updateUniformBuffer(imageIndex);
+// Scripted orbit around the model, one revolution per 8 simulated seconds
+void updateBenchmarkCamera() {
+    f64 angle = currentFrameTime * 6.283185 / 8.0;
+    eyeVector[0] = (f32)(sin(angle) * 4.0);
+    eyeVector[1] = (f32)(sin(currentFrameTime * 0.5) * 1.5);
+    eyeVector[2] = (f32)(cos(angle) * 4.0);
+}
 
-    // Submit command buffer
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+int compareFrameTimes(const void* a, const void* b) {
+    f64 left = *(const f64*)a;
+    f64 right = *(const f64*)b;
+    return (left > right) - (left < right);
+}
 
-    // Specify which semaphores to wait form and in which pipeline
-    VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+// Sorts `times` in place, percentiles use nearest rank
+FrameTimeSummary summarizeFrameTimes(f64* times, u32 count) {
+    FrameTimeSummary summary = {0};
+    if (count == 0) {
+        return summary;
+    }
 
-    // Specify which command buffer to submit
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+    qsort(times, count, sizeof(f64), &compareFrameTimes);
+    f64 sum = 0.0;
+    for (u32 i = 0; i < count; i++) {
+        sum += times[i];
+    }
 
-    // Specify semaphores to trigger when execution is finished
-    VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    f64 percentiles[3] = {50.0, 95.0, 99.0};
+    f64* results[3] = {&summary.p50Ms, &summary.p95Ms, &summary.p99Ms};
+    for (u32 i = 0; i < 3; i++) {
+        u32 rank = (u32)ceil(percentiles[i] / 100.0 * count);
+        *results[i] = times[max(rank, 1) - 1];
+    }
+    summary.count = count;
+    summary.averageMs = sum / count;
+    summary.maxMs = times[count - 1];
+    return summary;
+}
 
-    // Reset fences
-    vkResetFences(logicalDevice, 1, &inFlightFences[currentFrame]);
-    
-    // Submit command to graphics queue
-    if (vkQueueSubmit(
-        graphicsQueue,
-        1,
-        &submitInfo,
-        inFlightFences[currentFrame]
-    ) != VK_SUCCESS) {
-        printf("[ERROR] Failed to submit draw command buffer\n");
+void writeFrameTimeSummary(FILE* file, const char* name, const FrameTimeSummary* summary, b32 isLast) {
+    if (summary->count == 0) {
+        fprintf(file, "  \"%s\": null%s\n", name, isLast == QQ_TRUE ? "" : ",");
+        return;
+    }
+    fprintf(
+        file,
+        "  \"%s\": {\"samples\": %u, \"avg_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f}%s\n",
+        name,
+        summary->count,
+        summary->averageMs,
+        summary->p50Ms,
+        summary->p95Ms,
+        summary->p99Ms,
+        summary->maxMs,
+        isLast == QQ_TRUE ? "" : ","
+    );
+}
+
+// Writes benchmark result as JSON into `--bench-output` file or stdout
+void writeBenchmarkReport(f64 elapsedMs) {
+    FrameTimeSummary cpuSummary = summarizeFrameTimes(benchmarkCpuTimesMs, benchmarkCpuSampleCount);
+    FrameTimeSummary gpuSummary = summarizeFrameTimes(benchmarkGpuTimesMs, benchmarkGpuSampleCount);
+
+    // Report must not interleave with queued log lines
+    FILE* file = stdout;
+    logFlush();
+    if (benchmarkOutputPath != NULL) {
+        file = fopen(benchmarkOutputPath, "w");
+        if (file == NULL) {
+            logError("Failed to open benchmark output: %s", benchmarkOutputPath);
+            return;
+        }
+    }
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"device\": \"%s\",\n", properties.deviceName);
+    fprintf(file, "  \"width\": %u,\n", swapchainExtent.width);
+    fprintf(file, "  \"height\": %u,\n", swapchainExtent.height);
+    fprintf(file, "  \"headless\": %s,\n", headlessEnabled == QQ_TRUE ? "true" : "false");
+    fprintf(file, "  \"present_mode\": \"%s\",\n", headlessEnabled == QQ_TRUE ? "none" : getPresentModeName(swapchainPresentMode));
+    fprintf(file, "  \"frames_in_flight\": %u,\n", framesInFlight);
+    fprintf(file, "  \"timestep_ms\": %.4f,\n", BENCHMARK_TIMESTEP_SECONDS * 1000.0);
+    fprintf(file, "  \"warmup_frames\": %u,\n", BENCHMARK_WARMUP_FRAMES);
+    fprintf(file, "  \"frames\": %u,\n", benchmarkCpuSampleCount);
+    fprintf(file, "  \"elapsed_ms\": %.3f,\n", elapsedMs);
+    fprintf(file, "  \"fps\": %.2f,\n", elapsedMs > 0.0 ? benchmarkCpuSampleCount * 1000.0 / elapsedMs : 0.0);
+    writeFrameTimeSummary(file, "cpu_frame_time", &cpuSummary, QQ_FALSE);
+    writeFrameTimeSummary(file, "gpu_frame_time", &gpuSummary, QQ_FALSE);
+
+    // Draws never waited for the render thread to compile, skipped ones are the only visible cost
+    const PipelineCompileStats* pipelineStats = &pipelineCompileStats;
+    fprintf(
+        file,
+        "  \"pipelines\": {\"async\": %s, \"compiled\": %lu, \"failed\": %lu, \"avg_compile_ms\": %.4f, \"max_compile_ms\": %.4f, "
+        "\"avg_latency_ms\": %.4f, \"max_latency_ms\": %.4f, \"max_queue_depth\": %u, \"fallback_draws\": %lu, \"skipped_draws\": %lu},\n",
+        asyncPipelinesEnabled == QQ_TRUE ? "true" : "false",
+        pipelineStats->compiledCount,
+        pipelineStats->failedCount,
+        pipelineStats->compiledCount != 0 ? pipelineStats->totalCompileMs / (f64)pipelineStats->compiledCount : 0.0,
+        pipelineStats->maxCompileMs,
+        pipelineStats->compiledCount != 0 ? pipelineStats->totalLatencyMs / (f64)pipelineStats->compiledCount : 0.0,
+        pipelineStats->maxLatencyMs,
+        pipelineStats->maxQueueDepth,
+        pipelineStats->fallbackDrawCount,
+        pipelineStats->skippedDrawCount
+    );
+    fprintf(file, "  \"gpu_scopes\": ");
+    writeGpuProfileScopes(file);
+    fprintf(file, "\n");
+    fprintf(file, "}\n");
+
+    if (file != stdout) {
+        fclose(file);
+        logInfo("[BENCH] Report written into %s", benchmarkOutputPath);
     }
+}
 
+// Hands rendered swapchain image to presentation engine
+void presentFrame(u32 imageIndex, f64 inputTimeMs) {
     // Swapchains to put images into
     VkSwapchainKHR swapChains[] = {swapchain};
 
+    // Ids of presented frames are waited for latency measurement
+    presentId += 1;
+    VkPresentIdKHR presentIdInfo = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &presentId
+    };
+
     // Configure presentation
     VkPresentInfoKHR presentInfo = {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+        .pNext = isPresentWaitSupported == QQ_TRUE ? &presentIdInfo : NULL,
 
         // Define semaphores to wait
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores = signalSemaphores,
+        .pWaitSemaphores = &renderFinishedSemaphores[currentFrame],
 
         // Sets swapchain
         .swapchainCount = 1,
@@ -2988,6 +8160,9 @@ void drawFrame() {
 
     // Queue presentation
     VkResult presentResult = vkQueuePresentKHR(presentQueue, &presentInfo);
+    if (isPresentWaitSupported == QQ_TRUE && (presentResult == VK_SUCCESS || presentResult == VK_SUBOPTIMAL_KHR)) {
+        trackPresentedFrame(presentId, inputTimeMs);
+    }
 
     // Recreate chain if image is suboptimal
     if (
@@ -2998,60 +8173,700 @@ void drawFrame() {
         framebufferResized = QQ_FALSE;
         recreateSwapchain();
     } else if (presentResult != VK_SUCCESS) {
-        printf("[ERROR] Failed to present swap chain data\n");
+        logError("Failed to present swap chain data");
+    }
+}
+
+void drawFrame() {
+    u64 frameStart = traceBegin();
+
+    // Wait for the previous frame of this slot to be finished
+    u64 phaseStart = traceBegin();
+    waitTimelineValue(frameTimelineValues[currentFrame], HOST_WAIT_FRAME_SLOT);
+    traceEnd("wait frame slot", phaseStart);
+
+    // Without present wait GPU finish is the closest measurable point (timeline may have
+    // been reached earlier, so this is an upper bound)
+    if (isPresentWaitSupported == QQ_TRUE) {
+        pollPresentedFrames();
+    } else if (frameInputTimesMs[currentFrame] > 0.0) {
+        recordFrameLatency(getTimeMs() - frameInputTimesMs[currentFrame]);
+        frameInputTimesMs[currentFrame] = 0.0;
+    }
+
+    collectGpuProfile(currentFrame);
+
+    // Sample animation time once, so culling and rendering agree
+    // Benchmark simulates fixed steps, so every run renders the same frames
+    if (benchmarkEnabled == QQ_TRUE) {
+        currentFrameTime = submittedFrameCount * BENCHMARK_TIMESTEP_SECONDS;
+        updateBenchmarkCamera();
+    } else {
+        currentFrameTime = getApplicationTime();
+    }
+
+    // Cull on worker thread, while waiting for the swapchain image
+    kickOcclusionCulling();
+
+    // Headless frame slot owns its offscreen image, windowed one acquires from swap chain
+    u32 imageIndex = currentFrame;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    if (headlessEnabled == QQ_FALSE) {
+        imageAvailableSemaphore = imageAvailableSemaphores[currentFrame];
+        renderFinishedSemaphore = renderFinishedSemaphores[currentFrame];
+
+        phaseStart = traceBegin();
+        VkResult acquireResult = vkAcquireNextImageKHR(
+            // Device and swap chain to aquire image from
+            logicalDevice,
+            swapchain,
+
+            // Timeout for image to become available (nanoseconds)
+            // "max" value disables timeout
+            U64_MAX,
+
+            // Objects to signal when image will become available
+            imageAvailableSemaphore,
+            VK_NULL_HANDLE,
+
+            // Available image index (in swaphChainImages)
+            &imageIndex
+        );
+        traceEnd("acquire", phaseStart);
+
+        // Determine if swapchain needs to be recreated, based on result of image acquiring
+        if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR) {
+            occlusionCullerWait(&occlusionCuller, &jobPool);
+            recreateSwapchain();
+            traceEnd("drawFrame", frameStart);
+            return;
+        } else if (acquireResult != VK_SUCCESS) {
+            logError("Failed to acquire swap chain image!");
+        }
+    }
+
+    // Command buffer of the image may still be used by older frame of other slot
+    phaseStart = traceBegin();
+    waitTimelineValue(imageTimelineValues[imageIndex], HOST_WAIT_SWAPCHAIN_IMAGE);
+    traceEnd("wait image", phaseStart);
+
+    phaseStart = traceBegin();
+    updateTextureResidency(currentFrame);
+    updateVirtualTextures(currentFrame);
+    traceEnd("texture residency", phaseStart);
+
+    // Visibility is required to record draws
+    phaseStart = traceBegin();
+    occlusionCullerWait(&occlusionCuller, &jobPool);
+    traceEnd("wait culling", phaseStart);
+
+    phaseStart = traceBegin();
+    recordCommandBuffer(imageIndex);
+    traceEnd("record", phaseStart);
+
+    // Camera goes in as late as possible, with input polled right before it
+    phaseStart = traceBegin();
+    if (headlessEnabled == QQ_FALSE) {
+        glfwPollEvents();
+    }
+    f64 inputTimeMs = getTimeMs();
+    updateUniformBuffer(currentFrame);
+    traceEnd("update uniforms", phaseStart);
+
+    // Rendering waits for the image only at color output, signals present and the timeline
+    phaseStart = traceBegin();
+    u64 frameValue = submitGraphicsCommands(
+        commandBuffers[imageIndex],
+        imageAvailableSemaphore,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        renderFinishedSemaphore
+    );
+    traceEnd("submit", phaseStart);
+    frameTimelineValues[currentFrame] = frameValue;
+    imageTimelineValues[imageIndex] = frameValue;
+
+    frameInputTimesMs[currentFrame] = inputTimeMs;
+    submittedFrameCount += 1;
+
+    // Offscreen image stays in place, there is nothing to present
+    if (headlessEnabled == QQ_FALSE) {
+        phaseStart = traceBegin();
+        presentFrame(imageIndex, inputTimeMs);
+        traceEnd("present", phaseStart);
     }
 
     // Update current frame sepahore index
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % framesInFlight;
+    traceEnd("drawFrame", frameStart);
 }
 
 void framebufferResizeCallback(GLFWwindow* window, int width, int height) {
     framebufferResized = QQ_TRUE;
 }
 
-int main(int argc, const char **argv) {
+// First call starts recording, second one writes the trace and stops
+void toggleTraceCapture() {
+    const char* path = traceOutputPath != NULL ? traceOutputPath : TRACE_DEFAULT_OUTPUT_PATH;
+    if (traceIsEnabled() == QQ_FALSE) {
+        traceSetEnabled(QQ_TRUE);
+        logInfo("[TRACE] Recording, press F6 again to write %s", path);
+        return;
+    }
 
-    // Init GLFW
-    glfwInit();
+    traceSetEnabled(QQ_FALSE);
+    if (traceWriteFile(path) == QQ_TRUE) {
+        logInfo("[TRACE] Trace written into %s", path);
+    } else {
+        logError("Failed to write trace: %s", path);
+    }
+}
 
-    // Window hints
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS) {
+        return;
+    }
 
-    // Create GLFW window
-    window = glfwCreateWindow(
-        WINDOW_WIDTH,
-        WINDOW_HEIGHT,
-        "qq",
-        NULL,
-        NULL
+    // Command buffers are recorded every frame, so toggle applies to the next one
+    if (key == GLFW_KEY_F2) {
+        depthPrepassEnabled = !depthPrepassEnabled;
+        logInfo("[RUNTIME] Depth pre-pass: %s", depthPrepassEnabled ? "on" : "off");
+    }
+
+    if (key == GLFW_KEY_F3) {
+        printRenderQueueStats();
+        printTextureStreamingStats();
+        printVirtualTextureStats();
+        printFrameStats(lastFrameStats.frameCount > 0 ? &lastFrameStats : &frameStats);
+        printHostWaitStats();
+        printGpuProfile();
+        printPipelineCompileStats();
+    }
+
+    if (key == GLFW_KEY_F5) {
+        writeGpuProfile(gpuProfileOutputPath != NULL ? gpuProfileOutputPath : GPU_PROFILE_DEFAULT_OUTPUT_PATH);
+    }
+
+    if (key == GLFW_KEY_F6) {
+        toggleTraceCapture();
+    }
+
+    if (key == GLFW_KEY_F4) {
+        cycleMeshMaterial();
+    }
+}
+
+// Sorts randomly generated draw keys, reports average and best time
+void benchmarkRenderQueue() {
+    u32 drawCount = RENDER_QUEUE_BENCHMARK_DRAW_COUNT;
+    u32 iterationCount = 20;
+
+    RenderQueueEntry* keys = malloc(sizeof(RenderQueueEntry) * drawCount);
+    RenderQueueEntry* entries = malloc(sizeof(RenderQueueEntry) * drawCount);
+    RenderQueueEntry* scratch = malloc(sizeof(RenderQueueEntry) * drawCount);
+
+    // Realistic distribution: few passes and pipelines, more materials and meshes
+    srand(1);
+    for (u32 i = 0; i < drawCount; i++) {
+        keys[i].key = renderQueueMakeKey(
+            rand() % 2,
+            rand() % 16,
+            rand() % 256,
+            rand() % 1024,
+            (f32)rand() / (f32)RAND_MAX
+        );
+        keys[i].drawIndex = i;
+    }
+
+    f64 totalTimeMs = 0.0;
+    f64 bestTimeMs = 0.0;
+    for (u32 iteration = 0; iteration < iterationCount; iteration++) {
+        memcpy(entries, keys, sizeof(RenderQueueEntry) * drawCount);
+
+        f64 startTime = getTimeMs();
+        renderQueueRadixSort(entries, scratch, drawCount);
+        f64 timeMs = getTimeMs() - startTime;
+
+        totalTimeMs += timeMs;
+        if (iteration == 0 || timeMs < bestTimeMs) {
+            bestTimeMs = timeMs;
+        }
+    }
+
+    // Make sure sort did its job
+    for (u32 i = 1; i < drawCount; i++) {
+        if (entries[i - 1].key > entries[i].key) {
+            logError("Render queue is not sorted at %u", i);
+            break;
+        }
+    }
+
+    logInfo(
+        "[RENDER QUEUE] Sorted %u draws | avg: %f ms | best: %f ms",
+        drawCount,
+        totalTimeMs / (f64)iterationCount,
+        bestTimeMs
+    );
+
+    free(scratch);
+    free(entries);
+    free(keys);
+}
+
+// Culls synthetic scene with orbiting camera, reports cull rate and time per frame
+void benchmarkOcclusionCulling() {
+    JobPool pool;
+    jobPoolCreate(&pool, 0);
+
+    OcclusionCuller culler;
+    occlusionCullerCreate(&culler, OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+
+    // One unit quad (two triangles) shared by all walls, scaled by their transform
+    f32 quadPositions[4][3] = {
+        {-0.5f, 0.0f, 0.0f},
+        { 0.5f, 0.0f, 0.0f},
+        { 0.5f, 1.0f, 0.0f},
+        {-0.5f, 1.0f, 0.0f}
+    };
+    u32 quadIndices[6] = {0, 1, 2, 0, 2, 3};
+
+    // Walls on an 8x8 grid, rotated randomly around up axis
+    srand(1);
+    u32 gridSize = 8;
+    for (u32 i = 0; i < OCCLUSION_BENCHMARK_OCCLUDER_COUNT; i++) {
+        OcclusionMesh mesh = {
+            .positions = &quadPositions[0][0],
+            .positionStride = sizeof(f32) * 3,
+            .vertexCount = 4,
+            .indices = quadIndices,
+            .indexCount = 6
+        };
+        mat4 model = GLM_MAT4_IDENTITY_INIT;
+        glm_translate(model, (vec3){
+            ((f32)(i % gridSize) - (f32)gridSize * 0.5f) * 8.0f,
+            0.0f,
+            ((f32)(i / gridSize) - (f32)gridSize * 0.5f) * 8.0f
+        });
+        glm_rotate_y(model, (f32)rand() / (f32)RAND_MAX * 3.14159f, model);
+        glm_scale(model, (vec3){6.0f, 4.0f, 1.0f});
+        memcpy(mesh.model, model, sizeof(mesh.model));
+        occlusionCullerAddOccluder(&culler, &mesh);
+    }
+
+    // Small boxes anywhere within the grid
+    for (u32 i = 0; i < OCCLUSION_BENCHMARK_OBJECT_COUNT; i++) {
+        f32 x = ((f32)rand() / (f32)RAND_MAX - 0.5f) * 64.0f;
+        f32 z = ((f32)rand() / (f32)RAND_MAX - 0.5f) * 64.0f;
+        OcclusionBounds bounds = {
+            .min = {x - 0.5f, 0.0f, z - 0.5f},
+            .max = {x + 0.5f, 1.0f, z + 0.5f}
+        };
+        occlusionCullerAddObject(&culler, &bounds);
+    }
+
+    f64 bestTimeMs = 0.0;
+    for (u32 frame = 0; frame < OCCLUSION_BENCHMARK_FRAMES; frame++) {
+        f32 angle = (f32)frame / (f32)OCCLUSION_BENCHMARK_FRAMES * 6.28318f;
+        mat4 view, projection, viewProjection;
+        glm_lookat((vec3){cosf(angle) * 40.0f, 1.7f, sinf(angle) * 40.0f}, (vec3){0.0f, 1.0f, 0.0f}, (vec3){0.0f, 1.0f, 0.0f}, view);
+        glm_perspective(0.785398f, (f32)OCCLUSION_BUFFER_WIDTH / (f32)OCCLUSION_BUFFER_HEIGHT, 0.1f, 200.0f, projection);
+        glm_mat4_mul(projection, view, viewProjection);
+
+        occlusionCullerKick(&culler, &pool, (f32*)viewProjection);
+        occlusionCullerWait(&culler, &pool);
+        if (frame == 0 || culler.lastTimeMs < bestTimeMs) {
+            bestTimeMs = culler.lastTimeMs;
+        }
+    }
+
+    logInfo(
+        "[OCCLUSION] %u occluders, %u objects, %lu frames | culled: %.1f%% | avg: %f ms/frame | best: %f ms",
+        OCCLUSION_BENCHMARK_OCCLUDER_COUNT,
+        OCCLUSION_BENCHMARK_OBJECT_COUNT,
+        culler.totalPasses,
+        culler.totalTested != 0 ? 100.0 * (f64)culler.totalCulled / (f64)culler.totalTested : 0.0,
+        culler.totalTimeMs / (f64)culler.totalPasses,
+        bestTimeMs
+    );
+
+    occlusionCullerDestroy(&culler);
+    jobPoolDestroy(&pool);
+}
+
+// Writes last headless frame as binary PPM, image is in transfer source layout after render pass
+void captureHeadlessFrame(const char* path) {
+    u32 imageIndex = (currentFrame + framesInFlight - 1) % framesInFlight;
+    VkDeviceSize size = (VkDeviceSize)headlessWidth * headlessHeight * 4;
+
+    VkBuffer readbackBuffer;
+    VkDeviceMemory readbackBufferMemory;
+    createBuffer(
+        size,
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &readbackBuffer,
+        &readbackBufferMemory
+    );
+
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    VkBufferImageCopy region = {
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageExtent = {headlessWidth, headlessHeight, 1}
+    };
+    vkCmdCopyImageToBuffer(commandBuffer, swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+    // Copy must be visible to host reads of the mapped buffer
+    VkBufferMemoryBarrier readbackBarrier = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer = readbackBuffer,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE
+    };
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, NULL,
+        1, &readbackBarrier,
+        0, NULL
     );
-    glfwSetFramebufferSizeCallback(window, &framebufferResizeCallback);
+    endSingleTimeCommands(commandBuffer);
+
+    u8* pixels;
+    vkMapMemory(logicalDevice, readbackBufferMemory, 0, size, 0, (void**)&pixels);
+
+    // Texels are already sRGB encoded, alpha is dropped
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        logError("Failed to open capture file: %s", path);
+    } else {
+        fprintf(file, "P6\n%u %u\n255\n", headlessWidth, headlessHeight);
+        u8* row = (u8*)malloc((size_t)headlessWidth * 3);
+        for (u32 y = 0; y < headlessHeight; y++) {
+            for (u32 x = 0; x < headlessWidth; x++) {
+                memcpy(&row[x * 3], &pixels[((VkDeviceSize)y * headlessWidth + x) * 4], 3);
+            }
+            fwrite(row, 1, (size_t)headlessWidth * 3, file);
+        }
+        free(row);
+        fclose(file);
+        logInfo("[HEADLESS] Captured frame into %s", path);
+    }
+
+    vkUnmapMemory(logicalDevice, readbackBufferMemory);
+    vkDestroyBuffer(logicalDevice, readbackBuffer, NULL);
+    vkFreeMemory(logicalDevice, readbackBufferMemory, NULL);
+}
+
+// Main loop runs till window is closed, exit is requested or headless frames are done
+b32 isApplicationRunning() {
+    if (isExitRequested == QQ_TRUE) {
+        return QQ_FALSE;
+    }
+    if (benchmarkEnabled == QQ_TRUE) {
+        return submittedFrameCount < BENCHMARK_WARMUP_FRAMES + benchmarkFrameCount;
+    }
+    if (headlessEnabled == QQ_TRUE) {
+        return submittedFrameCount < headlessFrameCount;
+    }
+    return !glfwWindowShouldClose(window);
+}
+
+void startStartupTasks() {
+    modelLoadTask = (StartupTask){.name = "load model", .function = &loadModelJob};
+    meshTextureTask = (StartupTask){.name = "decode mesh texture", .function = &decodeMeshTextureJob};
+    shaderReadTask = (StartupTask){.name = "read shaders", .function = &readStartupShadersJob};
+
+    // Serial startup runs every task when it is first needed, for comparison
+    if (serialStartupEnabled == QQ_TRUE) {
+        return;
+    }
+    startStartupTask(&modelLoadTask);
+    startStartupTask(&meshTextureTask);
+    startStartupTask(&shaderReadTask);
+}
+
+// Time to first frame per stage, tasks show how much of their run main thread waited for
+void printStartupReport() {
+    logInfo("[STARTUP] %s startup stages:", serialStartupEnabled == QQ_TRUE ? "Serial" : "Parallel");
+    for (u32 i = 0; i < startupStageCount; i++) {
+        logInfo("[STARTUP]   %-30s %8.2f ms", startupStages[i].name, startupStages[i].durationMs);
+    }
+
+    StartupTask* tasks[] = {&modelLoadTask, &meshTextureTask, &shaderReadTask};
+    for (u32 i = 0; i < sizeof(tasks) / sizeof(tasks[0]); i++) {
+        logInfo(
+            "[STARTUP]   task %-25s %8.2f ms on %s, main thread waited %.2f ms",
+            tasks[i]->name,
+            tasks[i]->runTimeMs,
+            tasks[i]->isSubmitted == QQ_TRUE ? "worker" : "main thread",
+            tasks[i]->waitTimeMs
+        );
+    }
+}
+
+int main(int argc, const char **argv) {
+    applicationStartTime = getTimeMs();
+    traceInit();
+    traceSetThreadName("main");
+
+    // Parse command line options
+    for (i32 i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--depth-prepass") == 0) {
+            depthPrepassEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--load-textures") == 0 && i + 1 < argc) {
+            textureDirectoryPath = argv[++i];
+        } else if (strcmp(argv[i], "--atlas") == 0 && i + 1 < argc) {
+            atlasDirectoryPath = argv[++i];
+        } else if (strcmp(argv[i], "--virtual-texture") == 0 && i + 1 < argc) {
+            virtualTexturePath = argv[++i];
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            framesInFlight = (u32)atoi(argv[++i]);
+            if (framesInFlight < 1 || framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+                logWarning("Frames in flight must be 1-%u, using 2", MAX_FRAMES_IN_FLIGHT);
+                framesInFlight = 2;
+            }
+        } else if (strcmp(argv[i], "--present-mode") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            isPresentModeRequested = QQ_TRUE;
+            if (strcmp(mode, "immediate") == 0) {
+                requestedPresentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+            } else if (strcmp(mode, "mailbox") == 0) {
+                requestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+            } else if (strcmp(mode, "fifo") == 0) {
+                requestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+            } else if (strcmp(mode, "fifo-relaxed") == 0) {
+                requestedPresentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+            } else {
+                logWarning("Unknown present mode: %s", mode);
+                isPresentModeRequested = QQ_FALSE;
+            }
+        } else if (strcmp(argv[i], "--fps-limit") == 0 && i + 1 < argc) {
+            frameLimitFps = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--frame-stats") == 0) {
+            frameStatsEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headlessEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--headless-size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &headlessWidth, &headlessHeight) != 2 || headlessWidth == 0 || headlessHeight == 0) {
+                logWarning("Headless size must be WxH, using %ux%u", WINDOW_WIDTH, WINDOW_HEIGHT);
+                headlessWidth = WINDOW_WIDTH;
+                headlessHeight = WINDOW_HEIGHT;
+            }
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            headlessFrameCount = (u64)atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            headlessCapturePath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            benchmarkEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--bench-frames") == 0 && i + 1 < argc) {
+            benchmarkFrameCount = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench-output") == 0 && i + 1 < argc) {
+            benchmarkOutputPath = argv[++i];
+        } else if (strcmp(argv[i], "--gpu-profile-output") == 0 && i + 1 < argc) {
+            gpuProfileOutputPath = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceOutputPath = argv[++i];
+            traceSetEnabled(QQ_TRUE);
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            LogLevel level;
+            if (logParseLevel(argv[++i], &level) == QQ_TRUE) {
+                logSetLevel(level);
+            } else {
+                logWarning("Unknown log level: %s (debug, info, warning, error, none)", argv[i]);
+            }
+        } else if (strcmp(argv[i], "--log-file") == 0 && i + 1 < argc) {
+            logFilePath = argv[++i];
+        } else if (strcmp(argv[i], "--serial-startup") == 0) {
+            serialStartupEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--sync-pipelines") == 0) {
+            asyncPipelinesEnabled = QQ_FALSE;
+        } else if (strcmp(argv[i], "--pipeline-cache") == 0 && i + 1 < argc) {
+            pipelineCachePath = argv[++i];
+        } else if (strcmp(argv[i], "--quantized-positions") == 0) {
+            quantizedPositionsEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--shader-feature-mask") == 0 && i + 1 < argc) {
+            shaderFeatureMask = (u32)strtoul(argv[++i], NULL, 16) & SHADER_FEATURE_ALL;
+        } else if (strcmp(argv[i], "--no-texture-streaming") == 0) {
+            textureStreamingEnabled = QQ_FALSE;
+        } else if (strcmp(argv[i], "--bench-mip-generation") == 0) {
+            mipGenerationBenchmarkEnabled = QQ_TRUE;
+        } else if (strcmp(argv[i], "--bench-render-queue") == 0) {
+            benchmarkRenderQueue();
+            return 0;
+        } else if (strcmp(argv[i], "--bench-occlusion") == 0) {
+            benchmarkOcclusionCulling();
+            return 0;
+        } else {
+            logWarning("Unknown option: %s", argv[i]);
+        }
+    }
+
+    // Messages go through background flusher from here on
+    logStart(logFilePath);
+
+    // Start worker threads, assets are read by them while window and device are created
+    jobPoolCreate(&jobPool, 0);
+    jobPoolCreate(&streamingJobPool, 1);
+    jobPoolCreate(&pipelineJobPool, PIPELINE_COMPILE_THREADS);
+    startupStageEndMs = applicationStartTime;
+    startStartupTasks();
+
+    // Headless run needs neither display nor swapchain extension (works on lavapipe)
+    if (headlessEnabled == QQ_TRUE) {
+        requiredVulkanDeviceExtensionCount = 0;
+        logInfo("[HEADLESS] Rendering %lu frames at %ux%u", headlessFrameCount, headlessWidth, headlessHeight);
+    } else {
+        // Init GLFW
+        glfwInit();
+
+        // Window hints
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+
+        // Create GLFW window
+        window = glfwCreateWindow(
+            WINDOW_WIDTH,
+            WINDOW_HEIGHT,
+            "qq",
+            NULL,
+            NULL
+        );
+        glfwSetFramebufferSizeCallback(window, &framebufferResizeCallback);
+        glfwSetKeyCallback(window, &keyCallback);
+    }
+
+    if (benchmarkEnabled == QQ_TRUE) {
+        benchmarkCpuTimesMs = (f64*)malloc(max(benchmarkFrameCount, 1) * sizeof(f64));
+        benchmarkGpuTimesMs = (f64*)malloc(max(benchmarkFrameCount, 1) * sizeof(f64));
+    }
+
+    endStartupStage("init window", 0);
 
     // Init vulkan
     initVulkan();
 
+    // Benchmark needs the device only, application exits right after it
+    if (mipGenerationBenchmarkEnabled == QQ_TRUE) {
+        benchmarkMipGeneration();
+        isExitRequested = QQ_TRUE;
+    }
+
     // Main loop
-    f64 lastFrameTime = glfwGetTime();
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
+    f64 lastFrameTime = getApplicationTime();
+    frameStats.startTimeMs = getTimeMs();
+    nextFrameStartMs = frameStats.startTimeMs;
+
+    // Frame stats restart every interval, headless summary covers the whole run
+    f64 headlessStartTimeMs = frameStats.startTimeMs;
+    while (isApplicationRunning() == QQ_TRUE) {
+        f64 iterationStartMs = getTimeMs();
+        u64 frameIndex = submittedFrameCount;
+        if (benchmarkEnabled == QQ_TRUE && frameIndex == BENCHMARK_WARMUP_FRAMES && benchmarkCpuSampleCount == 0) {
+            benchmarkStartTimeMs = iterationStartMs;
+        }
+
+        if (headlessEnabled == QQ_FALSE) {
+            glfwPollEvents();
+        }
+        u64 traceStart = traceBegin();
+        updateTextureStreams();
+        updateTextureLoads();
+        traceEnd("texture loading", traceStart);
         drawFrame();
-        frameDeltaTime = glfwGetTime() - lastFrameTime;
-        // printf("[RENDER] %f FPS (took: %f sec)\n", (1.0f/frameDeltaTime), frameDeltaTime);
-        lastFrameTime = glfwGetTime();
+
+        // CPU frame time excludes limiter sleep, frames which were not submitted are not counted
+        if (
+            benchmarkEnabled == QQ_TRUE
+            && submittedFrameCount > frameIndex
+            && frameIndex >= BENCHMARK_WARMUP_FRAMES
+        ) {
+            benchmarkCpuTimesMs[benchmarkCpuSampleCount++] = getTimeMs() - iterationStartMs;
+        }
+
+        // Startup ends when the first frame is handed to presentation
+        if (isFirstFramePresented == QQ_FALSE) {
+            isFirstFramePresented = QQ_TRUE;
+            logInfo(
+                "[STARTUP] First frame after %.2f ms (texture staging peak: %lu KiB)",
+                getTimeMs() - applicationStartTime,
+                textureStagingPeakBytes / 1024
+            );
+            endStartupStage("first frame", 0);
+            printStartupReport();
+        }
+        f64 frameTime = getApplicationTime();
+        frameDeltaTime = frameTime - lastFrameTime;
+        lastFrameTime = frameTime;
+        traceStart = traceBegin();
+        updateFramePacing(frameDeltaTime * 1000.0);
+        traceEnd("frame pacing", traceStart);
     }
 
     // Wait till device finished
     vkDeviceWaitIdle(logicalDevice);
 
+    // Last frames of every slot are finished now, measured time includes them
+    if (benchmarkEnabled == QQ_TRUE && isExitRequested == QQ_FALSE) {
+        f64 elapsedMs = getTimeMs() - benchmarkStartTimeMs;
+        for (u32 i = 0; i < framesInFlight; i++) {
+            collectGpuProfile(i);
+        }
+        writeBenchmarkReport(elapsedMs);
+    }
+    if (gpuProfileOutputPath != NULL) {
+        writeGpuProfile(gpuProfileOutputPath);
+    }
+    free(benchmarkCpuTimesMs);
+    free(benchmarkGpuTimesMs);
+
+    if (headlessEnabled == QQ_TRUE && submittedFrameCount > 0) {
+        f64 elapsedMs = getTimeMs() - headlessStartTimeMs;
+        logInfo(
+            "[HEADLESS] %lu frames at %ux%u in %.2f ms (%.1f FPS)",
+            submittedFrameCount,
+            headlessWidth,
+            headlessHeight,
+            elapsedMs,
+            submittedFrameCount * 1000.0 / elapsedMs
+        );
+        if (headlessCapturePath != NULL) {
+            captureHeadlessFrame(headlessCapturePath);
+        }
+    }
+
     // Shutdown vulkan
     shutdownVulkan();
 
-    // Destroy GLFW window
-    glfwDestroyWindow(window);
+    // Stop worker threads
+    jobPoolDestroy(&pipelineJobPool);
+    jobPoolDestroy(&streamingJobPool);
+    jobPoolDestroy(&jobPool);
+
+    // Rings of worker threads outlive them, so trace is written after they are joined
+    if (traceIsEnabled() == QQ_TRUE && traceOutputPath != NULL) {
+        if (traceWriteFile(traceOutputPath) == QQ_TRUE) {
+            logInfo("[TRACE] Trace written into %s", traceOutputPath);
+        } else {
+            logError("Failed to write trace: %s", traceOutputPath);
+        }
+    }
+    traceShutdown();
+
+    if (headlessEnabled == QQ_FALSE) {
+        // Destroy GLFW window
+        glfwDestroyWindow(window);
+
+        // Stop GLFW
+        glfwTerminate();
+    }
 
-    // Stop GLFW
-    glfwTerminate();
+    logStop();
 
     return 0;
 }
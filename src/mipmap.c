@@ -0,0 +1,219 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <mipmap.h>
+
+// Linear values are quantized to this many steps before sRGB encoding,
+// enough to keep the result within one code of the exact curve
+#define MIPMAP_LINEAR_STEPS 4096
+
+// Conversion tables shared by all callers, built once
+static f32 srgbToLinearTable[256];
+static f32 unormToLinearTable[256];
+static u8 linearToSrgbTable[MIPMAP_LINEAR_STEPS];
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT;
+
+static f32 srgbToLinear(f32 value) {
+    if (value <= 0.04045f) {
+        return value / 12.92f;
+    }
+    return powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static f32 linearToSrgb(f32 value) {
+    if (value <= 0.0031308f) {
+        return value * 12.92f;
+    }
+    return 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+static void buildTables() {
+    for (u32 i = 0; i < 256; i++) {
+        srgbToLinearTable[i] = srgbToLinear((f32)i / 255.0f);
+        unormToLinearTable[i] = (f32)i / 255.0f;
+    }
+    for (u32 i = 0; i < MIPMAP_LINEAR_STEPS; i++) {
+        f32 value = linearToSrgb((f32)i / (f32)(MIPMAP_LINEAR_STEPS - 1));
+        linearToSrgbTable[i] = (u8)(value * 255.0f + 0.5f);
+    }
+}
+
+u32 mipmapGetLevelCount(u32 width, u32 height) {
+    u32 size = width > height ? width : height;
+    u32 levelCount = 1;
+    while (size > 1) {
+        size >>= 1;
+        levelCount += 1;
+    }
+    return levelCount;
+}
+
+u32 mipmapGetLevelDimension(u32 baseDimension, u32 level) {
+    u32 dimension = baseDimension >> level;
+    return dimension != 0 ? dimension : 1;
+}
+
+// Expands RGBA8 row into linear floats (alpha is always linear)
+static void expandRow(const u8* source, u32 width, f32* row) {
+    for (u32 x = 0; x < width; x++) {
+        row[x * 4 + 0] = srgbToLinearTable[source[x * 4 + 0]];
+        row[x * 4 + 1] = srgbToLinearTable[source[x * 4 + 1]];
+        row[x * 4 + 2] = srgbToLinearTable[source[x * 4 + 2]];
+        row[x * 4 + 3] = unormToLinearTable[source[x * 4 + 3]];
+    }
+}
+
+// Linear images are averaged exactly in integers, no conversion needed
+static void downsampleUnorm(
+    const u8* source,
+    u32 width,
+    u32 height,
+    u8* destination,
+    u32 destinationWidth,
+    u32 destinationHeight
+) {
+    for (u32 y = 0; y < destinationHeight; y++) {
+        u32 sourceY0 = y * 2;
+        u32 sourceY1 = sourceY0 + 1 < height ? sourceY0 + 1 : sourceY0;
+        const u8* row0 = &source[(u64)sourceY0 * width * 4];
+        const u8* row1 = &source[(u64)sourceY1 * width * 4];
+        u8* output = &destination[(u64)y * destinationWidth * 4];
+
+        u32 x = 0;
+#if defined(__SSE2__)
+        // Two output texels from 4x2 source texels per iteration (needs width >= 2)
+        if (width >= 2) {
+            __m128i zero = _mm_setzero_si128();
+            __m128i rounding = _mm_set1_epi16(2);
+            for (; x + 1 < destinationWidth; x += 2) {
+                __m128i top = _mm_loadu_si128((const __m128i*)&row0[x * 8]);
+                __m128i bottom = _mm_loadu_si128((const __m128i*)&row1[x * 8]);
+
+                // Vertical sums as 16 bit lanes, texels 0-1 and 2-3
+                __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+                __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+
+                // Horizontal sums pair even and odd texels
+                __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+                __m128i average = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+                _mm_storel_epi64((__m128i*)&output[x * 4], _mm_packus_epi16(average, average));
+            }
+        }
+#endif
+        for (; x < destinationWidth; x++) {
+            u32 sourceX0 = x * 2;
+            u32 sourceX1 = sourceX0 + 1 < width ? sourceX0 + 1 : sourceX0;
+            for (u32 c = 0; c < 4; c++) {
+                u32 sum = row0[sourceX0 * 4 + c] + row0[sourceX1 * 4 + c]
+                    + row1[sourceX0 * 4 + c] + row1[sourceX1 * 4 + c];
+                output[x * 4 + c] = (u8)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// sRGB color is averaged in linear space and encoded back through table
+static void downsampleSrgb(
+    const u8* source,
+    u32 width,
+    u32 height,
+    u8* destination,
+    u32 destinationWidth,
+    u32 destinationHeight
+) {
+    // Two expanded source rows, each texel is 4 floats
+    f32* rows = malloc(sizeof(f32) * width * 4 * 2);
+    f32* row0 = rows;
+    f32* row1 = rows + width * 4;
+
+    for (u32 y = 0; y < destinationHeight; y++) {
+        // 1 texel high/wide sources reuse the same row/column
+        u32 sourceY0 = y * 2;
+        u32 sourceY1 = sourceY0 + 1 < height ? sourceY0 + 1 : sourceY0;
+        expandRow(&source[(u64)sourceY0 * width * 4], width, row0);
+        expandRow(&source[(u64)sourceY1 * width * 4], width, row1);
+
+        u8* output = &destination[(u64)y * destinationWidth * 4];
+        for (u32 x = 0; x < destinationWidth; x++) {
+            u32 sourceX0 = x * 2;
+            u32 sourceX1 = sourceX0 + 1 < width ? sourceX0 + 1 : sourceX0;
+
+#if defined(__SSE2__)
+            // Whole RGBA texel is averaged in one register
+            __m128 sum = _mm_add_ps(
+                _mm_add_ps(_mm_loadu_ps(&row0[sourceX0 * 4]), _mm_loadu_ps(&row0[sourceX1 * 4])),
+                _mm_add_ps(_mm_loadu_ps(&row1[sourceX0 * 4]), _mm_loadu_ps(&row1[sourceX1 * 4]))
+            );
+            __m128 average = _mm_mul_ps(sum, _mm_set1_ps(0.25f));
+            average = _mm_min_ps(_mm_max_ps(average, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+            // Color goes through sRGB table index, alpha directly to 8 bits
+            __m128 scale = _mm_set_ps(255.0f, MIPMAP_LINEAR_STEPS - 1, MIPMAP_LINEAR_STEPS - 1, MIPMAP_LINEAR_STEPS - 1);
+            i32 values[4];
+            _mm_storeu_si128((__m128i*)values, _mm_cvtps_epi32(_mm_mul_ps(average, scale)));
+
+            output[x * 4 + 0] = linearToSrgbTable[values[0]];
+            output[x * 4 + 1] = linearToSrgbTable[values[1]];
+            output[x * 4 + 2] = linearToSrgbTable[values[2]];
+            output[x * 4 + 3] = (u8)values[3];
+#else
+            for (u32 c = 0; c < 4; c++) {
+                f32 average = (row0[sourceX0 * 4 + c] + row0[sourceX1 * 4 + c]
+                    + row1[sourceX0 * 4 + c] + row1[sourceX1 * 4 + c]) * 0.25f;
+                average = average < 0.0f ? 0.0f : (average > 1.0f ? 1.0f : average);
+
+                if (c < 3) {
+                    output[x * 4 + c] = linearToSrgbTable[(u32)(average * (f32)(MIPMAP_LINEAR_STEPS - 1) + 0.5f)];
+                } else {
+                    output[x * 4 + c] = (u8)(average * 255.0f + 0.5f);
+                }
+            }
+#endif
+        }
+    }
+
+    free(rows);
+}
+
+void mipmapDownsample(const u8* source, u32 width, u32 height, u8* destination, b32 isSrgb) {
+    u32 destinationWidth = mipmapGetLevelDimension(width, 1);
+    u32 destinationHeight = mipmapGetLevelDimension(height, 1);
+
+    if (isSrgb == QQ_TRUE) {
+        pthread_once(&tablesOnce, &buildTables);
+        downsampleSrgb(source, width, height, destination, destinationWidth, destinationHeight);
+    } else {
+        downsampleUnorm(source, width, height, destination, destinationWidth, destinationHeight);
+    }
+}
+
+void mipmapGenerateChain(const u8* base, u32 width, u32 height, u32 levelCount, u8* chain, b32 isSrgb) {
+    u64 baseSize = (u64)width * height * 4;
+    if (chain != base) {
+        memcpy(chain, base, baseSize);
+    }
+
+    // Every level is filtered from the previous one, right after it in memory
+    u8* previous = chain;
+    for (u32 level = 1; level < levelCount; level++) {
+        u32 previousWidth = mipmapGetLevelDimension(width, level - 1);
+        u32 previousHeight = mipmapGetLevelDimension(height, level - 1);
+        u8* current = previous + (u64)previousWidth * previousHeight * 4;
+        mipmapDownsample(previous, previousWidth, previousHeight, current, isSrgb);
+        previous = current;
+    }
+}
+
+u64 mipmapGetChainSize(u32 width, u32 height, u32 levelCount) {
+    u64 size = 0;
+    for (u32 level = 0; level < levelCount; level++) {
+        size += (u64)mipmapGetLevelDimension(width, level) * mipmapGetLevelDimension(height, level) * 4;
+    }
+    return size;
+}
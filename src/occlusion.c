@@ -0,0 +1,667 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <occlusion.h>
+#include <qq_time.h>
+#include <trace.h>
+
+// Vertices closer than this (in clip space w) are not rasterized
+#define OCCLUSION_NEAR_W 1e-4f
+
+// Registry initial capacity
+#define OCCLUSION_INITIAL_CAPACITY 16
+
+// Triangle prepared for rasterization, edges are E(x,y) = a*x + b*y + c >= 0 inside
+typedef struct {
+    f32 edgeA[3];
+    f32 edgeB[3];
+    f32 edgeC[3];
+
+    // Depth plane z = zA*x + zB*y + zC
+    f32 zA;
+    f32 zB;
+    f32 zC;
+    f32 zMax;
+
+    // Screen space bounds (pixels)
+    f32 minX;
+    f32 minY;
+    f32 maxX;
+    f32 maxY;
+} OcclusionTriangle;
+
+// result = a * b, all column-major
+static void multiplyMatrix(const f32* a, const f32* b, f32* result) {
+    for (u32 column = 0; column < 4; column++) {
+        for (u32 row = 0; row < 4; row++) {
+            f32 sum = 0.0f;
+            for (u32 k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+}
+
+static void transformPoint(const f32* matrix, const f32* point, f32* result) {
+    for (u32 row = 0; row < 4; row++) {
+        result[row] = matrix[0 * 4 + row] * point[0]
+            + matrix[1 * 4 + row] * point[1]
+            + matrix[2 * 4 + row] * point[2]
+            + matrix[3 * 4 + row];
+    }
+}
+
+// Bit mask with bits [first, last] set, empty if range is inverted
+static u32 getSpanMask(i32 first, i32 last) {
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > OCCLUSION_TILE_WIDTH - 1) {
+        last = OCCLUSION_TILE_WIDTH - 1;
+    }
+    if (first > last) {
+        return 0;
+    }
+    return (0xFFFFFFFFu >> (31 - (last - first))) << first;
+}
+
+void occlusionBufferCreate(OcclusionBuffer* buffer, u32 width, u32 height) {
+    buffer->tilesX = (width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH;
+    buffer->tilesY = (height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT;
+    buffer->width = buffer->tilesX * OCCLUSION_TILE_WIDTH;
+    buffer->height = buffer->tilesY * OCCLUSION_TILE_HEIGHT;
+    buffer->tiles = malloc(sizeof(OcclusionTile) * buffer->tilesX * buffer->tilesY);
+
+    occlusionBufferClear(buffer);
+}
+
+void occlusionBufferDestroy(OcclusionBuffer* buffer) {
+    free(buffer->tiles);
+    buffer->tiles = NULL;
+}
+
+void occlusionBufferClear(OcclusionBuffer* buffer) {
+    u32 tileCount = buffer->tilesX * buffer->tilesY;
+    for (u32 i = 0; i < tileCount; i++) {
+        memset(buffer->tiles[i].mask, 0, sizeof(buffer->tiles[i].mask));
+        buffer->tiles[i].zMax0 = 1.0f;
+        buffer->tiles[i].zMax1 = 0.0f;
+    }
+}
+
+// Projects clip space vertices and builds edge equations, returns QQ_FALSE if nothing to draw
+static b32 setupTriangle(
+    const OcclusionBuffer* buffer,
+    const f32* clip0,
+    const f32* clip1,
+    const f32* clip2,
+    OcclusionTriangle* triangle
+) {
+    // Near plane clipping is skipped, dropping an occluder is always conservative
+    if (
+        clip0[3] < OCCLUSION_NEAR_W
+        || clip1[3] < OCCLUSION_NEAR_W
+        || clip2[3] < OCCLUSION_NEAR_W
+    ) {
+        return QQ_FALSE;
+    }
+
+    f32 x[3], y[3], z[3];
+    const f32* clip[3] = { clip0, clip1, clip2 };
+    for (u32 i = 0; i < 3; i++) {
+        f32 inverseW = 1.0f / clip[i][3];
+        x[i] = (clip[i][0] * inverseW * 0.5f + 0.5f) * (f32)buffer->width;
+        y[i] = (clip[i][1] * inverseW * 0.5f + 0.5f) * (f32)buffer->height;
+        z[i] = clip[i][2] * inverseW;
+    }
+
+    // Make winding counter clockwise (both faces occlude)
+    f32 area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (fabsf(area) < 1e-6f) {
+        return QQ_FALSE;
+    }
+    if (area < 0.0f) {
+        f32 tmp;
+        tmp = x[1]; x[1] = x[2]; x[2] = tmp;
+        tmp = y[1]; y[1] = y[2]; y[2] = tmp;
+        tmp = z[1]; z[1] = z[2]; z[2] = tmp;
+        area = -area;
+    }
+
+    triangle->minX = fminf(x[0], fminf(x[1], x[2]));
+    triangle->maxX = fmaxf(x[0], fmaxf(x[1], x[2]));
+    triangle->minY = fminf(y[0], fminf(y[1], y[2]));
+    triangle->maxY = fmaxf(y[0], fmaxf(y[1], y[2]));
+    if (
+        triangle->maxX < 0.0f
+        || triangle->maxY < 0.0f
+        || triangle->minX >= (f32)buffer->width
+        || triangle->minY >= (f32)buffer->height
+    ) {
+        return QQ_FALSE;
+    }
+
+    for (u32 i = 0; i < 3; i++) {
+        u32 j = (i + 1) % 3;
+        triangle->edgeA[i] = y[i] - y[j];
+        triangle->edgeB[i] = x[j] - x[i];
+        triangle->edgeC[i] = -(triangle->edgeA[i] * x[i] + triangle->edgeB[i] * y[i]);
+    }
+
+    // Depth plane from barycentric gradients
+    f32 inverseArea = 1.0f / area;
+    triangle->zA = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inverseArea;
+    triangle->zB = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * inverseArea;
+    triangle->zC = z[0] - triangle->zA * x[0] - triangle->zB * y[0];
+    triangle->zMax = fmaxf(z[0], fmaxf(z[1], z[2]));
+
+    // Entirely beyond far plane
+    if (fminf(z[0], fminf(z[1], z[2])) > 1.0f) {
+        return QQ_FALSE;
+    }
+
+    return QQ_TRUE;
+}
+
+// Computes covered pixel span [first, last] for 4 rows starting at `rowY`
+static void computeRowSpans(
+    const OcclusionTriangle* triangle,
+    u32 rowY,
+    f32 width,
+    i32* first,
+    i32* last
+) {
+#if defined(__SSE2__)
+    // Pixel centers of the 4 rows, one per lane
+    __m128 y = _mm_add_ps(_mm_set1_ps((f32)rowY), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+    __m128 low = _mm_set1_ps(-1.0f);
+    __m128 high = _mm_set1_ps(width);
+
+    for (u32 i = 0; i < 3; i++) {
+        f32 a = triangle->edgeA[i];
+
+        // a*x >= -(b*y + c)
+        __m128 bound = _mm_sub_ps(
+            _mm_setzero_ps(),
+            _mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(triangle->edgeB[i]), y),
+                _mm_set1_ps(triangle->edgeC[i])
+            )
+        );
+
+        if (a > 0.0f) {
+            low = _mm_max_ps(low, _mm_div_ps(bound, _mm_set1_ps(a)));
+        } else if (a < 0.0f) {
+            high = _mm_min_ps(high, _mm_div_ps(bound, _mm_set1_ps(a)));
+        } else {
+            // Horizontal edge, rows are either fully inside or outside
+            __m128 outside = _mm_cmpgt_ps(bound, _mm_setzero_ps());
+            high = _mm_or_ps(
+                _mm_and_ps(outside, _mm_set1_ps(-2.0f)),
+                _mm_andnot_ps(outside, high)
+            );
+        }
+    }
+
+    // Clamp before conversion, so out of range values don't overflow
+    low = _mm_min_ps(_mm_max_ps(low, _mm_set1_ps(-1.0f)), _mm_set1_ps(width));
+    high = _mm_min_ps(_mm_max_ps(high, _mm_set1_ps(-2.0f)), _mm_set1_ps(width));
+
+    // first = ceil(low - 0.5), last = floor(high - 0.5)
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 lowShifted = _mm_sub_ps(low, half);
+    __m128 highShifted = _mm_sub_ps(high, half);
+
+    __m128i lowTruncated = _mm_cvttps_epi32(lowShifted);
+    __m128i highTruncated = _mm_cvttps_epi32(highShifted);
+
+    // Truncation rounds towards zero, fix up negatives for floor and positives for ceil
+    __m128i lowCeil = _mm_sub_epi32(
+        lowTruncated,
+        _mm_castps_si128(_mm_cmplt_ps(_mm_cvtepi32_ps(lowTruncated), lowShifted))
+    );
+    __m128i highFloor = _mm_add_epi32(
+        highTruncated,
+        _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(highTruncated), highShifted))
+    );
+
+    _mm_storeu_si128((__m128i*)first, lowCeil);
+    _mm_storeu_si128((__m128i*)last, highFloor);
+#else
+    for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++) {
+        f32 y = (f32)(rowY + row) + 0.5f;
+        f32 low = -1.0f;
+        f32 high = width;
+
+        for (u32 i = 0; i < 3; i++) {
+            f32 a = triangle->edgeA[i];
+            f32 bound = -(triangle->edgeB[i] * y + triangle->edgeC[i]);
+            if (a > 0.0f) {
+                low = fmaxf(low, bound / a);
+            } else if (a < 0.0f) {
+                high = fminf(high, bound / a);
+            } else if (bound > 0.0f) {
+                high = -2.0f;
+            }
+        }
+
+        low = fminf(fmaxf(low, -1.0f), width);
+        high = fminf(fmaxf(high, -2.0f), width);
+        first[row] = (i32)ceilf(low - 0.5f);
+        last[row] = (i32)floorf(high - 0.5f);
+    }
+#endif
+}
+
+// Merges triangle coverage into tile (two layer depth update)
+static void updateTile(OcclusionTile* tile, const u32* coverage, f32 depth) {
+    // Already behind everything stored in the tile
+    if (depth >= tile->zMax0) {
+        return;
+    }
+
+#if defined(__SSE2__)
+    __m128i newMask = _mm_loadu_si128((const __m128i*)coverage);
+    __m128i oldMask = _mm_loadu_si128((const __m128i*)tile->mask);
+    b32 isWorkingEmpty = _mm_movemask_epi8(
+        _mm_cmpeq_epi32(oldMask, _mm_setzero_si128())
+    ) == 0xFFFF;
+#else
+    b32 isWorkingEmpty = (tile->mask[0] | tile->mask[1] | tile->mask[2] | tile->mask[3]) == 0;
+#endif
+
+    // Drop working layer if new triangle is much closer than its distance to reference
+    if (
+        isWorkingEmpty == QQ_FALSE
+        && (tile->zMax1 - depth) > (tile->zMax0 - tile->zMax1)
+    ) {
+        isWorkingEmpty = QQ_TRUE;
+    }
+
+    if (isWorkingEmpty == QQ_TRUE) {
+        tile->zMax1 = depth;
+#if defined(__SSE2__)
+        oldMask = newMask;
+#else
+        memcpy(tile->mask, coverage, sizeof(tile->mask));
+#endif
+    } else {
+        tile->zMax1 = fmaxf(tile->zMax1, depth);
+#if defined(__SSE2__)
+        oldMask = _mm_or_si128(oldMask, newMask);
+#else
+        for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++) {
+            tile->mask[row] |= coverage[row];
+        }
+#endif
+    }
+
+    // Fully covered working layer becomes new reference layer
+#if defined(__SSE2__)
+    b32 isFull = _mm_movemask_epi8(
+        _mm_cmpeq_epi32(oldMask, _mm_set1_epi32(-1))
+    ) == 0xFFFF;
+    _mm_storeu_si128((__m128i*)tile->mask, isFull ? _mm_setzero_si128() : oldMask);
+#else
+    b32 isFull = (tile->mask[0] & tile->mask[1] & tile->mask[2] & tile->mask[3]) == 0xFFFFFFFFu;
+    if (isFull) {
+        memset(tile->mask, 0, sizeof(tile->mask));
+    }
+#endif
+    if (isFull) {
+        tile->zMax0 = fminf(tile->zMax0, tile->zMax1);
+        tile->zMax1 = 0.0f;
+    }
+}
+
+static void rasterizeTriangle(OcclusionBuffer* buffer, const OcclusionTriangle* triangle) {
+    i32 tileMinX = (i32)fmaxf(triangle->minX, 0.0f) / OCCLUSION_TILE_WIDTH;
+    i32 tileMaxX = (i32)fminf(triangle->maxX, (f32)(buffer->width - 1)) / OCCLUSION_TILE_WIDTH;
+    i32 tileMinY = (i32)fmaxf(triangle->minY, 0.0f) / OCCLUSION_TILE_HEIGHT;
+    i32 tileMaxY = (i32)fminf(triangle->maxY, (f32)(buffer->height - 1)) / OCCLUSION_TILE_HEIGHT;
+
+    for (i32 tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+        u32 rowY = (u32)tileY * OCCLUSION_TILE_HEIGHT;
+
+        // Spans are shared by all tiles of the tile row
+        i32 first[OCCLUSION_TILE_HEIGHT];
+        i32 last[OCCLUSION_TILE_HEIGHT];
+        computeRowSpans(triangle, rowY, (f32)buffer->width, first, last);
+
+        // Vertical range of the tile, clamped to triangle for tighter depth
+        f32 y0 = fmaxf((f32)rowY, triangle->minY);
+        f32 y1 = fminf((f32)(rowY + OCCLUSION_TILE_HEIGHT), triangle->maxY);
+
+        for (i32 tileX = tileMinX; tileX <= tileMaxX; tileX++) {
+            i32 tileStartX = tileX * OCCLUSION_TILE_WIDTH;
+
+            u32 coverage[OCCLUSION_TILE_HEIGHT];
+            u32 anyCoverage = 0;
+            for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++) {
+                coverage[row] = getSpanMask(first[row] - tileStartX, last[row] - tileStartX);
+                anyCoverage |= coverage[row];
+            }
+            if (anyCoverage == 0) {
+                continue;
+            }
+
+            // Conservative (farthest) depth of the triangle inside the tile
+            f32 x0 = fmaxf((f32)tileStartX, triangle->minX);
+            f32 x1 = fminf((f32)(tileStartX + OCCLUSION_TILE_WIDTH), triangle->maxX);
+            f32 depth = fmaxf(
+                fmaxf(
+                    triangle->zA * x0 + triangle->zB * y0,
+                    triangle->zA * x1 + triangle->zB * y0
+                ),
+                fmaxf(
+                    triangle->zA * x0 + triangle->zB * y1,
+                    triangle->zA * x1 + triangle->zB * y1
+                )
+            ) + triangle->zC;
+            depth = fminf(depth, triangle->zMax);
+            depth = fmaxf(depth, 0.0f);
+            if (depth > 1.0f) {
+                continue;
+            }
+
+            updateTile(&buffer->tiles[tileY * buffer->tilesX + tileX], coverage, depth);
+        }
+    }
+}
+
+void occlusionBufferRenderMesh(
+    OcclusionBuffer* buffer,
+    const f32* modelViewProjection,
+    const f32* positions,
+    u32 positionStride,
+    u32 vertexCount,
+    const u32* indices,
+    u32 indexCount
+) {
+    // Transform all vertices once, indices usually reference them multiple times
+    f32* clip = malloc(sizeof(f32) * 4 * vertexCount);
+    for (u32 i = 0; i < vertexCount; i++) {
+        const f32* position = (const f32*)((const u8*)positions + (u64)i * positionStride);
+        transformPoint(modelViewProjection, position, &clip[i * 4]);
+    }
+
+    for (u32 i = 0; i + 2 < indexCount; i += 3) {
+        if (
+            indices[i] >= vertexCount
+            || indices[i + 1] >= vertexCount
+            || indices[i + 2] >= vertexCount
+        ) {
+            continue;
+        }
+
+        OcclusionTriangle triangle;
+        b32 isVisible = setupTriangle(
+            buffer,
+            &clip[indices[i] * 4],
+            &clip[indices[i + 1] * 4],
+            &clip[indices[i + 2] * 4],
+            &triangle
+        );
+        if (isVisible == QQ_TRUE) {
+            rasterizeTriangle(buffer, &triangle);
+        }
+    }
+
+    free(clip);
+}
+
+b32 occlusionBufferTestBounds(
+    const OcclusionBuffer* buffer,
+    const f32* viewProjection,
+    const OcclusionBounds* bounds
+) {
+    f32 minX = (f32)buffer->width;
+    f32 minY = (f32)buffer->height;
+    f32 maxX = 0.0f;
+    f32 maxY = 0.0f;
+    f32 minZ = 1.0f;
+
+    for (u32 i = 0; i < 8; i++) {
+        f32 corner[3] = {
+            (i & 1) ? bounds->max[0] : bounds->min[0],
+            (i & 2) ? bounds->max[1] : bounds->min[1],
+            (i & 4) ? bounds->max[2] : bounds->min[2]
+        };
+        f32 clip[4];
+        transformPoint(viewProjection, corner, clip);
+
+        // Crosses near plane, treat as visible
+        if (clip[3] < OCCLUSION_NEAR_W) {
+            return QQ_TRUE;
+        }
+
+        f32 inverseW = 1.0f / clip[3];
+        f32 x = (clip[0] * inverseW * 0.5f + 0.5f) * (f32)buffer->width;
+        f32 y = (clip[1] * inverseW * 0.5f + 0.5f) * (f32)buffer->height;
+        minX = fminf(minX, x);
+        maxX = fmaxf(maxX, x);
+        minY = fminf(minY, y);
+        maxY = fmaxf(maxY, y);
+        minZ = fminf(minZ, clip[2] * inverseW);
+    }
+
+    // Outside of the view
+    if (
+        maxX < 0.0f
+        || maxY < 0.0f
+        || minX >= (f32)buffer->width
+        || minY >= (f32)buffer->height
+    ) {
+        return QQ_FALSE;
+    }
+    minZ = fmaxf(minZ, 0.0f);
+
+    i32 pixelMinX = (i32)fmaxf(minX, 0.0f);
+    i32 pixelMaxX = (i32)fminf(maxX, (f32)(buffer->width - 1));
+    i32 pixelMinY = (i32)fmaxf(minY, 0.0f);
+    i32 pixelMaxY = (i32)fminf(maxY, (f32)(buffer->height - 1));
+
+    for (i32 tileY = pixelMinY / OCCLUSION_TILE_HEIGHT; tileY <= pixelMaxY / OCCLUSION_TILE_HEIGHT; tileY++) {
+        for (i32 tileX = pixelMinX / OCCLUSION_TILE_WIDTH; tileX <= pixelMaxX / OCCLUSION_TILE_WIDTH; tileX++) {
+            const OcclusionTile* tile = &buffer->tiles[tileY * buffer->tilesX + tileX];
+
+            // Whole tile is farther than the object
+            if (minZ < tile->zMax0 && minZ < tile->zMax1) {
+                return QQ_TRUE;
+            }
+            if (minZ >= tile->zMax0) {
+                continue;
+            }
+
+            // Object is in front of reference layer, but behind working layer,
+            // visible only if it touches pixels not covered by working layer
+            i32 tileStartX = tileX * OCCLUSION_TILE_WIDTH;
+            u32 columnMask = getSpanMask(pixelMinX - tileStartX, pixelMaxX - tileStartX);
+            u32 rowMask[OCCLUSION_TILE_HEIGHT];
+            for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++) {
+                i32 y = tileY * OCCLUSION_TILE_HEIGHT + (i32)row;
+                rowMask[row] = (y >= pixelMinY && y <= pixelMaxY) ? columnMask : 0;
+            }
+
+#if defined(__SSE2__)
+            __m128i uncovered = _mm_andnot_si128(
+                _mm_loadu_si128((const __m128i*)tile->mask),
+                _mm_loadu_si128((const __m128i*)rowMask)
+            );
+            if (_mm_movemask_epi8(_mm_cmpeq_epi32(uncovered, _mm_setzero_si128())) != 0xFFFF) {
+                return QQ_TRUE;
+            }
+#else
+            for (u32 row = 0; row < OCCLUSION_TILE_HEIGHT; row++) {
+                if ((rowMask[row] & ~tile->mask[row]) != 0) {
+                    return QQ_TRUE;
+                }
+            }
+#endif
+        }
+    }
+
+    return QQ_FALSE;
+}
+
+void occlusionTransformBounds(
+    const f32* model,
+    const f32* localMin,
+    const f32* localMax,
+    OcclusionBounds* result
+) {
+    for (u32 axis = 0; axis < 3; axis++) {
+        result->min[axis] = INFINITY;
+        result->max[axis] = -INFINITY;
+    }
+
+    for (u32 i = 0; i < 8; i++) {
+        f32 corner[3] = {
+            (i & 1) ? localMax[0] : localMin[0],
+            (i & 2) ? localMax[1] : localMin[1],
+            (i & 4) ? localMax[2] : localMin[2]
+        };
+        f32 world[4];
+        transformPoint(model, corner, world);
+
+        for (u32 axis = 0; axis < 3; axis++) {
+            result->min[axis] = fminf(result->min[axis], world[axis]);
+            result->max[axis] = fmaxf(result->max[axis], world[axis]);
+        }
+    }
+}
+
+void occlusionCullerCreate(OcclusionCuller* culler, u32 width, u32 height) {
+    occlusionBufferCreate(&culler->buffer, width, height);
+
+    culler->occluderCount = 0;
+    culler->occluderCapacity = OCCLUSION_INITIAL_CAPACITY;
+    culler->occluders = malloc(sizeof(OcclusionMesh) * culler->occluderCapacity);
+
+    culler->objectCount = 0;
+    culler->objectCapacity = OCCLUSION_INITIAL_CAPACITY;
+    culler->objects = malloc(sizeof(OcclusionBounds) * culler->objectCapacity);
+    culler->objectVisible = malloc(sizeof(b32) * culler->objectCapacity);
+
+    atomic_init(&culler->counter.pending, 0);
+
+    culler->lastCulledCount = 0;
+    culler->lastTimeMs = 0.0;
+    culler->totalPasses = 0;
+    culler->totalTested = 0;
+    culler->totalCulled = 0;
+    culler->totalTimeMs = 0.0;
+}
+
+void occlusionCullerDestroy(OcclusionCuller* culler) {
+    occlusionBufferDestroy(&culler->buffer);
+    free(culler->occluders);
+    free(culler->objects);
+    free(culler->objectVisible);
+}
+
+u32 occlusionCullerAddOccluder(OcclusionCuller* culler, const OcclusionMesh* mesh) {
+    if (culler->occluderCount == culler->occluderCapacity) {
+        culler->occluderCapacity *= 2;
+        culler->occluders = realloc(
+            culler->occluders,
+            sizeof(OcclusionMesh) * culler->occluderCapacity
+        );
+    }
+
+    culler->occluders[culler->occluderCount] = *mesh;
+    return culler->occluderCount++;
+}
+
+u32 occlusionCullerAddObject(OcclusionCuller* culler, const OcclusionBounds* bounds) {
+    if (culler->objectCount == culler->objectCapacity) {
+        culler->objectCapacity *= 2;
+        culler->objects = realloc(
+            culler->objects,
+            sizeof(OcclusionBounds) * culler->objectCapacity
+        );
+        culler->objectVisible = realloc(
+            culler->objectVisible,
+            sizeof(b32) * culler->objectCapacity
+        );
+    }
+
+    culler->objects[culler->objectCount] = *bounds;
+    culler->objectVisible[culler->objectCount] = QQ_TRUE;
+    return culler->objectCount++;
+}
+
+void occlusionCullerSetOccluderTransform(OcclusionCuller* culler, u32 index, const f32* model) {
+    memcpy(culler->occluders[index].model, model, sizeof(f32) * 16);
+}
+
+void occlusionCullerSetObjectBounds(OcclusionCuller* culler, u32 index, const OcclusionBounds* bounds) {
+    culler->objects[index] = *bounds;
+}
+
+// Whole culling pass: clear, rasterize occluders, test objects
+static void runCullingPass(void* userData) {
+    OcclusionCuller* culler = (OcclusionCuller*)userData;
+    f64 startTime = getTimeMs();
+    u64 traceStart = traceBegin();
+
+    occlusionBufferClear(&culler->buffer);
+
+    for (u32 i = 0; i < culler->occluderCount; i++) {
+        const OcclusionMesh* mesh = &culler->occluders[i];
+
+        f32 modelViewProjection[16];
+        multiplyMatrix(culler->viewProjection, mesh->model, modelViewProjection);
+
+        occlusionBufferRenderMesh(
+            &culler->buffer,
+            modelViewProjection,
+            mesh->positions,
+            mesh->positionStride,
+            mesh->vertexCount,
+            mesh->indices,
+            mesh->indexCount
+        );
+    }
+
+    u32 culledCount = 0;
+    for (u32 i = 0; i < culler->objectCount; i++) {
+        culler->objectVisible[i] = occlusionBufferTestBounds(
+            &culler->buffer,
+            culler->viewProjection,
+            &culler->objects[i]
+        );
+        if (culler->objectVisible[i] == QQ_FALSE) {
+            culledCount += 1;
+        }
+    }
+
+    culler->lastCulledCount = culledCount;
+    culler->lastTimeMs = getTimeMs() - startTime;
+
+    culler->totalPasses += 1;
+    culler->totalTested += culler->objectCount;
+    culler->totalCulled += culledCount;
+    culler->totalTimeMs += culler->lastTimeMs;
+    traceEnd("occlusion culling", traceStart);
+}
+
+void occlusionCullerKick(OcclusionCuller* culler, JobPool* pool, const f32* viewProjection) {
+    memcpy(culler->viewProjection, viewProjection, sizeof(f32) * 16);
+    jobPoolSubmit(pool, &runCullingPass, culler, &culler->counter);
+}
+
+void occlusionCullerWait(OcclusionCuller* culler, JobPool* pool) {
+    jobPoolWait(pool, &culler->counter);
+}
+
+b32 occlusionCullerIsVisible(const OcclusionCuller* culler, u32 index) {
+    return culler->objectVisible[index];
+}
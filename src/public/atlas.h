@@ -0,0 +1,70 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * Texture atlas packing for many small images
+ *
+ * Images are packed into square layers of one array texture with skyline bottom-left
+ * packing. Every image gets a cell with a gutter of `padding` texels around it, filled
+ * by repeating edge texels. Cells start and end on multiples of `padding` (power of two),
+ * so box filtered levels down to atlasGetLevelCount never mix texels of two images
+ * and still have at least one gutter texel for bilinear filtering.
+ *
+ * Module does not depend on Vulkan, it places rectangles and fills layer pixels (RGBA8).
+ */
+
+// Skyline segment, top edge of packed cells from `x` to `x + width` is at `y`
+typedef struct {
+    u32 x;
+    u32 y;
+    u32 width;
+} AtlasSkylineNode;
+
+typedef struct {
+    u32 layerSize;
+    u32 padding;
+    u32 maxLayers;
+
+    // Layers with at least one cell
+    u32 layerCount;
+
+    // Skyline of every layer, `layerSize / alignment + 1` nodes reserved per layer
+    AtlasSkylineNode* nodes;
+    u32* nodeCounts;
+    u32 nodeCapacity;
+
+    // Texels covered by cells (with gutters)
+    u64 usedArea;
+} AtlasPacker;
+
+// Placement of one image, content starts at `x` and `y` (gutter is around it)
+typedef struct {
+    u32 x;
+    u32 y;
+    u32 width;
+    u32 height;
+    u32 layer;
+    b32 isPacked;
+} AtlasRect;
+
+// `padding` must be zero or power of two
+b32 atlasPackerCreate(AtlasPacker* packer, u32 layerSize, u32 padding, u32 maxLayers);
+
+void atlasPackerDestroy(AtlasPacker* packer);
+
+// Places image into first layer it fits, opens new layer when needed
+b32 atlasPackerInsert(AtlasPacker* packer, u32 width, u32 height, AtlasRect* rect);
+
+// Inserts images from the tallest one (fills layers much better than input order),
+// returns amount of packed images, `isPacked` tells which ones did not fit
+u32 atlasPackerInsertAll(AtlasPacker* packer, const u32* widths, const u32* heights, u32 count, AtlasRect* rects);
+
+// Levels which stay free of bleeding between images
+u32 atlasGetLevelCount(u32 layerSize, u32 padding);
+
+// Copies image into its cell of `layerPixels` and fills the gutter with edge texels
+void atlasCopyImage(u8* layerPixels, u32 layerSize, u32 padding, const AtlasRect* rect, const u8* pixels);
+
+// UV remap of the image, atlas uv = uv * transform.xy + transform.zw
+void atlasGetUvTransform(const AtlasRect* rect, u32 layerSize, f32* transform);
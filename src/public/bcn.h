@@ -0,0 +1,55 @@
+#pragma once
+
+#include <qq_types.h>
+#include <jobs.h>
+
+/**
+ * Block compression (BCn) helpers
+ *
+ * Decoder is used as CPU fallback when device cannot sample compressed format directly,
+ * encoder by the texture conversion tool.
+ * Every block covers 4x4 texels, stored as RGBA8 (row-major, 4 bytes per texel).
+ */
+
+typedef enum {
+    BCN_FORMAT_BC1,
+    BCN_FORMAT_BC3,
+    BCN_FORMAT_BC5,
+    BCN_FORMAT_BC7
+} BcnFormat;
+
+// Encoder effort, only BC7 searches more modes/partitions with higher quality
+typedef enum {
+    BCN_QUALITY_FAST,
+    BCN_QUALITY_NORMAL,
+    BCN_QUALITY_SLOW
+} BcnQuality;
+
+#define BCN_BLOCK_DIMENSION 4
+
+// Size of one compressed block in bytes
+u32 bcnGetBlockSize(BcnFormat format);
+
+// Size of compressed level in bytes
+u64 bcnGetLevelSize(BcnFormat format, u32 width, u32 height);
+
+// Decodes single block into 16 RGBA8 texels
+void bcnDecodeBlock(BcnFormat format, const u8* block, u8* rgba);
+
+// Decodes whole level, `rgba` must hold width * height * 4 bytes
+void bcnDecodeImage(BcnFormat format, const u8* blocks, u32 width, u32 height, u8* rgba);
+
+// Encodes 16 RGBA8 texels into single block
+void bcnEncodeBlock(BcnFormat format, BcnQuality quality, const u8* rgba, u8* block);
+
+// Encodes whole level, rows of blocks are split across `pool` (runs inline if NULL)
+// `blocks` must hold bcnGetLevelSize bytes
+void bcnEncodeImage(
+    BcnFormat format,
+    BcnQuality quality,
+    const u8* rgba,
+    u32 width,
+    u32 height,
+    u8* blocks,
+    JobPool* pool
+);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <qq_types.h>
+
+/**
+ * Files compiled into the executable
+ *
+ * Build generates table of files (SPIR-V by default, default model and textures with
+ * QQ_EMBED_ASSETS) with qq-embed. Contents are stored as u32 words, so SPIR-V is passed
+ * to Vulkan without a copy. Files are looked up by path relative to the output directory
+ * ("shader/vert.spv"), so callers keep their paths and fall back to the file system
+ * when a file is not embedded.
+ */
+
+typedef struct {
+    const char* path;
+    const u32* words;
+
+    // Size in bytes, last word is zero padded
+    u64 size;
+} EmbeddedFile;
+
+// Generated by qq-embed
+extern const EmbeddedFile embeddedFiles[];
+extern const u32 embeddedFileCount;
+
+// NULL when `path` is not embedded, leading "./" is ignored
+const EmbeddedFile* embeddedFind(const char* path);
+
+// Opens embedded file as read-only stream, otherwise opens `path` on disk
+FILE* embeddedOpen(const char* path, const char* mode);
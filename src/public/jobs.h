@@ -0,0 +1,56 @@
+#pragma once
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include <qq_types.h>
+
+// Work item executed by one of the pool threads
+typedef void (*JobFunction)(void* userData);
+
+// Counter of unfinished jobs, used to wait for a group of submitted jobs
+typedef struct {
+    _Atomic u32 pending;
+} JobCounter;
+
+typedef struct {
+    JobFunction function;
+    void* userData;
+    JobCounter* counter;
+} Job;
+
+// Fixed set of worker threads consuming a shared FIFO of jobs
+typedef struct {
+    pthread_t* threads;
+    u32 threadCount;
+
+    // Ring buffer of queued jobs (grows when full)
+    Job* queue;
+    u32 queueCapacity;
+    u32 queueHead;
+    u32 queueCount;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeCondition;
+    pthread_cond_t doneCondition;
+
+    b32 isShuttingDown;
+} JobPool;
+
+// Amount of worker threads to use when caller does not care (cores - 1, at least 1)
+u32 jobPoolDefaultThreadCount();
+
+// Starts `threadCount` workers (0 picks default)
+void jobPoolCreate(JobPool* pool, u32 threadCount);
+
+// Finishes queued jobs and joins all workers
+void jobPoolDestroy(JobPool* pool);
+
+// Queues job, `counter` is optional and incremented before queueing
+void jobPoolSubmit(JobPool* pool, JobFunction function, void* userData, JobCounter* counter);
+
+// Blocks until counter reaches zero, executing queued jobs meanwhile
+void jobPoolWait(JobPool* pool, JobCounter* counter);
+
+// Non-blocking check if all jobs of the counter are finished
+b32 jobCounterIsDone(JobCounter* counter);
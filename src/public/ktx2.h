@@ -0,0 +1,69 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * Minimal KTX2 container reader/writer
+ *
+ * Supports 2D textures with a single layer and face, without supercompression.
+ * Format is stored as VkFormat value, so module does not depend on Vulkan headers.
+ * Level 0 is the base (largest) mip level.
+ */
+
+// VkFormat values used by the loader
+#define KTX2_FORMAT_R8G8B8A8_UNORM 37
+#define KTX2_FORMAT_R8G8B8A8_SRGB 43
+#define KTX2_FORMAT_BC1_RGB_UNORM 131
+#define KTX2_FORMAT_BC1_RGB_SRGB 132
+#define KTX2_FORMAT_BC1_RGBA_UNORM 133
+#define KTX2_FORMAT_BC1_RGBA_SRGB 134
+#define KTX2_FORMAT_BC3_UNORM 137
+#define KTX2_FORMAT_BC3_SRGB 138
+#define KTX2_FORMAT_BC5_UNORM 141
+#define KTX2_FORMAT_BC7_UNORM 145
+#define KTX2_FORMAT_BC7_SRGB 146
+
+typedef struct {
+    // Location of level data inside the file
+    u64 offset;
+    u64 size;
+
+    u32 width;
+    u32 height;
+} Ktx2Level;
+
+typedef struct {
+    // Whole file, levels point into it
+    u8* data;
+    u64 dataSize;
+
+    u32 format;
+    u32 width;
+    u32 height;
+
+    u32 levelCount;
+    Ktx2Level* levels;
+} Ktx2Texture;
+
+// Reads and validates file, returns QQ_FALSE on failure
+b32 ktx2Load(const char* path, Ktx2Texture* texture);
+
+// Validates file contents already in memory, takes ownership of malloc'd `data` on success
+b32 ktx2Parse(u8* data, u64 dataSize, Ktx2Texture* texture);
+
+void ktx2Free(Ktx2Texture* texture);
+
+// Returns pointer to level data
+const u8* ktx2GetLevelData(const Ktx2Texture* texture, u32 level);
+
+// Writes 2D texture in one of KTX2_FORMAT_* formats,
+// `levelData` and `levelSizes` are ordered from the base level
+b32 ktx2Write(
+    const char* path,
+    u32 format,
+    u32 width,
+    u32 height,
+    u32 levelCount,
+    const u8* const* levelData,
+    const u64* levelSizes
+);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include <qq_types.h>
+
+/**
+ * Asynchronous leveled logger
+ *
+ * Producers format messages into slots of a bounded lock-free ring (every slot carries
+ * a sequence number, producers claim slots with compare-and-swap) and one background
+ * thread writes them out in order. When the ring is full producers yield until the
+ * flusher catches up, so no message is lost.
+ *
+ * Calls below LOG_COMPILE_LEVEL are compiled out. Calls below the runtime level cost one
+ * relaxed atomic load and do not evaluate their arguments.
+ *
+ * Before logStart and after logStop messages are written right away by the caller,
+ * so modules shared with tools log without any setup.
+ */
+
+typedef enum {
+    LOG_LEVEL_DEBUG = 0,
+    LOG_LEVEL_INFO = 1,
+    LOG_LEVEL_WARNING = 2,
+    LOG_LEVEL_ERROR = 3,
+    LOG_LEVEL_NONE = 4
+} LogLevel;
+
+// Lowest level compiled in, override with -DLOG_COMPILE_LEVEL=...
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Messages waiting for the flusher (power of two) and their length with terminator
+#define LOG_RING_CAPACITY 1024
+#define LOG_MESSAGE_LENGTH 248
+
+typedef struct {
+    // Slot is free for position `sequence` and holds message of position `sequence - 1`
+    _Atomic u64 sequence;
+    LogLevel level;
+    char text[LOG_MESSAGE_LENGTH];
+} LogSlot;
+
+// Runtime threshold, read by logging macros
+extern _Atomic i32 logLevel;
+
+#define logAt(level, ...) \
+    do { \
+        if ((level) >= LOG_COMPILE_LEVEL && (i32)(level) >= atomic_load_explicit(&logLevel, memory_order_relaxed)) { \
+            logWrite((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+// Message is one line, newline is added by the logger
+#define logDebug(...) logAt(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define logInfo(...) logAt(LOG_LEVEL_INFO, __VA_ARGS__)
+#define logWarning(...) logAt(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define logError(...) logAt(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+void logSetLevel(LogLevel level);
+
+// Parses "debug", "info", "warning", "error" or "none"
+b32 logParseLevel(const char* name, LogLevel* level);
+
+// Starts background flusher writing into `path` (stdout when NULL)
+b32 logStart(const char* path);
+
+// Writes queued messages and stops flusher
+void logStop();
+
+// Blocks until messages queued so far are written
+void logFlush();
+
+// Formats message regardless of level, use the macros instead
+void logWrite(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * CPU mip chain generation for RGBA8 images
+ *
+ * Color channels of sRGB images are averaged in linear space, alpha is always linear.
+ * Chains are tightly packed RGBA8 levels, base level first (4 byte aligned, ready for
+ * one buffer to image copy with a region per level).
+ */
+
+// Amount of levels down to 1x1, including base level
+u32 mipmapGetLevelCount(u32 width, u32 height);
+
+// Size of level in texels (never less than 1)
+u32 mipmapGetLevelDimension(u32 baseDimension, u32 level);
+
+// Box filters `source` into half sized `destination` (max(width / 2, 1) x max(height / 2, 1))
+void mipmapDownsample(const u8* source, u32 width, u32 height, u8* destination, b32 isSrgb);
+
+// Size in bytes of tightly packed chain with `levelCount` levels
+u64 mipmapGetChainSize(u32 width, u32 height, u32 levelCount);
+
+// Fills `chain` (mipmapGetChainSize bytes) with base level followed by downsampled levels,
+// `base` may point to the start of `chain`
+void mipmapGenerateChain(const u8* base, u32 width, u32 height, u32 levelCount, u8* chain, b32 isSrgb);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <qq_types.h>
+#include <jobs.h>
+
+/**
+ * CPU occlusion culling with a masked software depth buffer
+ *
+ * Occluders (simplified meshes) are rasterized into a low resolution depth buffer,
+ * split into 32x4 pixel tiles. Instead of per pixel depth, each tile keeps
+ * a coverage bit mask and two conservative depth values:
+ *  - zMax0: farthest depth of the whole tile ("reference" layer)
+ *  - zMax1: farthest depth of the pixels set in the mask ("working" layer)
+ *
+ * Once working layer covers the whole tile, it replaces the reference layer.
+ * Object bounds are then tested against the tiles, before command recording.
+ *
+ * Module does not depend on Vulkan, matrices are column-major f32[16]
+ * (same memory layout as cglm `mat4`), depth is in Vulkan [0, 1] range.
+ */
+
+// Tile dimensions in pixels, 4 rows of 32 bits make one 128-bit SIMD register
+#define OCCLUSION_TILE_WIDTH 32
+#define OCCLUSION_TILE_HEIGHT 4
+
+typedef struct {
+    // Coverage of working layer, bit per pixel for each tile row
+    u32 mask[OCCLUSION_TILE_HEIGHT];
+
+    // Farthest depth of the whole tile
+    f32 zMax0;
+
+    // Farthest depth of the pixels covered by the mask
+    f32 zMax1;
+} OcclusionTile;
+
+typedef struct {
+    // Dimensions in pixels (multiple of the tile size)
+    u32 width;
+    u32 height;
+
+    u32 tilesX;
+    u32 tilesY;
+    OcclusionTile* tiles;
+} OcclusionBuffer;
+
+// Occluder mesh, referenced (not copied) by the culler
+typedef struct {
+    // Vertex positions (3 floats), `positionStride` bytes apart
+    const f32* positions;
+    u32 positionStride;
+    u32 vertexCount;
+
+    const u32* indices;
+    u32 indexCount;
+
+    // Object to world transform
+    f32 model[16];
+} OcclusionMesh;
+
+// World space axis-aligned bounds of a tested object
+typedef struct {
+    f32 min[3];
+    f32 max[3];
+} OcclusionBounds;
+
+// Occluder/object registry with culling pass running on the job pool
+typedef struct {
+    OcclusionBuffer buffer;
+
+    u32 occluderCount;
+    u32 occluderCapacity;
+    OcclusionMesh* occluders;
+
+    u32 objectCount;
+    u32 objectCapacity;
+    OcclusionBounds* objects;
+
+    // Result of the last pass, indexed same as objects
+    b32* objectVisible;
+
+    // Camera used by the pass in flight
+    f32 viewProjection[16];
+
+    // Counter of the pass in flight
+    JobCounter counter;
+
+    // Stats of the last finished pass
+    u32 lastCulledCount;
+    f64 lastTimeMs;
+
+    // Accumulated stats
+    u64 totalPasses;
+    u64 totalTested;
+    u64 totalCulled;
+    f64 totalTimeMs;
+} OcclusionCuller;
+
+// Depth buffer
+void occlusionBufferCreate(OcclusionBuffer* buffer, u32 width, u32 height);
+void occlusionBufferDestroy(OcclusionBuffer* buffer);
+void occlusionBufferClear(OcclusionBuffer* buffer);
+
+// Rasterizes indexed triangle list, `modelViewProjection` transforms positions to clip space
+void occlusionBufferRenderMesh(
+    OcclusionBuffer* buffer,
+    const f32* modelViewProjection,
+    const f32* positions,
+    u32 positionStride,
+    u32 vertexCount,
+    const u32* indices,
+    u32 indexCount
+);
+
+// Returns QQ_TRUE if any part of the bounds may be visible
+b32 occlusionBufferTestBounds(
+    const OcclusionBuffer* buffer,
+    const f32* viewProjection,
+    const OcclusionBounds* bounds
+);
+
+// Culler
+void occlusionCullerCreate(OcclusionCuller* culler, u32 width, u32 height);
+void occlusionCullerDestroy(OcclusionCuller* culler);
+
+// Registers occluder, returns its index
+u32 occlusionCullerAddOccluder(OcclusionCuller* culler, const OcclusionMesh* mesh);
+
+// Registers tested object, returns its index (visible until first pass is done)
+u32 occlusionCullerAddObject(OcclusionCuller* culler, const OcclusionBounds* bounds);
+
+// Occluders and objects must not be modified while a pass is in flight
+void occlusionCullerSetOccluderTransform(OcclusionCuller* culler, u32 index, const f32* model);
+void occlusionCullerSetObjectBounds(OcclusionCuller* culler, u32 index, const OcclusionBounds* bounds);
+
+// Starts culling pass on the job pool
+void occlusionCullerKick(OcclusionCuller* culler, JobPool* pool, const f32* viewProjection);
+
+// Waits for the pass started by `occlusionCullerKick`
+void occlusionCullerWait(OcclusionCuller* culler, JobPool* pool);
+
+b32 occlusionCullerIsVisible(const OcclusionCuller* culler, u32 index);
+
+// Transforms object space bounds by column-major matrix into world space bounds
+void occlusionTransformBounds(
+    const f32* model,
+    const f32* localMin,
+    const f32* localMax,
+    OcclusionBounds* result
+);
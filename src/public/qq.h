@@ -3,43 +3,93 @@
 // Math
 #include <cglm/vec2.h>
 #include <cglm/vec3.h>
+#include <cglm/vec4.h>
 #include <cglm/mat4.h>
 
-// Custom primitive types definitions
-#include <stdint.h>
+// Custom primitive types (kept apart so non-Vulkan modules can use them)
+#include <qq_types.h>
 
-// Signed integers
-#define U32_MAX UINT32_MAX
-#define U64_MAX UINT64_MAX
-typedef int8_t i8;
-typedef int16_t i16;
-typedef int32_t i32;
-typedef int64_t i64;
+#include <jobs.h>
+#include <ktx2.h>
+#include <bcn.h>
+#include <virtual_texture.h>
+#include <atlas.h>
+#include <spirv_reflect.h>
 
-// Unsigned integers
-typedef uint8_t u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
+// Descriptor - UniformBufferObject (UBO), one slice per frame in flight
+typedef struct {
+    // Premultiplied projection * view
+    mat4 viewProjection;
+} UniformBufferObject;
 
-// Floats
-typedef float f32;
-typedef double f64;
+// Per draw data, passed with push constants
+typedef struct {
+    mat4 model;
 
-// Booleans
-typedef uint32_t b32;
-typedef uint64_t b64;
+    // Index into global material buffer
+    u32 materialIndex;
 
-// Project-scope boolean values
-#define QQ_TRUE 1
-#define QQ_FALSE 0
+    // Uniform buffer slice of the frame being recorded
+    u32 frameIndex;
+} DrawPushConstants;
 
-// Descriptor - UniformBufferObject (UBO)
+// Specialization constants of graphics shaders, see SHADER_CONSTANT_* in main.c
 typedef struct {
-    mat4 model;
-    mat4 view;
-    mat4 projection;
-} UniformBufferObject;
+    VkBool32 useTexture;
+    VkBool32 useVertexColor;
+    VkBool32 useAlphaTest;
+    f32 alphaCutoff;
+} ShaderSpecialization;
+
+// Graphics pipeline of one pass kind and shader feature set
+// Compiled by pipeline worker, `state` (PIPELINE_VARIANT_*) publishes `pipeline`
+typedef struct {
+    u32 kind;
+    u32 features;
+    VkPipeline pipeline;
+    _Atomic u32 state;
+
+    // Wall clock of the request and time spent in the driver
+    f64 requestTimeMs;
+    f64 compileMs;
+    f64 readyTimeMs;
+
+    // Finished compile was added to PipelineCompileStats
+    b32 isReported;
+} PipelineVariant;
+
+// Background pipeline compiles, latency is from request to ready pipeline
+typedef struct {
+    u64 compiledCount;
+    u64 failedCount;
+    f64 totalCompileMs;
+    f64 maxCompileMs;
+    f64 totalLatencyMs;
+    f64 maxLatencyMs;
+
+    // Variants requested but not compiled yet
+    u32 queueDepth;
+    u32 maxQueueDepth;
+
+    // Draws which used fallback variant or were left out while their variant compiled
+    u64 fallbackDrawCount;
+    u64 skippedDrawCount;
+} PipelineCompileStats;
+
+// Material entry of global material buffer (std430 layout)
+typedef struct {
+    vec4 baseColor;
+
+    // Texture coordinate remap (scale xy, offset zw), identity unless albedo is atlas image
+    vec4 uvTransform;
+
+    // Index into global texture array
+    u32 albedoTexture;
+
+    // Index into virtual textures (U32_MAX when albedo is a regular texture)
+    u32 virtualTexture;
+    u32 padding[2];
+} MaterialData;
 
 // New vertex implementation
 typedef struct {
@@ -48,10 +98,45 @@ typedef struct {
     vec2 uv;
 } Vertex;
 
+// Vertex data uploaded next to the position stream
+typedef struct {
+    vec3 color;
+    vec2 uv;
+} VertexAttributes;
+
+// Where the mesh keeps attribute which shaders read at `location`
+typedef struct {
+    u32 location;
+    u32 binding;
+    u32 offset;
+    u32 stride;
+    VkFormat format;
+
+    // Type shader reads the format as
+    SpirvComponentType componentType;
+} VertexStream;
+
+// Vertex input of one pipeline, only streams read by its vertex shader
+typedef struct {
+    VkVertexInputBindingDescription bindings[SPIRV_REFLECT_MAX_INPUTS];
+    u32 bindingCount;
+    VkVertexInputAttributeDescription attributes[SPIRV_REFLECT_MAX_INPUTS];
+    u32 attributeCount;
+} VertexInputDescription;
+
+// Reflected shader module, cached by path
+typedef struct {
+    const char* path;
+    SpirvReflection reflection;
+} ShaderReflection;
+
 // Shader code
 typedef struct {
     u8* data;
     i64 size;
+
+    // Points into the executable (see embedded.h), not freed
+    b32 isEmbedded;
 } VulkanShaderCode;
 
 // Vulkan swap chain properties
@@ -76,4 +161,250 @@ typedef struct {
     u32 present;
 } QueueFamilyIndices;
 
+// Texture whose mip levels are streamed in after startup, from the smallest one
+typedef struct {
+    // Source file, kept until every level is resident
+    Ktx2Texture source;
+    BcnFormat bcnFormat;
+    b32 isBlockCompressed;
+    b32 decompress;
+
+    VkImage image;
+    u32 levelCount;
+
+    // Index into global texture array, shader clamps sampling to resident levels
+    u32 textureIndex;
+
+    // Most detailed level which can be sampled
+    u32 residentLevel;
+
+    // Level decoded into staging buffer on streaming thread, then copied on GPU
+    u32 streamingLevel;
+    b32 isPreparing;
+    b32 isUploading;
+    JobCounter prepareCounter;
+    VkCommandBuffer uploadCommandBuffer;
+    u64 uploadTimelineValue;
+
+    // Sizes of levels as uploaded
+    u64 residentBytes;
+    u64 totalBytes;
+
+    f64 startTime;
+    f64 completeTime;
+} TextureStream;
+
+
+// Texture load request of the loading service
+typedef enum {
+    TEXTURE_LOAD_DECODING,
+    TEXTURE_LOAD_UPLOADING,
+    TEXTURE_LOAD_READY,
+    TEXTURE_LOAD_FAILED
+} TextureLoadState;
+
+#define TEXTURE_LOAD_MAX_LEVELS 16
+
+typedef struct {
+    char path[512];
+    TextureLoadState state;
+
+    // Written by decode worker, read once counter is done
+    JobCounter decodeCounter;
+    b32 isDecoded;
+    VkFormat format;
+    u32 width;
+    u32 height;
+    u32 levelCount;
+    u32 stagingSlice;
+    VkDeviceSize levelOffsets[TEXTURE_LOAD_MAX_LEVELS];
+    VkDeviceSize uploadSize;
+    f64 decodeTimeMs;
+
+    // Created by upload batch
+    VkImage image;
+    VkDeviceMemory imageMemory;
+    VkImageView imageView;
+    u32 textureIndex;
+} TextureLoadRequest;
+
+// Uploads of all textures decoded since previous batch, submitted at once
+typedef struct {
+    VkCommandBuffer commandBuffer;
+    u64 timelineValue;
+    b32 isInFlight;
+
+    TextureLoadRequest** requests;
+    u32 requestCount;
+} TextureUploadBatch;
+
+
+// Virtual texture entry of global virtual texture buffer (std430 layout)
+typedef struct {
+    // Level 0 size in texels
+    u32 width;
+    u32 height;
+
+    u32 levelCount;
+    u32 pageTableSize;
+
+    // Pages of this texture in feedback buffer, frame slices are `feedbackStride` apart
+    u32 feedbackOffset;
+    u32 feedbackStride;
+
+    // Page cache in global texture array
+    u32 cacheTexture;
+    u32 padding;
+} VirtualTextureData;
+
+// Page read from virtual texture file on streaming thread
+typedef struct {
+    u32 texture;
+    u32 page;
+    u32 level;
+    u32 x;
+    u32 y;
+
+    b32 isActive;
+    b32 isRead;
+    JobCounter readCounter;
+    u8* texels;
+} VirtualPageLoad;
+
+
+// Places where CPU waits for graphics timeline
+typedef enum {
+    HOST_WAIT_FRAME_SLOT,
+    HOST_WAIT_SWAPCHAIN_IMAGE,
+    HOST_WAIT_SINGLE_TIME_COMMANDS,
+    HOST_WAIT_SITE_COUNT
+} HostWaitSite;
+
+// Waits of one site, stalls are waits for a value which was not reached yet
+typedef struct {
+    u64 waitCount;
+    u64 stallCount;
+    f64 stallTimeMs;
+    f64 maxStallTimeMs;
+} HostWaitStats;
+
+// Frame waiting for `vkWaitForPresentKHR`, input time is taken right before camera update
+typedef struct {
+    u64 presentId;
+    f64 inputTimeMs;
+} PendingPresent;
+
+// Frame pacing statistics of one reporting window
+typedef struct {
+    f64 startTimeMs;
+    u32 frameCount;
+    f64 frameTimeSumMs;
+    f64 frameTimeMaxMs;
+
+    // Input to present (present wait) or input to GPU finish (frame timeline value)
+    u32 latencyCount;
+    f64 latencySumMs;
+    f64 latencyMaxMs;
+} FrameStats;
+
+// Frame times of benchmark run, percentiles are nearest rank
+typedef struct {
+    u32 count;
+    f64 averageMs;
+    f64 p50Ms;
+    f64 p95Ms;
+    f64 p99Ms;
+    f64 maxMs;
+} FrameTimeSummary;
+
+// Named GPU scope, times come from timestamp pairs written around the recorded commands
+typedef struct {
+    const char* name;
+
+    // Nesting level when scope was first recorded, used for indentation only
+    u32 depth;
 
+    u64 sampleCount;
+    f64 lastMs;
+    f64 averageMs;
+    f64 maxMs;
+} GpuProfileScope;
+
+// Startup work which does not need the device, runs on worker while device is created
+typedef struct {
+    const char* name;
+    JobFunction function;
+    JobCounter counter;
+
+    // Serial startup (`--serial-startup`) runs task on main thread when it is needed
+    b32 isSubmitted;
+    b32 isFinished;
+
+    // Time the task ran and time main thread waited for it
+    f64 runTimeMs;
+    f64 waitTimeMs;
+} StartupTask;
+
+// Sequential startup stage, measured from the end of the previous one
+typedef struct {
+    const char* name;
+    f64 durationMs;
+} StartupStage;
+
+// Mesh texture read during startup, KTX2 is uploaded as is, PNG comes with its mip chain
+typedef struct {
+    b32 isKtx2;
+    Ktx2Texture ktx2;
+
+    // NULL when PNG failed to load
+    u8* chain;
+    u32 width;
+    u32 height;
+    u32 levelCount;
+    f64 mipTimeMs;
+} MeshTextureSource;
+
+
+// Small image packed into texture atlas, decoded on worker
+typedef struct {
+    char path[512];
+    JobCounter decodeCounter;
+
+    // NULL when decoding failed
+    u8* pixels;
+    u32 width;
+    u32 height;
+
+    // Some texels are transparent, material is alpha tested
+    b32 hasTransparency;
+
+    AtlasRect rect;
+    u32 material;
+} AtlasImage;
+
+
+// Image whose mip chain is generated by downsample.comp, levels are written through UNORM views
+#define MIP_GENERATION_MAX_LEVELS 13
+
+typedef struct {
+    VkImage image;
+    u32 width;
+    u32 height;
+    u32 levelCount;
+    b32 isSrgb;
+
+    VkImageView levelViews[MIP_GENERATION_MAX_LEVELS];
+    VkDescriptorSet descriptorSet;
+
+    // Slot of the workgroup counter, counters of different images must not alias
+    u32 counterSlot;
+} MipGenerationTarget;
+
+// Push constants of downsample.comp
+typedef struct {
+    u32 width;
+    u32 height;
+    u32 levelCount;
+    u32 isSrgb;
+    u32 workgroupCount;
+} MipPushConstants;
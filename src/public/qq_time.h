@@ -0,0 +1,20 @@
+#pragma once
+
+#include <time.h>
+
+#include <qq_types.h>
+
+/**
+ * Monotonic clock shared by all modules, unaffected by wall clock changes.
+ * Used for stats, benchmarks and trace timestamps.
+ */
+
+static inline u64 getTimeNs() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
+static inline f64 getTimeMs() {
+    return (f64)getTimeNs() / 1000000.0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * Render queue sorts draws by a 64-bit key, so draws sharing state end up
+ * next to each other and recorder can skip redundant binds.
+ *
+ * Key layout (most significant first):
+ *  - pass      4 bits  (depth pre-pass, opaque, ...)
+ *  - pipeline 10 bits
+ *  - material 16 bits  (descriptor set)
+ *  - mesh     16 bits  (vertex/index buffers)
+ *  - depth    18 bits  (front to back inside the same state)
+ *
+ * Module only knows about ids, mapping them to Vulkan objects is up to recorder.
+ */
+
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_PIPELINE_BITS 10
+#define RENDER_KEY_MATERIAL_BITS 16
+#define RENDER_KEY_MESH_BITS 16
+#define RENDER_KEY_DEPTH_BITS 18
+
+// State a sorted draw changes against the previous one (see renderQueueGetChanges)
+#define RENDER_QUEUE_CHANGE_PIPELINE 0x1
+#define RENDER_QUEUE_CHANGE_MATERIAL 0x2
+#define RENDER_QUEUE_CHANGE_MESH 0x4
+
+typedef struct {
+    u32 pass;
+    u32 pipeline;
+    u32 material;
+    u32 mesh;
+
+    // Normalized [0, 1] view depth, used for ordering only
+    f32 depth;
+
+    // Per draw data (pushed as constants), column-major
+    f32 model[16];
+} RenderDraw;
+
+typedef struct {
+    u64 key;
+    u32 drawIndex;
+} RenderQueueEntry;
+
+typedef struct {
+    u32 drawCount;
+    u32 drawCapacity;
+    RenderDraw* draws;
+
+    // Sorted entries and scratch storage for radix sort
+    RenderQueueEntry* entries;
+    RenderQueueEntry* scratch;
+} RenderQueue;
+
+// Bind statistics of recorded queue (or accumulated over frames)
+typedef struct {
+    u64 drawCount;
+    u64 pipelineBinds;
+    u64 descriptorSetBinds;
+    u64 vertexBufferBinds;
+} RenderQueueStats;
+
+u64 renderQueueMakeKey(u32 pass, u32 pipeline, u32 material, u32 mesh, f32 depth);
+
+void renderQueueCreate(RenderQueue* queue, u32 initialCapacity);
+void renderQueueDestroy(RenderQueue* queue);
+
+// Drops all draws, keeps allocated memory
+void renderQueueReset(RenderQueue* queue);
+
+// Copies draw into queue, returns its index
+u32 renderQueuePush(RenderQueue* queue, const RenderDraw* draw);
+
+// Sorts entries by key (LSD radix sort, stable)
+void renderQueueSort(RenderQueue* queue);
+
+// Sorts `count` entries in place, `scratch` must hold `count` entries
+void renderQueueRadixSort(RenderQueueEntry* entries, RenderQueueEntry* scratch, u32 count);
+
+// Returns draw referenced by sorted position
+const RenderDraw* renderQueueGetSorted(const RenderQueue* queue, u32 position);
+
+// Returns RENDER_QUEUE_CHANGE_* bits of state the draw at sorted position has to bind,
+// first draw changes everything, others only what differs from the previous draw
+u32 renderQueueGetChanges(const RenderQueue* queue, u32 position);
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * SPIR-V reflection
+ *
+ * Parses shader module words and reports what the pipeline has to provide:
+ * vertex inputs (location and type), descriptor bindings (set, binding, type and
+ * array size) and size of the push constant block. Layouts built from it always
+ * match the GLSL, so they are not declared twice.
+ *
+ * Input which is declared but never read by the shader is reported with
+ * `isUsed` false, so its vertex stream does not have to be fetched.
+ *
+ * Module does not depend on Vulkan, caller maps the enums to Vulkan ones.
+ */
+
+#define SPIRV_REFLECT_MAX_INPUTS 16
+#define SPIRV_REFLECT_MAX_BINDINGS 16
+
+typedef enum {
+    SPIRV_STAGE_VERTEX = 0,
+    SPIRV_STAGE_FRAGMENT = 1,
+    SPIRV_STAGE_COMPUTE = 2
+} SpirvStage;
+
+typedef enum {
+    SPIRV_COMPONENT_FLOAT = 0,
+    SPIRV_COMPONENT_INT = 1,
+    SPIRV_COMPONENT_UINT = 2
+} SpirvComponentType;
+
+typedef enum {
+    SPIRV_DESCRIPTOR_SAMPLER = 0,
+    SPIRV_DESCRIPTOR_COMBINED_IMAGE_SAMPLER = 1,
+    SPIRV_DESCRIPTOR_SAMPLED_IMAGE = 2,
+    SPIRV_DESCRIPTOR_STORAGE_IMAGE = 3,
+    SPIRV_DESCRIPTOR_UNIFORM_TEXEL_BUFFER = 4,
+    SPIRV_DESCRIPTOR_STORAGE_TEXEL_BUFFER = 5,
+    SPIRV_DESCRIPTOR_UNIFORM_BUFFER = 6,
+    SPIRV_DESCRIPTOR_STORAGE_BUFFER = 7
+} SpirvDescriptorType;
+
+// Stage input of the entry point (vertex attribute for vertex shaders)
+typedef struct {
+    u32 location;
+    SpirvComponentType componentType;
+    u32 componentCount;
+    u32 componentBits;
+    b32 isUsed;
+} SpirvInput;
+
+typedef struct {
+    u32 set;
+    u32 binding;
+    SpirvDescriptorType type;
+
+    // Elements of descriptor array, 0 for unsized (runtime) array
+    u32 count;
+} SpirvBinding;
+
+typedef struct {
+    SpirvStage stage;
+
+    SpirvInput inputs[SPIRV_REFLECT_MAX_INPUTS];
+    u32 inputCount;
+
+    SpirvBinding bindings[SPIRV_REFLECT_MAX_BINDINGS];
+    u32 bindingCount;
+
+    // End of the last push constant member, 0 without push constants
+    u32 pushConstantSize;
+} SpirvReflection;
+
+// Reflects first entry point of the module, `size` is in bytes
+b32 spirvReflect(const u32* words, u64 size, SpirvReflection* reflection);
+
+// NULL when module has no input at `location`
+const SpirvInput* spirvFindInput(const SpirvReflection* reflection, u32 location);
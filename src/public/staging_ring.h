@@ -0,0 +1,58 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <qq_types.h>
+
+/**
+ * Ring allocator of upload staging space, shared by worker threads
+ *
+ * Hands out byte ranges of one persistently mapped buffer. Slices may be released
+ * in any order, space is reclaimed once all older slices are released too.
+ * Allocation blocks while ring is full, so whoever releases slices (upload thread)
+ * must never wait for the allocating workers.
+ *
+ * Module does not depend on Vulkan, it manages offsets only.
+ */
+
+typedef struct {
+    // Reserved region starts at `start`, which is before `offset` when
+    // slice was aligned or wrapped to the beginning of the ring
+    u64 start;
+    u64 offset;
+    u64 size;
+
+    b32 isReleased;
+} StagingRingSlice;
+
+typedef struct {
+    u64 capacity;
+
+    // Next allocation offset and bytes held by live slices (including skipped space)
+    u64 head;
+    u64 used;
+
+    // FIFO of live slices in allocation order
+    StagingRingSlice* slices;
+    u32 sliceCapacity;
+    u32 sliceHead;
+    u32 sliceCount;
+
+    // Bookkeeping for reports
+    u64 peakUsed;
+    u32 waitCount;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t releaseCondition;
+} StagingRing;
+
+void stagingRingCreate(StagingRing* ring, u64 capacity, u32 maxSlices);
+
+void stagingRingDestroy(StagingRing* ring);
+
+// Reserves `size` bytes aligned to `alignment` (power of two), blocks until space is released
+// Returns QQ_FALSE if request can never fit
+b32 stagingRingAllocate(StagingRing* ring, u64 size, u64 alignment, u64* offset, u32* sliceId);
+
+// Releases slice returned by stagingRingAllocate, may be called from any thread
+void stagingRingRelease(StagingRing* ring, u32 sliceId);
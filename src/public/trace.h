@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdatomic.h>
+
+#include <qq_types.h>
+
+/**
+ * CPU instrumentation with Chrome trace event export
+ *
+ * Scopes are timed with traceBegin/traceEnd pairs and recorded as complete events
+ * into a ring buffer of the calling thread. Only the owning thread writes its ring,
+ * so recording takes no locks. Rings are allocated on first event of a thread and
+ * linked into one list with compare-and-swap.
+ *
+ * When tracing is disabled traceBegin is one relaxed atomic load and traceEnd returns
+ * right away. Written file loads in chrome://tracing and Perfetto.
+ *
+ * Event names are stored by pointer, so they must outlive the trace (string literals).
+ */
+
+// Events kept per thread, oldest ones are overwritten
+#define TRACE_RING_CAPACITY 16384
+
+#define TRACE_THREAD_NAME_LENGTH 32
+
+typedef struct {
+    const char* name;
+    u64 startNs;
+    u64 durationNs;
+} TraceEvent;
+
+// Ring of one thread, `writeIndex` counts all events ever written
+typedef struct TraceThreadBuffer {
+    TraceEvent events[TRACE_RING_CAPACITY];
+    _Atomic u64 writeIndex;
+
+    u32 threadId;
+    char threadName[TRACE_THREAD_NAME_LENGTH];
+
+    struct TraceThreadBuffer* next;
+} TraceThreadBuffer;
+
+// Sets time origin of written events, call once before any thread records
+void traceInit();
+
+// Frees thread rings, recording threads must be finished
+void traceShutdown();
+
+void traceSetEnabled(b32 isEnabled);
+
+b32 traceIsEnabled();
+
+// Names calling thread in the trace, does not allocate the ring
+void traceSetThreadName(const char* name);
+
+// Start of a scope, returns 0 when tracing is disabled
+u64 traceBegin();
+
+// Records scope started by traceBegin, does nothing for 0
+void traceEnd(const char* name, u64 startNs);
+
+// Writes events of all threads as Chrome trace event JSON
+b32 traceWriteFile(const char* path);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <qq_types.h>
+
+/**
+ * Virtual texturing without sparse binding
+ *
+ * Texture is split into square pages, only pages the camera actually sees are kept
+ * in one fixed size physical page cache. Fragment shader finds page through page table
+ * (one texel per page, one level per mip level) and writes requested pages into
+ * feedback buffer, which drives the streamer.
+ *
+ * Virtual textures have power of two dimensions, so every page has exactly one parent page
+ * in the next level. Last level always fits into a single page.
+ *
+ * Pages are numbered by page table texels: levels one after another, row-major, every
+ * level is (pageTableSize >> level) pages wide and high. Feedback and page table
+ * use the same numbering.
+ *
+ * Module does not depend on Vulkan, it manages files, page residency and page table contents.
+ */
+
+// Page content and border (for bilinear filtering across pages) in texels
+#define VIRTUAL_TEXTURE_PAGE_SIZE 128
+#define VIRTUAL_TEXTURE_PAGE_BORDER 4
+#define VIRTUAL_TEXTURE_PAGE_SLOT_SIZE (VIRTUAL_TEXTURE_PAGE_SIZE + 2 * VIRTUAL_TEXTURE_PAGE_BORDER)
+
+// Page with border as stored in file and cache, RGBA8
+#define VIRTUAL_TEXTURE_PAGE_BYTES (VIRTUAL_TEXTURE_PAGE_SLOT_SIZE * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE * 4)
+
+#define VIRTUAL_TEXTURE_MAX_LEVELS 16
+
+// Page slot values which are not cache slots
+#define VIRTUAL_PAGE_NOT_RESIDENT U32_MAX
+#define VIRTUAL_PAGE_LOADING (U32_MAX - 1)
+
+// Tiled file (.qvt), pages of every level follow the header
+typedef struct {
+    // Opened for positional reads, so pages can be read from several threads
+    i32 descriptor;
+
+    u32 width;
+    u32 height;
+    u32 levelCount;
+    b32 isSrgb;
+
+    // Stored pages of every level (clipped to texture size)
+    u32 pageCountsX[VIRTUAL_TEXTURE_MAX_LEVELS];
+    u32 pageCountsY[VIRTUAL_TEXTURE_MAX_LEVELS];
+    u64 levelOffsets[VIRTUAL_TEXTURE_MAX_LEVELS];
+} VirtualTextureFile;
+
+typedef struct {
+    VirtualTextureFile file;
+
+    // Page table is square, size of level 0 is power of two
+    u32 pageTableSize;
+    u32 pageTableLevelOffsets[VIRTUAL_TEXTURE_MAX_LEVELS];
+    u32 pageCount;
+
+    // Cache slot of every page (or VIRTUAL_PAGE_*)
+    u32* pageSlots;
+
+    // Packed page table entries (x, y, level, 255) for R8G8B8A8_UINT image,
+    // pages which are not resident point to closest resident ancestor
+    u32* pageTable;
+    b32 isPageTableDirty;
+} VirtualTexture;
+
+typedef struct {
+    u32 texture;
+    u32 page;
+
+    // Frame the page was requested last time
+    u64 lastUsedFrame;
+
+    // LRU list links, pinned and free slots are not in the list
+    u32 previous;
+    u32 next;
+
+    b32 isUsed;
+    b32 isPinned;
+} VirtualPageSlot;
+
+// Physical page cache, slots form a square grid in the cache image
+typedef struct {
+    u32 slotsPerSide;
+    u32 slotCount;
+    VirtualPageSlot* slots;
+
+    // Least recently used page is at the tail
+    u32 head;
+    u32 tail;
+
+    // Slots never used yet
+    u32 freeCount;
+
+    u64 evictionCount;
+} VirtualPageCache;
+
+// Levels down to the one which fits into a single page
+u32 virtualTextureGetLevelCount(u32 width, u32 height);
+
+// Writes pages of the mip chain (`levelPixels` from base level, at least
+// virtualTextureGetLevelCount levels), dimensions must be power of two
+b32 virtualTextureFileWrite(
+    const char* path,
+    const u8* const* levelPixels,
+    u32 width,
+    u32 height,
+    b32 isSrgb
+);
+
+b32 virtualTextureFileOpen(const char* path, VirtualTextureFile* file);
+
+void virtualTextureFileClose(VirtualTextureFile* file);
+
+// Reads page with its border into `texels` (VIRTUAL_TEXTURE_PAGE_BYTES), thread safe
+b32 virtualTextureFileReadPage(const VirtualTextureFile* file, u32 level, u32 x, u32 y, u8* texels);
+
+// Opens file and allocates page table, no page is resident
+b32 virtualTextureCreate(VirtualTexture* texture, const char* path);
+
+void virtualTextureDestroy(VirtualTexture* texture);
+
+// Finds level and coordinates of page, returns QQ_FALSE if page is outside of the stored pages
+b32 virtualTextureGetPageLocation(const VirtualTexture* texture, u32 page, u32* level, u32* x, u32* y);
+
+// Rebuilds page table entries from page slots
+void virtualTextureUpdatePageTable(VirtualTexture* texture, const VirtualPageCache* cache);
+
+void virtualPageCacheCreate(VirtualPageCache* cache, u32 slotsPerSide);
+
+void virtualPageCacheDestroy(VirtualPageCache* cache);
+
+// Marks slot as most recently used
+void virtualPageCacheTouch(VirtualPageCache* cache, u32 slot, u64 frame);
+
+// Takes free slot or evicts least recently used page which was not requested in `frame`
+// Evicted page is returned through `evictedTexture` and `evictedPage` (U32_MAX if none)
+// Returns U32_MAX when every slot is pinned or in use this frame
+u32 virtualPageCacheAllocate(
+    VirtualPageCache* cache,
+    u32 texture,
+    u32 page,
+    u64 frame,
+    b32 isPinned,
+    u32* evictedTexture,
+    u32* evictedPage
+);
@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <render_queue.h>
+
+// Radix sort processes key one byte at a time
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_PASSES (64 / RADIX_BITS)
+
+// Keeps lowest `bits` of value
+static u64 maskBits(u32 value, u32 bits) {
+    return (u64)value & ((1ull << bits) - 1);
+}
+
+u64 renderQueueMakeKey(u32 pass, u32 pipeline, u32 material, u32 mesh, f32 depth) {
+    // Clamp and quantize depth
+    if (!(depth > 0.0f)) {
+        depth = 0.0f;
+    }
+    if (depth > 1.0f) {
+        depth = 1.0f;
+    }
+    u32 depthMax = (1u << RENDER_KEY_DEPTH_BITS) - 1;
+    u32 quantizedDepth = (u32)(depth * (f32)depthMax);
+
+    u64 key = maskBits(pass, RENDER_KEY_PASS_BITS);
+    key = (key << RENDER_KEY_PIPELINE_BITS) | maskBits(pipeline, RENDER_KEY_PIPELINE_BITS);
+    key = (key << RENDER_KEY_MATERIAL_BITS) | maskBits(material, RENDER_KEY_MATERIAL_BITS);
+    key = (key << RENDER_KEY_MESH_BITS) | maskBits(mesh, RENDER_KEY_MESH_BITS);
+    key = (key << RENDER_KEY_DEPTH_BITS) | maskBits(quantizedDepth, RENDER_KEY_DEPTH_BITS);
+
+    return key;
+}
+
+void renderQueueCreate(RenderQueue* queue, u32 initialCapacity) {
+    if (initialCapacity == 0) {
+        initialCapacity = 1;
+    }
+
+    queue->drawCount = 0;
+    queue->drawCapacity = initialCapacity;
+    queue->draws = malloc(sizeof(RenderDraw) * initialCapacity);
+    queue->entries = malloc(sizeof(RenderQueueEntry) * initialCapacity);
+    queue->scratch = malloc(sizeof(RenderQueueEntry) * initialCapacity);
+}
+
+void renderQueueDestroy(RenderQueue* queue) {
+    free(queue->draws);
+    free(queue->entries);
+    free(queue->scratch);
+}
+
+void renderQueueReset(RenderQueue* queue) {
+    queue->drawCount = 0;
+}
+
+u32 renderQueuePush(RenderQueue* queue, const RenderDraw* draw) {
+    if (queue->drawCount == queue->drawCapacity) {
+        queue->drawCapacity *= 2;
+        queue->draws = realloc(queue->draws, sizeof(RenderDraw) * queue->drawCapacity);
+        queue->entries = realloc(queue->entries, sizeof(RenderQueueEntry) * queue->drawCapacity);
+        queue->scratch = realloc(queue->scratch, sizeof(RenderQueueEntry) * queue->drawCapacity);
+    }
+
+    u32 index = queue->drawCount++;
+    queue->draws[index] = *draw;
+    queue->entries[index].key = renderQueueMakeKey(
+        draw->pass,
+        draw->pipeline,
+        draw->material,
+        draw->mesh,
+        draw->depth
+    );
+    queue->entries[index].drawIndex = index;
+
+    return index;
+}
+
+void renderQueueRadixSort(RenderQueueEntry* entries, RenderQueueEntry* scratch, u32 count) {
+    if (count < 2) {
+        return;
+    }
+
+    // Build histograms of all passes with a single read of the keys
+    u32 histograms[RADIX_PASSES][RADIX_BUCKETS];
+    memset(histograms, 0, sizeof(histograms));
+    for (u32 i = 0; i < count; i++) {
+        u64 key = entries[i].key;
+        for (u32 pass = 0; pass < RADIX_PASSES; pass++) {
+            histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)] += 1;
+        }
+    }
+
+    RenderQueueEntry* source = entries;
+    RenderQueueEntry* destination = scratch;
+
+    for (u32 pass = 0; pass < RADIX_PASSES; pass++) {
+        u32* histogram = histograms[pass];
+        u32 shift = pass * RADIX_BITS;
+
+        // All keys share this byte (unused key bits, single material etc.), nothing to reorder
+        if (histogram[(source[0].key >> shift) & (RADIX_BUCKETS - 1)] == count) {
+            continue;
+        }
+
+        // Turn counts into bucket start offsets
+        u32 offset = 0;
+        for (u32 bucket = 0; bucket < RADIX_BUCKETS; bucket++) {
+            u32 bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (u32 i = 0; i < count; i++) {
+            u32 bucket = (source[i].key >> shift) & (RADIX_BUCKETS - 1);
+            destination[histogram[bucket]++] = source[i];
+        }
+
+        RenderQueueEntry* tmp = source;
+        source = destination;
+        destination = tmp;
+    }
+
+    // Odd amount of performed passes leaves result in scratch
+    if (source != entries) {
+        memcpy(entries, source, sizeof(RenderQueueEntry) * count);
+    }
+}
+
+void renderQueueSort(RenderQueue* queue) {
+    renderQueueRadixSort(queue->entries, queue->scratch, queue->drawCount);
+}
+
+const RenderDraw* renderQueueGetSorted(const RenderQueue* queue, u32 position) {
+    return &queue->draws[queue->entries[position].drawIndex];
+}
+
+u32 renderQueueGetChanges(const RenderQueue* queue, u32 position) {
+    u32 changes = RENDER_QUEUE_CHANGE_PIPELINE | RENDER_QUEUE_CHANGE_MATERIAL | RENDER_QUEUE_CHANGE_MESH;
+    if (position == 0) {
+        return changes;
+    }
+
+    const RenderDraw* previous = renderQueueGetSorted(queue, position - 1);
+    const RenderDraw* draw = renderQueueGetSorted(queue, position);
+    if (draw->pipeline == previous->pipeline) {
+        changes &= ~RENDER_QUEUE_CHANGE_PIPELINE;
+    }
+    if (draw->material == previous->material) {
+        changes &= ~RENDER_QUEUE_CHANGE_MATERIAL;
+    }
+    if (draw->mesh == previous->mesh) {
+        changes &= ~RENDER_QUEUE_CHANGE_MESH;
+    }
+    return changes;
+}
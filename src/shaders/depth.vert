@@ -0,0 +1,28 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Same uniform buffer object as main pass
+struct UniformBufferObject {
+    mat4 viewProjection;
+};
+layout(set = 0, binding = 0) uniform Frames {
+    // One slice per frame in flight (MAX_FRAMES_IN_FLIGHT)
+    UniformBufferObject frames[4];
+} ubo;
+
+// Per draw data
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+    uint frameIndex;
+} draw;
+
+// Depth pre-pass reads only position stream
+layout(location = 0) in vec3 inPosition;
+
+// Must match main pass bit for bit, which tests depth with EQUAL afterwards
+invariant gl_Position;
+
+void main() {
+    gl_Position = ubo.frames[draw.frameIndex].viewProjection * (draw.model * vec4(inPosition, 1.0));
+}
@@ -1,13 +1,152 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(binding = 1) uniform sampler2D texSampler;
+// Unsized texture array of the global set
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct MaterialData {
+    vec4 baseColor;
+    vec4 uvTransform;
+    uint albedoTexture;
+    uint virtualTexture;
+};
+
+// Virtual texture entry, see VirtualTextureData in qq.h
+struct VirtualTextureData {
+    uvec2 size;
+    uint levelCount;
+    uint pageTableSize;
+    uint feedbackOffset;
+    uint feedbackStride;
+    uint cacheTexture;
+    uint padding;
+};
+
+// Page layout, must match virtual_texture.h
+#define VIRTUAL_PAGE_SIZE 128
+#define VIRTUAL_PAGE_BORDER 4
+#define VIRTUAL_PAGE_SLOT_SIZE 136
+#define MAX_VIRTUAL_TEXTURES 8
+#define NO_VIRTUAL_TEXTURE 0xFFFFFFFFu
+
+// Global (bindless) set, see GLOBAL_BINDING_* in main.c
+layout(std430, set = 0, binding = 1) readonly buffer Materials {
+    MaterialData materials[];
+};
+layout(set = 0, binding = 2) uniform sampler textureSampler;
+layout(set = 0, binding = 3) uniform texture2D textures[];
+
+// Most detailed resident level of every texture, one value per frame in flight
+// (MAX_FRAMES_IN_FLIGHT slots, fewer may be used)
+#define FRAMES_IN_FLIGHT 4
+layout(std430, set = 0, binding = 4) readonly buffer TextureResidency {
+    float textureMinLods[];
+};
+
+// Page tables (x, y and level of cache slot per page), virtual textures and page requests
+layout(set = 0, binding = 5) uniform utexture2D virtualPageTables[MAX_VIRTUAL_TEXTURES];
+layout(std430, set = 0, binding = 6) readonly buffer VirtualTextures {
+    VirtualTextureData virtualTextures[];
+};
+layout(std430, set = 0, binding = 7) writeonly buffer VirtualFeedback {
+    uint virtualFeedback[];
+};
+
+// Per draw data
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+    uint frameIndex;
+} draw;
+
+// Shader features, see SHADER_CONSTANT_* in main.c
+// Disabled paths are removed when the pipeline variant is compiled
+layout(constant_id = 0) const bool USE_TEXTURE = true;
+layout(constant_id = 1) const bool USE_VERTEX_COLOR = false;
+layout(constant_id = 2) const bool USE_ALPHA_TEST = false;
+layout(constant_id = 3) const float ALPHA_CUTOFF = 0.5;
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec2 fragTexCoord;
 
 layout(location = 0) out vec4 outColor;
 
+// Samples texture without touching levels which are still streaming,
+// gradients are passed in as atlas coordinates are not continuous
+vec4 sampleResident(uint textureIndex, vec2 uv, vec2 uvDx, vec2 uvDy) {
+    float minLod = textureMinLods[textureIndex * FRAMES_IN_FLIGHT + draw.frameIndex];
+    if (minLod <= 0.0) {
+        return textureGrad(sampler2D(textures[textureIndex], textureSampler), uv, uvDx, uvDy);
+    }
+
+    // Scaling gradients raises LOD by the same amount and keeps anisotropic filtering
+    float lod = textureQueryLod(sampler2D(textures[textureIndex], textureSampler), uv).y;
+    float scale = exp2(max(minLod - lod, 0.0));
+    return textureGrad(
+        sampler2D(textures[textureIndex], textureSampler),
+        uv,
+        uvDx * scale,
+        uvDy * scale
+    );
+}
+
+// Samples page cache through page table, requests the page for next frames
+vec4 sampleVirtual(uint virtualTexture, vec2 uv) {
+    VirtualTextureData vt = virtualTextures[virtualTexture];
+
+    // Level from screen space footprint in texels of level 0
+    vec2 texelDx = dFdx(uv) * vec2(vt.size);
+    vec2 texelDy = dFdy(uv) * vec2(vt.size);
+    float lod = 0.5 * log2(max(dot(texelDx, texelDx), dot(texelDy, texelDy)));
+    uint level = uint(clamp(lod, 0.0, float(vt.levelCount - 1u)));
+
+    // Texture repeats, same as the shared sampler does for regular textures
+    uv = fract(uv);
+    uint levelPages = vt.pageTableSize >> level;
+    uvec2 levelSize = max(vt.size >> level, uvec2(1));
+    uvec2 page = min(uvec2(uv * vec2(levelSize)) / uint(VIRTUAL_PAGE_SIZE), uvec2(levelPages - 1u));
+
+    // One fragment of every 2x2 block reports the page, levels are stored one after another
+    if ((uint(gl_FragCoord.x) & 1u) == 0u && (uint(gl_FragCoord.y) & 1u) == 0u) {
+        uint levelOffset = (vt.pageTableSize * vt.pageTableSize - levelPages * levelPages) / 3u * 4u;
+        uint feedbackIndex = vt.feedbackOffset + levelOffset + page.y * levelPages + page.x;
+        virtualFeedback[draw.frameIndex * vt.feedbackStride + feedbackIndex] = 1u;
+    }
+
+    // Entry points to the page or to its closest resident ancestor
+    uvec4 entry = texelFetch(usampler2D(virtualPageTables[virtualTexture], textureSampler), ivec2(page), int(level));
+    vec2 residentSize = vec2(max(vt.size >> entry.z, uvec2(1)));
+    vec2 pageTexel = fract(uv * residentSize / float(VIRTUAL_PAGE_SIZE)) * float(VIRTUAL_PAGE_SIZE);
+
+    // Border around the page keeps bilinear filter inside the slot
+    vec2 cacheTexel = vec2(entry.xy) * float(VIRTUAL_PAGE_SLOT_SIZE) + float(VIRTUAL_PAGE_BORDER) + pageTexel;
+    vec2 cacheSize = vec2(textureSize(sampler2D(textures[vt.cacheTexture], textureSampler), 0));
+    return textureLod(sampler2D(textures[vt.cacheTexture], textureSampler), cacheTexel / cacheSize, 0.0);
+}
+
 void main() {
-    outColor = texture(texSampler, fragTexCoord);
+    // Material index comes from push constants, so texture index is uniform for the draw
+    MaterialData material = materials[draw.materialIndex];
+    vec4 color = material.baseColor;
+    if (USE_TEXTURE) {
+        if (material.virtualTexture != NO_VIRTUAL_TEXTURE) {
+            color *= sampleVirtual(material.virtualTexture, fragTexCoord);
+        } else {
+            // Atlas images repeat inside their rectangle (atlas layers are never streamed)
+            vec2 uv = fragTexCoord;
+            vec2 uvDx = dFdx(fragTexCoord) * material.uvTransform.xy;
+            vec2 uvDy = dFdy(fragTexCoord) * material.uvTransform.xy;
+            if (material.uvTransform != vec4(1.0, 1.0, 0.0, 0.0)) {
+                uv = fract(uv) * material.uvTransform.xy + material.uvTransform.zw;
+            }
+            color *= sampleResident(material.albedoTexture, uv, uvDx, uvDy);
+        }
+    }
+    if (USE_VERTEX_COLOR) {
+        color.rgb *= fragColor;
+    }
+    if (USE_ALPHA_TEST && color.a < ALPHA_CUTOFF) {
+        discard;
+    }
+    outColor = color;
 }
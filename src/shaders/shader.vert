@@ -1,25 +1,45 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-// Use uniform buffer object (UBO)
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
-    mat4 view;
-    mat4 projection;
+// Use uniform buffer object (UBO), sliced per frame in flight
+struct UniformBufferObject {
+    mat4 viewProjection;
+};
+layout(set = 0, binding = 0) uniform Frames {
+    // One slice per frame in flight (MAX_FRAMES_IN_FLIGHT)
+    UniformBufferObject frames[4];
 } ubo;
 
-// Get vertex and color data from input buffer
+// Per draw data
+layout(push_constant) uniform DrawPushConstants {
+    mat4 model;
+    uint materialIndex;
+    uint frameIndex;
+} draw;
+
+// Vertex data from input buffers, pipeline fetches only the locations declared here
+// (quantized positions arrive in [0, 1], model matrix of the draw maps them back)
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
 layout(location = 2) in vec2 inUv;
 
+// Compiled into vert_color.spv only, so other variants do not fetch the color stream
+#ifdef USE_VERTEX_COLOR
+layout(location = 1) in vec3 inColor;
+#endif
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
 
+// Must match depth pre-pass bit for bit (main pass may test depth with EQUAL)
+invariant gl_Position;
+
 void main() {
-    gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    gl_Position = ubo.frames[draw.frameIndex].viewProjection * (draw.model * vec4(inPosition, 1.0));
+#ifdef USE_VERTEX_COLOR
     fragColor = inColor;
+#else
+    fragColor = vec3(1.0);
+#endif
     fragTexCoord = inUv;
 }
 
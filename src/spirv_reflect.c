@@ -0,0 +1,468 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <spirv_reflect.h>
+#include <log.h>
+
+#define SPIRV_MAGIC 0x07230203
+#define SPIRV_HEADER_WORDS 5
+
+// Instructions read by reflection (SPIR-V specification, section 3.49)
+#define SPIRV_OP_NAME 5
+#define SPIRV_OP_MEMBER_NAME 6
+#define SPIRV_OP_ENTRY_POINT 15
+#define SPIRV_OP_TYPE_INT 21
+#define SPIRV_OP_TYPE_FLOAT 22
+#define SPIRV_OP_TYPE_VECTOR 23
+#define SPIRV_OP_TYPE_MATRIX 24
+#define SPIRV_OP_TYPE_IMAGE 25
+#define SPIRV_OP_TYPE_SAMPLER 26
+#define SPIRV_OP_TYPE_SAMPLED_IMAGE 27
+#define SPIRV_OP_TYPE_ARRAY 28
+#define SPIRV_OP_TYPE_RUNTIME_ARRAY 29
+#define SPIRV_OP_TYPE_STRUCT 30
+#define SPIRV_OP_TYPE_POINTER 32
+#define SPIRV_OP_CONSTANT 43
+#define SPIRV_OP_VARIABLE 59
+#define SPIRV_OP_DECORATE 71
+#define SPIRV_OP_MEMBER_DECORATE 72
+
+#define SPIRV_DECORATION_BLOCK 2
+#define SPIRV_DECORATION_BUFFER_BLOCK 3
+#define SPIRV_DECORATION_ARRAY_STRIDE 6
+#define SPIRV_DECORATION_MATRIX_STRIDE 7
+#define SPIRV_DECORATION_BUILT_IN 11
+#define SPIRV_DECORATION_LOCATION 30
+#define SPIRV_DECORATION_BINDING 33
+#define SPIRV_DECORATION_DESCRIPTOR_SET 34
+#define SPIRV_DECORATION_OFFSET 35
+
+#define SPIRV_STORAGE_UNIFORM_CONSTANT 0
+#define SPIRV_STORAGE_INPUT 1
+#define SPIRV_STORAGE_UNIFORM 2
+#define SPIRV_STORAGE_PUSH_CONSTANT 9
+#define SPIRV_STORAGE_STORAGE_BUFFER 12
+
+#define SPIRV_EXECUTION_MODEL_VERTEX 0
+#define SPIRV_EXECUTION_MODEL_FRAGMENT 4
+#define SPIRV_EXECUTION_MODEL_GL_COMPUTE 5
+
+#define SPIRV_DIM_BUFFER 5
+
+// Image is used with a sampler (1) or as storage image (2)
+#define SPIRV_IMAGE_STORAGE 2
+
+// Decorations of one id
+#define SPIRV_ID_LOCATION 0x1
+#define SPIRV_ID_BINDING 0x2
+#define SPIRV_ID_BUFFER_BLOCK 0x4
+#define SPIRV_ID_BUILT_IN 0x8
+#define SPIRV_ID_USED 0x10
+
+typedef struct {
+    // Offset of the defining instruction in words, 0 for ids not defined by a type,
+    // constant or variable
+    u32 definition;
+
+    u32 flags;
+    u32 location;
+    u32 set;
+    u32 binding;
+    u32 arrayStride;
+} SpirvId;
+
+typedef struct {
+    const u32* words;
+    u32 wordCount;
+    u32 bound;
+    SpirvId* ids;
+} SpirvModule;
+
+static u32 getWordCount(const SpirvModule* module, u32 offset) {
+    return module->words[offset] >> 16;
+}
+
+static u32 getOpcode(const SpirvModule* module, u32 offset) {
+    return module->words[offset] & 0xFFFF;
+}
+
+// Operand `index` of the instruction at `offset` (result type or id is operand 1), 0 when missing
+static u32 getOperand(const SpirvModule* module, u32 offset, u32 index) {
+    return index < getWordCount(module, offset) ? module->words[offset + index] : 0;
+}
+
+// Defining instruction of `id`, 0 for unknown ids
+static u32 getDefinition(const SpirvModule* module, u32 id) {
+    return id < module->bound ? module->ids[id].definition : 0;
+}
+
+// Byte offset and matrix stride of struct member from member decorations
+static void getMemberLayout(const SpirvModule* module, u32 structId, u32 member, u32* offset, u32* matrixStride) {
+    *offset = 0;
+    *matrixStride = 0;
+    for (u32 i = SPIRV_HEADER_WORDS; i < module->wordCount; i += getWordCount(module, i)) {
+        if (
+            getOpcode(module, i) != SPIRV_OP_MEMBER_DECORATE
+            || getOperand(module, i, 1) != structId
+            || getOperand(module, i, 2) != member
+        ) {
+            continue;
+        }
+        if (getOperand(module, i, 3) == SPIRV_DECORATION_OFFSET) {
+            *offset = getOperand(module, i, 4);
+        } else if (getOperand(module, i, 3) == SPIRV_DECORATION_MATRIX_STRIDE) {
+            *matrixStride = getOperand(module, i, 4);
+        }
+    }
+}
+
+// Size in bytes of type as laid out by explicit offsets and strides, `matrixStride` is 0 outside structs
+static u32 getTypeSize(const SpirvModule* module, u32 typeId, u32 matrixStride, u32 depth) {
+    u32 offset = getDefinition(module, typeId);
+    if (offset == 0 || depth > 16) {
+        return 0;
+    }
+
+    switch (getOpcode(module, offset)) {
+        case SPIRV_OP_TYPE_INT:
+        case SPIRV_OP_TYPE_FLOAT:
+            return getOperand(module, offset, 2) / 8;
+        case SPIRV_OP_TYPE_VECTOR:
+            return getOperand(module, offset, 3) * getTypeSize(module, getOperand(module, offset, 2), 0, depth + 1);
+        case SPIRV_OP_TYPE_MATRIX: {
+            u32 columnSize = getTypeSize(module, getOperand(module, offset, 2), 0, depth + 1);
+            return getOperand(module, offset, 3) * (matrixStride != 0 ? matrixStride : columnSize);
+        }
+        case SPIRV_OP_TYPE_ARRAY: {
+            u32 lengthOffset = getDefinition(module, getOperand(module, offset, 3));
+            u32 length = lengthOffset != 0 ? getOperand(module, lengthOffset, 3) : 0;
+            u32 stride = module->ids[typeId].arrayStride;
+            if (stride == 0) {
+                stride = getTypeSize(module, getOperand(module, offset, 2), matrixStride, depth + 1);
+            }
+            return length * stride;
+        }
+        case SPIRV_OP_TYPE_STRUCT: {
+            // Members may be declared out of order, size ends with the furthest one
+            u32 size = 0;
+            for (u32 member = 0; member + 2 < getWordCount(module, offset); member++) {
+                u32 memberOffset, memberMatrixStride;
+                getMemberLayout(module, typeId, member, &memberOffset, &memberMatrixStride);
+                u32 memberSize = getTypeSize(module, getOperand(module, offset, member + 2), memberMatrixStride, depth + 1);
+                if (memberOffset + memberSize > size) {
+                    size = memberOffset + memberSize;
+                }
+            }
+            return size;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Pointee of pointer type, 0 for other types
+static u32 getPointeeType(const SpirvModule* module, u32 pointerTypeId) {
+    u32 offset = getDefinition(module, pointerTypeId);
+    if (offset == 0 || getOpcode(module, offset) != SPIRV_OP_TYPE_POINTER) {
+        return 0;
+    }
+    return getOperand(module, offset, 3);
+}
+
+static b32 reflectInput(const SpirvModule* module, u32 variableId, u32 typeId, SpirvInput* input) {
+    u32 offset = getDefinition(module, typeId);
+    u32 componentCount = 1;
+    if (offset != 0 && getOpcode(module, offset) == SPIRV_OP_TYPE_VECTOR) {
+        componentCount = getOperand(module, offset, 3);
+        offset = getDefinition(module, getOperand(module, offset, 2));
+    }
+    if (offset == 0) {
+        return QQ_FALSE;
+    }
+
+    // Matrices and arrays take several locations, vertex streams here are vectors only
+    SpirvComponentType componentType;
+    if (getOpcode(module, offset) == SPIRV_OP_TYPE_FLOAT) {
+        componentType = SPIRV_COMPONENT_FLOAT;
+    } else if (getOpcode(module, offset) == SPIRV_OP_TYPE_INT) {
+        componentType = getOperand(module, offset, 3) != 0 ? SPIRV_COMPONENT_INT : SPIRV_COMPONENT_UINT;
+    } else {
+        logError("SPIR-V input at location %u is not a scalar or vector", module->ids[variableId].location);
+        return QQ_FALSE;
+    }
+
+    *input = (SpirvInput){
+        .location = module->ids[variableId].location,
+        .componentType = componentType,
+        .componentCount = componentCount,
+        .componentBits = getOperand(module, offset, 2),
+        .isUsed = (module->ids[variableId].flags & SPIRV_ID_USED) != 0
+    };
+    return QQ_TRUE;
+}
+
+static b32 reflectBinding(const SpirvModule* module, u32 variableId, u32 storageClass, u32 typeId, SpirvBinding* binding) {
+    *binding = (SpirvBinding){
+        .set = module->ids[variableId].set,
+        .binding = module->ids[variableId].binding,
+        .count = 1
+    };
+
+    u32 offset = getDefinition(module, typeId);
+    if (offset != 0 && getOpcode(module, offset) == SPIRV_OP_TYPE_ARRAY) {
+        u32 lengthOffset = getDefinition(module, getOperand(module, offset, 3));
+        binding->count = lengthOffset != 0 ? getOperand(module, lengthOffset, 3) : 1;
+        typeId = getOperand(module, offset, 2);
+    } else if (offset != 0 && getOpcode(module, offset) == SPIRV_OP_TYPE_RUNTIME_ARRAY) {
+        binding->count = 0;
+        typeId = getOperand(module, offset, 2);
+    }
+
+    offset = getDefinition(module, typeId);
+    if (offset == 0) {
+        return QQ_FALSE;
+    }
+
+    switch (getOpcode(module, offset)) {
+        case SPIRV_OP_TYPE_SAMPLER:
+            binding->type = SPIRV_DESCRIPTOR_SAMPLER;
+            return QQ_TRUE;
+        case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            binding->type = SPIRV_DESCRIPTOR_COMBINED_IMAGE_SAMPLER;
+            return QQ_TRUE;
+        case SPIRV_OP_TYPE_IMAGE: {
+            b32 isBuffer = getOperand(module, offset, 3) == SPIRV_DIM_BUFFER;
+            if (getOperand(module, offset, 7) == SPIRV_IMAGE_STORAGE) {
+                binding->type = isBuffer == QQ_TRUE ? SPIRV_DESCRIPTOR_STORAGE_TEXEL_BUFFER : SPIRV_DESCRIPTOR_STORAGE_IMAGE;
+            } else {
+                binding->type = isBuffer == QQ_TRUE ? SPIRV_DESCRIPTOR_UNIFORM_TEXEL_BUFFER : SPIRV_DESCRIPTOR_SAMPLED_IMAGE;
+            }
+            return QQ_TRUE;
+        }
+        case SPIRV_OP_TYPE_STRUCT:
+            // Storage buffers are Uniform + BufferBlock before SPIR-V 1.3
+            if (
+                storageClass == SPIRV_STORAGE_STORAGE_BUFFER
+                || (module->ids[typeId].flags & SPIRV_ID_BUFFER_BLOCK) != 0
+            ) {
+                binding->type = SPIRV_DESCRIPTOR_STORAGE_BUFFER;
+            } else {
+                binding->type = SPIRV_DESCRIPTOR_UNIFORM_BUFFER;
+            }
+            return QQ_TRUE;
+        default:
+            return QQ_FALSE;
+    }
+}
+
+// Records definitions and decorations of every id
+static b32 parseModule(SpirvModule* module, SpirvReflection* reflection) {
+    b32 hasEntryPoint = QQ_FALSE;
+
+    for (u32 i = SPIRV_HEADER_WORDS; i < module->wordCount;) {
+        u32 wordCount = getWordCount(module, i);
+        if (wordCount == 0 || i + wordCount > module->wordCount) {
+            logError("SPIR-V instruction at word %u is truncated", i);
+            return QQ_FALSE;
+        }
+
+        u32 opcode = getOpcode(module, i);
+        switch (opcode) {
+            case SPIRV_OP_ENTRY_POINT:
+                if (hasEntryPoint == QQ_TRUE) {
+                    break;
+                }
+                hasEntryPoint = QQ_TRUE;
+                switch (getOperand(module, i, 1)) {
+                    case SPIRV_EXECUTION_MODEL_VERTEX:
+                        reflection->stage = SPIRV_STAGE_VERTEX;
+                        break;
+                    case SPIRV_EXECUTION_MODEL_FRAGMENT:
+                        reflection->stage = SPIRV_STAGE_FRAGMENT;
+                        break;
+                    case SPIRV_EXECUTION_MODEL_GL_COMPUTE:
+                        reflection->stage = SPIRV_STAGE_COMPUTE;
+                        break;
+                    default:
+                        logError("Unsupported SPIR-V execution model %u", getOperand(module, i, 1));
+                        return QQ_FALSE;
+                }
+                break;
+            case SPIRV_OP_TYPE_INT:
+            case SPIRV_OP_TYPE_FLOAT:
+            case SPIRV_OP_TYPE_VECTOR:
+            case SPIRV_OP_TYPE_MATRIX:
+            case SPIRV_OP_TYPE_IMAGE:
+            case SPIRV_OP_TYPE_SAMPLER:
+            case SPIRV_OP_TYPE_SAMPLED_IMAGE:
+            case SPIRV_OP_TYPE_ARRAY:
+            case SPIRV_OP_TYPE_RUNTIME_ARRAY:
+            case SPIRV_OP_TYPE_STRUCT:
+            case SPIRV_OP_TYPE_POINTER:
+                if (wordCount >= 2 && module->words[i + 1] < module->bound) {
+                    module->ids[module->words[i + 1]].definition = i;
+                }
+                break;
+            case SPIRV_OP_CONSTANT:
+            case SPIRV_OP_VARIABLE:
+                // Result id follows result type
+                if (wordCount >= 4 && module->words[i + 2] < module->bound) {
+                    module->ids[module->words[i + 2]].definition = i;
+                }
+                break;
+            case SPIRV_OP_DECORATE: {
+                u32 target = getOperand(module, i, 1);
+                if (target >= module->bound || wordCount < 3) {
+                    break;
+                }
+                SpirvId* id = &module->ids[target];
+                u32 value = getOperand(module, i, 3);
+                switch (getOperand(module, i, 2)) {
+                    case SPIRV_DECORATION_LOCATION:
+                        id->flags |= SPIRV_ID_LOCATION;
+                        id->location = value;
+                        break;
+                    case SPIRV_DECORATION_BINDING:
+                        id->flags |= SPIRV_ID_BINDING;
+                        id->binding = value;
+                        break;
+                    case SPIRV_DECORATION_DESCRIPTOR_SET:
+                        id->set = value;
+                        break;
+                    case SPIRV_DECORATION_BUFFER_BLOCK:
+                        id->flags |= SPIRV_ID_BUFFER_BLOCK;
+                        break;
+                    case SPIRV_DECORATION_BUILT_IN:
+                        id->flags |= SPIRV_ID_BUILT_IN;
+                        break;
+                    case SPIRV_DECORATION_ARRAY_STRIDE:
+                        id->arrayStride = value;
+                        break;
+                }
+                break;
+            }
+        }
+        i += wordCount;
+    }
+
+    if (hasEntryPoint == QQ_FALSE) {
+        logError("SPIR-V module has no entry point");
+        return QQ_FALSE;
+    }
+    return QQ_TRUE;
+}
+
+// Marks variables referenced by any instruction other than debug names, decorations,
+// entry point interface and the variable declaration itself
+static void markUsedIds(SpirvModule* module) {
+    for (u32 i = SPIRV_HEADER_WORDS; i < module->wordCount; i += getWordCount(module, i)) {
+        u32 opcode = getOpcode(module, i);
+        if (
+            opcode == SPIRV_OP_NAME
+            || opcode == SPIRV_OP_MEMBER_NAME
+            || opcode == SPIRV_OP_ENTRY_POINT
+            || opcode == SPIRV_OP_DECORATE
+            || opcode == SPIRV_OP_MEMBER_DECORATE
+            || opcode == SPIRV_OP_VARIABLE
+        ) {
+            continue;
+        }
+
+        // Literal operands may look like ids, which at worst keeps an unused input
+        for (u32 word = 1; word < getWordCount(module, i); word++) {
+            u32 id = module->words[i + word];
+            if (id < module->bound) {
+                module->ids[id].flags |= SPIRV_ID_USED;
+            }
+        }
+    }
+}
+
+b32 spirvReflect(const u32* words, u64 size, SpirvReflection* reflection) {
+    memset(reflection, 0, sizeof(SpirvReflection));
+
+    if (size < SPIRV_HEADER_WORDS * 4 || size % 4 != 0 || words[0] != SPIRV_MAGIC) {
+        logError("Not a SPIR-V module");
+        return QQ_FALSE;
+    }
+
+    SpirvModule module = {
+        .words = words,
+        .wordCount = (u32)(size / 4),
+        .bound = words[3]
+    };
+    module.ids = calloc(module.bound > 0 ? module.bound : 1, sizeof(SpirvId));
+
+    if (parseModule(&module, reflection) == QQ_FALSE) {
+        free(module.ids);
+        return QQ_FALSE;
+    }
+    markUsedIds(&module);
+
+    b32 isValid = QQ_TRUE;
+    for (u32 id = 1; id < module.bound && isValid == QQ_TRUE; id++) {
+        u32 offset = module.ids[id].definition;
+        if (offset == 0 || getOpcode(&module, offset) != SPIRV_OP_VARIABLE) {
+            continue;
+        }
+
+        u32 typeId = getPointeeType(&module, getOperand(&module, offset, 1));
+        u32 storageClass = getOperand(&module, offset, 3);
+        u32 flags = module.ids[id].flags;
+
+        if (
+            storageClass == SPIRV_STORAGE_INPUT
+            && (flags & SPIRV_ID_LOCATION) != 0
+            && (flags & SPIRV_ID_BUILT_IN) == 0
+        ) {
+            if (reflection->inputCount == SPIRV_REFLECT_MAX_INPUTS) {
+                logError("SPIR-V module has more than %u inputs", SPIRV_REFLECT_MAX_INPUTS);
+                isValid = QQ_FALSE;
+            } else if (reflectInput(&module, id, typeId, &reflection->inputs[reflection->inputCount]) == QQ_TRUE) {
+                reflection->inputCount += 1;
+            } else {
+                isValid = QQ_FALSE;
+            }
+        } else if (
+            (
+                storageClass == SPIRV_STORAGE_UNIFORM_CONSTANT
+                || storageClass == SPIRV_STORAGE_UNIFORM
+                || storageClass == SPIRV_STORAGE_STORAGE_BUFFER
+            )
+            && (flags & SPIRV_ID_BINDING) != 0
+        ) {
+            if (reflection->bindingCount == SPIRV_REFLECT_MAX_BINDINGS) {
+                logError("SPIR-V module has more than %u bindings", SPIRV_REFLECT_MAX_BINDINGS);
+                isValid = QQ_FALSE;
+            } else if (reflectBinding(
+                &module,
+                id,
+                storageClass,
+                typeId,
+                &reflection->bindings[reflection->bindingCount]
+            ) == QQ_TRUE) {
+                reflection->bindingCount += 1;
+            } else {
+                logError("Unsupported SPIR-V resource at binding %u", module.ids[id].binding);
+                isValid = QQ_FALSE;
+            }
+        } else if (storageClass == SPIRV_STORAGE_PUSH_CONSTANT) {
+            u32 pushConstantSize = getTypeSize(&module, typeId, 0, 0);
+            if (pushConstantSize > reflection->pushConstantSize) {
+                reflection->pushConstantSize = pushConstantSize;
+            }
+        }
+    }
+
+    free(module.ids);
+    return isValid;
+}
+
+const SpirvInput* spirvFindInput(const SpirvReflection* reflection, u32 location) {
+    for (u32 i = 0; i < reflection->inputCount; i++) {
+        if (reflection->inputs[i].location == location) {
+            return &reflection->inputs[i];
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,119 @@
+#include <stdlib.h>
+
+#include <staging_ring.h>
+
+void stagingRingCreate(StagingRing* ring, u64 capacity, u32 maxSlices) {
+    *ring = (StagingRing){
+        .capacity = capacity,
+        .slices = malloc(sizeof(StagingRingSlice) * maxSlices),
+        .sliceCapacity = maxSlices
+    };
+
+    pthread_mutex_init(&ring->mutex, NULL);
+    pthread_cond_init(&ring->releaseCondition, NULL);
+}
+
+void stagingRingDestroy(StagingRing* ring) {
+    pthread_cond_destroy(&ring->releaseCondition);
+    pthread_mutex_destroy(&ring->mutex);
+    free(ring->slices);
+}
+
+// Finds place for the slice, must be called with mutex held
+static b32 tryAllocate(StagingRing* ring, u64 size, u64 alignment, u64* offset) {
+    if (ring->sliceCount == ring->sliceCapacity) {
+        return QQ_FALSE;
+    }
+
+    // Empty ring restarts from the beginning, so the largest slice always fits eventually
+    if (ring->sliceCount == 0) {
+        ring->head = 0;
+        *offset = 0;
+        return QQ_TRUE;
+    }
+
+    u64 tail = ring->slices[ring->sliceHead].start;
+    u64 alignedHead = (ring->head + alignment - 1) & ~(alignment - 1);
+
+    if (ring->head > tail) {
+        // Free space is [head, capacity) and [0, tail)
+        if (alignedHead + size <= ring->capacity) {
+            *offset = alignedHead;
+            return QQ_TRUE;
+        }
+        if (size <= tail) {
+            *offset = 0;
+            return QQ_TRUE;
+        }
+    } else if (ring->head < tail) {
+        // Free space is [head, tail)
+        if (alignedHead + size <= tail) {
+            *offset = alignedHead;
+            return QQ_TRUE;
+        }
+    }
+
+    // Head caught up with tail, ring is full
+    return QQ_FALSE;
+}
+
+b32 stagingRingAllocate(StagingRing* ring, u64 size, u64 alignment, u64* offset, u32* sliceId) {
+    if (size > ring->capacity) {
+        return QQ_FALSE;
+    }
+
+    pthread_mutex_lock(&ring->mutex);
+
+    b32 hasWaited = QQ_FALSE;
+    while (tryAllocate(ring, size, alignment, offset) == QQ_FALSE) {
+        hasWaited = QQ_TRUE;
+        pthread_cond_wait(&ring->releaseCondition, &ring->mutex);
+    }
+    if (hasWaited == QQ_TRUE) {
+        ring->waitCount += 1;
+    }
+
+    *sliceId = (ring->sliceHead + ring->sliceCount) % ring->sliceCapacity;
+    ring->slices[*sliceId] = (StagingRingSlice){
+        .start = ring->head,
+        .offset = *offset,
+        .size = size,
+        .isReleased = QQ_FALSE
+    };
+    ring->sliceCount += 1;
+
+    // Skipped space (alignment or wrap) stays reserved until the slice is reclaimed
+    ring->used += *offset >= ring->head ? *offset + size - ring->head : ring->capacity - ring->head + size;
+    ring->head = *offset + size;
+    if (ring->used > ring->peakUsed) {
+        ring->peakUsed = ring->used;
+    }
+
+    pthread_mutex_unlock(&ring->mutex);
+
+    return QQ_TRUE;
+}
+
+void stagingRingRelease(StagingRing* ring, u32 sliceId) {
+    pthread_mutex_lock(&ring->mutex);
+
+    ring->slices[sliceId].isReleased = QQ_TRUE;
+
+    // Oldest slices are reclaimed in order, newer released ones wait for them
+    b32 isReclaimed = QQ_FALSE;
+    while (ring->sliceCount > 0 && ring->slices[ring->sliceHead].isReleased == QQ_TRUE) {
+        StagingRingSlice* slice = &ring->slices[ring->sliceHead];
+        ring->used -= slice->offset >= slice->start
+            ? slice->offset + slice->size - slice->start
+            : ring->capacity - slice->start + slice->size;
+        ring->sliceHead = (ring->sliceHead + 1) % ring->sliceCapacity;
+        ring->sliceCount -= 1;
+        isReclaimed = QQ_TRUE;
+    }
+
+    if (isReclaimed == QQ_TRUE) {
+        pthread_cond_broadcast(&ring->releaseCondition);
+    }
+
+    pthread_mutex_unlock(&ring->mutex);
+}
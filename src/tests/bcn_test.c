@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <bcn.h>
+
+/**
+ * BC7 round trip: every block of a synthetic opaque image is encoded at each quality,
+ * decoded back and compared with the source. Slower quality searches a superset of
+ * the candidates of the faster one, so its error must never be higher.
+ */
+
+#define TEST_IMAGE_SIZE 128
+#define TEST_BLOCKS_PER_SIDE (TEST_IMAGE_SIZE / BCN_BLOCK_DIMENSION)
+
+// Deterministic noise, so failures reproduce
+static u32 nextRandom(u32* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 16;
+}
+
+// Gradients, hard edges splitting blocks in two and three regions, and noise
+static void fillTestImage(u8* rgba) {
+    u32 state = 1;
+    for (u32 y = 0; y < TEST_IMAGE_SIZE; y++) {
+        for (u32 x = 0; x < TEST_IMAGE_SIZE; x++) {
+            u8* pixel = &rgba[(y * TEST_IMAGE_SIZE + x) * 4];
+            u32 region = ((x * 7 + y * 3) / 5 + (x * y) / 11) % 3;
+            u32 noise = nextRandom(&state) % 24;
+            pixel[0] = (u8)((region == 0 ? x * 2 : 255 - y) % 232 + noise);
+            pixel[1] = (u8)((region == 1 ? y * 2 : x + y) % 232 + noise);
+            pixel[2] = (u8)((region == 2 ? 200 : (x * y) / 64) % 232 + noise);
+            pixel[3] = 255;
+        }
+    }
+}
+
+static void readBlock(const u8* rgba, u32 blockX, u32 blockY, u8* texels) {
+    for (u32 y = 0; y < BCN_BLOCK_DIMENSION; y++) {
+        const u8* row = &rgba[((blockY * BCN_BLOCK_DIMENSION + y) * TEST_IMAGE_SIZE + blockX * BCN_BLOCK_DIMENSION) * 4];
+        memcpy(&texels[y * BCN_BLOCK_DIMENSION * 4], row, BCN_BLOCK_DIMENSION * 4);
+    }
+}
+
+// Squared error of the decoded block over all channels
+static u64 getBlockError(BcnQuality quality, const u8* texels) {
+    u8 block[16];
+    u8 decoded[16 * 4];
+    bcnEncodeBlock(BCN_FORMAT_BC7, quality, texels, block);
+    bcnDecodeBlock(BCN_FORMAT_BC7, block, decoded);
+
+    u64 error = 0;
+    for (u32 i = 0; i < 16 * 4; i++) {
+        i32 difference = (i32)texels[i] - (i32)decoded[i];
+        error += (u64)(difference * difference);
+    }
+    return error;
+}
+
+int main() {
+    static u8 rgba[TEST_IMAGE_SIZE * TEST_IMAGE_SIZE * 4];
+    fillTestImage(rgba);
+
+    u64 totalErrors[3] = {0, 0, 0};
+    u32 failureCount = 0;
+    for (u32 blockY = 0; blockY < TEST_BLOCKS_PER_SIDE; blockY++) {
+        for (u32 blockX = 0; blockX < TEST_BLOCKS_PER_SIDE; blockX++) {
+            u8 texels[16 * 4];
+            readBlock(rgba, blockX, blockY, texels);
+
+            u64 errors[3];
+            for (u32 quality = BCN_QUALITY_FAST; quality <= BCN_QUALITY_SLOW; quality++) {
+                errors[quality] = getBlockError((BcnQuality)quality, texels);
+                totalErrors[quality] += errors[quality];
+            }
+
+            if (errors[BCN_QUALITY_SLOW] > errors[BCN_QUALITY_NORMAL] || errors[BCN_QUALITY_NORMAL] > errors[BCN_QUALITY_FAST]) {
+                printf(
+                    "[FAIL] Block (%u, %u) error fast: %lu, normal: %lu, slow: %lu\n",
+                    blockX,
+                    blockY,
+                    errors[BCN_QUALITY_FAST],
+                    errors[BCN_QUALITY_NORMAL],
+                    errors[BCN_QUALITY_SLOW]
+                );
+                failureCount += 1;
+            }
+        }
+    }
+
+    printf(
+        "BC7 round trip of %u blocks, total error fast: %lu, normal: %lu, slow: %lu\n",
+        TEST_BLOCKS_PER_SIDE * TEST_BLOCKS_PER_SIDE,
+        totalErrors[BCN_QUALITY_FAST],
+        totalErrors[BCN_QUALITY_NORMAL],
+        totalErrors[BCN_QUALITY_SLOW]
+    );
+    if (failureCount != 0) {
+        printf("[FAIL] %u blocks got worse with higher quality\n", failureCount);
+        return 1;
+    }
+    return 0;
+}
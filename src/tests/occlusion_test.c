@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include <occlusion.h>
+
+/**
+ * Software depth buffer and culler without Vulkan: a wall occluder is rasterized
+ * in front of the camera (looking down -Z), boxes behind, in front of and beside it
+ * are tested against the result.
+ */
+
+#define TEST_BUFFER_WIDTH 320
+#define TEST_BUFFER_HEIGHT 192
+
+static u32 failureCount = 0;
+
+static void check(b32 condition, const char* name) {
+    if (condition == QQ_FALSE) {
+        printf("[FAIL] %s\n", name);
+        failureCount += 1;
+    }
+}
+
+// Column-major perspective with Vulkan [0, 1] depth, camera at origin
+static void makeProjection(f32* matrix) {
+    f32 nearZ = 0.1f;
+    f32 farZ = 100.0f;
+    f32 focal = 1.0f / tanf(0.5f * 1.0471976f);
+    memset(matrix, 0, sizeof(f32) * 16);
+    matrix[0] = focal * (f32)TEST_BUFFER_HEIGHT / (f32)TEST_BUFFER_WIDTH;
+    matrix[5] = focal;
+    matrix[10] = farZ / (nearZ - farZ);
+    matrix[11] = -1.0f;
+    matrix[14] = nearZ * farZ / (nearZ - farZ);
+}
+
+static void makeIdentity(f32* matrix) {
+    memset(matrix, 0, sizeof(f32) * 16);
+    matrix[0] = 1.0f;
+    matrix[5] = 1.0f;
+    matrix[10] = 1.0f;
+    matrix[15] = 1.0f;
+}
+
+// Square wall facing the camera at depth `z`, two triangles
+static const u32 wallIndices[6] = {0, 1, 2, 0, 2, 3};
+static void makeWall(f32 halfSize, f32 z, f32* positions) {
+    f32 corners[4][3] = {
+        {-halfSize, -halfSize, z},
+        { halfSize, -halfSize, z},
+        { halfSize,  halfSize, z},
+        {-halfSize,  halfSize, z}
+    };
+    memcpy(positions, corners, sizeof(corners));
+}
+
+static OcclusionBounds makeBox(f32 x, f32 y, f32 z, f32 halfSize) {
+    return (OcclusionBounds){
+        .min = {x - halfSize, y - halfSize, z - halfSize},
+        .max = {x + halfSize, y + halfSize, z + halfSize}
+    };
+}
+
+static void testEmptyBuffer() {
+    OcclusionBuffer buffer;
+    occlusionBufferCreate(&buffer, TEST_BUFFER_WIDTH, TEST_BUFFER_HEIGHT);
+    occlusionBufferClear(&buffer);
+
+    f32 projection[16];
+    makeProjection(projection);
+    OcclusionBounds box = makeBox(0.0f, 0.0f, -10.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &box), "box is visible in empty buffer");
+
+    // Behind the camera and beside the view
+    OcclusionBounds behind = makeBox(0.0f, 0.0f, 10.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &behind), "box crossing near plane is visible");
+    OcclusionBounds outside = makeBox(100.0f, 0.0f, -10.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &outside) == QQ_FALSE, "box outside of view is culled");
+
+    occlusionBufferDestroy(&buffer);
+}
+
+static void testWall() {
+    OcclusionBuffer buffer;
+    occlusionBufferCreate(&buffer, TEST_BUFFER_WIDTH, TEST_BUFFER_HEIGHT);
+    occlusionBufferClear(&buffer);
+
+    f32 projection[16];
+    makeProjection(projection);
+    f32 wall[4 * 3];
+    makeWall(1.0f, -5.0f, wall);
+    occlusionBufferRenderMesh(&buffer, projection, wall, sizeof(f32) * 3, 4, wallIndices, 6);
+
+    OcclusionBounds hidden = makeBox(0.0f, 0.0f, -20.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &hidden) == QQ_FALSE, "box behind wall is culled");
+
+    OcclusionBounds front = makeBox(0.0f, 0.0f, -3.0f, 0.5f);
+    check(occlusionBufferTestBounds(&buffer, projection, &front), "box in front of wall is visible");
+
+    // Box partly sticking out of the wall silhouette
+    OcclusionBounds side = makeBox(4.0f, 0.0f, -20.0f, 3.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &side), "box beside wall is visible");
+
+    // Box cutting through the wall reaches in front of it
+    OcclusionBounds through = makeBox(0.0f, 0.0f, -5.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &through), "box crossing wall is visible");
+
+    occlusionBufferDestroy(&buffer);
+}
+
+// Closed mesh registered as occluder and object at once must not hide itself
+static void testSelfOcclusion() {
+    OcclusionBuffer buffer;
+    occlusionBufferCreate(&buffer, TEST_BUFFER_WIDTH, TEST_BUFFER_HEIGHT);
+    occlusionBufferClear(&buffer);
+
+    f32 projection[16];
+    makeProjection(projection);
+
+    // Cube of two walls (front and back) is enough to cover its own bounds
+    f32 cube[8 * 3];
+    makeWall(1.0f, -9.0f, &cube[0]);
+    makeWall(1.0f, -11.0f, &cube[12]);
+    u32 indices[12] = {0, 1, 2, 0, 2, 3, 4, 5, 6, 4, 6, 7};
+    occlusionBufferRenderMesh(&buffer, projection, cube, sizeof(f32) * 3, 8, indices, 12);
+
+    OcclusionBounds bounds = makeBox(0.0f, 0.0f, -10.0f, 1.0f);
+    check(occlusionBufferTestBounds(&buffer, projection, &bounds), "occluder does not hide its own bounds");
+
+    occlusionBufferDestroy(&buffer);
+}
+
+static void testCuller() {
+    JobPool pool;
+    jobPoolCreate(&pool, 2);
+
+    OcclusionCuller culler;
+    occlusionCullerCreate(&culler, TEST_BUFFER_WIDTH, TEST_BUFFER_HEIGHT);
+
+    f32 wall[4 * 3];
+    makeWall(1.0f, -5.0f, wall);
+    OcclusionMesh mesh = {
+        .positions = wall,
+        .positionStride = sizeof(f32) * 3,
+        .vertexCount = 4,
+        .indices = wallIndices,
+        .indexCount = 6
+    };
+    makeIdentity(mesh.model);
+    u32 occluder = occlusionCullerAddOccluder(&culler, &mesh);
+
+    // Row of boxes behind the wall, the outer ones stick out of it
+    u32 objectCount = 9;
+    u32 objects[9];
+    for (u32 i = 0; i < objectCount; i++) {
+        OcclusionBounds box = makeBox(((f32)i - 4.0f) * 3.0f, 0.0f, -20.0f, 1.0f);
+        objects[i] = occlusionCullerAddObject(&culler, &box);
+    }
+    check(occlusionCullerIsVisible(&culler, objects[4]), "objects are visible before the first pass");
+
+    f32 projection[16];
+    makeProjection(projection);
+    occlusionCullerKick(&culler, &pool, projection);
+    occlusionCullerWait(&culler, &pool);
+
+    check(occlusionCullerIsVisible(&culler, objects[4]) == QQ_FALSE, "object behind wall is culled");
+    check(occlusionCullerIsVisible(&culler, objects[0]), "object beside wall is visible");
+    check(culler.lastCulledCount > 0 && culler.lastCulledCount < objectCount, "pass culls part of the objects");
+    check(culler.totalPasses == 1 && culler.totalTested == objectCount, "pass stats are counted");
+
+    // Wall moved aside uncovers the middle object
+    f32 model[16];
+    makeIdentity(model);
+    model[12] = 50.0f;
+    occlusionCullerSetOccluderTransform(&culler, occluder, model);
+    occlusionCullerKick(&culler, &pool, projection);
+    occlusionCullerWait(&culler, &pool);
+    check(occlusionCullerIsVisible(&culler, objects[4]), "object is visible once occluder moves away");
+
+    occlusionCullerDestroy(&culler);
+    jobPoolDestroy(&pool);
+}
+
+int main() {
+    testEmptyBuffer();
+    testWall();
+    testSelfOcclusion();
+    testCuller();
+
+    if (failureCount != 0) {
+        printf("[FAIL] %u occlusion checks failed\n", failureCount);
+        return 1;
+    }
+    printf("Occlusion checks passed\n");
+    return 0;
+}
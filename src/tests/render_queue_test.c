@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <render_queue.h>
+
+/**
+ * Render queue without Vulkan: draws of every state combination are pushed in
+ * shuffled order, sorted queue must be ordered by key, keep push order of equal
+ * keys and bind every state exactly once per run of draws sharing it.
+ */
+
+#define TEST_PIPELINE_COUNT 3
+#define TEST_MATERIAL_COUNT 4
+#define TEST_MESH_COUNT 2
+#define TEST_DRAWS_PER_STATE 5
+#define TEST_DRAW_COUNT (TEST_PIPELINE_COUNT * TEST_MATERIAL_COUNT * TEST_MESH_COUNT * TEST_DRAWS_PER_STATE)
+
+static u32 failureCount = 0;
+
+static void check(b32 condition, const char* name) {
+    if (condition == QQ_FALSE) {
+        printf("[FAIL] %s\n", name);
+        failureCount += 1;
+    }
+}
+
+static void testEmptySort() {
+    RenderQueueEntry entries[1] = {{.key = 7, .drawIndex = 0}};
+    RenderQueueEntry scratch[1];
+    renderQueueRadixSort(entries, scratch, 0);
+    renderQueueRadixSort(entries, scratch, 1);
+    check(entries[0].key == 7 && entries[0].drawIndex == 0, "sort of zero or one entry keeps it");
+}
+
+static void testKeyOrder() {
+    // Pass outranks everything, depth only orders draws sharing all state
+    u64 prepass = renderQueueMakeKey(0, 9, 9, 9, 1.0f);
+    u64 opaque = renderQueueMakeKey(1, 0, 0, 0, 0.0f);
+    check(prepass < opaque, "pass is the most significant key part");
+
+    u64 near = renderQueueMakeKey(1, 2, 3, 4, 0.25f);
+    u64 far = renderQueueMakeKey(1, 2, 3, 4, 0.75f);
+    check(near < far, "nearer draw sorts first");
+
+    u64 clamped = renderQueueMakeKey(1, 2, 3, 4, 2.0f);
+    u64 farthest = renderQueueMakeKey(1, 2, 3, 4, 1.0f);
+    check(clamped == farthest, "depth is clamped into [0, 1]");
+}
+
+static void testSortAndChanges() {
+    RenderQueue queue;
+    renderQueueCreate(&queue, 4);
+
+    // Every state combination, draws of one state share two depths so equal keys occur
+    RenderDraw draws[TEST_DRAW_COUNT];
+    u32 drawCount = 0;
+    for (u32 pipeline = 0; pipeline < TEST_PIPELINE_COUNT; pipeline++) {
+        for (u32 material = 0; material < TEST_MATERIAL_COUNT; material++) {
+            for (u32 mesh = 0; mesh < TEST_MESH_COUNT; mesh++) {
+                for (u32 i = 0; i < TEST_DRAWS_PER_STATE; i++) {
+                    draws[drawCount++] = (RenderDraw){
+                        .pass = 1,
+                        .pipeline = pipeline,
+                        .material = material,
+                        .mesh = mesh,
+                        .depth = (i % 2) == 0 ? 0.5f : 0.25f
+                    };
+                }
+            }
+        }
+    }
+
+    srand(1);
+    for (u32 i = drawCount - 1; i > 0; i--) {
+        u32 j = (u32)rand() % (i + 1);
+        RenderDraw draw = draws[i];
+        draws[i] = draws[j];
+        draws[j] = draw;
+    }
+
+    // Queue grows past its initial capacity
+    for (u32 i = 0; i < drawCount; i++) {
+        check(renderQueuePush(&queue, &draws[i]) == i, "push returns draw index");
+    }
+    renderQueueSort(&queue);
+
+    b32 isOrdered = QQ_TRUE;
+    b32 isStable = QQ_TRUE;
+    for (u32 i = 1; i < queue.drawCount; i++) {
+        const RenderQueueEntry* previous = &queue.entries[i - 1];
+        const RenderQueueEntry* entry = &queue.entries[i];
+        if (previous->key > entry->key) {
+            isOrdered = QQ_FALSE;
+        }
+        if (previous->key == entry->key && previous->drawIndex > entry->drawIndex) {
+            isStable = QQ_FALSE;
+        }
+    }
+    check(isOrdered, "sorted keys do not decrease");
+    check(isStable, "equal keys keep push order");
+
+    // Sorted draws reference their own data
+    b32 isMatching = QQ_TRUE;
+    for (u32 i = 0; i < queue.drawCount; i++) {
+        const RenderDraw* draw = renderQueueGetSorted(&queue, i);
+        u64 key = renderQueueMakeKey(draw->pass, draw->pipeline, draw->material, draw->mesh, draw->depth);
+        if (key != queue.entries[i].key) {
+            isMatching = QQ_FALSE;
+        }
+    }
+    check(isMatching, "sorted position maps to its draw");
+
+    // Each state is bound once per run, runs nest pipeline > material > mesh
+    u32 pipelineChanges = 0;
+    u32 materialChanges = 0;
+    u32 meshChanges = 0;
+    for (u32 i = 0; i < queue.drawCount; i++) {
+        u32 changes = renderQueueGetChanges(&queue, i);
+        pipelineChanges += (changes & RENDER_QUEUE_CHANGE_PIPELINE) != 0;
+        materialChanges += (changes & RENDER_QUEUE_CHANGE_MATERIAL) != 0;
+        meshChanges += (changes & RENDER_QUEUE_CHANGE_MESH) != 0;
+    }
+    check(pipelineChanges == TEST_PIPELINE_COUNT, "pipeline is bound once per pipeline");
+    check(materialChanges == TEST_PIPELINE_COUNT * TEST_MATERIAL_COUNT, "material is bound once per pipeline and material");
+    check(
+        meshChanges == TEST_PIPELINE_COUNT * TEST_MATERIAL_COUNT * TEST_MESH_COUNT,
+        "mesh is bound once per state combination"
+    );
+
+    // Reset keeps memory, next frame starts with a full bind again
+    renderQueueReset(&queue);
+    renderQueuePush(&queue, &draws[0]);
+    renderQueueSort(&queue);
+    check(
+        renderQueueGetChanges(&queue, 0) == (RENDER_QUEUE_CHANGE_PIPELINE | RENDER_QUEUE_CHANGE_MATERIAL | RENDER_QUEUE_CHANGE_MESH),
+        "first draw binds all state"
+    );
+
+    renderQueueDestroy(&queue);
+}
+
+int main() {
+    testEmptySort();
+    testKeyOrder();
+    testSortAndChanges();
+
+    if (failureCount != 0) {
+        printf("[FAIL] %u render queue checks failed\n", failureCount);
+        return 1;
+    }
+    printf("Render queue checks passed\n");
+    return 0;
+}
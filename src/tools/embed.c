@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <qq_types.h>
+
+/**
+ * File embedder (qq-embed)
+ *
+ * Writes C source with contents of given files as aligned u32 arrays and table
+ * of them (see embedded.h), which is compiled into the main application.
+ * Words keep byte order of the files, so the build host must match the target.
+ */
+
+// Words per line of generated source
+#define EMBED_WORDS_PER_LINE 8
+
+void printUsage() {
+    printf(
+        "Usage: qq-embed <output.c> [<path>=<file> ...]\n"
+        "  <path>  name the file is looked up by at runtime (e.g. shader/vert.spv)\n"
+        "  <file>  file on disk whose contents are embedded\n"
+    );
+}
+
+// Writes contents of `file` as array `name`, returns size in bytes
+b32 writeFileWords(FILE* output, const char* name, const char* path, u64* size) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        printf("[ERROR] Failed to open %s\n", path);
+        return QQ_FALSE;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (fileSize < 0) {
+        fclose(file);
+        printf("[ERROR] Failed to read %s\n", path);
+        return QQ_FALSE;
+    }
+
+    // Last word is zero padded, empty file still gets one word (C has no empty arrays)
+    u64 wordCount = ((u64)fileSize + 3) / 4;
+    u32* words = calloc(wordCount > 0 ? wordCount : 1, sizeof(u32));
+    size_t readSize = fread(words, 1, fileSize, file);
+    fclose(file);
+    if (readSize != (size_t)fileSize) {
+        free(words);
+        printf("[ERROR] Failed to read %s\n", path);
+        return QQ_FALSE;
+    }
+
+    fprintf(output, "\n// %s\nstatic const u32 %s[] = {", path, name);
+    for (u64 i = 0; i < (wordCount > 0 ? wordCount : 1); i++) {
+        if (i % EMBED_WORDS_PER_LINE == 0) {
+            fprintf(output, "\n   ");
+        }
+        fprintf(output, " 0x%08xu,", words[i]);
+    }
+    fprintf(output, "\n};\n");
+
+    free(words);
+    *size = (u64)fileSize;
+    return QQ_TRUE;
+}
+
+int main(int argc, const char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    const char* outputPath = argv[1];
+    u32 fileCount = (u32)(argc - 2);
+    u64* sizes = calloc(fileCount > 0 ? fileCount : 1, sizeof(u64));
+
+    // Written into temporary file, so failed run does not leave source which looks complete
+    char temporaryPath[1024];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp", outputPath);
+    FILE* output = fopen(temporaryPath, "w");
+    if (output == NULL) {
+        printf("[ERROR] Failed to create %s\n", temporaryPath);
+        free(sizes);
+        return 1;
+    }
+
+    fprintf(output, "// Generated by qq-embed, do not edit\n\n#include <embedded.h>\n");
+
+    for (u32 i = 0; i < fileCount; i++) {
+        const char* argument = argv[i + 2];
+        const char* separator = strchr(argument, '=');
+        if (separator == NULL) {
+            printf("[ERROR] Expected <path>=<file>: %s\n", argument);
+            printUsage();
+            fclose(output);
+            remove(temporaryPath);
+            free(sizes);
+            return 1;
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "embeddedFile%u", i);
+        if (writeFileWords(output, name, separator + 1, &sizes[i]) == QQ_FALSE) {
+            fclose(output);
+            remove(temporaryPath);
+            free(sizes);
+            return 1;
+        }
+    }
+
+    // Table keeps one terminating entry, so it is never empty
+    fprintf(output, "\nconst EmbeddedFile embeddedFiles[] = {\n");
+    for (u32 i = 0; i < fileCount; i++) {
+        const char* argument = argv[i + 2];
+        i32 pathLength = (i32)(strchr(argument, '=') - argument);
+        fprintf(
+            output,
+            "    {.path = \"%.*s\", .words = embeddedFile%u, .size = %luu},\n",
+            pathLength,
+            argument,
+            i,
+            sizes[i]
+        );
+    }
+    fprintf(output, "    {.path = NULL, .words = NULL, .size = 0}\n};\n");
+    fprintf(output, "\nconst u32 embeddedFileCount = %u;\n", fileCount);
+
+    fclose(output);
+    free(sizes);
+
+    if (rename(temporaryPath, outputPath) != 0) {
+        printf("[ERROR] Failed to write %s\n", outputPath);
+        remove(temporaryPath);
+        return 1;
+    }
+    printf("Embedded %u files into %s\n", fileCount, outputPath);
+    return 0;
+}
@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <qq_types.h>
+#include <qq_time.h>
+#include <jobs.h>
+#include <bcn.h>
+#include <ktx2.h>
+#include <mipmap.h>
+#include <virtual_texture.h>
+
+/**
+ * Offline texture converter (qq-texconv)
+ *
+ * Loads PNG (or anything stb_image reads), builds mip chain on the CPU,
+ * encodes every level to BCn across worker threads (or keeps RGBA8) and writes
+ * KTX2 container that main application uploads without any runtime conversion.
+ * With --virtual, writes RGBA8 pages of the chain for virtual texturing instead.
+ */
+
+typedef struct {
+    const char* inputPath;
+    const char* outputPath;
+    BcnFormat format;
+    b32 isUncompressed; // Pre-baked RGBA8 mips only
+    b32 isVirtual; // Tiled pages (.qvt)
+    BcnQuality quality;
+    b32 isSrgb;
+    b32 generateMips;
+    u32 threadCount;
+    u32 benchIterations;
+} TexconvOptions;
+
+void printUsage() {
+    printf(
+        "Usage: qq-texconv <input.png> <output.ktx2> [options]\n"
+        "  --format bc1|bc3|bc5|bc7|rgba8  output format (default: bc7)\n"
+        "  --quality 0|1|2           encoder effort, fast/normal/slow (default: 1)\n"
+        "  --linear                  treat color as linear instead of sRGB\n"
+        "  --threads N               worker threads (default: cores - 1)\n"
+        "  --no-mips                 write only the base level\n"
+        "  --bench N                 encode N times and report throughput\n"
+        "  --virtual                 write virtual texture pages (.qvt), resized to power of two\n"
+    );
+}
+
+b32 parseFormat(const char* name, BcnFormat* format) {
+    if (strcmp(name, "bc1") == 0) {
+        *format = BCN_FORMAT_BC1;
+    } else if (strcmp(name, "bc3") == 0) {
+        *format = BCN_FORMAT_BC3;
+    } else if (strcmp(name, "bc5") == 0) {
+        *format = BCN_FORMAT_BC5;
+    } else if (strcmp(name, "bc7") == 0) {
+        *format = BCN_FORMAT_BC7;
+    } else {
+        return QQ_FALSE;
+    }
+    return QQ_TRUE;
+}
+
+const char* getFormatName(BcnFormat format) {
+    switch (format) {
+        case BCN_FORMAT_BC1: return "BC1";
+        case BCN_FORMAT_BC3: return "BC3";
+        case BCN_FORMAT_BC5: return "BC5";
+        case BCN_FORMAT_BC7: return "BC7";
+    }
+    return "?";
+}
+
+// BC1 encoder always emits 4-color blocks, so output is stored as opaque RGB
+u32 getKtx2Format(BcnFormat format, b32 isSrgb) {
+    switch (format) {
+        case BCN_FORMAT_BC1:
+            return isSrgb == QQ_TRUE ? KTX2_FORMAT_BC1_RGB_SRGB : KTX2_FORMAT_BC1_RGB_UNORM;
+        case BCN_FORMAT_BC3:
+            return isSrgb == QQ_TRUE ? KTX2_FORMAT_BC3_SRGB : KTX2_FORMAT_BC3_UNORM;
+        case BCN_FORMAT_BC5:
+            return KTX2_FORMAT_BC5_UNORM;
+        case BCN_FORMAT_BC7:
+            return isSrgb == QQ_TRUE ? KTX2_FORMAT_BC7_SRGB : KTX2_FORMAT_BC7_UNORM;
+    }
+    return 0;
+}
+
+// Error over channels the format actually stores (BC5 keeps only red and green)
+f64 computeMeanSquaredError(BcnFormat format, const u8* original, const u8* decoded, u64 texelCount) {
+    u32 channelCount = format == BCN_FORMAT_BC5 ? 2 : (format == BCN_FORMAT_BC1 ? 3 : 4);
+    f64 sum = 0.0;
+    for (u64 i = 0; i < texelCount; i++) {
+        for (u32 channel = 0; channel < channelCount; channel++) {
+            f64 difference = (f64)original[i * 4 + channel] - (f64)decoded[i * 4 + channel];
+            sum += difference * difference;
+        }
+    }
+    return sum / (f64)(texelCount * channelCount);
+}
+
+b32 parseOptions(i32 argc, const char** argv, TexconvOptions* options) {
+    *options = (TexconvOptions){
+        .format = BCN_FORMAT_BC7,
+        .isUncompressed = QQ_FALSE,
+        .quality = BCN_QUALITY_NORMAL,
+        .isSrgb = QQ_TRUE,
+        .generateMips = QQ_TRUE,
+        .threadCount = 0,
+        .benchIterations = 0,
+    };
+
+    u32 positionalCount = 0;
+    for (i32 i = 1; i < argc; i++) {
+        b32 hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--format") == 0 && hasValue) {
+            options->isUncompressed = strcmp(argv[++i], "rgba8") == 0;
+            if (options->isUncompressed == QQ_FALSE && parseFormat(argv[i], &options->format) == QQ_FALSE) {
+                printf("[ERROR] Unknown format: %s\n", argv[i]);
+                return QQ_FALSE;
+            }
+        } else if (strcmp(argv[i], "--quality") == 0 && hasValue) {
+            i32 quality = atoi(argv[++i]);
+            if (quality < BCN_QUALITY_FAST || quality > BCN_QUALITY_SLOW) {
+                printf("[ERROR] Quality must be 0, 1 or 2\n");
+                return QQ_FALSE;
+            }
+            options->quality = (BcnQuality)quality;
+        } else if (strcmp(argv[i], "--linear") == 0) {
+            options->isSrgb = QQ_FALSE;
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            options->threadCount = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-mips") == 0) {
+            options->generateMips = QQ_FALSE;
+        } else if (strcmp(argv[i], "--bench") == 0 && hasValue) {
+            options->benchIterations = (u32)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--virtual") == 0) {
+            options->isVirtual = QQ_TRUE;
+        } else if (argv[i][0] != '-' && positionalCount < 2) {
+            if (positionalCount == 0) {
+                options->inputPath = argv[i];
+            } else {
+                options->outputPath = argv[i];
+            }
+            positionalCount++;
+        } else {
+            printf("[ERROR] Unknown option: %s\n", argv[i]);
+            return QQ_FALSE;
+        }
+    }
+
+    if (positionalCount != 2) {
+        return QQ_FALSE;
+    }
+
+    // Two-channel normal maps are never sRGB encoded
+    if (options->isUncompressed == QQ_FALSE && options->format == BCN_FORMAT_BC5) {
+        options->isSrgb = QQ_FALSE;
+    }
+
+    return QQ_TRUE;
+}
+
+u32 getNextPowerOfTwo(u32 value) {
+    u32 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Bilinear resize of RGBA8 image (in encoded space, good enough for upscaling to power of two)
+u8* resizeImage(const u8* pixels, u32 width, u32 height, u32 newWidth, u32 newHeight) {
+    u8* resized = malloc((u64)newWidth * newHeight * 4);
+    for (u32 y = 0; y < newHeight; y++) {
+        f32 sourceY = ((f32)y + 0.5f) * (f32)height / (f32)newHeight - 0.5f;
+        sourceY = sourceY < 0.0f ? 0.0f : sourceY;
+        u32 y0 = (u32)sourceY;
+        u32 y1 = y0 + 1 < height ? y0 + 1 : y0;
+        f32 fy = sourceY - (f32)y0;
+
+        for (u32 x = 0; x < newWidth; x++) {
+            f32 sourceX = ((f32)x + 0.5f) * (f32)width / (f32)newWidth - 0.5f;
+            sourceX = sourceX < 0.0f ? 0.0f : sourceX;
+            u32 x0 = (u32)sourceX;
+            u32 x1 = x0 + 1 < width ? x0 + 1 : x0;
+            f32 fx = sourceX - (f32)x0;
+
+            for (u32 c = 0; c < 4; c++) {
+                f32 top = pixels[((u64)y0 * width + x0) * 4 + c] * (1.0f - fx) + pixels[((u64)y0 * width + x1) * 4 + c] * fx;
+                f32 bottom = pixels[((u64)y1 * width + x0) * 4 + c] * (1.0f - fx) + pixels[((u64)y1 * width + x1) * 4 + c] * fx;
+                resized[((u64)y * newWidth + x) * 4 + c] = (u8)(top * (1.0f - fy) + bottom * fy + 0.5f);
+            }
+        }
+    }
+    return resized;
+}
+
+// Virtual textures need every level, pages are cut from the whole chain
+int writeVirtualTexture(const TexconvOptions* options, u8* pixels, u32 width, u32 height) {
+    u32 virtualWidth = getNextPowerOfTwo(width);
+    u32 virtualHeight = getNextPowerOfTwo(height);
+    u8* base = pixels;
+    if (virtualWidth != width || virtualHeight != height) {
+        printf("[INFO] Resizing %ux%u to %ux%u\n", width, height, virtualWidth, virtualHeight);
+        base = resizeImage(pixels, width, height, virtualWidth, virtualHeight);
+    }
+
+    u32 levelCount = mipmapGetLevelCount(virtualWidth, virtualHeight);
+    u8* chain = malloc(mipmapGetChainSize(virtualWidth, virtualHeight, levelCount));
+    mipmapGenerateChain(base, virtualWidth, virtualHeight, levelCount, chain, options->isSrgb);
+
+    const u8** levelPixels = malloc(sizeof(u8*) * levelCount);
+    u8* level = chain;
+    for (u32 i = 0; i < levelCount; i++) {
+        levelPixels[i] = level;
+        level += (u64)mipmapGetLevelDimension(virtualWidth, i) * mipmapGetLevelDimension(virtualHeight, i) * 4;
+    }
+
+    printf(
+        "[INFO] Writing %s (%ux%u, %u levels) as virtual texture pages\n",
+        options->inputPath,
+        virtualWidth,
+        virtualHeight,
+        virtualTextureGetLevelCount(virtualWidth, virtualHeight)
+    );
+    b32 isWritten = virtualTextureFileWrite(
+        options->outputPath,
+        (const u8* const*)levelPixels,
+        virtualWidth,
+        virtualHeight,
+        options->isSrgb
+    );
+    if (isWritten == QQ_TRUE) {
+        printf("[INFO] Written %s\n", options->outputPath);
+    }
+
+    if (base != pixels) {
+        free(base);
+    }
+    free(levelPixels);
+    free(chain);
+
+    return isWritten == QQ_TRUE ? 0 : 1;
+}
+
+int main(int argc, const char** argv) {
+    TexconvOptions options;
+    if (parseOptions(argc, argv, &options) == QQ_FALSE) {
+        printUsage();
+        return 1;
+    }
+
+    // Load source image as RGBA8
+    i32 width, height, channels;
+    u8* pixels = stbi_load(options.inputPath, &width, &height, &channels, STBI_rgb_alpha);
+    if (pixels == NULL) {
+        printf("[ERROR] Failed to load %s: %s\n", options.inputPath, stbi_failure_reason());
+        return 1;
+    }
+
+    if (options.isVirtual == QQ_TRUE) {
+        int result = writeVirtualTexture(&options, pixels, width, height);
+        stbi_image_free(pixels);
+        return result;
+    }
+
+    u32 levelCount = options.generateMips == QQ_TRUE ? mipmapGetLevelCount(width, height) : 1;
+
+    // Build RGBA8 mip chain, every level is filtered from the previous one
+    u8** levelPixels = malloc(sizeof(u8*) * levelCount);
+    levelPixels[0] = pixels;
+    for (u32 level = 1; level < levelCount; level++) {
+        u32 previousWidth = mipmapGetLevelDimension(width, level - 1);
+        u32 previousHeight = mipmapGetLevelDimension(height, level - 1);
+        u32 levelWidth = mipmapGetLevelDimension(width, level);
+        u32 levelHeight = mipmapGetLevelDimension(height, level);
+        levelPixels[level] = malloc((u64)levelWidth * levelHeight * 4);
+        mipmapDownsample(
+            levelPixels[level - 1],
+            previousWidth,
+            previousHeight,
+            levelPixels[level],
+            options.isSrgb
+        );
+    }
+
+    // Uncompressed output stores the chain as is
+    if (options.isUncompressed == QQ_TRUE) {
+        u64* rgbaSizes = malloc(sizeof(u64) * levelCount);
+        for (u32 level = 0; level < levelCount; level++) {
+            rgbaSizes[level] = (u64)mipmapGetLevelDimension(width, level) * mipmapGetLevelDimension(height, level) * 4;
+        }
+
+        printf("[INFO] Writing %s (%dx%d, %u levels) as RGBA8\n", options.inputPath, width, height, levelCount);
+        b32 isWritten = ktx2Write(
+            options.outputPath,
+            options.isSrgb == QQ_TRUE ? KTX2_FORMAT_R8G8B8A8_SRGB : KTX2_FORMAT_R8G8B8A8_UNORM,
+            width,
+            height,
+            levelCount,
+            (const u8* const*)levelPixels,
+            rgbaSizes
+        );
+
+        for (u32 level = 1; level < levelCount; level++) {
+            free(levelPixels[level]);
+        }
+        stbi_image_free(pixels);
+        free(levelPixels);
+        free(rgbaSizes);
+
+        return isWritten == QQ_TRUE ? 0 : 1;
+    }
+
+    // Allocate compressed levels
+    u8** levelBlocks = malloc(sizeof(u8*) * levelCount);
+    u64* levelSizes = malloc(sizeof(u64) * levelCount);
+    u64 totalTexelCount = 0;
+    for (u32 level = 0; level < levelCount; level++) {
+        u32 levelWidth = mipmapGetLevelDimension(width, level);
+        u32 levelHeight = mipmapGetLevelDimension(height, level);
+        levelSizes[level] = bcnGetLevelSize(options.format, levelWidth, levelHeight);
+        levelBlocks[level] = malloc(levelSizes[level]);
+        totalTexelCount += (u64)levelWidth * levelHeight;
+    }
+
+    JobPool pool;
+    jobPoolCreate(&pool, options.threadCount);
+
+    printf(
+        "[INFO] Encoding %s (%dx%d, %u levels) to %s (%s, quality %u) on %u threads\n",
+        options.inputPath,
+        width,
+        height,
+        levelCount,
+        getFormatName(options.format),
+        options.isSrgb == QQ_TRUE ? "sRGB" : "linear",
+        options.quality,
+        pool.threadCount
+    );
+
+    // Encode whole chain (repeatedly when benchmarking)
+    u32 iterationCount = options.benchIterations > 0 ? options.benchIterations : 1;
+    f64 bestTimeMs = 0.0;
+    f64 totalTimeMs = 0.0;
+    for (u32 iteration = 0; iteration < iterationCount; iteration++) {
+        f64 startTime = getTimeMs();
+        for (u32 level = 0; level < levelCount; level++) {
+            bcnEncodeImage(
+                options.format,
+                options.quality,
+                levelPixels[level],
+                mipmapGetLevelDimension(width, level),
+                mipmapGetLevelDimension(height, level),
+                levelBlocks[level],
+                &pool
+            );
+        }
+        f64 timeMs = getTimeMs() - startTime;
+
+        totalTimeMs += timeMs;
+        if (iteration == 0 || timeMs < bestTimeMs) {
+            bestTimeMs = timeMs;
+        }
+    }
+
+    jobPoolDestroy(&pool);
+
+    f64 megapixels = (f64)totalTexelCount / 1000000.0;
+    printf(
+        "[INFO] Encode: best %.2f ms (%.2f MP/s), avg %.2f ms (%.2f MP/s) over %u run(s)\n",
+        bestTimeMs,
+        megapixels / (bestTimeMs / 1000.0),
+        totalTimeMs / iterationCount,
+        megapixels / (totalTimeMs / iterationCount / 1000.0),
+        iterationCount
+    );
+
+    // Report quality of every level by decoding it back
+    for (u32 level = 0; level < levelCount; level++) {
+        u32 levelWidth = mipmapGetLevelDimension(width, level);
+        u32 levelHeight = mipmapGetLevelDimension(height, level);
+        u64 texelCount = (u64)levelWidth * levelHeight;
+
+        u8* decoded = malloc(texelCount * 4);
+        bcnDecodeImage(options.format, levelBlocks[level], levelWidth, levelHeight, decoded);
+        f64 meanSquaredError = computeMeanSquaredError(options.format, levelPixels[level], decoded, texelCount);
+        free(decoded);
+
+        f64 psnr = meanSquaredError > 0.0 ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : INFINITY;
+        printf(
+            "[INFO]   level %u: %ux%u, %lu bytes, RMSE %.3f, PSNR %.2f dB\n",
+            level,
+            levelWidth,
+            levelHeight,
+            levelSizes[level],
+            sqrt(meanSquaredError),
+            psnr
+        );
+    }
+
+    b32 isWritten = ktx2Write(
+        options.outputPath,
+        getKtx2Format(options.format, options.isSrgb),
+        width,
+        height,
+        levelCount,
+        (const u8* const*)levelBlocks,
+        levelSizes
+    );
+    if (isWritten == QQ_TRUE) {
+        printf("[INFO] Written %s\n", options.outputPath);
+    }
+
+    // Cleanup
+    for (u32 level = 0; level < levelCount; level++) {
+        free(levelBlocks[level]);
+        if (level > 0) {
+            free(levelPixels[level]);
+        }
+    }
+    stbi_image_free(pixels);
+    free(levelBlocks);
+    free(levelSizes);
+    free(levelPixels);
+
+    return isWritten == QQ_TRUE ? 0 : 1;
+}
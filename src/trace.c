@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <trace.h>
+#include <qq_time.h>
+
+static _Atomic b32 isTraceEnabled = QQ_FALSE;
+static _Atomic(TraceThreadBuffer*) threadBuffers = NULL;
+static _Atomic u32 nextThreadId = 1;
+static u64 traceOriginNs = 0;
+
+static _Thread_local TraceThreadBuffer* threadBuffer = NULL;
+
+// Kept apart from the ring, so naming a thread does not allocate it
+static _Thread_local char threadName[TRACE_THREAD_NAME_LENGTH];
+
+// Allocates ring of calling thread and pushes it to the front of the list
+static TraceThreadBuffer* getThreadBuffer() {
+    if (threadBuffer != NULL) {
+        return threadBuffer;
+    }
+
+    TraceThreadBuffer* buffer = calloc(1, sizeof(TraceThreadBuffer));
+    buffer->threadId = atomic_fetch_add(&nextThreadId, 1);
+    if (threadName[0] != '\0') {
+        snprintf(buffer->threadName, TRACE_THREAD_NAME_LENGTH, "%s", threadName);
+    } else {
+        snprintf(buffer->threadName, TRACE_THREAD_NAME_LENGTH, "thread %u", buffer->threadId);
+    }
+
+    TraceThreadBuffer* head = atomic_load(&threadBuffers);
+    do {
+        buffer->next = head;
+    } while (atomic_compare_exchange_weak(&threadBuffers, &head, buffer) == 0);
+
+    threadBuffer = buffer;
+    return buffer;
+}
+
+void traceInit() {
+    traceOriginNs = getTimeNs();
+}
+
+void traceShutdown() {
+    atomic_store(&isTraceEnabled, QQ_FALSE);
+
+    TraceThreadBuffer* buffer = atomic_exchange(&threadBuffers, NULL);
+    while (buffer != NULL) {
+        TraceThreadBuffer* next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    threadBuffer = NULL;
+}
+
+void traceSetEnabled(b32 isEnabled) {
+    atomic_store(&isTraceEnabled, isEnabled);
+}
+
+b32 traceIsEnabled() {
+    return atomic_load_explicit(&isTraceEnabled, memory_order_relaxed);
+}
+
+void traceSetThreadName(const char* name) {
+    snprintf(threadName, TRACE_THREAD_NAME_LENGTH, "%s", name);
+    if (threadBuffer != NULL) {
+        snprintf(threadBuffer->threadName, TRACE_THREAD_NAME_LENGTH, "%s", name);
+    }
+}
+
+u64 traceBegin() {
+    if (atomic_load_explicit(&isTraceEnabled, memory_order_relaxed) == QQ_FALSE) {
+        return 0;
+    }
+    return getTimeNs();
+}
+
+void traceEnd(const char* name, u64 startNs) {
+    if (startNs == 0) {
+        return;
+    }
+
+    u64 endNs = getTimeNs();
+    TraceThreadBuffer* buffer = getThreadBuffer();
+
+    // Event is complete before the index publishes it
+    u64 index = atomic_load_explicit(&buffer->writeIndex, memory_order_relaxed);
+    buffer->events[index % TRACE_RING_CAPACITY] = (TraceEvent){
+        .name = name,
+        .startNs = startNs,
+        .durationNs = endNs - startNs
+    };
+    atomic_store_explicit(&buffer->writeIndex, index + 1, memory_order_release);
+}
+
+b32 traceWriteFile(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return QQ_FALSE;
+    }
+
+    TraceEvent* events = malloc(sizeof(TraceEvent) * TRACE_RING_CAPACITY);
+    b32 isFirst = QQ_TRUE;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+    for (TraceThreadBuffer* buffer = atomic_load(&threadBuffers); buffer != NULL; buffer = buffer->next) {
+        fprintf(
+            file,
+            "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+            isFirst == QQ_TRUE ? "" : ",",
+            buffer->threadId,
+            buffer->threadName
+        );
+        isFirst = QQ_FALSE;
+
+        // Owner keeps recording meanwhile, so events it may have overwritten during the copy
+        // (and the one it may be writing right now) are dropped
+        u64 endIndex = atomic_load_explicit(&buffer->writeIndex, memory_order_acquire);
+        u64 copyIndex = endIndex > TRACE_RING_CAPACITY ? endIndex - TRACE_RING_CAPACITY : 0;
+        for (u64 i = copyIndex; i < endIndex; i++) {
+            events[i - copyIndex] = buffer->events[i % TRACE_RING_CAPACITY];
+        }
+        u64 writtenIndex = atomic_load_explicit(&buffer->writeIndex, memory_order_acquire) + 1;
+        u64 validIndex = writtenIndex > TRACE_RING_CAPACITY ? writtenIndex - TRACE_RING_CAPACITY : 0;
+
+        for (u64 i = validIndex > copyIndex ? validIndex : copyIndex; i < endIndex; i++) {
+            const TraceEvent* event = &events[i - copyIndex];
+            fprintf(
+                file,
+                ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                event->name,
+                buffer->threadId,
+                (f64)(event->startNs - traceOriginNs) / 1000.0,
+                (f64)event->durationNs / 1000.0
+            );
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    free(events);
+    fclose(file);
+    return QQ_TRUE;
+}
@@ -0,0 +1,370 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <virtual_texture.h>
+#include <log.h>
+
+// Magic, version, width, height, level count, page size, page border, sRGB flag
+#define VIRTUAL_TEXTURE_HEADER_SIZE 32
+#define VIRTUAL_TEXTURE_VERSION 1
+
+static const u8 virtualTextureMagic[4] = {'Q', 'Q', 'V', 'T'};
+
+// File is little endian, same as KTX2
+static u32 readU32(const u8* data) {
+    return (u32)data[0]
+        | ((u32)data[1] << 8)
+        | ((u32)data[2] << 16)
+        | ((u32)data[3] << 24);
+}
+
+static void writeU32(u8* data, u32 value) {
+    data[0] = (u8)value;
+    data[1] = (u8)(value >> 8);
+    data[2] = (u8)(value >> 16);
+    data[3] = (u8)(value >> 24);
+}
+
+static b32 isPowerOfTwo(u32 value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static u32 getLevelDimension(u32 baseDimension, u32 level) {
+    u32 dimension = baseDimension >> level;
+    return dimension != 0 ? dimension : 1;
+}
+
+static u32 getPageCount(u32 levelDimension) {
+    return (levelDimension + VIRTUAL_TEXTURE_PAGE_SIZE - 1) / VIRTUAL_TEXTURE_PAGE_SIZE;
+}
+
+// Page offsets of every level, returns size of the whole file
+static u64 layoutFile(VirtualTextureFile* file) {
+    u64 offset = VIRTUAL_TEXTURE_HEADER_SIZE;
+    for (u32 level = 0; level < file->levelCount; level++) {
+        file->pageCountsX[level] = getPageCount(getLevelDimension(file->width, level));
+        file->pageCountsY[level] = getPageCount(getLevelDimension(file->height, level));
+        file->levelOffsets[level] = offset;
+        offset += (u64)file->pageCountsX[level] * file->pageCountsY[level] * VIRTUAL_TEXTURE_PAGE_BYTES;
+    }
+    return offset;
+}
+
+u32 virtualTextureGetLevelCount(u32 width, u32 height) {
+    u32 size = width > height ? width : height;
+    u32 levelCount = 1;
+    while (size > VIRTUAL_TEXTURE_PAGE_SIZE) {
+        size >>= 1;
+        levelCount += 1;
+    }
+    return levelCount;
+}
+
+// Copies page with border, texture repeats (same as the sampler), which also fills
+// pages of levels smaller than a page
+static void extractPage(const u8* pixels, u32 width, u32 height, u32 pageX, u32 pageY, u8* texels) {
+    for (u32 y = 0; y < VIRTUAL_TEXTURE_PAGE_SLOT_SIZE; y++) {
+        i64 sourceY = (i64)pageY * VIRTUAL_TEXTURE_PAGE_SIZE + y - VIRTUAL_TEXTURE_PAGE_BORDER;
+        u32 wrappedY = (u32)(((sourceY % height) + height) % height);
+        const u8* row = &pixels[(u64)wrappedY * width * 4];
+
+        for (u32 x = 0; x < VIRTUAL_TEXTURE_PAGE_SLOT_SIZE; x++) {
+            i64 sourceX = (i64)pageX * VIRTUAL_TEXTURE_PAGE_SIZE + x - VIRTUAL_TEXTURE_PAGE_BORDER;
+            u32 wrappedX = (u32)(((sourceX % width) + width) % width);
+            memcpy(&texels[((u64)y * VIRTUAL_TEXTURE_PAGE_SLOT_SIZE + x) * 4], &row[(u64)wrappedX * 4], 4);
+        }
+    }
+}
+
+b32 virtualTextureFileWrite(
+    const char* path,
+    const u8* const* levelPixels,
+    u32 width,
+    u32 height,
+    b32 isSrgb
+) {
+    if (isPowerOfTwo(width) == QQ_FALSE || isPowerOfTwo(height) == QQ_FALSE) {
+        logError("Virtual texture must have power of two dimensions (%ux%u)", width, height);
+        return QQ_FALSE;
+    }
+
+    FILE* output = fopen(path, "wb");
+    if (output == NULL) {
+        logError("Failed to open %s for writing", path);
+        return QQ_FALSE;
+    }
+
+    VirtualTextureFile layout = {
+        .width = width,
+        .height = height,
+        .levelCount = virtualTextureGetLevelCount(width, height)
+    };
+    layoutFile(&layout);
+
+    u8 header[VIRTUAL_TEXTURE_HEADER_SIZE];
+    memcpy(header, virtualTextureMagic, sizeof(virtualTextureMagic));
+    writeU32(header + 4, VIRTUAL_TEXTURE_VERSION);
+    writeU32(header + 8, width);
+    writeU32(header + 12, height);
+    writeU32(header + 16, layout.levelCount);
+    writeU32(header + 20, VIRTUAL_TEXTURE_PAGE_SIZE);
+    writeU32(header + 24, VIRTUAL_TEXTURE_PAGE_BORDER);
+    writeU32(header + 28, isSrgb == QQ_TRUE ? 1 : 0);
+    b32 isWritten = fwrite(header, sizeof(header), 1, output) == 1;
+
+    // Pages are written in the order they are laid out, level by level, row-major
+    u8* texels = malloc(VIRTUAL_TEXTURE_PAGE_BYTES);
+    for (u32 level = 0; isWritten == QQ_TRUE && level < layout.levelCount; level++) {
+        u32 levelWidth = getLevelDimension(width, level);
+        u32 levelHeight = getLevelDimension(height, level);
+        for (u32 y = 0; isWritten == QQ_TRUE && y < layout.pageCountsY[level]; y++) {
+            for (u32 x = 0; isWritten == QQ_TRUE && x < layout.pageCountsX[level]; x++) {
+                extractPage(levelPixels[level], levelWidth, levelHeight, x, y, texels);
+                isWritten = fwrite(texels, VIRTUAL_TEXTURE_PAGE_BYTES, 1, output) == 1;
+            }
+        }
+    }
+    free(texels);
+
+    if (fclose(output) != 0 || isWritten == QQ_FALSE) {
+        logError("Failed to write %s", path);
+        return QQ_FALSE;
+    }
+
+    return QQ_TRUE;
+}
+
+b32 virtualTextureFileOpen(const char* path, VirtualTextureFile* file) {
+    i32 descriptor = open(path, O_RDONLY);
+    if (descriptor < 0) {
+        logError("Failed to open virtual texture %s", path);
+        return QQ_FALSE;
+    }
+
+    u8 header[VIRTUAL_TEXTURE_HEADER_SIZE];
+    if (
+        pread(descriptor, header, sizeof(header), 0) != sizeof(header)
+        || memcmp(header, virtualTextureMagic, sizeof(virtualTextureMagic)) != 0
+        || readU32(header + 4) != VIRTUAL_TEXTURE_VERSION
+    ) {
+        logError("%s is not a virtual texture", path);
+        close(descriptor);
+        return QQ_FALSE;
+    }
+
+    *file = (VirtualTextureFile){
+        .descriptor = descriptor,
+        .width = readU32(header + 8),
+        .height = readU32(header + 12),
+        .levelCount = readU32(header + 16),
+        .isSrgb = readU32(header + 28) != 0
+    };
+
+    // Page layout is baked into shaders, so it must match exactly
+    if (
+        isPowerOfTwo(file->width) == QQ_FALSE
+        || isPowerOfTwo(file->height) == QQ_FALSE
+        || file->levelCount != virtualTextureGetLevelCount(file->width, file->height)
+        || file->levelCount > VIRTUAL_TEXTURE_MAX_LEVELS
+        || readU32(header + 20) != VIRTUAL_TEXTURE_PAGE_SIZE
+        || readU32(header + 24) != VIRTUAL_TEXTURE_PAGE_BORDER
+    ) {
+        logError("Virtual texture %s has unsupported layout", path);
+        close(descriptor);
+        return QQ_FALSE;
+    }
+
+    u64 expectedSize = layoutFile(file);
+    off_t fileSize = lseek(descriptor, 0, SEEK_END);
+    if (fileSize < 0 || (u64)fileSize < expectedSize) {
+        logError("Virtual texture %s is truncated", path);
+        close(descriptor);
+        return QQ_FALSE;
+    }
+
+    return QQ_TRUE;
+}
+
+void virtualTextureFileClose(VirtualTextureFile* file) {
+    close(file->descriptor);
+    file->descriptor = -1;
+}
+
+b32 virtualTextureFileReadPage(const VirtualTextureFile* file, u32 level, u32 x, u32 y, u8* texels) {
+    u64 offset = file->levelOffsets[level]
+        + ((u64)y * file->pageCountsX[level] + x) * VIRTUAL_TEXTURE_PAGE_BYTES;
+    return pread(file->descriptor, texels, VIRTUAL_TEXTURE_PAGE_BYTES, offset) == VIRTUAL_TEXTURE_PAGE_BYTES;
+}
+
+b32 virtualTextureCreate(VirtualTexture* texture, const char* path) {
+    *texture = (VirtualTexture){0};
+    if (virtualTextureFileOpen(path, &texture->file) == QQ_FALSE) {
+        return QQ_FALSE;
+    }
+
+    // Last level is a single page
+    texture->pageTableSize = 1u << (texture->file.levelCount - 1);
+    for (u32 level = 0; level < texture->file.levelCount; level++) {
+        u32 levelSize = texture->pageTableSize >> level;
+        texture->pageTableLevelOffsets[level] = texture->pageCount;
+        texture->pageCount += levelSize * levelSize;
+    }
+
+    texture->pageSlots = malloc(sizeof(u32) * texture->pageCount);
+    texture->pageTable = calloc(texture->pageCount, sizeof(u32));
+    for (u32 page = 0; page < texture->pageCount; page++) {
+        texture->pageSlots[page] = VIRTUAL_PAGE_NOT_RESIDENT;
+    }
+    texture->isPageTableDirty = QQ_TRUE;
+
+    return QQ_TRUE;
+}
+
+void virtualTextureDestroy(VirtualTexture* texture) {
+    virtualTextureFileClose(&texture->file);
+    free(texture->pageSlots);
+    free(texture->pageTable);
+}
+
+b32 virtualTextureGetPageLocation(const VirtualTexture* texture, u32 page, u32* level, u32* x, u32* y) {
+    u32 pageLevel = texture->file.levelCount - 1;
+    while (pageLevel > 0 && page < texture->pageTableLevelOffsets[pageLevel]) {
+        pageLevel -= 1;
+    }
+
+    u32 levelSize = texture->pageTableSize >> pageLevel;
+    u32 levelPage = page - texture->pageTableLevelOffsets[pageLevel];
+    *level = pageLevel;
+    *x = levelPage % levelSize;
+    *y = levelPage / levelSize;
+
+    // Page table is square, stored pages may not cover it
+    return *x < texture->file.pageCountsX[pageLevel] && *y < texture->file.pageCountsY[pageLevel];
+}
+
+void virtualTextureUpdatePageTable(VirtualTexture* texture, const VirtualPageCache* cache) {
+    // Coarse levels first, so missing pages can copy entry of their parent
+    for (i32 level = (i32)texture->file.levelCount - 1; level >= 0; level--) {
+        u32 levelSize = texture->pageTableSize >> level;
+        u32* entries = &texture->pageTable[texture->pageTableLevelOffsets[level]];
+        const u32* slots = &texture->pageSlots[texture->pageTableLevelOffsets[level]];
+        const u32* parentEntries = level + 1 < (i32)texture->file.levelCount
+            ? &texture->pageTable[texture->pageTableLevelOffsets[level + 1]]
+            : NULL;
+
+        for (u32 y = 0; y < levelSize; y++) {
+            for (u32 x = 0; x < levelSize; x++) {
+                u32 slot = slots[y * levelSize + x];
+                if (slot < VIRTUAL_PAGE_LOADING) {
+                    entries[y * levelSize + x] = (slot % cache->slotsPerSide)
+                        | ((slot / cache->slotsPerSide) << 8)
+                        | ((u32)level << 16)
+                        | (255u << 24);
+                } else if (parentEntries != NULL) {
+                    entries[y * levelSize + x] = parentEntries[(y >> 1) * (levelSize >> 1) + (x >> 1)];
+                } else {
+                    entries[y * levelSize + x] = 0;
+                }
+            }
+        }
+    }
+}
+
+void virtualPageCacheCreate(VirtualPageCache* cache, u32 slotsPerSide) {
+    *cache = (VirtualPageCache){
+        .slotsPerSide = slotsPerSide,
+        .slotCount = slotsPerSide * slotsPerSide,
+        .head = U32_MAX,
+        .tail = U32_MAX
+    };
+    cache->slots = calloc(cache->slotCount, sizeof(VirtualPageSlot));
+    cache->freeCount = cache->slotCount;
+}
+
+void virtualPageCacheDestroy(VirtualPageCache* cache) {
+    free(cache->slots);
+    cache->slots = NULL;
+}
+
+static void unlinkSlot(VirtualPageCache* cache, u32 slot) {
+    VirtualPageSlot* entry = &cache->slots[slot];
+    if (entry->previous != U32_MAX) {
+        cache->slots[entry->previous].next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+    if (entry->next != U32_MAX) {
+        cache->slots[entry->next].previous = entry->previous;
+    } else {
+        cache->tail = entry->previous;
+    }
+}
+
+static void linkSlotAtHead(VirtualPageCache* cache, u32 slot) {
+    VirtualPageSlot* entry = &cache->slots[slot];
+    entry->previous = U32_MAX;
+    entry->next = cache->head;
+    if (cache->head != U32_MAX) {
+        cache->slots[cache->head].previous = slot;
+    } else {
+        cache->tail = slot;
+    }
+    cache->head = slot;
+}
+
+void virtualPageCacheTouch(VirtualPageCache* cache, u32 slot, u64 frame) {
+    VirtualPageSlot* entry = &cache->slots[slot];
+    entry->lastUsedFrame = frame;
+    if (entry->isPinned == QQ_TRUE || cache->head == slot) {
+        return;
+    }
+    unlinkSlot(cache, slot);
+    linkSlotAtHead(cache, slot);
+}
+
+u32 virtualPageCacheAllocate(
+    VirtualPageCache* cache,
+    u32 texture,
+    u32 page,
+    u64 frame,
+    b32 isPinned,
+    u32* evictedTexture,
+    u32* evictedPage
+) {
+    *evictedTexture = U32_MAX;
+    *evictedPage = U32_MAX;
+
+    u32 slot;
+    if (cache->freeCount > 0) {
+        slot = cache->slotCount - cache->freeCount;
+        cache->freeCount -= 1;
+    } else {
+        // Pages visible this frame are never evicted, cache is too small for the view then
+        slot = cache->tail;
+        if (slot == U32_MAX || cache->slots[slot].lastUsedFrame >= frame) {
+            return U32_MAX;
+        }
+        unlinkSlot(cache, slot);
+        *evictedTexture = cache->slots[slot].texture;
+        *evictedPage = cache->slots[slot].page;
+        cache->evictionCount += 1;
+    }
+
+    cache->slots[slot] = (VirtualPageSlot){
+        .texture = texture,
+        .page = page,
+        .lastUsedFrame = frame,
+        .previous = U32_MAX,
+        .next = U32_MAX,
+        .isUsed = QQ_TRUE,
+        .isPinned = isPinned
+    };
+    if (isPinned == QQ_FALSE) {
+        linkSlotAtHead(cache, slot);
+    }
+
+    return slot;
+}